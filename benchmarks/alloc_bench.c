@@ -0,0 +1,71 @@
+#include "bench.h"
+
+#include "../src/core/log.h"
+#include "../src/core/memory.h"
+
+#include <stdlib.h>
+
+/*
+ * Allocates small objects from one bump allocator until it holds hundreds
+ * of MB and reports allocations/sec for every 32MB of it, which should stay
+ * flat however many blocks the allocator has. The allocator is then cleared
+ * and filled again from its retired blocks.
+ *
+ * Usage: alloc_bench [MB] [object size]
+ */
+
+#define SEGMENT_SIZE MB(32)
+
+static size_t count_blocks(cord_bump_t *bump) {
+    size_t count = 0;
+    for (cord_bump_t *it = bump; it; it = it->next) {
+        count++;
+    }
+    return count;
+}
+
+static void fill(cord_bump_t *bump,
+                 const char *pass,
+                 size_t total,
+                 size_t object_size) {
+    size_t per_segment = SEGMENT_SIZE / object_size;
+    size_t check = 0;
+
+    for (size_t filled = 0; filled < total; filled += SEGMENT_SIZE) {
+        double start = bench_now();
+        for (size_t i = 0; i < per_segment; i++) {
+            u8 *memory = balloc(bump, object_size);
+            memory[0] = (u8)i;
+            check += memory[0];
+        }
+        double elapsed = bench_now() - start;
+
+        char name[64];
+        snprintf(name,
+                 sizeof(name),
+                 "%s %4zu-%4zuMB (%zu blocks)",
+                 pass,
+                 filled / MB(1),
+                 (filled + SEGMENT_SIZE) / MB(1),
+                 count_blocks(bump));
+        bench_report(name, per_segment, elapsed);
+    }
+    printf("%-40s (check %zu)\n", "", check);
+}
+
+int main(int argc, char **argv) {
+    global_logger_init();
+
+    size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+    size_t total = MB(megabytes);
+    size_t object_size = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+
+    cord_bump_t *bump = cord_bump_create();
+    fill(bump, "grow", total, object_size);
+
+    cord_bump_clear(bump);
+    fill(bump, "reuse", total, object_size);
+
+    cord_bump_destroy(bump);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Minimal helpers shared by the benchmark programs
+ */
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline void
+bench_report(const char *name, size_t iterations, double seconds) {
+    printf("%-40s %12zu ops %10.3f s %14.1f ops/s\n",
+           name,
+           iterations,
+           seconds,
+           (double)iterations / seconds);
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "bench.h"
+
+#include "../src/core/log.h"
+#include "../src/discord/cache.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Fills a cache with the members of one synthetic guild, sent in chunks of
+ * 1000 like GUILD_MEMBERS_CHUNK does, and reports the heap the cache takes
+ * per member. A quarter of the members have a nickname, most of them
+ * unique, and members share a handful of role sets.
+ *
+ * Usage: cache_bench [members]
+ */
+
+#define CHUNK_MEMBERS 1000
+#define MEMBER_JSON_SIZE 160
+
+static const char *role_sets[] = {
+    "",
+    "\"1100000000000000001\"",
+    "\"1100000000000000001\",\"1100000000000000002\"",
+    "\"1100000000000000003\",\"1100000000000000001\","
+    "\"1100000000000000004\"",
+};
+
+static size_t heap_used(void) {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static size_t write_member(char *json, size_t index) {
+    u64 user_id = 81384788765712384ull + index * 4194304ull;
+    const char *roles = role_sets[index % 10 < 4   ? 0
+                                  : index % 10 < 7 ? 1
+                                  : index % 10 < 9 ? 2
+                                                   : 3];
+    char nick[32] = "null";
+    if (index % 4 == 0) {
+        snprintf(nick, sizeof(nick), "\"member %zu\"", index % 3 ? index : 0);
+    }
+    return (size_t)snprintf(json,
+                            MEMBER_JSON_SIZE,
+                            "{\"user\":{\"id\":\"%llu\"},\"nick\":%s,"
+                            "\"roles\":[%s]},",
+                            (unsigned long long)user_id,
+                            nick,
+                            roles);
+}
+
+int main(int argc, char **argv) {
+    global_logger_init();
+
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    char *chunk = malloc(CHUNK_MEMBERS * MEMBER_JSON_SIZE + 64);
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+    if (!chunk || !allocator) {
+        return 1;
+    }
+
+    cord_cache_config_t config = {0};
+    config.types[CORD_CACHE_MEMBERS].policy = CORD_CACHE_FULL;
+
+    size_t heap_before = heap_used();
+    cord_cache_t *cache = cord_cache_create(config);
+    if (!cache) {
+        return 1;
+    }
+
+    double start = bench_now();
+    for (size_t first = 0; first < count; first += CHUNK_MEMBERS) {
+        size_t length = (size_t)sprintf(
+            chunk, "{\"guild_id\":\"81384788765712384\",\"members\":[");
+        for (size_t i = first; i < first + CHUNK_MEMBERS && i < count; i++) {
+            length += write_member(chunk + length, i);
+        }
+        strcpy(chunk + length - 1, "]}");
+
+        cord_json_reader_t reader = {0};
+        cord_json_reader_init(
+            &reader, (cord_str_t){chunk, (ssize_t)length + 1}, allocator);
+        cord_cache_apply(cache, GATEWAY_EVENT_GUILD_MEMBERS_CHUNK, &reader);
+        cord_bump_clear(allocator);
+    }
+    bench_report("cache members", count, bench_now() - start);
+
+    size_t heap = heap_used() - heap_before;
+    printf("%zu members cached, %zu bytes of heap, %.1f bytes per member\n",
+           (size_t)cord_cache_count(cache, CORD_CACHE_MEMBERS),
+           heap,
+           (double)heap / (double)count);
+
+    cord_cached_member_t member = {0};
+    size_t found = 0;
+    start = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        u64 user_id = 81384788765712384ull + i * 4194304ull;
+        found += cord_cache_get_member(
+            cache, 81384788765712384ull, user_id, &member);
+    }
+    bench_report("get member", found, bench_now() - start);
+
+    cord_cache_destroy(cache);
+    cord_bump_destroy(allocator);
+    free(chunk);
+    return found == count ? 0 : 1;
+}
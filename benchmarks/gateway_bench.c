@@ -0,0 +1,420 @@
+#include "bench.h"
+
+#include "../src/core/log.h"
+#include "../src/core/memory.h"
+#include "../src/discord/client.h"
+#include "../src/discord/compression.h"
+#include "../src/discord/events.h"
+#include "../src/discord/message_view.h"
+#include "../src/discord/serialization.h"
+#include "../src/discord/shard.h"
+
+#include <jansson.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/*
+ * Replays a captured stream of gateway frames (one JSON frame per line)
+ * through the client's dispatch pipeline and reports frames/sec and heap
+ * allocations per frame. The reader pipeline decodes MESSAGE_CREATE and
+ * GUILD_CREATE into entities, then reads messages through a view that
+ * only decodes what a typical bot looks at: the content, the channel and
+ * the author id. Next to it runs the jansson pipeline it replaced, which built a tree per frame and deep copied the event data
+ * twice. The frames are also replayed as a zlib-stream, the way the gateway
+ * sends them with transport compression, and without handlers, which drops
+ * them before parsing. Last the frames are replayed on every shard of 1 to
+ * 8 shards, each on its own thread, which should scale with the cores.
+ *
+ * Usage: gateway_bench [frames.jsonl] [rounds]
+ */
+
+#ifndef GATEWAY_FRAMES_PATH
+#define GATEWAY_FRAMES_PATH "data/gateway_frames.jsonl"
+#endif
+
+#define MAX_FRAMES 4096
+
+typedef struct frame_t {
+    const char *data;
+    size_t length;
+} frame_t;
+
+// Shards count from several threads
+static atomic_size_t num_allocations = 0;
+static atomic_size_t num_handled = 0;
+
+#ifdef __GLIBC__
+// Count every heap allocation, including the ones of the bump allocators
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+    num_allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    num_allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    num_allocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+// Decode the event like a real handler would
+static void bench_handler(cord_client_t *client,
+                          cord_json_reader_t *data,
+                          cord_str_t event) {
+    cord_bump_t *allocator = client->temporary_allocator;
+    cord_serialize_result_t result = {0};
+
+    if (cord_str_equals_cstring(event, "MESSAGE_CREATE")) {
+        result = cord_message_serialize(data, cord_json_next(data), allocator);
+    } else {
+        result = cord_guild_serialize(data, cord_json_next(data), allocator);
+    }
+
+    if (result.obj) {
+        num_handled++;
+    }
+}
+
+static void view_handler(cord_client_t *client,
+                         cord_json_reader_t *data,
+                         cord_str_t event) {
+    if (!cord_str_equals_cstring(event, "MESSAGE_CREATE")) {
+        bench_handler(client, data, event);
+        return;
+    }
+
+    cord_message_view_t view = {0};
+    if (cord_message_view_init(&view, data, client->temporary_allocator) &&
+        cord_message_get_channel_id(&view) &&
+        cord_message_get_author_id(&view)) {
+        num_handled += cord_message_get_content(&view).length >= 0;
+    }
+}
+
+// What the handlers did with the jansson tree
+static void legacy_handler(json_t *data) {
+    json_t *id = json_object_get(data, "id");
+    json_t *content = json_object_get(data, "content");
+    if (json_is_string(id) && (!content || json_is_string(content))) {
+        num_handled++;
+    }
+}
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = malloc((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    if (data) {
+        data[size] = '\0';
+        *length = (size_t)size;
+    }
+    return data;
+}
+
+static size_t split_frames(char *data, size_t length, frame_t *frames) {
+    size_t count = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i <= length && count < MAX_FRAMES; i++) {
+        if (i == length || data[i] == '\n') {
+            if (i > begin) {
+                frames[count++] = (frame_t){data + begin, i - begin};
+            }
+            begin = i + 1;
+        }
+    }
+    return count;
+}
+
+// The pipeline before the streaming reader
+static void legacy_handle_frame(frame_t frame) {
+    json_error_t err = {0};
+    json_t *root = json_loadb(frame.data, frame.length, 0, &err);
+    if (!root) {
+        return;
+    }
+
+    json_t *t = json_object_get(root, PAYLOAD_KEY_EVENT);
+    char *event = strdup(json_string_value(t));
+    json_t *d = json_deep_copy(json_object_get(root, PAYLOAD_KEY_DATA));
+    json_decref(root);
+
+    json_t *data = json_deep_copy(d);
+    json_decref(d);
+    legacy_handler(data);
+    json_decref(data);
+    free(event);
+}
+
+// Compress the frames into one stream with a sync flush after each frame
+static frame_t *compress_frames(frame_t *frames, size_t num_frames) {
+    z_stream stream = {0};
+    deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+
+    frame_t *compressed = calloc(num_frames, sizeof(frame_t));
+    size_t raw_bytes = 0;
+    size_t compressed_bytes = 0;
+    for (size_t i = 0; i < num_frames; i++) {
+        size_t capacity = deflateBound(&stream, frames[i].length) + 16;
+        char *data = malloc(capacity);
+
+        stream.next_in = (Bytef *)frames[i].data;
+        stream.avail_in = (uInt)frames[i].length;
+        stream.next_out = (Bytef *)data;
+        stream.avail_out = (uInt)capacity;
+        deflate(&stream, Z_SYNC_FLUSH);
+
+        compressed[i] = (frame_t){data, capacity - stream.avail_out};
+        raw_bytes += frames[i].length;
+        compressed_bytes += compressed[i].length;
+    }
+    deflateEnd(&stream);
+
+    printf("zlib-stream: %zu bytes, %zu compressed (%.1f%%)\n",
+           raw_bytes,
+           compressed_bytes,
+           100.0 * (double)compressed_bytes / (double)raw_bytes);
+    return compressed;
+}
+
+static void run_compressed(cord_client_t *client,
+                           frame_t *frames,
+                           size_t num_frames,
+                           size_t rounds) {
+    frame_t *compressed = compress_frames(frames, num_frames);
+    num_allocations = 0;
+    num_handled = 0;
+
+    double elapsed = 0;
+    for (size_t round = 0; round < rounds; round++) {
+        // Every round is a new connection, so a new stream
+        cord_bump_t *allocator = cord_bump_create_with_size(MB(1));
+        cord_inflate_t inflater = {0};
+        cord_inflate_init(&inflater, allocator);
+
+        double start = bench_now();
+        for (size_t i = 0; i < num_frames; i++) {
+            cord_str_t message = {0};
+            if (cord_inflate_message(&inflater,
+                                     compressed[i].data,
+                                     compressed[i].length,
+                                     &message) == CORD_INFLATE_MESSAGE) {
+                cord_client_handle_frame(
+                    client, message.data, (size_t)message.length);
+            }
+        }
+        elapsed += bench_now() - start;
+
+        cord_inflate_destroy(&inflater);
+        cord_bump_destroy(allocator);
+    }
+
+    size_t total = num_frames * rounds;
+    bench_report("reader (zlib-stream)", total, elapsed);
+    printf("%-40s %12.1f allocations/frame (%zu handled)\n",
+           "",
+           (double)num_allocations / (double)total,
+           num_handled);
+
+    for (size_t i = 0; i < num_frames; i++) {
+        free((char *)compressed[i].data);
+    }
+    free(compressed);
+}
+
+static frame_t *shard_frames = NULL;
+static size_t shard_num_frames = 0;
+static size_t shard_rounds = 0;
+
+// Replaces the connection of a shard, which replays the frames instead
+static i32 replay_shard(cord_client_t *client) {
+    client->sequence = -1;
+    client->temporary_allocator = cord_bump_create_with_size(KB(64));
+
+    for (size_t round = 0; round < shard_rounds; round++) {
+        for (size_t i = 0; i < shard_num_frames; i++) {
+            cord_client_handle_frame(
+                client, shard_frames[i].data, shard_frames[i].length);
+        }
+    }
+    return 0;
+}
+
+static void run_sharded(frame_t *frames,
+                        size_t num_frames,
+                        size_t rounds,
+                        i32 shard_count) {
+    shard_frames = frames;
+    shard_num_frames = num_frames;
+    shard_rounds = rounds;
+    num_handled = 0;
+
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+    cord_shards_t *shards = cord_shards_create(allocator, shard_count, 1);
+    if (!shards) {
+        cord_bump_destroy(allocator);
+        return;
+    }
+    shards->run = replay_shard;
+
+    double start = bench_now();
+    cord_shards_run(shards);
+    double elapsed = bench_now() - start;
+
+    char name[64];
+    snprintf(name, sizeof(name), "reader (%d shards)", shard_count);
+    bench_report(name, num_frames * rounds * (size_t)shard_count, elapsed);
+
+    cord_shards_destroy(shards);
+    cord_bump_destroy(allocator);
+}
+
+#define GATEWAY_EVENT_NAME(name, intents) #name,
+
+static const char *event_names[] = {GATEWAY_EVENTS(GATEWAY_EVENT_NAME)};
+
+// The linear scan the perfect hash replaced
+static const char *linear_lookup(cord_str_t event) {
+    for (size_t i = 0; i < GATEWAY_EVENT_COUNT; i++) {
+        if (cord_str_equals_cstring(event, event_names[i])) {
+            return event_names[i];
+        }
+    }
+    return NULL;
+}
+
+static void run_event_lookup(size_t rounds, bool linear) {
+    cord_str_t names[GATEWAY_EVENT_COUNT];
+    for (size_t i = 0; i < GATEWAY_EVENT_COUNT; i++) {
+        names[i] = cstr(event_names[i]);
+    }
+
+    size_t found = 0;
+    double start = bench_now();
+    for (size_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < GATEWAY_EVENT_COUNT; i++) {
+            if (linear) {
+                found += linear_lookup(names[i]) != NULL;
+            } else {
+                found += get_gateway_event_from_str(names[i]) != NULL;
+            }
+        }
+    }
+    double elapsed = bench_now() - start;
+
+    bench_report(linear ? "event lookup (linear scan)"
+                        : "event lookup (perfect hash)",
+                 found,
+                 elapsed);
+}
+
+static void run(const char *name,
+                cord_client_t *client,
+                frame_t *frames,
+                size_t num_frames,
+                size_t rounds,
+                bool legacy) {
+    num_allocations = 0;
+    num_handled = 0;
+
+    double start = bench_now();
+    for (size_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < num_frames; i++) {
+            if (legacy) {
+                legacy_handle_frame(frames[i]);
+            } else {
+                cord_client_handle_frame(
+                    client, frames[i].data, frames[i].length);
+            }
+        }
+    }
+    double elapsed = bench_now() - start;
+
+    size_t total = num_frames * rounds;
+    bench_report(name, total, elapsed);
+    printf("%-40s %12.1f allocations/frame (%zu handled)\n",
+           "",
+           (double)num_allocations / (double)total,
+           num_handled);
+}
+
+int main(int argc, char **argv) {
+    global_logger_init();
+
+    const char *path = argc > 1 ? argv[1] : GATEWAY_FRAMES_PATH;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 200;
+
+    size_t length = 0;
+    char *data = read_file(path, &length);
+    if (!data) {
+        fprintf(stderr, "Failed to read frames from %s\n", path);
+        return 1;
+    }
+
+    static frame_t frames[MAX_FRAMES];
+    size_t num_frames = split_frames(data, length, frames);
+    printf("%zu frames, %zu bytes, %zu rounds\n", num_frames, length, rounds);
+
+    get_gateway_event(GATEWAY_EVENT_MESSAGE_CREATE)->handler = bench_handler;
+    get_gateway_event(GATEWAY_EVENT_GUILD_CREATE)->handler = bench_handler;
+
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+    cord_client_t *client = balloc(allocator, sizeof(cord_client_t));
+    memset(client, 0, sizeof(cord_client_t));
+    client->sequence = -1;
+    client->temporary_allocator = cord_bump_create_with_size(KB(64));
+
+    run("jansson (tree + 2 deep copies)",
+        client,
+        frames,
+        num_frames,
+        rounds,
+        true);
+    run("reader (decode entities)", client, frames, num_frames, rounds, false);
+    get_gateway_event(GATEWAY_EVENT_MESSAGE_CREATE)->handler = view_handler;
+    run("reader (message view)", client, frames, num_frames, rounds, false);
+    get_gateway_event(GATEWAY_EVENT_MESSAGE_CREATE)->handler = bench_handler;
+
+    run_compressed(client, frames, num_frames, rounds);
+
+    // Nothing handles the events, so frames are dropped after "t" and "s"
+    get_gateway_event(GATEWAY_EVENT_MESSAGE_CREATE)->handler = NULL;
+    get_gateway_event(GATEWAY_EVENT_GUILD_CREATE)->handler = NULL;
+    run("reader (no handlers)", client, frames, num_frames, rounds, false);
+
+    run_event_lookup(rounds * 200, true);
+    run_event_lookup(rounds * 200, false);
+
+    get_gateway_event(GATEWAY_EVENT_MESSAGE_CREATE)->handler = bench_handler;
+    get_gateway_event(GATEWAY_EVENT_GUILD_CREATE)->handler = bench_handler;
+    setenv("CORD_APPLICATION_TOKEN", "bench", 0);
+    for (i32 shard_count = 1; shard_count <= 8; shard_count *= 2) {
+        run_sharded(frames, num_frames, rounds, shard_count);
+    }
+
+    cord_bump_destroy(client->temporary_allocator);
+    cord_bump_destroy(allocator);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include "../src/core/hashmap.h"
+#include "../src/core/log.h"
+#include "../src/core/snowflake.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Puts count snowflake-like keys in a hash map, then looks all of them up,
+ * looks up as many keys that are not in it and removes them all. The map
+ * starts small so that puts include every rehash on the way. The same ids
+ * are then put and looked up as integers in a u64 map.
+ *
+ * Usage: hashmap_bench [count]
+ */
+
+#define KEY_SIZE 24
+
+static void *create_value(cord_bump_t *allocator) {
+    return balloc(allocator, sizeof(u64));
+}
+
+static cord_str_t key_of(char *keys, size_t index) {
+    char *key = keys + index * KEY_SIZE;
+    return (cord_str_t){key, (ssize_t)strlen(key)};
+}
+
+int main(int argc, char **argv) {
+    global_logger_init();
+
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    char *keys = malloc(count * 2 * KEY_SIZE);
+    if (!keys) {
+        return 1;
+    }
+
+    // The second half are misses
+    for (size_t i = 0; i < count * 2; i++) {
+        u64 id = 81384788765712384ull + i * 4194304ull + i % 7;
+        snprintf(keys + i * KEY_SIZE, KEY_SIZE, "%llu", (unsigned long long)id);
+    }
+
+    cord_bump_t *allocator = cord_bump_create_with_size(MB(1));
+    cord_hashmap_t *map = cord_hashmap_create(allocator, create_value);
+
+    double start = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        u64 *value = cord_hashmap_put(map, key_of(keys, i));
+        *value = i;
+    }
+    bench_report("put", count, bench_now() - start);
+
+    size_t check = 0;
+    start = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        u64 *value = cord_hashmap_get(map, key_of(keys, i));
+        check += *value;
+    }
+    bench_report("get hit", count, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = count; i < count * 2; i++) {
+        check += cord_hashmap_get(map, key_of(keys, i)) != NULL;
+    }
+    bench_report("get miss", count, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        check += cord_hashmap_remove(map, key_of(keys, i));
+    }
+    bench_report("remove", count, bench_now() - start);
+    printf("%-40s (check %zu, %zu slots)\n", "", check, map->capacity);
+
+    cord_u64_map_t *ids = cord_u64_map_create(allocator, 0);
+    start = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        cord_snowflake_t id = cord_snowflake_parse(key_of(keys, i));
+        cord_u64_map_put(ids, id, keys + i * KEY_SIZE);
+    }
+    bench_report("u64 put (parsing ids)", count, bench_now() - start);
+
+    cord_snowflake_t *parsed = malloc(count * 2 * sizeof(cord_snowflake_t));
+    for (size_t i = 0; parsed && i < count * 2; i++) {
+        parsed[i] = cord_snowflake_parse(key_of(keys, i));
+    }
+
+    start = bench_now();
+    for (size_t i = 0; parsed && i < count; i++) {
+        check += cord_u64_map_get(ids, parsed[i]) != NULL;
+    }
+    bench_report("u64 get hit", count, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = count; parsed && i < count * 2; i++) {
+        check += cord_u64_map_get(ids, parsed[i]) != NULL;
+    }
+    bench_report("u64 get miss", count, bench_now() - start);
+    printf("%-40s (check %zu, %zu slots)\n", "", check, ids->capacity);
+
+    free(parsed);
+
+    cord_bump_destroy(allocator);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#define _GNU_SOURCE
+
+#include "bench.h"
+
+#include "../src/core/log.h"
+#include "../src/http/http.h"
+
+#include <arpa/inet.h>
+#include <curl/curl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Compares requests/sec of the pooled http client against the previous
+ * request path (curl_easy_reset and a new header list on every request),
+ * using a local keep-alive HTTP server as a stand-in for the Discord API.
+ */
+
+#define NUM_REQUESTS 20000
+
+static const char response[] = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/json\r\n"
+                               "Content-Length: 2\r\n"
+                               "\r\n"
+                               "{}";
+
+static void serve_connection(int fd) {
+    char buffer[8192];
+    size_t used = 0;
+
+    for (;;) {
+        ssize_t n = read(fd, buffer + used, sizeof(buffer) - used);
+        if (n <= 0) {
+            break;
+        }
+        used += (size_t)n;
+
+        // Answer every complete request header in the buffer
+        char *end = NULL;
+        while ((end = memmem(buffer, used, "\r\n\r\n", 4))) {
+            size_t consumed = (size_t)(end - buffer) + 4;
+            if (write(fd, response, sizeof(response) - 1) < 0) {
+                return;
+            }
+            memmove(buffer, buffer + consumed, used - consumed);
+            used -= consumed;
+        }
+    }
+    close(fd);
+}
+
+static pid_t start_server(int *port) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 128) < 0) {
+        perror("server");
+        exit(1);
+    }
+
+    socklen_t length = sizeof(addr);
+    getsockname(listener, (struct sockaddr *)&addr, &length);
+    *port = ntohs(addr.sin_port);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGCHLD, SIG_IGN);
+        for (;;) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd < 0) {
+                continue;
+            }
+            if (fork() == 0) {
+                close(listener);
+                serve_connection(fd);
+                _exit(0);
+            }
+            close(fd);
+        }
+    }
+    close(listener);
+    return pid;
+}
+
+static size_t discard_cb(void *data, size_t size, size_t nmemb, void *ud) {
+    (void)data;
+    (void)ud;
+    return size * nmemb;
+}
+
+// The request path before handles were pooled
+static void legacy_request(CURL *curl, const char *url) {
+    curl_easy_reset(curl);
+    struct curl_slist *headers = discord_api_headers("benchmark-token");
+    curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_cb);
+    curl_easy_perform(curl);
+    curl_slist_free_all(headers);
+}
+
+int main(void) {
+    global_logger_init();
+
+    int port = 0;
+    pid_t server = start_server(&port);
+
+    char url[64] = {0};
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/api/v10/users/@me", port);
+
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+    cord_http_client_t *client =
+        cord_http_client_create(allocator, "benchmark-token");
+
+    CURL *legacy = curl_easy_init();
+    double start = bench_now();
+    for (size_t i = 0; i < NUM_REQUESTS; i++) {
+        legacy_request(legacy, url);
+    }
+    bench_report("legacy (reset + headers per request)",
+                 NUM_REQUESTS,
+                 bench_now() - start);
+    curl_easy_cleanup(legacy);
+
+    start = bench_now();
+    for (size_t i = 0; i < NUM_REQUESTS; i++) {
+        cord_http_result_t result = cord_http_get(client, allocator, cstr(url));
+        free(result.body);
+    }
+    bench_report("pooled handles", NUM_REQUESTS, bench_now() - start);
+
+    cord_http_client_destroy(client);
+    cord_bump_destroy(allocator);
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    return 0;
+}
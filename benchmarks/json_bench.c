@@ -0,0 +1,236 @@
+#include "bench.h"
+
+#include "../src/core/json_index.h"
+#include "../src/core/json_reader.h"
+#include "../src/core/log.h"
+#include "../src/core/memory.h"
+#include "../src/core/simd.h"
+#include "../src/discord/serialization.h"
+
+#include <jansson.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Parses synthetic GUILD_CREATE payloads of 1MB and 10MB, which is the size
+ * of the event for large guilds, and reports throughput for:
+ *  - jansson building a tree of the whole payload
+ *  - the structural index alone, per instruction set
+ *  - the reader skipping the payload, scanning byte by byte and indexed
+ *  - decoding the guild entity, which skips members, roles and channels
+ *  - decoding it into one allocator cleared every round, the way the client
+ *    reuses its allocators between events
+ *
+ * Usage: json_bench [rounds]
+ */
+
+#define MEMBER                                                                 \
+    "{\"user\": {\"id\": \"%zu\", \"username\": \"member \\\"%zu\\\"\", "      \
+    "\"discriminator\": \"0001\", \"avatar\": "                                \
+    "\"8342729096ea3675442027381ff50dfe\", \"bot\": false}, "                  \
+    "\"nick\": null, \"roles\": [\"41771983423143936\", "                      \
+    "\"41771983423143937\"], \"joined_at\": "                                  \
+    "\"2015-04-26T06:26:56.936000+00:00\", \"deaf\": false, "                  \
+    "\"mute\": false}"
+
+#define ROLE                                                                   \
+    "{\"id\": \"%zu\", \"name\": \"role %zu\", \"color\": 3447003, "           \
+    "\"hoist\": true, \"position\": %zu, \"permissions\": \"66321471\", "      \
+    "\"managed\": false, \"mentionable\": false}"
+
+#define CHANNEL                                                                \
+    "{\"id\": \"%zu\", \"type\": 0, \"name\": \"channel-%zu\", "               \
+    "\"position\": %zu, \"topic\": \"24/7 chat about {things} [and] "          \
+    "stuff\\n\", \"nsfw\": false, \"permission_overwrites\": []}"
+
+typedef struct payload_t {
+    char *data;
+    size_t length;
+} payload_t;
+
+static payload_t generate_guild(size_t target) {
+    size_t capacity = target + KB(4);
+    char *data = malloc(capacity);
+    size_t used = (size_t)snprintf(
+        data,
+        capacity,
+        "{\"id\": \"197038439483310086\", \"name\": \"Large guild\", "
+        "\"icon\": \"f64c482b807da4f539cff778d174971c\", \"splash\": null, "
+        "\"discovery_splash\": null, \"member_count\": 0, \"roles\": [");
+
+    for (size_t i = 0; i < 250; i++) {
+        used += (size_t)snprintf(
+            data + used, capacity - used, ROLE ",", 1000 + i, i, i);
+    }
+    data[used - 1] = ']';
+    used += (size_t)snprintf(data + used, capacity - used, ", \"channels\": [");
+    for (size_t i = 0; i < 500; i++) {
+        used += (size_t)snprintf(
+            data + used, capacity - used, CHANNEL ",", 5000 + i, i, i);
+    }
+    data[used - 1] = ']';
+
+    used += (size_t)snprintf(data + used, capacity - used, ", \"members\": [");
+    for (size_t i = 0; used + KB(1) < target; i++) {
+        used += (size_t)snprintf(
+            data + used, capacity - used, MEMBER ",", 80351110224678912 + i, i);
+    }
+    data[used - 1] = ']';
+    used += (size_t)snprintf(data + used, capacity - used, "}");
+
+    return (payload_t){data, used};
+}
+
+static void report(const char *name,
+                   payload_t payload,
+                   size_t rounds,
+                   double elapsed,
+                   size_t check) {
+    bench_report(name, rounds, elapsed);
+    printf("%-40s %12.1f MB/s (check %zu)\n",
+           "",
+           (double)(payload.length * rounds) / elapsed / (double)MB(1),
+           check);
+}
+
+static void bench_jansson(payload_t payload, size_t rounds) {
+    size_t check = 0;
+    double start = bench_now();
+    for (size_t i = 0; i < rounds; i++) {
+        json_error_t error = {0};
+        json_t *root = json_loadb(payload.data, payload.length, 0, &error);
+        check += json_object_size(root);
+        json_decref(root);
+    }
+    report("jansson json_loadb", payload, rounds, bench_now() - start, check);
+}
+
+static void bench_index(payload_t payload,
+                        size_t rounds,
+                        cord_simd_level_t level) {
+    cord_str_t input = {payload.data, (ssize_t)payload.length};
+    size_t check = 0;
+
+    double start = bench_now();
+    for (size_t i = 0; i < rounds; i++) {
+        cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+        cord_json_index_t index = {0};
+        cord_json_index_init(&index, input, allocator, level);
+
+        size_t position = 0;
+        size_t next = 0;
+        while ((next = cord_json_index_next(&index, position)) !=
+               CORD_JSON_INDEX_END) {
+            position = next + 1;
+            check++;
+        }
+        cord_bump_destroy(allocator);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "index (%s)", cord_simd_level_name(level));
+    report(name, payload, rounds, bench_now() - start, check);
+}
+
+/*
+ * Reader over the payload, without an index when level is negative. With
+ * decode the guild entity is decoded, otherwise the whole value is skipped.
+ */
+static void
+bench_reader(payload_t payload, size_t rounds, i32 level, bool decode) {
+    cord_str_t input = {payload.data, (ssize_t)payload.length};
+    size_t check = 0;
+
+    double start = bench_now();
+    for (size_t i = 0; i < rounds; i++) {
+        cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+        cord_json_reader_t reader = {0};
+        cord_json_reader_init(&reader, input, allocator);
+        reader.index = NULL;
+        if (level >= 0) {
+            cord_json_reader_use_index(&reader, (cord_simd_level_t)level);
+        }
+
+        if (decode) {
+            cord_json_token_t value = cord_json_next(&reader);
+            cord_serialize_result_t result =
+                cord_guild_serialize(&reader, value, allocator);
+            cord_guild_t *guild = result.obj;
+            check += guild ? (size_t)guild->name.length : 0;
+        } else {
+            check += cord_json_skip(&reader, cord_json_next(&reader));
+        }
+        cord_bump_destroy(allocator);
+    }
+
+    char name[64];
+    snprintf(name,
+             sizeof(name),
+             "reader %s (%s)",
+             decode ? "guild" : "skip",
+             level < 0 ? "no index" : cord_simd_level_name(level));
+    report(name, payload, rounds, bench_now() - start, check);
+}
+
+static void bench_decode_cleared(payload_t payload, size_t rounds) {
+    cord_str_t input = {payload.data, (ssize_t)payload.length};
+    cord_bump_t *allocator = cord_bump_create_with_size(MB(1));
+    size_t check = 0;
+
+    double start = bench_now();
+    for (size_t i = 0; i < rounds; i++) {
+        cord_json_reader_t reader = {0};
+        cord_json_reader_init(&reader, input, allocator);
+
+        cord_json_token_t value = cord_json_next(&reader);
+        cord_serialize_result_t result =
+            cord_guild_serialize(&reader, value, allocator);
+        cord_guild_t *guild = result.obj;
+        check += guild ? (size_t)guild->name.length : 0;
+        cord_bump_clear(allocator);
+    }
+    report("reader guild (cleared allocator)",
+           payload,
+           rounds,
+           bench_now() - start,
+           check);
+    cord_bump_destroy(allocator);
+}
+
+static void run(size_t size, size_t rounds) {
+    payload_t payload = generate_guild(size);
+    printf("\nGUILD_CREATE payload of %zu bytes, %zu rounds\n",
+           payload.length,
+           rounds);
+
+    bench_jansson(payload, rounds);
+    for (i32 level = CORD_SIMD_SCALAR; level <= CORD_SIMD_AVX2; level++) {
+        if (cord_simd_supported(level) == (cord_simd_level_t)level) {
+            bench_index(payload, rounds, level);
+        }
+    }
+
+    bench_reader(payload, rounds, -1, false);
+    bench_reader(payload, rounds, -1, true);
+    bench_decode_cleared(payload, rounds);
+    for (i32 level = CORD_SIMD_SCALAR; level <= CORD_SIMD_AVX2; level++) {
+        if (cord_simd_supported(level) == (cord_simd_level_t)level) {
+            bench_reader(payload, rounds, level, false);
+            bench_reader(payload, rounds, level, true);
+        }
+    }
+
+    free(payload.data);
+}
+
+int main(int argc, char **argv) {
+    global_logger_init();
+
+    size_t rounds = argc > 1 ? strtoul(argv[1], NULL, 10) : 100;
+    printf("Best instruction set: %s\n",
+           cord_simd_level_name(cord_simd_detect()));
+
+    run(MB(1), rounds);
+    run(MB(10), rounds / 10 > 0 ? rounds / 10 : 1);
+    return 0;
+}
@@ -9,9 +9,13 @@ void on_message(cord_t *cord, cord_bump_t *bump, cord_message_t *message) {
 
     if (cord_str_equals(content, cstr("me"))) {
         cord_user_t *user = cord_get_current_user(cord, bump);
-        char *id = cord_strbuf_to_cstring(*user->id);
-        char *username = cord_strbuf_to_cstring(*user->username);
-        logger_info("User{id: %s, name: %s}", id, username);
+        if (!user) {
+            return;
+        }
+        logger_info("User{id: %lu, name: %.*s}",
+                    user->id,
+                    (int)user->username.length,
+                    user->username.data);
     }
 }
 
@@ -3,16 +3,19 @@
 #include "../core/log.h"
 #include "../core/memory.h"
 #include "../discord/client.h"
+#include "../discord/events.h"
 #include "../discord/serialization.h"
+#include "../discord/shard.h"
 #include "../http/rest.h"
 
 #include <assert.h>
-#include <jansson.h>
 #include <uwsc/log.h>
 #include <uwsc/uwsc.h>
 
 cord_t *cord_create(void) {
     global_logger_init();
+    // Shards never wait for the terminal, records are dropped instead
+    logger_start_async(global_logger(), LOG_OVERFLOW_DROP);
 
     cord_bump_t *application_allocator = cord_bump_create_with_size(MB(8));
 
@@ -32,19 +35,81 @@ void cord_connect(cord_t *cord) {
     cord_client_connect(cord->client);
 }
 
-void cord_destroy(cord_t *cord) {
-    if (cord) {
-        for (i32 i = 0; i < cord->allocator_count; i++) {
-            cord_bump_destroy(cord->user_allocators[i]);
+// Context handed to the callbacks of a shard, sharing only user_data
+static cord_t *shard_context(cord_t *cord, cord_client_t *client) {
+    cord_t *context = balloc(client->persistent_allocator, sizeof(cord_t));
+    if (!context) {
+        return NULL;
+    }
+
+    context->client = client;
+    context->logger = cord->logger;
+    context->permanent_allocator = client->persistent_allocator;
+    context->user_data = cord->user_data;
+
+    client->user_data = context;
+    client->event_callbacks = cord->client->event_callbacks;
+    client->intents = cord->client->intents;
+    client->compress = cord->client->compress;
+
+    if (cord->client->cache) {
+        client->cache = cord_cache_create(cord->client->cache->config);
+        if (!client->cache) {
+            return NULL;
         }
+    }
+    return context;
+}
+
+static void destroy_user_allocators(cord_t *cord) {
+    for (i32 i = 0; i < cord->allocator_count; i++) {
+        cord_bump_destroy(cord->user_allocators[i]);
+    }
+    cord->allocator_count = 0;
+}
+
+void cord_connect_sharded(cord_t *cord, i32 shard_count, i32 max_concurrency) {
+    cord_shards_t *shards = cord_shards_create(
+        cord->permanent_allocator, shard_count, max_concurrency);
+    if (!shards) {
+        logger_error("Failed to create %d shards", shard_count);
+        return;
+    }
+
+    for (i32 i = 0; i < shards->count; i++) {
+        if (!shard_context(cord, shards->shards[i].client)) {
+            logger_error("Failed to create context of shard %d", i);
+            cord_shards_destroy(shards);
+            return;
+        }
+    }
+
+    cord_shards_run(shards);
+
+    for (i32 i = 0; i < shards->count; i++) {
+        destroy_user_allocators(shards->shards[i].client->user_data);
+    }
+    cord_shards_destroy(shards);
+}
+
+i32 cord_shard_id(cord_t *cord) {
+    return cord->client->shard_id;
+}
 
+cord_arena_pool_stats_t cord_event_arena_stats(cord_t *cord) {
+    return cord_arena_pool_stats(&cord->client->event_arenas);
+}
+
+void cord_destroy(cord_t *cord) {
+    if (cord) {
+        destroy_user_allocators(cord);
         cord_client_destroy(cord->client);
-        free(cord);
+
+        // cord lives in the permanent allocator, destroy it last
+        cord_bump_destroy(cord->permanent_allocator);
     }
+    cord_scratch_release();
     global_logger_destroy();
-
-    // destroy permanent allocator last
-    cord_bump_destroy(cord->permanent_allocator);
 }
 
 static bool is_valid_allocator_id(cord_t *cord, i32 allocator_id) {
@@ -147,27 +212,91 @@ void cord_on_message(cord_t *cord,
                                            cord_bump_t *bump,
                                            cord_message_t *message)) {
     cord->client->event_callbacks.on_message_cb = on_message_cb;
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE,
+                                   on_message_create);
+}
+
+void cord_on_message_view(cord_t *cord,
+                          void (*on_message_view_cb)(
+                              cord_t *ctx,
+                              cord_bump_t *bump,
+                              cord_message_view_t *message)) {
+    cord->client->event_callbacks.on_message_view_cb = on_message_view_cb;
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE,
+                                   on_message_create);
+}
+
+void cord_set_intents(cord_t *cord, i32 intents) {
+    cord->client->intents = intents;
+}
+
+typedef struct cache_handler_t {
+    gateway_event_t event;
+    event_handler handler;
+} cache_handler_t;
+
+static const cache_handler_t cache_handlers[] = {
+    {GATEWAY_EVENT_GUILD_CREATE, on_guild_create},
+    {GATEWAY_EVENT_GUILD_UPDATE, on_guild_update},
+    {GATEWAY_EVENT_GUILD_DELETE, on_guild_delete},
+    {GATEWAY_EVENT_CHANNEL_CREATE, on_channel_create},
+    {GATEWAY_EVENT_CHANNEL_UPDATE, on_channel_update},
+    {GATEWAY_EVENT_CHANNEL_DELETE, on_channel_delete},
+    {GATEWAY_EVENT_GUILD_ROLE_CREATE, on_guild_role_create},
+    {GATEWAY_EVENT_GUILD_ROLE_UPDATE, on_guild_role_update},
+    {GATEWAY_EVENT_GUILD_ROLE_DELETE, on_guild_role_delete},
+    {GATEWAY_EVENT_GUILD_MEMBER_ADD, on_guild_member_add},
+    {GATEWAY_EVENT_GUILD_MEMBER_REMOVE, on_guild_member_remove},
+    {GATEWAY_EVENT_GUILD_MEMBER_UPDATE, on_guild_member_update},
+    {GATEWAY_EVENT_GUILD_MEMBERS_CHUNK, on_guild_members_chunk},
+};
+
+bool cord_enable_cache(cord_t *cord, cord_cache_config_t config) {
+    cord_cache_t *cache = cord_cache_create(config);
+    if (!cache) {
+        return false;
+    }
+
+    cord_cache_destroy(cord->client->cache);
+    cord->client->cache = cache;
+    for (size_t i = 0; i < array_length(cache_handlers); i++) {
+        if (cord_cache_wants(cache, cache_handlers[i].event)) {
+            cord_gateway_event_set_handler(cache_handlers[i].event,
+                                           cache_handlers[i].handler);
+        }
+    }
+    return true;
 }
 
-void cord_send_text(cord_t *cord, cord_strbuf_t *channel_id, char *message) {
-    cord_bump_t *bump = cord_bump_create();
-    cord_message_t *msg = balloc(bump, sizeof(cord_message_t));
-    cord_strbuf_t *content = cord_strbuf_create();
-    cord_strbuf_append(content, cstr(message));
-    msg->content = content;
-    msg->channel_id = channel_id;
-    cord_client_send_message(cord->client, msg);
-    cord_bump_destroy(bump);
+cord_cache_t *cord_get_cache(cord_t *cord) {
+    return cord->client->cache;
+}
+
+void cord_set_compression(cord_t *cord, bool enabled) {
+    cord->client->compress = enabled;
+}
+
+void cord_send_text(cord_t *cord,
+                    cord_snowflake_t channel_id,
+                    char *message) {
+    cord_message_t msg = {0};
+    msg.content = cstr(message);
+    msg.channel_id = channel_id;
+    cord_client_send_message(cord->client, &msg);
 }
 
 void cord_send_message(cord_t *cord, cord_message_t *message) {
     cord_client_send_message(cord->client, message);
 }
 
+void cord_send_builder(cord_t *cord, cord_message_builder_t *builder) {
+    cord_client_send_builder(cord->client, builder);
+}
+
 cord_user_t *cord_get_current_user(cord_t *cord, cord_bump_t *bump) {
     return cord_api_get_current_user(cord->client->http, bump);
 }
 
 cord_str_t cord_message_get_str(cord_message_t *message) {
-    return cord_strbuf_to_str(*message->content);
+    return message->content;
 }
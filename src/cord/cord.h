@@ -4,7 +4,9 @@
 #include "../core/log.h"
 #include "../core/memory.h"
 
+#include "../discord/cache.h"
 #include "../discord/client.h"
+#include "../discord/events.h"
 
 #define MAX_USER_ALLOCATORS 6
 
@@ -21,6 +23,25 @@ typedef struct cord_t {
 
 cord_t *cord_create(void);
 void cord_connect(cord_t *cord);
+
+/*
+ * Connect with shard_count shards, each with its own connection, event loop
+ * and allocators on a thread of its own. max_concurrency is the number of
+ * shards that may identify at once, from GET /gateway/bot. Callbacks run on
+ * the thread of the shard that received the event and get a context of
+ * that shard, so REST calls made from them go through the shard too.
+ */
+void cord_connect_sharded(cord_t *cord, i32 shard_count, i32 max_concurrency);
+
+// Shard of a callback context, 0 without sharding
+i32 cord_shard_id(cord_t *cord);
+
+/*
+ * How the arenas given to event callbacks are reused. The bump passed to a
+ * callback goes back to the pool when it returns.
+ */
+cord_arena_pool_stats_t cord_event_arena_stats(cord_t *cord);
+
 void cord_destroy(cord_t *cord);
 
 cord_allocator_id_t cord_get_allocator(cord_t *cord);
@@ -34,9 +55,55 @@ void cord_on_message(cord_t *cord,
                                            cord_bump_t *bump,
                                            cord_message_t *message));
 
-void cord_send_text(cord_t *cord, cord_strbuf_t *guild_id, char *message);
+/*
+ * Receive new messages as views that decode only the fields the callback
+ * asks for (see message_view.h), for bots that look at a few fields of
+ * every message. Can be used together with cord_on_message, which then
+ * gets the message decoded in full after this returns.
+ */
+void cord_on_message_view(cord_t *cord,
+                          void (*on_message_view_cb)(
+                              cord_t *ctx,
+                              cord_bump_t *bump,
+                              cord_message_view_t *message));
+
+/*
+ * By default the intents are derived from the event handlers registered
+ * when the connection identifies, so only events that are handled are
+ * received. This subscribes to exactly the given intents instead.
+ */
+void cord_set_intents(cord_t *cord, i32 intents);
+
+/*
+ * Keep guilds, channels, roles and members in memory as the gateway sends
+ * them, each type according to its policy in config. Has to be called
+ * before connecting, it registers the events the cache needs, and caching
+ * members subscribes to the privileged GUILD_MEMBERS intent. With sharding
+ * every shard caches the guilds it receives.
+ */
+bool cord_enable_cache(cord_t *cord, cord_cache_config_t config);
+
+// Cache of the callback context, NULL when caching is off
+cord_cache_t *cord_get_cache(cord_t *cord);
+
+/*
+ * Gateway messages are compressed with zlib-stream unless this disables it
+ * before connecting
+ */
+void cord_set_compression(cord_t *cord, bool enabled);
+
+void cord_send_text(cord_t *cord,
+                    cord_snowflake_t channel_id,
+                    char *message);
 void cord_send_message(cord_t *cord, cord_message_t *message);
 
+/*
+ * Send a message built with a cord_message_builder_t, see message_builder.h.
+ * Its json is written in one pass and its files are streamed from disk or
+ * memory as the request goes out.
+ */
+void cord_send_builder(cord_t *cord, cord_message_builder_t *builder);
+
 cord_user_t *cord_get_current_user(cord_t *cord, cord_bump_t *bump);
 cord_str_t cord_message_get_str(cord_message_t *message);
 
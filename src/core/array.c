@@ -21,17 +21,17 @@ cord_array_t *cord_array_create(cord_bump_t *allocator, size_t element_size) {
     const i32 default_capacity = 16;
     array->capacity = default_capacity;
 
-    const size_t initial_array_size = element_size * (size_t)array->capacity;
-    array->data = balloc(allocator, initial_array_size);
+    // Elements are zeroed as they are pushed
+    array->data = balloc_array(allocator, array->capacity, element_size);
     return array->data ? array : NULL;
 }
 
 void *cord_array_push(cord_array_t *array) {
     if (array->num_elements == array->capacity) {
         // When the array is full, we allocate a new one with double capacity
-        size_t new_size = array->capacity * array->element_size * 2;
         u8 *current_items = array->data;
-        u8 *new_items = balloc(array->allocator, new_size);
+        u8 *new_items = balloc_array(
+            array->allocator, array->capacity * 2, array->element_size);
         if (!new_items) {
             return NULL;
         }
@@ -47,7 +47,7 @@ void *cord_array_push(cord_array_t *array) {
     void *new_element =
         array->data + (array->element_size * array->num_elements);
     array->num_elements++;
-    return new_element;
+    return memset(new_element, 0, array->element_size);
 }
 
 void *cord_array_get(cord_array_t *array, int index) {
@@ -1,23 +1,218 @@
 #include "hashmap.h"
+#include "log.h"
 #include "memory.h"
 #include "strings.h"
 
 #include <assert.h>
 #include <string.h>
 
-static const cord_hash_item_t EMPTY_ITEM = (cord_hash_item_t){
-    .key = "", .value = NULL, .next = NULL, .deleted = false};
+// SSE2 is part of x86-64, so unlike the JSON scanners this needs no dispatch
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-static u64 hash(char *key) {
-    u64 hash = 0;
-    for (size_t i = 0; key[i] != '\0'; i++) {
-        hash = hash * 31 + key[i];
+#define CONTROL_EMPTY ((i8)-128)
+#define CONTROL_DELETED ((i8)-2)
+
+#define DEFAULT_CAPACITY 64
+
+/*
+ * wyhash by Wang Yi, released to the public domain
+ */
+static const u64 wyhash_secret[4] = {0x2d358dccaa6c78a5ull,
+                                     0x8bb84b93962eacc9ull,
+                                     0x4b33a62ed433d4a3ull,
+                                     0x4d5a2da51de1aa47ull};
+
+static inline void wyhash_multiply(u64 *a, u64 *b) {
+    __uint128_t product = (__uint128_t)*a * *b;
+    *a = (u64)product;
+    *b = (u64)(product >> 64);
+}
+
+static inline u64 wyhash_mix(u64 a, u64 b) {
+    wyhash_multiply(&a, &b);
+    return a ^ b;
+}
+
+static inline u64 read_u64(const u8 *p) {
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u64 read_u32(const u8 *p) {
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u64 read_u24(const u8 *p, size_t length) {
+    return ((u64)p[0] << 16) | ((u64)p[length >> 1] << 8) | p[length - 1];
+}
+
+u64 cord_hash(const void *data, size_t length) {
+    const u64 *secret = wyhash_secret;
+    const u8 *p = data;
+    u64 seed = wyhash_mix(secret[0], secret[1]);
+    u64 a = 0;
+    u64 b = 0;
+
+    if (length <= 16) {
+        if (length >= 4) {
+            size_t middle = (length >> 3) << 2;
+            a = (read_u32(p) << 32) | read_u32(p + middle);
+            b = (read_u32(p + length - 4) << 32) |
+                read_u32(p + length - 4 - middle);
+        } else if (length > 0) {
+            a = read_u24(p, length);
+        }
+    } else {
+        size_t left = length;
+        if (left >= 48) {
+            u64 seed1 = seed;
+            u64 seed2 = seed;
+            do {
+                seed = wyhash_mix(read_u64(p) ^ secret[1],
+                                  read_u64(p + 8) ^ seed);
+                seed1 = wyhash_mix(read_u64(p + 16) ^ secret[2],
+                                   read_u64(p + 24) ^ seed1);
+                seed2 = wyhash_mix(read_u64(p + 32) ^ secret[3],
+                                   read_u64(p + 40) ^ seed2);
+                p += 48;
+                left -= 48;
+            } while (left >= 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (left > 16) {
+            seed = wyhash_mix(read_u64(p) ^ secret[1], read_u64(p + 8) ^ seed);
+            p += 16;
+            left -= 16;
+        }
+        a = read_u64(p + left - 16);
+        b = read_u64(p + left - 8);
     }
-    return hash;
+
+    a ^= secret[1];
+    b ^= seed;
+    wyhash_multiply(&a, &b);
+    return wyhash_mix(a ^ secret[0] ^ length, b ^ secret[1]);
 }
 
-cord_hashmap_t *cord_hashmap_create(cord_bump_t *allocator,
-                                    cord_item_create_cb create_item_func) {
+// Top 7 bits of the hash, the low bits pick the group
+static inline i8 hash_tag(u64 hash) {
+    return (i8)(hash >> 57);
+}
+
+/*
+ * Bit i of the result is set when control byte i of the group matches. The
+ * control bytes are 16 byte aligned since balloc aligns to max_align_t.
+ */
+#ifdef __SSE2__
+static inline u32 group_match(const i8 *control, i8 tag) {
+    __m128i group = _mm_load_si128((const __m128i *)control);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+}
+
+// Empty and deleted are the only control bytes with the top bit set
+static inline u32 group_match_free(const i8 *control) {
+    __m128i group = _mm_load_si128((const __m128i *)control);
+    return (u32)_mm_movemask_epi8(group);
+}
+#else
+static inline u32 group_match(const i8 *control, i8 tag) {
+    u32 match = 0;
+    for (u32 i = 0; i < CORD_HASHMAP_GROUP_SIZE; i++) {
+        match |= (u32)(control[i] == tag) << i;
+    }
+    return match;
+}
+
+static inline u32 group_match_free(const i8 *control) {
+    u32 match = 0;
+    for (u32 i = 0; i < CORD_HASHMAP_GROUP_SIZE; i++) {
+        match |= (u32)(control[i] < 0) << i;
+    }
+    return match;
+}
+#endif
+
+static inline size_t first_match(u32 match) {
+    return (size_t)__builtin_ctz(match);
+}
+
+/*
+ * Groups are probed triangularly, which visits every group once when their
+ * number is a power of two
+ */
+typedef struct probe_t {
+    size_t group;
+    size_t mask;
+    size_t step;
+} probe_t;
+
+static inline probe_t probe_start(size_t capacity, size_t group) {
+    size_t mask = capacity / CORD_HASHMAP_GROUP_SIZE - 1;
+    return (probe_t){.group = group & mask, .mask = mask, .step = 0};
+}
+
+static inline void probe_next(probe_t *probe) {
+    probe->step++;
+    probe->group = (probe->group + probe->step) & probe->mask;
+}
+
+// Control bytes of capacity empty slots and uninitialized items
+static bool allocate_slots(cord_bump_t *allocator,
+                           size_t capacity,
+                           size_t item_size,
+                           i8 **control,
+                           void **items) {
+    *control = balloc_uninit(allocator, capacity);
+    *items = balloc_array(allocator, capacity, item_size);
+    if (!*control || !*items) {
+        logger_error("Failed to allocate hash map of %zu slots", capacity);
+        return false;
+    }
+
+    memset(*control, CONTROL_EMPTY, capacity);
+    return true;
+}
+
+static bool allocate_table(cord_hashmap_t *map, size_t capacity) {
+    i8 *control = NULL;
+    void *items = NULL;
+    if (!allocate_slots(map->allocator,
+                        capacity,
+                        sizeof(cord_hash_item_t),
+                        &control,
+                        &items)) {
+        return false;
+    }
+
+    map->control = control;
+    map->items = items;
+    map->capacity = capacity;
+    map->num_deleted = 0;
+    return true;
+}
+
+// Keys stay below 7/8 of the slots, so probing always ends at an empty slot
+static size_t max_load(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+static size_t capacity_for(size_t num_items) {
+    size_t capacity = DEFAULT_CAPACITY;
+    while (max_load(capacity) < num_items) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+cord_hashmap_t *
+cord_hashmap_create_with_capacity(cord_bump_t *allocator,
+                                  cord_item_create_cb create_item_func,
+                                  size_t capacity) {
     assert(allocator);
     assert(create_item_func);
 
@@ -26,90 +221,294 @@ cord_hashmap_t *cord_hashmap_create(cord_bump_t *allocator,
         return NULL;
     }
 
-    const u32 default_capacity = 64;
-    hashmap->items =
-        balloc(allocator, default_capacity * sizeof(cord_hash_item_t));
-    if (!hashmap->items) {
-        return NULL;
-    }
-    for (size_t i = 0; i < default_capacity; i++) {
-        hashmap->items[i] = EMPTY_ITEM;
-    }
-
     hashmap->allocator = allocator;
     hashmap->create_item_func = create_item_func;
-    hashmap->capacity = default_capacity;
     hashmap->num_items = 0;
+    if (!allocate_table(hashmap, capacity_for(capacity))) {
+        return NULL;
+    }
 
     return hashmap;
 }
 
-static cord_hash_item_t *create_hash_item(cord_hashmap_t *map, char *key) {
-    cord_hash_item_t *item = balloc(map->allocator, sizeof(cord_hash_item_t));
-    if (!item) {
+cord_hashmap_t *cord_hashmap_create(cord_bump_t *allocator,
+                                    cord_item_create_cb create_item_func) {
+    return cord_hashmap_create_with_capacity(
+        allocator, create_item_func, max_load(DEFAULT_CAPACITY));
+}
+
+static size_t find_slot(cord_hashmap_t *map, cord_str_t key, u64 hash) {
+    i8 tag = hash_tag(hash);
+    probe_t probe = probe_start(map->capacity, (size_t)hash);
+    for (;; probe_next(&probe)) {
+        size_t base = probe.group * CORD_HASHMAP_GROUP_SIZE;
+        const i8 *control = map->control + base;
+
+        for (u32 match = group_match(control, tag); match; match &= match - 1) {
+            cord_hash_item_t *item = &map->items[base + first_match(match)];
+            if (item->hash == hash && item->key.length == key.length &&
+                memcmp(item->key.data, key.data, (size_t)key.length) == 0) {
+                return base + first_match(match);
+            }
+        }
+
+        if (group_match(control, CONTROL_EMPTY)) {
+            return SIZE_MAX;
+        }
+    }
+}
+
+static size_t find_free_slot(const i8 *control, probe_t probe) {
+    for (;; probe_next(&probe)) {
+        size_t base = probe.group * CORD_HASHMAP_GROUP_SIZE;
+        u32 match = group_match_free(control + base);
+        if (match) {
+            return base + first_match(match);
+        }
+    }
+}
+
+/*
+ * Empty the slot of a removed key. Probing never went past a group that has
+ * an empty slot, so no other key depends on this one being there. Returns
+ * true if the slot was marked deleted instead.
+ */
+static bool clear_slot(i8 *control, size_t slot) {
+    size_t base = slot - slot % CORD_HASHMAP_GROUP_SIZE;
+    if (group_match(control + base, CONTROL_EMPTY)) {
+        control[slot] = CONTROL_EMPTY;
+        return false;
+    }
+    control[slot] = CONTROL_DELETED;
+    return true;
+}
+
+// Grow when keys are over the max load, compact when deleted slots are
+static size_t rehash_capacity(size_t capacity, size_t num_items) {
+    return num_items >= max_load(capacity) / 2 ? capacity * 2 : capacity;
+}
+
+static void place_item(cord_hashmap_t *map, cord_hash_item_t item) {
+    probe_t probe = probe_start(map->capacity, (size_t)item.hash);
+    size_t slot = find_free_slot(map->control, probe);
+    if (map->control[slot] == CONTROL_DELETED) {
+        map->num_deleted--;
+    }
+    map->control[slot] = hash_tag(item.hash);
+    map->items[slot] = item;
+}
+
+/*
+ * Rehash into a table twice as large, or of the same size when at most
+ * half of the used slots hold keys and the rest are deleted
+ */
+static bool rehash(cord_hashmap_t *map) {
+    size_t capacity = rehash_capacity(map->capacity, map->num_items);
+    i8 *old_control = map->control;
+    cord_hash_item_t *old_items = map->items;
+    size_t old_capacity = map->capacity;
+    if (!allocate_table(map, capacity)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_control[i] >= 0) {
+            place_item(map, old_items[i]);
+        }
+    }
+    return true;
+}
+
+void *cord_hashmap_put(cord_hashmap_t *map, cord_str_t key) {
+    assert(cord_str_valid(key));
+
+    void *value = map->create_item_func(map->allocator);
+    if (!value) {
         return NULL;
     }
-    strcpy(item->key, key);
-    item->value = map->create_item_func(map->allocator);
-    item->next = NULL;
-    item->deleted = false;
-    return item;
+
+    u64 hash = cord_hash(key.data, (size_t)key.length);
+    size_t slot = find_slot(map, key, hash);
+    if (slot != SIZE_MAX) {
+        map->items[slot].value = value;
+        return value;
+    }
+
+    if (map->num_items + map->num_deleted >= max_load(map->capacity) &&
+        !rehash(map)) {
+        return NULL;
+    }
+
+    char *key_copy = balloc_uninit(map->allocator, (size_t)key.length);
+    if (!key_copy) {
+        return NULL;
+    }
+    memcpy(key_copy, key.data, (size_t)key.length);
+
+    place_item(map,
+               (cord_hash_item_t){.key = {key_copy, key.length},
+                                  .hash = hash,
+                                  .value = value});
+    map->num_items++;
+    return value;
+}
+
+void *cord_hashmap_get(cord_hashmap_t *map, cord_str_t key) {
+    assert(cord_str_valid(key));
+
+    u64 hash = cord_hash(key.data, (size_t)key.length);
+    size_t slot = find_slot(map, key, hash);
+    return slot != SIZE_MAX ? map->items[slot].value : NULL;
+}
+
+bool cord_hashmap_remove(cord_hashmap_t *map, cord_str_t key) {
+    assert(cord_str_valid(key));
+
+    u64 hash = cord_hash(key.data, (size_t)key.length);
+    size_t slot = find_slot(map, key, hash);
+    if (slot == SIZE_MAX) {
+        return false;
+    }
+
+    if (clear_slot(map->control, slot)) {
+        map->num_deleted++;
+    }
+    map->items[slot] = (cord_hash_item_t){0};
+    map->num_items--;
+    return true;
 }
 
-void *cord_hashmap_put(cord_hashmap_t *map, char *key) {
-    assert(key);
-    assert(strlen(key) <= MAX_HASHMAP_KEY_LEN);
+// 2^64 divided by the golden ratio, spreads consecutive keys apart
+#define FIBONACCI_MULTIPLIER 0x9e3779b97f4a7c15ull
 
-    cord_hash_item_t *item = create_hash_item(map, key);
-    if (!item) {
+static inline u64 u64_hash(u64 key) {
+    return key * FIBONACCI_MULTIPLIER;
+}
+
+static inline size_t u64_group(cord_u64_map_t *map, u64 hash) {
+    return (size_t)(hash >> map->shift);
+}
+
+static inline i8 u64_tag(cord_u64_map_t *map, u64 hash) {
+    return (i8)((hash >> (map->shift - 7)) & 0x7F);
+}
+
+static bool u64_allocate_table(cord_u64_map_t *map, size_t capacity) {
+    i8 *control = NULL;
+    void *items = NULL;
+    if (!allocate_slots(map->allocator,
+                        capacity,
+                        sizeof(cord_u64_item_t),
+                        &control,
+                        &items)) {
+        return false;
+    }
+
+    map->control = control;
+    map->items = items;
+    map->capacity = capacity;
+    map->num_deleted = 0;
+    size_t groups = capacity / CORD_HASHMAP_GROUP_SIZE;
+    map->shift = 64 - (u32)__builtin_ctzll(groups);
+    return true;
+}
+
+cord_u64_map_t *cord_u64_map_create(cord_bump_t *allocator, size_t capacity) {
+    assert(allocator);
+
+    cord_u64_map_t *map = balloc(allocator, sizeof(cord_u64_map_t));
+    if (!map) {
         return NULL;
     }
 
-    size_t index = (size_t)hash(key) % map->capacity;
-    cord_hash_item_t *found_item = map->items + index;
-    if (found_item == &EMPTY_ITEM) {
-        map->items[index] = *item;
-        map->num_items++;
-        return item->value;
+    map->allocator = allocator;
+    map->num_items = 0;
+    if (!u64_allocate_table(map, capacity_for(capacity))) {
+        return NULL;
     }
+    return map;
+}
+
+static size_t u64_find_slot(cord_u64_map_t *map, u64 key) {
+    u64 hash = u64_hash(key);
+    i8 tag = u64_tag(map, hash);
+    probe_t probe = probe_start(map->capacity, u64_group(map, hash));
+    for (;; probe_next(&probe)) {
+        size_t base = probe.group * CORD_HASHMAP_GROUP_SIZE;
+        const i8 *control = map->control + base;
 
-    cord_hash_item_t *iter = NULL;
-    for (iter = found_item; iter->next != NULL; iter = iter->next) {
-        // decrement num items when marking items as deleted
-        if (cstring_is_equal(iter->key, key)) {
-            iter->deleted = true;
-            map->num_items--;
+        for (u32 match = group_match(control, tag); match; match &= match - 1) {
+            if (map->items[base + first_match(match)].key == key) {
+                return base + first_match(match);
+            }
+        }
+
+        if (group_match(control, CONTROL_EMPTY)) {
+            return SIZE_MAX;
         }
     }
+}
 
-    iter->next = item;
-    map->num_items++;
-    return item->value;
+static void u64_place_item(cord_u64_map_t *map, cord_u64_item_t item) {
+    u64 hash = u64_hash(item.key);
+    probe_t probe = probe_start(map->capacity, u64_group(map, hash));
+    size_t slot = find_free_slot(map->control, probe);
+    if (map->control[slot] == CONTROL_DELETED) {
+        map->num_deleted--;
+    }
+    map->control[slot] = u64_tag(map, hash);
+    map->items[slot] = item;
 }
 
-static cord_hash_item_t *find_item_in_list(cord_hash_item_t *head, char *key) {
-    assert(head);
-    assert(key);
+static bool u64_rehash(cord_u64_map_t *map) {
+    size_t capacity = rehash_capacity(map->capacity, map->num_items);
+    i8 *old_control = map->control;
+    cord_u64_item_t *old_items = map->items;
+    size_t old_capacity = map->capacity;
+    if (!u64_allocate_table(map, capacity)) {
+        return false;
+    }
 
-    for (cord_hash_item_t *iter = head; iter != NULL; iter = iter->next) {
-        if (!iter->deleted && cstring_is_equal(iter->key, key)) {
-            return iter;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_control[i] >= 0) {
+            u64_place_item(map, old_items[i]);
         }
     }
+    return true;
+}
 
-    return NULL;
+bool cord_u64_map_put(cord_u64_map_t *map, u64 key, void *value) {
+    size_t slot = u64_find_slot(map, key);
+    if (slot != SIZE_MAX) {
+        map->items[slot].value = value;
+        return true;
+    }
+
+    if (map->num_items + map->num_deleted >= max_load(map->capacity) &&
+        !u64_rehash(map)) {
+        return false;
+    }
+
+    u64_place_item(map, (cord_u64_item_t){.key = key, .value = value});
+    map->num_items++;
+    return true;
 }
 
-void *cord_hashmap_get(cord_hashmap_t *map, char *key) {
-    assert(key);
-    assert(strlen(key) <= MAX_HASHMAP_KEY_LEN);
+void *cord_u64_map_get(cord_u64_map_t *map, u64 key) {
+    size_t slot = u64_find_slot(map, key);
+    return slot != SIZE_MAX ? map->items[slot].value : NULL;
+}
 
-    size_t index = (size_t)hash(key) % map->capacity;
-    cord_hash_item_t *head = map->items + index;
-    if (head == &EMPTY_ITEM) {
-        return NULL;
+bool cord_u64_map_remove(cord_u64_map_t *map, u64 key) {
+    size_t slot = u64_find_slot(map, key);
+    if (slot == SIZE_MAX) {
+        return false;
     }
 
-    cord_hash_item_t *item = find_item_in_list(head, key);
-    return item ? item->value : NULL;
+    if (clear_slot(map->control, slot)) {
+        map->num_deleted++;
+    }
+    map->items[slot] = (cord_u64_item_t){0};
+    map->num_items--;
+    return true;
 }
@@ -2,34 +2,55 @@
 #define HASHMAP_H
 
 #include "memory.h"
+#include "strings.h"
 
 #include <stdbool.h>
 
-#define MAX_HASHMAP_KEY_LEN 32
+// Slots whose control bytes are matched at once
+#define CORD_HASHMAP_GROUP_SIZE 16
+
+/*
+ * Hash of length bytes of data (wyhash), good enough for hash tables but
+ * not meant to resist collision attacks
+ */
+u64 cord_hash(const void *data, size_t length);
 
 typedef void *(*cord_item_create_cb)(cord_bump_t *alloc);
 
 typedef struct cord_hash_item_t {
-    char key[MAX_HASHMAP_KEY_LEN];
+    cord_str_t key;
+    u64 hash;
     void *value;
-    struct cord_hash_item_t *next;
-    bool deleted;
 } cord_hash_item_t;
 
 /*
- * char* to void* hash map that uses linked lists to handle collisions
+ * cord_str_t to void* open addressing hash map (Swiss table)
+ *
+ * Every slot has a control byte that is either empty, deleted or the top 7
+ * bits of its key's hash. Lookups scan the control bytes of a group of
+ * CORD_HASHMAP_GROUP_SIZE slots at once for the 7 bits and only compare the
+ * keys of the slots that match. Probing moves group by group and stops at
+ * the first group with an empty slot.
+ *
+ * The map doubles when it is 7/8 full. Removed keys leave a deleted slot
+ * behind unless their group has an empty one, and when deleted slots fill
+ * the map it is rehashed at the same capacity instead of growing.
  *
  * Instead of the caller passing an already created object to the map,
  * in this case the hash map itself create an empty object based on
- * 'cord_item_create_cb' callback and returns it.
+ * 'cord_item_create_cb' callback and returns it. Keys are copied.
  *
  * The lifetime of the hashmap depends on the passed/underlying
- * memory allocator
+ * memory allocator. Like cord_array_t, tables outgrown by the map stay in
+ * the allocator until it is destroyed.
  */
 typedef struct cord_hashmap_t {
+    i8 *control;
     cord_hash_item_t *items;
+    // Number of slots, a power of two and a multiple of the group size
     size_t capacity;
     size_t num_items;
+    size_t num_deleted;
     cord_bump_t *allocator;
     cord_item_create_cb create_item_func;
 } cord_hashmap_t;
@@ -41,17 +62,69 @@ cord_hashmap_t *cord_hashmap_create(cord_bump_t *allocator,
                                     cord_item_create_cb create_item_func);
 
 /*
- * Put a new key-value pair to the map and return the value's address
+ * Create a new hash map with room for capacity keys before it grows
+ */
+cord_hashmap_t *
+cord_hashmap_create_with_capacity(cord_bump_t *allocator,
+                                  cord_item_create_cb create_item_func,
+                                  size_t capacity);
+
+/*
+ * Put a new key-value pair to the map and return the value's address. A key
+ * that is already in the map gets a new value.
  *
  * In case of key-value pair allocation failure return NULL
  */
-void *cord_hashmap_put(cord_hashmap_t *map, char *key);
+void *cord_hashmap_put(cord_hashmap_t *map, cord_str_t key);
 
 /*
  * Retrieves the value of a key-value pair in the map
  *
  * Returns NULL if the value is not present in the map
  */
-void *cord_hashmap_get(cord_hashmap_t *map, char *key);
+void *cord_hashmap_get(cord_hashmap_t *map, cord_str_t key);
+
+/*
+ * Removes a key-value pair from the map, returns false if the key is not
+ * present
+ */
+bool cord_hashmap_remove(cord_hashmap_t *map, cord_str_t key);
+
+typedef struct cord_u64_item_t {
+    u64 key;
+    void *value;
+} cord_u64_item_t;
+
+/*
+ * u64 to void* map for integer keys such as snowflakes, laid out like
+ * cord_hashmap_t
+ *
+ * Keys are hashed by a single multiplication. The top bits of the product
+ * pick the group and the 7 bits below them are the control byte, so a
+ * lookup is a multiply, a group match and an integer compare. Values are
+ * stored as they are given, the map doesn't own them.
+ */
+typedef struct cord_u64_map_t {
+    i8 *control;
+    cord_u64_item_t *items;
+    size_t capacity;
+    size_t num_items;
+    size_t num_deleted;
+    // 64 minus the bits of the number of groups
+    u32 shift;
+    cord_bump_t *allocator;
+} cord_u64_map_t;
+
+cord_u64_map_t *cord_u64_map_create(cord_bump_t *allocator, size_t capacity);
+
+/*
+ * Map key to value, replacing the value it had. Returns false if the map
+ * failed to grow.
+ */
+bool cord_u64_map_put(cord_u64_map_t *map, u64 key, void *value);
+
+// Returns NULL if the key is not present in the map
+void *cord_u64_map_get(cord_u64_map_t *map, u64 key);
+bool cord_u64_map_remove(cord_u64_map_t *map, u64 key);
 
 #endif
@@ -0,0 +1,220 @@
+#include "intern.h"
+#include "log.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define INTERN_INITIAL_ENTRIES 64
+#define INTERN_BLOCK_SIZE KB(16)
+// Released memory below this is never worth copying the live strings for
+#define INTERN_MIN_GARBAGE KB(64)
+
+static size_t aligned_length(size_t length) {
+    size_t alignment = alignof(max_align_t);
+    return (length + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t index_size(cord_u64_map_t *index) {
+    return index->capacity * (sizeof(i8) + sizeof(cord_u64_item_t));
+}
+
+bool cord_interner_init(cord_interner_t *interner) {
+    assert(interner && "cord_interner_t must not be null");
+
+    memset(interner, 0, sizeof(cord_interner_t));
+    interner->allocator = cord_bump_create_with_size(INTERN_BLOCK_SIZE);
+    if (!interner->allocator) {
+        return false;
+    }
+
+    interner->index = cord_u64_map_create(interner->allocator, 0);
+    if (!interner->index) {
+        logger_error("Failed to create string interner index");
+        cord_interner_destroy(interner);
+        return false;
+    }
+    // Handle 0 is the empty string
+    interner->num_entries = 1;
+    return true;
+}
+
+void cord_interner_destroy(cord_interner_t *interner) {
+    if (interner) {
+        free(interner->entries);
+        if (interner->allocator) {
+            cord_bump_destroy(interner->allocator);
+        }
+        memset(interner, 0, sizeof(cord_interner_t));
+    }
+}
+
+static cord_intern_t index_get(cord_u64_map_t *index, u64 hash) {
+    return (cord_intern_t)(uintptr_t)cord_u64_map_get(index, hash);
+}
+
+static bool index_put(cord_u64_map_t *index, u64 hash, cord_intern_t handle) {
+    return cord_u64_map_put(index, hash, (void *)(uintptr_t)handle);
+}
+
+static cord_intern_t new_entry(cord_interner_t *interner) {
+    cord_intern_t handle = interner->free_entries;
+    if (handle) {
+        interner->free_entries = interner->entries[handle].next_free;
+        return handle;
+    }
+
+    if (interner->num_entries >= interner->capacity) {
+        u32 capacity = interner->capacity ? interner->capacity * 2
+                                          : INTERN_INITIAL_ENTRIES;
+        cord_intern_entry_t *entries =
+            realloc(interner->entries, capacity * sizeof(cord_intern_entry_t));
+        if (!entries) {
+            logger_error("Failed to grow string interner to %u entries",
+                         capacity);
+            return 0;
+        }
+        interner->entries = entries;
+        interner->capacity = capacity;
+    }
+    return interner->num_entries++;
+}
+
+cord_intern_t cord_intern(cord_interner_t *interner, cord_str_t string) {
+    if (string.length <= 0) {
+        return 0;
+    }
+
+    u64 hash = cord_hash(string.data, (size_t)string.length);
+    cord_intern_t found = index_get(interner->index, hash);
+    if (found) {
+        cord_intern_entry_t *entry = &interner->entries[found];
+        if (entry->length == (u32)string.length &&
+            memcmp(entry->data, string.data, entry->length) == 0) {
+            entry->refs++;
+            return found;
+        }
+    }
+
+    char *data = balloc_uninit(interner->allocator, (size_t)string.length);
+    cord_intern_t handle = data ? new_entry(interner) : 0;
+    if (!handle) {
+        return 0;
+    }
+    // Colliding strings are kept without being shared
+    if (!found && !index_put(interner->index, hash, handle)) {
+        logger_error("Failed to grow string interner index");
+        interner->entries[handle] = (cord_intern_entry_t){
+            .next_free = interner->free_entries,
+        };
+        interner->free_entries = handle;
+        return 0;
+    }
+
+    memcpy(data, string.data, (size_t)string.length);
+    interner->entries[handle] = (cord_intern_entry_t){
+        .data = data,
+        .length = (u32)string.length,
+        .refs = 1,
+        .hash = hash,
+    };
+    interner->num_strings++;
+    interner->live_bytes += aligned_length((size_t)string.length);
+    return handle;
+}
+
+/*
+ * Copy the live strings into a new allocator with a new index, releasing
+ * everything else. Nothing changes if memory runs out.
+ */
+static void compact(cord_interner_t *interner) {
+    size_t size = interner->live_bytes + index_size(interner->index);
+    cord_bump_t *allocator =
+        cord_bump_create_with_size(max(size, INTERN_BLOCK_SIZE));
+    cord_u64_map_t *index =
+        allocator ? cord_u64_map_create(allocator, interner->num_strings)
+                  : NULL;
+    // One allocation for all of the strings, so either all or none move
+    char *strings =
+        index ? balloc_uninit(allocator, max(interner->live_bytes, 1)) : NULL;
+
+    for (cord_intern_t handle = 1; strings && handle < interner->num_entries;
+         handle++) {
+        cord_intern_entry_t *entry = &interner->entries[handle];
+        if (entry->refs > 0 && !index_get(index, entry->hash) &&
+            !index_put(index, entry->hash, handle)) {
+            strings = NULL;
+        }
+    }
+
+    if (!strings) {
+        logger_warn("Failed to compact string interner");
+        if (allocator) {
+            cord_bump_destroy(allocator);
+        }
+        return;
+    }
+
+    for (cord_intern_t handle = 1; handle < interner->num_entries; handle++) {
+        cord_intern_entry_t *entry = &interner->entries[handle];
+        if (entry->refs > 0) {
+            memcpy(strings, entry->data, entry->length);
+            entry->data = strings;
+            strings += aligned_length(entry->length);
+        }
+    }
+
+    cord_bump_destroy(interner->allocator);
+    interner->allocator = allocator;
+    interner->index = index;
+}
+
+void cord_intern_release(cord_interner_t *interner, cord_intern_t handle) {
+    if (handle == 0) {
+        return;
+    }
+
+    cord_intern_entry_t *entry = &interner->entries[handle];
+    assert(entry->refs > 0 && "Interned string released too many times");
+    if (--entry->refs > 0) {
+        return;
+    }
+
+    if (index_get(interner->index, entry->hash) == handle) {
+        cord_u64_map_remove(interner->index, entry->hash);
+    }
+    interner->num_strings--;
+    interner->live_bytes -= aligned_length(entry->length);
+    entry->data = NULL;
+    entry->next_free = interner->free_entries;
+    interner->free_entries = handle;
+
+    size_t live = interner->live_bytes + index_size(interner->index);
+    if (cord_bump_used(interner->allocator) > 2 * live + INTERN_MIN_GARBAGE) {
+        compact(interner);
+    }
+}
+
+cord_intern_t cord_intern_replace(cord_interner_t *interner,
+                                  cord_intern_t handle,
+                                  cord_str_t string) {
+    cord_intern_t replacement = cord_intern(interner, string);
+    cord_intern_release(interner, handle);
+    return replacement;
+}
+
+cord_str_t cord_interned(cord_interner_t *interner, cord_intern_t handle) {
+    if (handle == 0) {
+        return (cord_str_t){"", 0};
+    }
+
+    cord_intern_entry_t *entry = &interner->entries[handle];
+    return (cord_str_t){entry->data, (ssize_t)entry->length};
+}
+
+size_t cord_interner_bytes(cord_interner_t *interner) {
+    return cord_bump_used(interner->allocator) +
+           interner->capacity * sizeof(cord_intern_entry_t);
+}
@@ -0,0 +1,84 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "hashmap.h"
+#include "memory.h"
+#include "strings.h"
+
+#include <stdbool.h>
+
+/*
+ * Handle of an interned string, 0 is the empty string
+ */
+typedef u32 cord_intern_t;
+
+typedef struct cord_intern_entry_t {
+    char *data;
+    u32 length;
+    // 0 for entries on the free list
+    u32 refs;
+    union {
+        u64 hash;
+        cord_intern_t next_free;
+    };
+} cord_intern_entry_t;
+
+/*
+ * Reference counted string interner
+ *
+ * Equal strings share one copy and one 32 bit handle, which is what makes
+ * values that repeat a lot (names, nicknames, sets of role ids) cheap to
+ * keep for every entity. Strings are copied into allocator and found by
+ * their hash through index. Two different strings with the same hash are
+ * both kept, only the first one is shared.
+ *
+ * Released strings stay in the allocator until they, together with tables
+ * outgrown by the index, take as much memory as the live ones. The live
+ * strings are then copied into a new allocator, so handles stay valid but
+ * the data of strings returned earlier doesn't.
+ */
+typedef struct cord_interner_t {
+    // Indexed by handle, entry 0 is not used
+    cord_intern_entry_t *entries;
+    u32 num_entries;
+    u32 capacity;
+    cord_intern_t free_entries;
+    // Strings with at least one reference
+    u32 num_strings;
+    // Memory of the live strings in allocator
+    size_t live_bytes;
+
+    cord_u64_map_t *index;
+    cord_bump_t *allocator;
+} cord_interner_t;
+
+bool cord_interner_init(cord_interner_t *interner);
+void cord_interner_destroy(cord_interner_t *interner);
+
+/*
+ * Add a reference to the copy of string, interning it if needed. Returns 0
+ * for empty strings and when memory ran out.
+ */
+cord_intern_t cord_intern(cord_interner_t *interner, cord_str_t string);
+
+// Drop a reference, the string is released with the last one
+void cord_intern_release(cord_interner_t *interner, cord_intern_t handle);
+
+/*
+ * Intern string and release handle, the usual way of updating a field that
+ * holds a handle
+ */
+cord_intern_t cord_intern_replace(cord_interner_t *interner,
+                                  cord_intern_t handle,
+                                  cord_str_t string);
+
+/*
+ * The string of a handle, valid until a string is next released.
+ * Strings are aligned like balloc memory.
+ */
+cord_str_t cord_interned(cord_interner_t *interner, cord_intern_t handle);
+
+// Heap taken by the strings, the entries and the index
+size_t cord_interner_bytes(cord_interner_t *interner);
+
+#endif
@@ -0,0 +1,234 @@
+#include "json_index.h"
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef CORD_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define BLOCK_SIZE 64
+
+static void scan_scalar(const u8 *block, cord_json_block_masks_t *masks) {
+    u64 quote = 0;
+    u64 backslash = 0;
+    u64 bracket = 0;
+    u64 control = 0;
+
+    for (i32 i = 0; i < BLOCK_SIZE; i++) {
+        u8 c = block[i];
+        u64 bit = (u64)1 << i;
+
+        // '[' and ']' are '{' and '}' without the 0x20 bit
+        if (c == '"') {
+            quote |= bit;
+        } else if (c == '\\') {
+            backslash |= bit;
+        } else if ((c | 0x20) == '{' || (c | 0x20) == '}') {
+            bracket |= bit;
+        } else if (c < 0x20) {
+            control |= bit;
+        }
+    }
+
+    *masks = (cord_json_block_masks_t){quote, backslash, bracket, control};
+}
+
+#ifdef CORD_SIMD_X86
+__attribute__((target("sse2"))) static void
+scan_sse2(const u8 *block, cord_json_block_masks_t *masks) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+
+    *masks = (cord_json_block_masks_t){0};
+    for (i32 i = 0; i < BLOCK_SIZE / 16; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(block + i * 16));
+        __m128i folded = _mm_or_si128(chunk, case_bit);
+        __m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                                        _mm_cmpeq_epi8(folded, close));
+        __m128i controls =
+            _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk);
+
+        i32 shift = i * 16;
+        masks->quote |=
+            (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote))
+            << shift;
+        masks->backslash |=
+            (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash))
+            << shift;
+        masks->bracket |= (u64)(u16)_mm_movemask_epi8(brackets) << shift;
+        masks->control |= (u64)(u16)_mm_movemask_epi8(controls) << shift;
+    }
+}
+
+__attribute__((target("avx2"))) static void
+scan_avx2(const u8 *block, cord_json_block_masks_t *masks) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+
+    *masks = (cord_json_block_masks_t){0};
+    for (i32 i = 0; i < BLOCK_SIZE / 32; i++) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(block + i * 32));
+        __m256i folded = _mm256_or_si256(chunk, case_bit);
+        __m256i brackets = _mm256_or_si256(_mm256_cmpeq_epi8(folded, open),
+                                           _mm256_cmpeq_epi8(folded, close));
+        __m256i controls =
+            _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control_max), chunk);
+
+        i32 shift = i * 32;
+        masks->quote |=
+            (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote))
+            << shift;
+        masks->backslash |=
+            (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash))
+            << shift;
+        masks->bracket |= (u64)(u32)_mm256_movemask_epi8(brackets) << shift;
+        masks->control |= (u64)(u32)_mm256_movemask_epi8(controls) << shift;
+    }
+}
+#endif
+
+/*
+ * Mask of the characters escaped by a backslash. A run of backslashes
+ * escapes the character after it only if its length is odd, which is
+ * resolved for the whole block at once by looking at where the runs start.
+ */
+static u64 find_escaped(u64 backslash, u64 *prev_escaped) {
+    const u64 even_bits = 0x5555555555555555ULL;
+
+    // An escaped backslash doesn't escape anything itself
+    backslash &= ~*prev_escaped;
+    u64 follows_escape = backslash << 1 | *prev_escaped;
+    u64 odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+
+    u64 sequences_starting_on_even_bits = 0;
+    *prev_escaped = __builtin_add_overflow(odd_sequence_starts,
+                                           backslash,
+                                           &sequences_starting_on_even_bits);
+    u64 invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+// Each bit becomes the xor of itself and all the bits below it
+static u64 prefix_xor(u64 bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static void index_block(cord_json_index_t *index, const u8 *block) {
+    cord_json_block_masks_t masks = {0};
+    index->scan(block, &masks);
+
+    u64 escaped = find_escaped(masks.backslash, &index->prev_escaped);
+    u64 quotes = masks.quote & ~escaped;
+
+    // Set from each opening quote up to, but not including, its closing one
+    u64 in_string = prefix_xor(quotes) ^ index->prev_in_string;
+    index->prev_in_string = (u64)((i64)in_string >> 63);
+
+    u64 control = masks.control & in_string;
+    if (control && index->error == CORD_JSON_INDEX_END) {
+        index->error = index->indexed + (size_t)__builtin_ctzll(control);
+    }
+
+    u64 structurals = (masks.bracket & ~in_string) | quotes;
+    u32 base = (u32)index->indexed;
+    while (structurals) {
+        index->positions[index->count++] =
+            base + (u32)__builtin_ctzll(structurals);
+        structurals &= structurals - 1;
+    }
+}
+
+static void index_fill(cord_json_index_t *index) {
+    index->count = 0;
+    index->cursor = 0;
+
+    const u8 *data = (const u8 *)index->data;
+    while (index->indexed < index->length &&
+           index->count + BLOCK_SIZE <= CORD_JSON_INDEX_CAPACITY) {
+        size_t remaining = index->length - index->indexed;
+        if (remaining >= BLOCK_SIZE) {
+            index_block(index, data + index->indexed);
+            index->indexed += BLOCK_SIZE;
+        } else {
+            // Pad the tail with whitespace, which is never structural
+            u8 block[BLOCK_SIZE];
+            memset(block, ' ', sizeof(block));
+            memcpy(block, data + index->indexed, remaining);
+            index_block(index, block);
+            index->indexed += remaining;
+        }
+    }
+}
+
+bool cord_json_index_init(cord_json_index_t *index,
+                          cord_str_t input,
+                          cord_bump_t *allocator,
+                          cord_simd_level_t level) {
+    assert(index && "cord_json_index_t must not be null");
+
+    if (input.length < 0 || (u64)input.length > UINT32_MAX) {
+        return false;
+    }
+
+    u32 *positions =
+        balloc_array(allocator, CORD_JSON_INDEX_CAPACITY, sizeof(u32));
+    if (!positions) {
+        return false;
+    }
+
+    *index = (cord_json_index_t){
+        .data = input.data,
+        .length = (size_t)input.length,
+        .scan = scan_scalar,
+        .error = CORD_JSON_INDEX_END,
+        .positions = positions,
+    };
+
+#ifdef CORD_SIMD_X86
+    switch (cord_simd_supported(level)) {
+        case CORD_SIMD_AVX2:
+            index->scan = scan_avx2;
+            break;
+        case CORD_SIMD_SSE2:
+            index->scan = scan_sse2;
+            break;
+        case CORD_SIMD_SCALAR:
+            break;
+    }
+#else
+    (void)level;
+#endif
+    return true;
+}
+
+size_t cord_json_index_next(cord_json_index_t *index, size_t position) {
+    for (;;) {
+        while (index->cursor < index->count) {
+            size_t next = index->positions[index->cursor];
+            if (next >= position) {
+                return next;
+            }
+            index->cursor++;
+        }
+
+        if (index->indexed >= index->length) {
+            return CORD_JSON_INDEX_END;
+        }
+        index_fill(index);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef JSON_INDEX_H
+#define JSON_INDEX_H
+
+#include "memory.h"
+#include "simd.h"
+#include "strings.h"
+#include "typedefs.h"
+
+#include <stdbool.h>
+
+// Number of positions buffered at a time
+#define CORD_JSON_INDEX_CAPACITY 4096
+
+// Returned when there are no structural characters left
+#define CORD_JSON_INDEX_END SIZE_MAX
+
+typedef struct cord_json_block_masks_t {
+    u64 quote;
+    u64 backslash;
+    u64 bracket;
+    u64 control;
+} cord_json_block_masks_t;
+
+/*
+ * Structural index of a JSON document (stage 1)
+ *
+ * Finds the quotes that delimit strings and the brackets outside of strings
+ * 64 bytes at a time, using SIMD to classify the bytes of each block and
+ * bit manipulation to resolve escapes and string boundaries. The reader uses
+ * it to find the end of strings and skip whole values without looking at
+ * every byte.
+ *
+ * Indexing is incremental: positions are produced into a fixed buffer as the
+ * consumer moves forward, so the memory it needs doesn't depend on the size
+ * of the document.
+ */
+typedef struct cord_json_index_t {
+    const char *data;
+    size_t length;
+    void (*scan)(const u8 *block, cord_json_block_masks_t *masks);
+
+    size_t indexed;
+    u64 prev_in_string;
+    u64 prev_escaped;
+    // Position of the first control character inside a string, if any
+    size_t error;
+
+    u32 *positions;
+    size_t count;
+    size_t cursor;
+} cord_json_index_t;
+
+/*
+ * Returns false if the input is too large to be indexed or the position
+ * buffer can't be allocated
+ */
+bool cord_json_index_init(cord_json_index_t *index,
+                          cord_str_t input,
+                          cord_bump_t *allocator,
+                          cord_simd_level_t level);
+
+/*
+ * Position of the first structural character at or after position. Calls
+ * must not go backwards since positions before the cursor are discarded.
+ */
+size_t cord_json_index_next(cord_json_index_t *index, size_t position);
+
+#endif
@@ -0,0 +1,705 @@
+#include "json_reader.h"
+#include "memory.h"
+#include "strings.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * What the reader accepts next, which is enough to validate the grammar
+ * without a tree
+ */
+enum {
+    STATE_VALUE,
+    STATE_VALUE_OR_CLOSE,
+    STATE_KEY,
+    STATE_KEY_OR_CLOSE,
+    STATE_SEPARATOR,
+    STATE_DONE,
+    STATE_ERROR
+};
+
+enum { CONTAINER_OBJECT = 1, CONTAINER_ARRAY = 2 };
+
+void cord_json_reader_init(cord_json_reader_t *reader,
+                           cord_str_t input,
+                           cord_bump_t *allocator) {
+    assert(reader && "cord_json_reader_t must not be null");
+
+    reader->data = input.data;
+    reader->length = input.length > 0 ? (size_t)input.length : 0;
+    reader->position = 0;
+    reader->allocator = allocator;
+    reader->depth = 0;
+    reader->state = STATE_VALUE;
+    reader->error = NULL;
+    reader->index = NULL;
+
+    // Without SIMD indexing is slower than scanning byte by byte
+    cord_simd_level_t level = cord_simd_detect();
+    if (allocator && level != CORD_SIMD_SCALAR &&
+        reader->length >= CORD_JSON_INDEX_THRESHOLD) {
+        cord_json_reader_use_index(reader, level);
+    }
+}
+
+bool cord_json_reader_use_index(cord_json_reader_t *reader,
+                                cord_simd_level_t level) {
+    if (!reader->allocator || reader->position > 0) {
+        return false;
+    }
+
+    cord_json_index_t *index =
+        balloc(reader->allocator, sizeof(cord_json_index_t));
+    cord_str_t input = {(char *)reader->data, (ssize_t)reader->length};
+    if (!index ||
+        !cord_json_index_init(index, input, reader->allocator, level)) {
+        return false;
+    }
+
+    reader->index = index;
+    return true;
+}
+
+static cord_str_t slice(cord_json_reader_t *reader, size_t begin, size_t end) {
+    return (cord_str_t){(char *)reader->data + begin, (ssize_t)(end - begin)};
+}
+
+static cord_json_token_t token(cord_json_token_type_t type, cord_str_t value) {
+    return (cord_json_token_t){.type = type, .value = value};
+}
+
+static cord_json_token_t fail(cord_json_reader_t *reader, const char *error) {
+    if (reader->state != STATE_ERROR) {
+        reader->state = STATE_ERROR;
+        reader->error = error;
+    }
+    return token(CORD_JSON_TOKEN_ERROR, (cord_str_t){"", 0});
+}
+
+static void skip_whitespace(cord_json_reader_t *reader) {
+    const char *data = reader->data;
+    size_t position = reader->position;
+    while (position < reader->length &&
+           (data[position] == ' ' || data[position] == '\n' ||
+            data[position] == '\r' || data[position] == '\t')) {
+        position++;
+    }
+    reader->position = position;
+}
+
+static void after_value(cord_json_reader_t *reader) {
+    reader->state = reader->depth > 0 ? STATE_SEPARATOR : STATE_DONE;
+}
+
+static cord_json_token_t open_container(cord_json_reader_t *reader,
+                                        u8 container,
+                                        cord_json_token_type_t type) {
+    if (reader->depth >= CORD_JSON_MAX_DEPTH) {
+        return fail(reader, "JSON nested too deep");
+    }
+    reader->containers[reader->depth++] = container;
+    reader->state = container == CONTAINER_OBJECT ? STATE_KEY_OR_CLOSE
+                                                  : STATE_VALUE_OR_CLOSE;
+
+    size_t begin = reader->position++;
+    return token(type, slice(reader, begin, reader->position));
+}
+
+static cord_json_token_t close_container(cord_json_reader_t *reader,
+                                         cord_json_token_type_t type) {
+    reader->depth--;
+    after_value(reader);
+
+    size_t begin = reader->position++;
+    return token(type, slice(reader, begin, reader->position));
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static i32 hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool read_hex4(cord_str_t raw, ssize_t index, u32 *codepoint) {
+    if (index + 4 > raw.length) {
+        return false;
+    }
+
+    u32 value = 0;
+    for (ssize_t i = index; i < index + 4; i++) {
+        i32 digit = hex_value(raw.data[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | (u32)digit;
+    }
+    *codepoint = value;
+    return true;
+}
+
+static ssize_t encode_utf8(u32 codepoint, char *out) {
+    if (codepoint < 0x80) {
+        if (out) {
+            out[0] = (char)codepoint;
+        }
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        if (out) {
+            out[0] = (char)(0xC0 | (codepoint >> 6));
+            out[1] = (char)(0x80 | (codepoint & 0x3F));
+        }
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        if (out) {
+            out[0] = (char)(0xE0 | (codepoint >> 12));
+            out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            out[2] = (char)(0x80 | (codepoint & 0x3F));
+        }
+        return 3;
+    }
+    if (out) {
+        out[0] = (char)(0xF0 | (codepoint >> 18));
+        out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (codepoint & 0x3F));
+    }
+    return 4;
+}
+
+static bool is_high_surrogate(u32 codepoint) {
+    return codepoint >= 0xD800 && codepoint <= 0xDBFF;
+}
+
+static bool is_low_surrogate(u32 codepoint) {
+    return codepoint >= 0xDC00 && codepoint <= 0xDFFF;
+}
+
+/*
+ * Decode the escape sequences of raw into out and return the decoded length,
+ * or -1 if an escape is invalid. The result is never longer than raw. With
+ * a null out the escapes are only validated.
+ */
+static ssize_t unescape(cord_str_t raw, char *out) {
+    ssize_t length = 0;
+    ssize_t i = 0;
+
+    while (i < raw.length) {
+        char c = raw.data[i];
+        if (c != '\\') {
+            if (out) {
+                out[length] = c;
+            }
+            length++;
+            i++;
+            continue;
+        }
+
+        if (i + 1 >= raw.length) {
+            return -1;
+        }
+        char escape = raw.data[i + 1];
+        i += 2;
+
+        char decoded = 0;
+        switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                decoded = escape;
+                break;
+            case 'b':
+                decoded = '\b';
+                break;
+            case 'f':
+                decoded = '\f';
+                break;
+            case 'n':
+                decoded = '\n';
+                break;
+            case 'r':
+                decoded = '\r';
+                break;
+            case 't':
+                decoded = '\t';
+                break;
+            case 'u': {
+                u32 codepoint = 0;
+                if (!read_hex4(raw, i, &codepoint)) {
+                    return -1;
+                }
+                i += 4;
+
+                u32 low = 0;
+                if (is_high_surrogate(codepoint)) {
+                    bool has_pair = i + 1 < raw.length &&
+                                    raw.data[i] == '\\' &&
+                                    raw.data[i + 1] == 'u' &&
+                                    read_hex4(raw, i + 2, &low) &&
+                                    is_low_surrogate(low);
+                    if (has_pair) {
+                        codepoint =
+                            0x10000 + ((codepoint - 0xD800) << 10) +
+                            (low - 0xDC00);
+                        i += 6;
+                    } else {
+                        codepoint = 0xFFFD;
+                    }
+                } else if (is_low_surrogate(codepoint)) {
+                    codepoint = 0xFFFD;
+                }
+                length += encode_utf8(codepoint, out ? out + length : NULL);
+                continue;
+            }
+            default:
+                return -1;
+        }
+
+        if (out) {
+            out[length] = decoded;
+        }
+        length++;
+    }
+    return length;
+}
+
+/*
+ * Closing quote of the string starting at begin according to the index, or
+ * CORD_JSON_INDEX_END to scan for it
+ */
+static size_t indexed_string_end(cord_json_reader_t *reader, size_t begin) {
+    if (!reader->index) {
+        return CORD_JSON_INDEX_END;
+    }
+
+    size_t end = cord_json_index_next(reader->index, begin);
+    if (end == CORD_JSON_INDEX_END || reader->data[end] != '"') {
+        return CORD_JSON_INDEX_END;
+    }
+    return end;
+}
+
+static bool
+read_string(cord_json_reader_t *reader, bool decode, cord_str_t *out) {
+    const char *data = reader->data;
+    size_t begin = ++reader->position;
+    size_t position = begin;
+    bool escaped = false;
+
+    size_t end = indexed_string_end(reader, begin);
+    if (end != CORD_JSON_INDEX_END) {
+        if (reader->index->error < end) {
+            fail(reader, "Control character in string");
+            return false;
+        }
+        escaped = memchr(data + begin, '\\', end - begin) != NULL;
+        position = end;
+    } else {
+        while (position < reader->length) {
+            u8 c = (u8)data[position];
+            if (c == '"') {
+                break;
+            }
+            if (c == '\\') {
+                escaped = true;
+                position += 2;
+                continue;
+            }
+            if (c < 0x20) {
+                fail(reader, "Control character in string");
+                return false;
+            }
+            position++;
+        }
+    }
+
+    if (position >= reader->length) {
+        fail(reader, "Unterminated string");
+        return false;
+    }
+
+    cord_str_t raw = slice(reader, begin, position);
+    reader->position = position + 1;
+    if (!escaped) {
+        *out = raw;
+        return true;
+    }
+
+    if (!decode) {
+        if (unescape(raw, NULL) < 0) {
+            fail(reader, "Invalid escape sequence");
+            return false;
+        }
+        *out = raw;
+        return true;
+    }
+
+    if (!reader->allocator) {
+        fail(reader, "No allocator to decode escaped string");
+        return false;
+    }
+
+    char *decoded = balloc_uninit(reader->allocator, (size_t)raw.length + 1);
+    if (!decoded) {
+        fail(reader, "Failed to allocate escaped string");
+        return false;
+    }
+
+    ssize_t length = unescape(raw, decoded);
+    if (length < 0) {
+        fail(reader, "Invalid escape sequence");
+        return false;
+    }
+    decoded[length] = '\0';
+    *out = (cord_str_t){decoded, length};
+    return true;
+}
+
+static cord_json_token_t read_number(cord_json_reader_t *reader) {
+    const char *data = reader->data;
+    size_t length = reader->length;
+    size_t begin = reader->position;
+    size_t position = begin;
+
+    if (data[position] == '-') {
+        position++;
+    }
+
+    if (position < length && data[position] == '0') {
+        position++;
+    } else if (position < length && is_digit(data[position])) {
+        while (position < length && is_digit(data[position])) {
+            position++;
+        }
+    } else {
+        return fail(reader, "Invalid number");
+    }
+
+    if (position < length && data[position] == '.') {
+        position++;
+        if (position >= length || !is_digit(data[position])) {
+            return fail(reader, "Invalid number fraction");
+        }
+        while (position < length && is_digit(data[position])) {
+            position++;
+        }
+    }
+
+    if (position < length && (data[position] == 'e' || data[position] == 'E')) {
+        position++;
+        if (position < length &&
+            (data[position] == '+' || data[position] == '-')) {
+            position++;
+        }
+        if (position >= length || !is_digit(data[position])) {
+            return fail(reader, "Invalid number exponent");
+        }
+        while (position < length && is_digit(data[position])) {
+            position++;
+        }
+    }
+
+    reader->position = position;
+    after_value(reader);
+    return token(CORD_JSON_TOKEN_NUMBER, slice(reader, begin, position));
+}
+
+static cord_json_token_t read_literal(cord_json_reader_t *reader,
+                                      const char *literal,
+                                      cord_json_token_type_t type) {
+    size_t length = strlen(literal);
+    size_t begin = reader->position;
+    if (reader->length - begin < length ||
+        memcmp(reader->data + begin, literal, length) != 0) {
+        return fail(reader, "Invalid literal");
+    }
+
+    reader->position += length;
+    after_value(reader);
+    return token(type, slice(reader, begin, reader->position));
+}
+
+static cord_json_token_t read_value(cord_json_reader_t *reader, bool decode) {
+    char c = reader->data[reader->position];
+    switch (c) {
+        case '{':
+            return open_container(
+                reader, CONTAINER_OBJECT, CORD_JSON_TOKEN_OBJECT_START);
+        case '[':
+            return open_container(
+                reader, CONTAINER_ARRAY, CORD_JSON_TOKEN_ARRAY_START);
+        case '"': {
+            cord_str_t value = {0};
+            if (!read_string(reader, decode, &value)) {
+                return token(CORD_JSON_TOKEN_ERROR, (cord_str_t){"", 0});
+            }
+            after_value(reader);
+            return token(CORD_JSON_TOKEN_STRING, value);
+        }
+        case 't':
+            return read_literal(reader, "true", CORD_JSON_TOKEN_TRUE);
+        case 'f':
+            return read_literal(reader, "false", CORD_JSON_TOKEN_FALSE);
+        case 'n':
+            return read_literal(reader, "null", CORD_JSON_TOKEN_NULL);
+        default:
+            if (c == '-' || is_digit(c)) {
+                return read_number(reader);
+            }
+            return fail(reader, "Unexpected character");
+    }
+}
+
+static cord_json_token_t next_token(cord_json_reader_t *reader, bool decode) {
+    for (;;) {
+        skip_whitespace(reader);
+        bool at_end = reader->position >= reader->length;
+        char c = at_end ? '\0' : reader->data[reader->position];
+
+        switch (reader->state) {
+            case STATE_DONE:
+                if (!at_end) {
+                    return fail(reader, "Unexpected data after JSON value");
+                }
+                return token(CORD_JSON_TOKEN_END, (cord_str_t){"", 0});
+            case STATE_ERROR:
+                return token(CORD_JSON_TOKEN_ERROR, (cord_str_t){"", 0});
+            case STATE_SEPARATOR: {
+                u8 container = reader->containers[reader->depth - 1];
+                if (c == ',') {
+                    reader->position++;
+                    reader->state = container == CONTAINER_OBJECT
+                                        ? STATE_KEY
+                                        : STATE_VALUE;
+                    continue;
+                }
+                if (c == '}' && container == CONTAINER_OBJECT) {
+                    return close_container(reader, CORD_JSON_TOKEN_OBJECT_END);
+                }
+                if (c == ']' && container == CONTAINER_ARRAY) {
+                    return close_container(reader, CORD_JSON_TOKEN_ARRAY_END);
+                }
+                return fail(reader, "Expected ',' or end of container");
+            }
+            case STATE_KEY:
+            case STATE_KEY_OR_CLOSE: {
+                if (c == '}' && reader->state == STATE_KEY_OR_CLOSE) {
+                    return close_container(reader, CORD_JSON_TOKEN_OBJECT_END);
+                }
+                if (c != '"') {
+                    return fail(reader, "Expected object key");
+                }
+
+                cord_str_t key = {0};
+                if (!read_string(reader, decode, &key)) {
+                    return token(CORD_JSON_TOKEN_ERROR, (cord_str_t){"", 0});
+                }
+                skip_whitespace(reader);
+                if (reader->position >= reader->length ||
+                    reader->data[reader->position] != ':') {
+                    return fail(reader, "Expected ':' after object key");
+                }
+                reader->position++;
+                reader->state = STATE_VALUE;
+                return token(CORD_JSON_TOKEN_KEY, key);
+            }
+            case STATE_VALUE:
+            case STATE_VALUE_OR_CLOSE:
+                if (at_end) {
+                    return fail(reader, "Unexpected end of input");
+                }
+                if (c == ']' && reader->state == STATE_VALUE_OR_CLOSE) {
+                    return close_container(reader, CORD_JSON_TOKEN_ARRAY_END);
+                }
+                return read_value(reader, decode);
+        }
+    }
+}
+
+cord_json_token_t cord_json_next(cord_json_reader_t *reader) {
+    return next_token(reader, true);
+}
+
+bool cord_json_next_key(cord_json_reader_t *reader, cord_str_t *key) {
+    cord_json_token_t next = cord_json_next(reader);
+    if (next.type == CORD_JSON_TOKEN_KEY) {
+        *key = next.value;
+        return true;
+    }
+    if (next.type != CORD_JSON_TOKEN_OBJECT_END) {
+        fail(reader, "Expected object key");
+    }
+    return false;
+}
+
+bool cord_json_next_item(cord_json_reader_t *reader, cord_json_token_t *item) {
+    cord_json_token_t next = cord_json_next(reader);
+    if (next.type == CORD_JSON_TOKEN_ARRAY_END ||
+        next.type == CORD_JSON_TOKEN_ERROR) {
+        return false;
+    }
+    if (next.type == CORD_JSON_TOKEN_KEY) {
+        fail(reader, "Expected array item");
+        return false;
+    }
+    *item = next;
+    return true;
+}
+
+/*
+ * Close containers until the reader is back at depth, jumping from bracket
+ * to bracket through the index
+ */
+static bool skip_indexed(cord_json_reader_t *reader, i32 depth) {
+    cord_json_index_t *index = reader->index;
+    size_t position = reader->position;
+
+    while (reader->depth > depth) {
+        size_t next = cord_json_index_next(index, position);
+        if (next == CORD_JSON_INDEX_END) {
+            fail(reader, "Unexpected end of input");
+            return false;
+        }
+        position = next + 1;
+
+        char c = reader->data[next];
+        if (c == '"') {
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            if (reader->depth >= CORD_JSON_MAX_DEPTH) {
+                fail(reader, "JSON nested too deep");
+                return false;
+            }
+            reader->containers[reader->depth++] =
+                c == '{' ? CONTAINER_OBJECT : CONTAINER_ARRAY;
+            continue;
+        }
+
+        u8 container = c == '}' ? CONTAINER_OBJECT : CONTAINER_ARRAY;
+        if (reader->containers[reader->depth - 1] != container) {
+            fail(reader, "Mismatched brackets");
+            return false;
+        }
+        reader->depth--;
+    }
+
+    if (index->error < position) {
+        fail(reader, "Control character in string");
+        return false;
+    }
+
+    reader->position = position;
+    after_value(reader);
+    return true;
+}
+
+static bool skip_to_depth(cord_json_reader_t *reader, i32 depth) {
+    if (cord_json_failed(reader)) {
+        return false;
+    }
+    if (reader->index) {
+        return skip_indexed(reader, depth);
+    }
+
+    while (reader->depth > depth) {
+        if (next_token(reader, false).type == CORD_JSON_TOKEN_ERROR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool cord_json_skip(cord_json_reader_t *reader, cord_json_token_t token) {
+    if (token.type != CORD_JSON_TOKEN_OBJECT_START &&
+        token.type != CORD_JSON_TOKEN_ARRAY_START) {
+        return token.type != CORD_JSON_TOKEN_ERROR;
+    }
+    return skip_to_depth(reader, reader->depth - 1);
+}
+
+cord_str_t cord_json_read_raw(cord_json_reader_t *reader) {
+    skip_whitespace(reader);
+    size_t begin = reader->position;
+
+    cord_json_token_t value = next_token(reader, false);
+    if (value.type == CORD_JSON_TOKEN_KEY) {
+        fail(reader, "Expected value");
+    }
+    if (!cord_json_skip(reader, value) || cord_json_failed(reader)) {
+        return (cord_str_t){"", 0};
+    }
+    return slice(reader, begin, reader->position);
+}
+
+bool cord_json_finish_value(cord_json_reader_t *reader, i32 depth) {
+    if (reader->depth == depth && reader->state == STATE_VALUE) {
+        return cord_json_skip(reader, next_token(reader, false));
+    }
+    if (reader->depth > depth) {
+        return skip_to_depth(reader, depth);
+    }
+    return !cord_json_failed(reader);
+}
+
+bool cord_json_failed(cord_json_reader_t *reader) {
+    return reader->state == STATE_ERROR;
+}
+
+bool cord_json_token_to_i64(cord_json_token_t token, i64 *value) {
+    if (token.type != CORD_JSON_TOKEN_NUMBER) {
+        return false;
+    }
+
+    cord_str_t text = token.value;
+    bool negative = text.length > 0 && text.data[0] == '-';
+    u64 result = 0;
+    for (ssize_t i = negative ? 1 : 0; i < text.length; i++) {
+        if (!is_digit(text.data[i])) {
+            // Fractions and exponents are not integers
+            return false;
+        }
+        u64 digit = (u64)(text.data[i] - '0');
+        if (result > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+
+    u64 limit = negative ? (u64)INT64_MAX + 1 : (u64)INT64_MAX;
+    if (result > limit) {
+        return false;
+    }
+    *value = negative ? (i64)(0 - result) : (i64)result;
+    return true;
+}
+
+bool cord_json_token_to_f64(cord_json_token_t token, f64 *value) {
+    char buffer[64] = {0};
+    if (token.type != CORD_JSON_TOKEN_NUMBER ||
+        token.value.length >= (ssize_t)sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, token.value.data, token.value.length);
+    *value = strtod(buffer, NULL);
+    return true;
+}
+
+bool cord_json_token_is_bool(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_TRUE ||
+           token.type == CORD_JSON_TOKEN_FALSE;
+}
@@ -0,0 +1,123 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include "json_index.h"
+#include "memory.h"
+#include "simd.h"
+#include "strings.h"
+#include "typedefs.h"
+
+#include <stdbool.h>
+
+#define CORD_JSON_MAX_DEPTH 64
+
+// Inputs at least this large get a structural index when SIMD is available
+#define CORD_JSON_INDEX_THRESHOLD KB(16)
+
+typedef enum cord_json_token_type_t {
+    CORD_JSON_TOKEN_NONE,
+    CORD_JSON_TOKEN_OBJECT_START,
+    CORD_JSON_TOKEN_OBJECT_END,
+    CORD_JSON_TOKEN_ARRAY_START,
+    CORD_JSON_TOKEN_ARRAY_END,
+    CORD_JSON_TOKEN_KEY,
+    CORD_JSON_TOKEN_STRING,
+    CORD_JSON_TOKEN_NUMBER,
+    CORD_JSON_TOKEN_TRUE,
+    CORD_JSON_TOKEN_FALSE,
+    CORD_JSON_TOKEN_NULL,
+    // The root value is complete and only whitespace is left
+    CORD_JSON_TOKEN_END,
+    CORD_JSON_TOKEN_ERROR
+} cord_json_token_type_t;
+
+/*
+ * Token returned by the reader
+ *
+ * For keys and strings value holds the contents without the quotes, for
+ * numbers and literals the text of the token. Values are slices of the input
+ * unless a string contained escape sequences, in which case it's decoded into
+ * the reader's allocator.
+ */
+typedef struct cord_json_token_t {
+    cord_json_token_type_t type;
+    cord_str_t value;
+} cord_json_token_t;
+
+/*
+ * Streaming (pull) JSON reader
+ *
+ * Tokens are read one by one straight from the input buffer without building
+ * a tree. The only memory it ever needs is for decoding escaped strings,
+ * which comes from the bump allocator, so the input has to outlive both the
+ * reader and the tokens it returns.
+ *
+ * Large inputs are indexed so that strings and skipped values are scanned
+ * in bulk instead of byte by byte.
+ */
+typedef struct cord_json_reader_t {
+    const char *data;
+    size_t length;
+    size_t position;
+    cord_bump_t *allocator;
+
+    i32 depth;
+    u8 containers[CORD_JSON_MAX_DEPTH];
+    u8 state;
+    const char *error;
+
+    cord_json_index_t *index;
+} cord_json_reader_t;
+
+void cord_json_reader_init(cord_json_reader_t *reader,
+                           cord_str_t input,
+                           cord_bump_t *allocator);
+
+/*
+ * Index the input with the given instruction set (see json_index.h), which
+ * init already does for inputs above CORD_JSON_INDEX_THRESHOLD. Has to be
+ * called before reading any tokens.
+ */
+bool cord_json_reader_use_index(cord_json_reader_t *reader,
+                                cord_simd_level_t level);
+
+cord_json_token_t cord_json_next(cord_json_reader_t *reader);
+
+/*
+ * Iterate the members of an object whose start token was already read.
+ * Returns false at the end of the object or on error.
+ */
+bool cord_json_next_key(cord_json_reader_t *reader, cord_str_t *key);
+
+/*
+ * Iterate the items of an array whose start token was already read.
+ * Returns false at the end of the array or on error.
+ */
+bool cord_json_next_item(cord_json_reader_t *reader, cord_json_token_t *item);
+
+/*
+ * Skip the rest of the value that token starts. Scalars are already
+ * complete so only objects and arrays consume more input. With an index
+ * the skipped input is only checked for balanced brackets and valid
+ * strings.
+ */
+bool cord_json_skip(cord_json_reader_t *reader, cord_json_token_t token);
+
+/*
+ * Read the next value and return its raw JSON text
+ */
+cord_str_t cord_json_read_raw(cord_json_reader_t *reader);
+
+/*
+ * Consume whatever is left of a value that started at depth, whether it
+ * was not read at all, partially read or read completely
+ */
+bool cord_json_finish_value(cord_json_reader_t *reader, i32 depth);
+
+bool cord_json_failed(cord_json_reader_t *reader);
+
+bool cord_json_token_to_i64(cord_json_token_t token, i64 *value);
+bool cord_json_token_to_f64(cord_json_token_t token, f64 *value);
+bool cord_json_token_is_bool(cord_json_token_t token);
+
+#endif
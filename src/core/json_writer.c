@@ -0,0 +1,422 @@
+#include "json_writer.h"
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef CORD_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define JSON_WRITER_INITIAL_SIZE 256
+// Sign and the 19 digits of the largest i64
+#define MAX_INTEGER_LENGTH 20
+
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+void cord_json_writer_init(cord_json_writer_t *writer, cord_bump_t *allocator) {
+    assert(writer && "cord_json_writer_t must not be null");
+    assert(allocator && "allocator must not be null");
+
+    memset(writer, 0, sizeof(cord_json_writer_t));
+    writer->allocator = allocator;
+    writer->level = cord_simd_detect();
+}
+
+void cord_json_writer_init_buffer(cord_json_writer_t *writer,
+                                  char *buffer,
+                                  size_t size) {
+    assert(writer && "cord_json_writer_t must not be null");
+
+    memset(writer, 0, sizeof(cord_json_writer_t));
+    writer->data = buffer;
+    writer->capacity = buffer ? size : 0;
+    writer->level = cord_simd_detect();
+}
+
+void cord_json_writer_use_simd(cord_json_writer_t *writer,
+                               cord_simd_level_t level) {
+    writer->level = cord_simd_supported(level);
+}
+
+static bool fail(cord_json_writer_t *writer) {
+    writer->failed = true;
+    return false;
+}
+
+static bool reserve(cord_json_writer_t *writer, size_t size) {
+    if (writer->failed) {
+        return false;
+    }
+    if (size <= writer->capacity - writer->length) {
+        return true;
+    }
+    if (!writer->allocator) {
+        return fail(writer);
+    }
+
+    size_t capacity = writer->capacity ? writer->capacity * 2
+                                       : JSON_WRITER_INITIAL_SIZE;
+    while (capacity - writer->length < size) {
+        capacity *= 2;
+    }
+
+    if (writer->data && cord_bump_extend(writer->allocator,
+                                         writer->data,
+                                         writer->capacity,
+                                         capacity)) {
+        writer->capacity = capacity;
+        return true;
+    }
+
+    // The old output stays in the allocator until it is cleared
+    char *data = balloc_uninit(writer->allocator, capacity);
+    if (!data) {
+        return fail(writer);
+    }
+    if (writer->length > 0) {
+        memcpy(data, writer->data, writer->length);
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+    return true;
+}
+
+// Only after reserving
+static void put(cord_json_writer_t *writer, const char *data, size_t length) {
+    memcpy(writer->data + writer->length, data, length);
+    writer->length += length;
+}
+
+static void append(cord_json_writer_t *writer,
+                   const char *data,
+                   size_t length) {
+    if (reserve(writer, length)) {
+        put(writer, data, length);
+    }
+}
+
+static u64 depth_bit(cord_json_writer_t *writer) {
+    return (u64)1 << (writer->depth - 1);
+}
+
+/*
+ * Put the comma in front of a value unless it's the first one of its
+ * container or comes after a key. In objects only keys can come first.
+ */
+static bool begin_value(cord_json_writer_t *writer) {
+    if (writer->failed) {
+        return false;
+    }
+    if (writer->after_key) {
+        writer->after_key = false;
+        return true;
+    }
+    if (writer->depth == 0) {
+        // One root value only
+        return writer->length == 0 || fail(writer);
+    }
+
+    u64 bit = depth_bit(writer);
+    if (writer->objects & bit) {
+        return fail(writer);
+    }
+    if (writer->nonempty & bit) {
+        append(writer, ",", 1);
+    }
+    writer->nonempty |= bit;
+    return !writer->failed;
+}
+
+static void open_container(cord_json_writer_t *writer, bool object) {
+    if (!begin_value(writer)) {
+        return;
+    }
+    if (writer->depth >= CORD_JSON_WRITER_MAX_DEPTH) {
+        fail(writer);
+        return;
+    }
+
+    append(writer, object ? "{" : "[", 1);
+    writer->depth++;
+    u64 bit = depth_bit(writer);
+    writer->objects = object ? writer->objects | bit : writer->objects & ~bit;
+    writer->nonempty &= ~bit;
+}
+
+static void close_container(cord_json_writer_t *writer, bool object) {
+    if (writer->failed) {
+        return;
+    }
+    if (writer->depth == 0 || writer->after_key ||
+        ((writer->objects & depth_bit(writer)) != 0) != object) {
+        fail(writer);
+        return;
+    }
+
+    append(writer, object ? "}" : "]", 1);
+    writer->depth--;
+}
+
+void cord_json_write_object_start(cord_json_writer_t *writer) {
+    open_container(writer, true);
+}
+
+void cord_json_write_object_end(cord_json_writer_t *writer) {
+    close_container(writer, true);
+}
+
+void cord_json_write_array_start(cord_json_writer_t *writer) {
+    open_container(writer, false);
+}
+
+void cord_json_write_array_end(cord_json_writer_t *writer) {
+    close_container(writer, false);
+}
+
+void cord_json_write_key(cord_json_writer_t *writer, cord_str_t key) {
+    if (writer->failed) {
+        return;
+    }
+    if (writer->depth == 0 || writer->after_key ||
+        !(writer->objects & depth_bit(writer))) {
+        fail(writer);
+        return;
+    }
+
+    size_t length = key.length > 0 ? (size_t)key.length : 0;
+    if (!reserve(writer, length + 4)) {
+        return;
+    }
+    if (writer->nonempty & depth_bit(writer)) {
+        put(writer, ",", 1);
+    }
+    put(writer, "\"", 1);
+    put(writer, key.data, length);
+    put(writer, "\":", 2);
+    writer->nonempty |= depth_bit(writer);
+    writer->after_key = true;
+}
+
+static bool needs_escape(u8 c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+static size_t find_escape_scalar(const u8 *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (needs_escape(data[i])) {
+            return i;
+        }
+    }
+    return length;
+}
+
+#ifdef CORD_SIMD_X86
+__attribute__((target("sse2"))) static size_t
+find_escape_sse2(const u8 *data, size_t length) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                         _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk));
+
+        u32 mask = (u32)_mm_movemask_epi8(special);
+        if (mask) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return i + find_escape_scalar(data + i, length - i);
+}
+
+__attribute__((target("avx2"))) static size_t
+find_escape_avx2(const u8 *data, size_t length) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                            _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control_max), chunk));
+
+        u32 mask = (u32)_mm256_movemask_epi8(special);
+        if (mask) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return i + find_escape_sse2(data + i, length - i);
+}
+#endif
+
+// Index of the first character that needs escaping, length if none does
+static size_t find_escape(cord_simd_level_t level,
+                          const u8 *data,
+                          size_t length) {
+#ifdef CORD_SIMD_X86
+    switch (level) {
+        case CORD_SIMD_AVX2:
+            return find_escape_avx2(data, length);
+        case CORD_SIMD_SSE2:
+            return find_escape_sse2(data, length);
+        case CORD_SIMD_SCALAR:
+            break;
+    }
+#else
+    (void)level;
+#endif
+    return find_escape_scalar(data, length);
+}
+
+static void write_escape(cord_json_writer_t *writer, u8 c) {
+    static const char hex[] = "0123456789abcdef";
+
+    char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+    size_t length = 2;
+    switch (c) {
+        case '"':
+        case '\\':
+            escape[1] = (char)c;
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        case '\b':
+            escape[1] = 'b';
+            break;
+        case '\f':
+            escape[1] = 'f';
+            break;
+        default:
+            length = sizeof(escape);
+            break;
+    }
+    append(writer, escape, length);
+}
+
+void cord_json_write_string(cord_json_writer_t *writer, cord_str_t value) {
+    size_t length = value.length > 0 ? (size_t)value.length : 0;
+    // Enough unless something has to be escaped
+    if (!begin_value(writer) || !reserve(writer, length + 2)) {
+        return;
+    }
+
+    const u8 *data = (const u8 *)value.data;
+    put(writer, "\"", 1);
+    size_t start = 0;
+    while (start < length) {
+        size_t run = find_escape(writer->level, data + start, length - start);
+        append(writer, (const char *)data + start, run);
+        start += run;
+        if (start < length) {
+            write_escape(writer, data[start++]);
+        }
+    }
+    append(writer, "\"", 1);
+}
+
+// Digits of value ending at end, two at a time. Returns where they start.
+static char *write_digits(char *end, u64 value) {
+    while (value >= 100) {
+        const char *pair = digit_pairs + (value % 100) * 2;
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (value >= 10) {
+        const char *pair = digit_pairs + value * 2;
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+void cord_json_write_integer(cord_json_writer_t *writer, i64 value) {
+    if (!begin_value(writer)) {
+        return;
+    }
+
+    char digits[MAX_INTEGER_LENGTH];
+    char *end = digits + sizeof(digits);
+    char *start = write_digits(end, value < 0 ? -(u64)value : (u64)value);
+    if (value < 0) {
+        *--start = '-';
+    }
+    append(writer, start, (size_t)(end - start));
+}
+
+void cord_json_write_snowflake(cord_json_writer_t *writer,
+                               cord_snowflake_t id) {
+    if (!begin_value(writer)) {
+        return;
+    }
+
+    char digits[MAX_INTEGER_LENGTH + 2];
+    char *end = digits + sizeof(digits);
+    *--end = '"';
+    char *start = write_digits(end, id);
+    *--start = '"';
+    append(writer, start, (size_t)(end + 1 - start));
+}
+
+void cord_json_write_bool(cord_json_writer_t *writer, bool value) {
+    if (begin_value(writer)) {
+        append(writer, value ? "true" : "false", value ? 4 : 5);
+    }
+}
+
+void cord_json_write_null(cord_json_writer_t *writer) {
+    if (begin_value(writer)) {
+        append(writer, "null", 4);
+    }
+}
+
+void cord_json_write_raw(cord_json_writer_t *writer, cord_str_t json) {
+    if (json.length <= 0) {
+        fail(writer);
+        return;
+    }
+    if (begin_value(writer)) {
+        append(writer, json.data, (size_t)json.length);
+    }
+}
+
+bool cord_json_writer_failed(cord_json_writer_t *writer) {
+    return writer->failed;
+}
+
+cord_str_t cord_json_writer_finish(cord_json_writer_t *writer) {
+    if (writer->depth != 0 || writer->after_key || writer->length == 0) {
+        fail(writer);
+    }
+    if (!reserve(writer, 1)) {
+        return (cord_str_t){0};
+    }
+
+    writer->data[writer->length] = '\0';
+    return (cord_str_t){writer->data, (ssize_t)writer->length};
+}
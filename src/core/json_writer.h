@@ -0,0 +1,82 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "memory.h"
+#include "simd.h"
+#include "snowflake.h"
+#include "strings.h"
+#include "typedefs.h"
+
+#include <stdbool.h>
+
+#define CORD_JSON_WRITER_MAX_DEPTH 64
+
+/*
+ * Streaming JSON writer
+ *
+ * Values are written one after the other and the writer puts the commas
+ * and colons between them, keeping track of nesting with a bit per level.
+ * The output goes into a buffer the caller supplies, such as a send
+ * buffer, or into a bump allocator where it grows in place while nothing
+ * else is allocated after it. Nothing else is ever allocated. Strings are
+ * escaped as they are copied, the characters that need escaping are
+ * looked for 16 or 32 bytes at a time.
+ *
+ * Errors (running out of space, a value where a key belongs, unbalanced
+ * containers) stick: everything after them is ignored and finishing fails.
+ */
+typedef struct cord_json_writer_t {
+    char *data;
+    size_t length;
+    size_t capacity;
+    // Output grows in allocator, NULL for a fixed buffer
+    cord_bump_t *allocator;
+
+    i32 depth;
+    // Bits per depth, containers that are objects and ones with a value
+    u64 objects;
+    u64 nonempty;
+    bool after_key;
+    bool failed;
+
+    cord_simd_level_t level;
+} cord_json_writer_t;
+
+void cord_json_writer_init(cord_json_writer_t *writer, cord_bump_t *allocator);
+void cord_json_writer_init_buffer(cord_json_writer_t *writer,
+                                  char *buffer,
+                                  size_t size);
+
+// Escape strings with the given instruction set, the best one by default
+void cord_json_writer_use_simd(cord_json_writer_t *writer,
+                               cord_simd_level_t level);
+
+void cord_json_write_object_start(cord_json_writer_t *writer);
+void cord_json_write_object_end(cord_json_writer_t *writer);
+void cord_json_write_array_start(cord_json_writer_t *writer);
+void cord_json_write_array_end(cord_json_writer_t *writer);
+
+// Keys are written as they are, they are not escaped
+void cord_json_write_key(cord_json_writer_t *writer, cord_str_t key);
+
+void cord_json_write_string(cord_json_writer_t *writer, cord_str_t value);
+void cord_json_write_integer(cord_json_writer_t *writer, i64 value);
+void cord_json_write_bool(cord_json_writer_t *writer, bool value);
+void cord_json_write_null(cord_json_writer_t *writer);
+
+// Ids are strings in Discord's JSON
+void cord_json_write_snowflake(cord_json_writer_t *writer,
+                               cord_snowflake_t id);
+
+// A value that is JSON already
+void cord_json_write_raw(cord_json_writer_t *writer, cord_str_t json);
+
+bool cord_json_writer_failed(cord_json_writer_t *writer);
+
+/*
+ * The JSON written so far, NUL terminated. Invalid if writing failed or a
+ * container was left open.
+ */
+cord_str_t cord_json_writer_finish(cord_json_writer_t *writer);
+
+#endif
@@ -2,10 +2,16 @@
 #include "typedefs.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
 #include <time.h>
 
 #define tnormal "\x1B[0m"
@@ -15,15 +21,71 @@
 #define tyellow "\x1B[33m"
 #define tred "\x1B[31m"
 
+// Longer records are cut short
+#define LOG_RECORD_SIZE 1024
+// Per thread, a power of two
+#define LOG_RING_SIZE (64 * 1024)
+#define LOG_FLUSH_INTERVAL_MS 50
+// How long a thread waits for room with LOG_OVERFLOW_BLOCK
+#define LOG_BLOCK_TIMEOUT_MS 100
+#define LOG_MAX_IOVECS 64
+
+static const char *labels[] = {
+    [LOG_LEVEL_ERROR] = tblue "[ " tred "ERROR " tblue "]" tnormal,
+    [LOG_LEVEL_WARNING] = tblue "[ " tyellow "WARN  " tblue "]" tnormal,
+    [LOG_LEVEL_DEBUG] = tblue "[ " tpurple "DEBUG " tblue "]" tnormal,
+    [LOG_LEVEL_INFO] = tblue "[ " tgreen "INFO  " tblue "]" tnormal,
+};
+
+/*
+ * Records of one thread waiting for the flusher
+ *
+ * Only the thread writes head and only the flusher writes tail, both
+ * count bytes from the start and are wrapped when the data is indexed.
+ * The ring is shared by the thread and the logger, whichever lets go of it
+ * last frees it.
+ */
+struct cord_log_ring_t {
+    atomic_size_t head;
+    atomic_size_t tail;
+    atomic_int refs;
+    // Set once the logger stopped writing asynchronously
+    atomic_bool closed;
+
+    cord_log_ring_t *next;
+    char data[LOG_RING_SIZE];
+};
+
 static cord_logger_t *g_logger = NULL;
 
+static atomic_ullong ring_generations = 0;
+
+static _Thread_local cord_log_ring_t *thread_ring = NULL;
+static _Thread_local u64 thread_ring_generation = 0;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+// Loggers writing asynchronously, for the exit handler
+static cord_logger_t *async_loggers = NULL;
+static pthread_mutex_t async_loggers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t exit_handler_once = PTHREAD_ONCE_INIT;
+
+// Formatted date and time of the second the thread logged in last
+static _Thread_local time_t clock_second = -1;
+static _Thread_local char clock_text[64];
+
 cord_logger_t *logger_create(FILE *stream, i32 log_level, bool verbose) {
-    cord_logger_t *logger = malloc(sizeof(cord_logger_t));
+    cord_logger_t *logger = calloc(1, sizeof(cord_logger_t));
     if (logger) {
         logger->stream[0] = stream;
         logger->num_streams = 1;
         logger->log_level = log_level;
         logger->verbose = verbose;
+        pthread_mutex_init(&logger->lock, NULL);
+        pthread_cond_init(&logger->wakeup, NULL);
+        atomic_init(&logger->async, false);
+        atomic_init(&logger->generation, 0);
+        atomic_init(&logger->dropped, 0);
         return logger;
     }
 
@@ -31,6 +93,8 @@ cord_logger_t *logger_create(FILE *stream, i32 log_level, bool verbose) {
 }
 
 void logger_add_stream(cord_logger_t *logger, FILE *stream) {
+    assert(!atomic_load(&logger->async) &&
+           "Streams can't be added to an async logger");
     if (logger->num_streams < MAX_LOGGER_OUTPUT_STREAMS) {
         logger->stream[logger->num_streams++] = stream;
     }
@@ -38,12 +102,18 @@ void logger_add_stream(cord_logger_t *logger, FILE *stream) {
 
 void logger_destroy(cord_logger_t *logger) {
     if (logger) {
+        logger_stop_async(logger);
         for (i32 i = 0; i < logger->num_streams; i++) {
             FILE *stream = logger->stream[i];
             if (stream) {
                 fclose(stream);
             }
         }
+        pthread_mutex_destroy(&logger->lock);
+        pthread_cond_destroy(&logger->wakeup);
+        if (g_logger == logger) {
+            g_logger = NULL;
+        }
         free(logger);
     }
 }
@@ -57,147 +127,449 @@ void logger_use(cord_logger_t *logger) {
     g_logger = logger;
 }
 
-static void check_global_logger(void) {
-    if (!g_logger) {
-        fprintf(stderr, "failed: Global Logger is null\n");
-        return;
+cord_logger_t *global_logger(void) {
+    return g_logger;
+}
+
+static void ring_release(cord_log_ring_t *ring) {
+    if (atomic_fetch_sub_explicit(&ring->refs, 1, memory_order_acq_rel) ==
+        1) {
+        free(ring);
     }
 }
 
-static void set_date_time(char *buffer) {
-    time_t timer;
-    time(&timer);
-    struct tm tm = *localtime(&timer);
-    sprintf(buffer,
-            "%02d/%02d/%02d %02d:%02d:%02d",
-            tm.tm_mday,
-            tm.tm_mon + 1,
-            tm.tm_year + 1900,
-            tm.tm_hour,
-            tm.tm_min,
-            tm.tm_sec);
+static void ring_thread_exit(void *ring) {
+    ring_release(ring);
+}
+
+static void ring_key_create(void) {
+    pthread_key_create(&ring_key, ring_thread_exit);
+}
+
+static size_t ring_used(cord_log_ring_t *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_relaxed) -
+           atomic_load_explicit(&ring->tail, memory_order_acquire);
 }
 
-static void log_date_time(FILE *stream) {
-    if (stream) {
-        char date_time[24] = {0};
-        set_date_time(date_time);
-        fprintf(
-            stream, tyellow "[" tnormal "%s" tyellow "]" tnormal, date_time);
+/*
+ * Write as much of the iovecs as the stream takes, going on after short
+ * writes. Errors give up on the stream for this batch.
+ */
+static void write_all(FILE *stream, struct iovec *iov, i32 count) {
+    i32 fd = fileno(stream);
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+}
+
+static void write_batch(cord_logger_t *logger,
+                        struct iovec *iov,
+                        i32 count) {
+    for (i32 i = 0; i < logger->num_streams; i++) {
+        if (logger->stream[i]) {
+            // writev moves the iovecs of short writes, every stream
+            // gets its own
+            struct iovec copy[LOG_MAX_IOVECS + 1];
+            memcpy(copy, iov, sizeof(struct iovec) * (size_t)count);
+            write_all(logger->stream[i], copy, count);
+        }
     }
 }
 
-void logger_info(const char *fmt, ...) {
-    check_global_logger();
+/*
+ * Write what every ring holds, as few writev calls as there are streams
+ * unless there are more rings than iovecs. Rings whose thread exited are
+ * freed once they are empty. Called with the lock held.
+ */
+static void flush_rings(cord_logger_t *logger) {
+    static char dropped_text[64];
+    struct iovec iov[LOG_MAX_IOVECS + 1];
+    size_t heads[LOG_MAX_IOVECS / 2];
+    cord_log_ring_t *batch[LOG_MAX_IOVECS / 2];
+
+    u64 dropped = atomic_load(&logger->dropped);
+    i32 count = 0;
+    if (dropped != logger->reported_drops) {
+        i32 length = snprintf(dropped_text,
+                              sizeof(dropped_text),
+                              "%llu log records dropped\n",
+                              (unsigned long long)(dropped -
+                                                   logger->reported_drops));
+        iov[count++] = (struct iovec){dropped_text, (size_t)length};
+        logger->reported_drops = dropped;
+    }
 
-    if (g_logger->log_level >= LOG_LEVEL_INFO) {
-        for (int i = 0; i < g_logger->num_streams; i++) {
-            log_date_time(g_logger->stream[i]);
+    cord_log_ring_t **link = &logger->rings;
+    while (*link || count > 0) {
+        i32 num_batched = 0;
+        for (; *link && num_batched < LOG_MAX_IOVECS / 2;
+             link = &(*link)->next) {
+            cord_log_ring_t *ring = *link;
+            size_t tail = atomic_load_explicit(&ring->tail,
+                                               memory_order_relaxed);
+            size_t head = atomic_load_explicit(&ring->head,
+                                               memory_order_acquire);
+            if (head == tail) {
+                continue;
+            }
 
-            if (g_logger->verbose) {
-                fprintf(g_logger->stream[i],
-                        tblue "[ " tgreen "INFO  " tblue "]" tnormal " %s:%d: ",
-                        __FILENAME__,
-                        __LINE__);
+            size_t start = tail & (LOG_RING_SIZE - 1);
+            size_t length = head - tail;
+            size_t first = LOG_RING_SIZE - start;
+            if (length <= first) {
+                iov[count++] = (struct iovec){ring->data + start, length};
             } else {
-                fprintf(g_logger->stream[i],
-                        tblue "[ " tgreen "INFO  " tblue "]" tnormal " ");
+                iov[count++] = (struct iovec){ring->data + start, first};
+                iov[count++] = (struct iovec){ring->data, length - first};
             }
+            heads[num_batched] = head;
+            batch[num_batched++] = ring;
+        }
 
-            va_list args;
-            va_start(args, fmt);
-            vfprintf(g_logger->stream[i], fmt, args);
-            va_end(args);
-            fprintf(g_logger->stream[i], "\n");
+        if (count > 0) {
+            write_batch(logger, iov, count);
+            count = 0;
+        }
+        for (i32 i = 0; i < num_batched; i++) {
+            atomic_store_explicit(
+                &batch[i]->tail, heads[i], memory_order_release);
         }
     }
-}
 
-static void log_debug_label(FILE *stream) {
-    if (stream) {
-        fprintf(stream, tblue "[ " tpurple "DEBUG " tblue "]" tnormal " ");
+    // The thread of a ring only we still hold is gone
+    link = &logger->rings;
+    while (*link) {
+        cord_log_ring_t *ring = *link;
+        if (atomic_load(&ring->refs) == 1 && ring_used(ring) == 0) {
+            *link = ring->next;
+            ring_release(ring);
+        } else {
+            link = &ring->next;
+        }
     }
 }
 
-static void log_debug_label_vewrbose(FILE *stream) {
-    if (stream) {
-        fprintf(stream,
-                tblue "[ " tpurple "DEBUG " tblue "]" tnormal " %s:%d: ",
-                __FILENAME__,
-                __LINE__);
+static void *flush_loop(void *arg) {
+    cord_logger_t *logger = arg;
+
+    pthread_mutex_lock(&logger->lock);
+    while (!logger->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&logger->wakeup, &logger->lock, &deadline);
+        flush_rings(logger);
     }
+    pthread_mutex_unlock(&logger->lock);
+    return NULL;
 }
 
-void logger_debug(const char *fmt, ...) {
-#if NDEBUG
-// Do not log debug logs on release builds
-#else
-    check_global_logger();
+/*
+ * Fatal errors are logged right before exit(), which doesn't wait for the
+ * flushers. Their threads are still running, so the rings are consistent.
+ */
+static void flush_at_exit(void) {
+    pthread_mutex_lock(&async_loggers_lock);
+    for (cord_logger_t *it = async_loggers; it; it = it->next_async) {
+        logger_flush(it);
+    }
+    pthread_mutex_unlock(&async_loggers_lock);
+}
 
-    if (g_logger->log_level >= LOG_LEVEL_DEBUG) {
-        for (int i = 0; i < g_logger->num_streams; i++) {
-            log_date_time(g_logger->stream[i]);
+static void register_exit_handler(void) {
+    atexit(flush_at_exit);
+}
 
-            if (g_logger->verbose) {
-                log_debug_label_vewrbose(g_logger->stream[i]);
-            } else {
-                log_debug_label(g_logger->stream[i]);
-            }
+bool logger_start_async(cord_logger_t *logger, cord_log_overflow_t overflow) {
+    if (atomic_load(&logger->async)) {
+        return true;
+    }
 
-            va_list args;
-            va_start(args, fmt);
-            vfprintf(g_logger->stream[i], fmt, args);
-            va_end(args);
-            fprintf(g_logger->stream[i], "\n");
+    // What was written synchronously comes first
+    for (i32 i = 0; i < logger->num_streams; i++) {
+        if (logger->stream[i]) {
+            fflush(logger->stream[i]);
         }
     }
-#endif
+
+    logger->overflow = overflow;
+    logger->stopping = false;
+    u64 generation = atomic_fetch_add(&ring_generations, 1) + 1;
+    atomic_store(&logger->generation, generation);
+    if (pthread_create(&logger->flusher, NULL, flush_loop, logger) != 0) {
+        fprintf(stderr, "Failed to start the log flusher\n");
+        return false;
+    }
+    atomic_store(&logger->async, true);
+
+    pthread_once(&exit_handler_once, register_exit_handler);
+    pthread_mutex_lock(&async_loggers_lock);
+    logger->next_async = async_loggers;
+    async_loggers = logger;
+    pthread_mutex_unlock(&async_loggers_lock);
+    return true;
 }
 
-void logger_warn(const char *fmt, ...) {
-    check_global_logger();
+void logger_stop_async(cord_logger_t *logger) {
+    if (!atomic_load(&logger->async)) {
+        return;
+    }
 
-    if (g_logger->log_level >= LOG_LEVEL_ERROR) {
-        for (int i = 0; i < g_logger->num_streams; i++) {
-            log_date_time(g_logger->stream[i]);
+    pthread_mutex_lock(&async_loggers_lock);
+    cord_logger_t **link = &async_loggers;
+    while (*link && *link != logger) {
+        link = &(*link)->next_async;
+    }
+    if (*link) {
+        *link = logger->next_async;
+    }
+    pthread_mutex_unlock(&async_loggers_lock);
+
+    pthread_mutex_lock(&logger->lock);
+    logger->stopping = true;
+    pthread_cond_signal(&logger->wakeup);
+    pthread_mutex_unlock(&logger->lock);
+    pthread_join(logger->flusher, NULL);
+
+    pthread_mutex_lock(&logger->lock);
+    atomic_store(&logger->async, false);
+    flush_rings(logger);
+    while (logger->rings) {
+        cord_log_ring_t *ring = logger->rings;
+        logger->rings = ring->next;
+        atomic_store(&ring->closed, true);
+        ring_release(ring);
+    }
+    pthread_mutex_unlock(&logger->lock);
+}
 
-            if (g_logger->verbose) {
-                fprintf(g_logger->stream[i],
-                        tblue "[ " tyellow "WARN  " tblue "]" tnormal
-                              " %s:%d: ",
-                        __FILENAME__,
-                        __LINE__);
-            } else {
-                fprintf(g_logger->stream[i],
-                        tblue "[ " tyellow "WARN  " tblue "]" tnormal " ");
+void logger_flush(cord_logger_t *logger) {
+    if (atomic_load(&logger->async)) {
+        pthread_mutex_lock(&logger->lock);
+        flush_rings(logger);
+        pthread_mutex_unlock(&logger->lock);
+    } else {
+        for (i32 i = 0; i < logger->num_streams; i++) {
+            if (logger->stream[i]) {
+                fflush(logger->stream[i]);
             }
+        }
+    }
+}
+
+u64 logger_dropped(cord_logger_t *logger) {
+    return atomic_load(&logger->dropped);
+}
+
+/*
+ * Ring of the calling thread for this run of the logger. A ring left over
+ * from an earlier run is let go of, it's only read after checking that.
+ */
+static cord_log_ring_t *ring_of_thread(cord_logger_t *logger) {
+    cord_log_ring_t *ring = thread_ring;
+    if (ring && thread_ring_generation == atomic_load(&logger->generation) &&
+        !atomic_load_explicit(&ring->closed, memory_order_relaxed)) {
+        return ring;
+    }
+
+    pthread_once(&ring_key_once, ring_key_create);
+    if (ring) {
+        thread_ring = NULL;
+        pthread_setspecific(ring_key, NULL);
+        ring_release(ring);
+    }
+
+    ring = malloc(sizeof(cord_log_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->refs, 2);
+    atomic_init(&ring->closed, false);
+
+    pthread_mutex_lock(&logger->lock);
+    u64 generation = atomic_load(&logger->generation);
+    if (!atomic_load(&logger->async)) {
+        // Stopped while the ring was made, nobody would write it
+        pthread_mutex_unlock(&logger->lock);
+        free(ring);
+        return NULL;
+    }
+    ring->next = logger->rings;
+    logger->rings = ring;
+    pthread_mutex_unlock(&logger->lock);
+
+    thread_ring = ring;
+    thread_ring_generation = generation;
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
 
-            va_list args;
-            va_start(args, fmt);
-            vfprintf(g_logger->stream[i], fmt, args);
-            va_end(args);
-            fprintf(g_logger->stream[i], "\n");
+// Sleep for a millisecond at a time until the flusher made room
+static bool wait_for_room(cord_logger_t *logger,
+                          cord_log_ring_t *ring,
+                          size_t length) {
+    struct timespec pause = {0, 1000000L};
+    for (i32 i = 0; i < LOG_BLOCK_TIMEOUT_MS; i++) {
+        pthread_cond_signal(&logger->wakeup);
+        nanosleep(&pause, NULL);
+        if (LOG_RING_SIZE - ring_used(ring) >= length) {
+            return true;
+        }
+        if (atomic_load(&ring->closed)) {
+            return false;
         }
     }
+    return false;
+}
+
+static bool ring_push(cord_logger_t *logger,
+                      cord_log_ring_t *ring,
+                      const char *record,
+                      size_t length) {
+    if (LOG_RING_SIZE - ring_used(ring) < length &&
+        (logger->overflow == LOG_OVERFLOW_DROP ||
+         !wait_for_room(logger, ring, length))) {
+        return false;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t start = head & (LOG_RING_SIZE - 1);
+    size_t first = LOG_RING_SIZE - start;
+    if (length <= first) {
+        memcpy(ring->data + start, record, length);
+    } else {
+        memcpy(ring->data + start, record, first);
+        memcpy(ring->data, record + first, length - first);
+    }
+    atomic_store_explicit(&ring->head, head + length, memory_order_release);
+
+    // Past half full the flusher shouldn't wait for its timer
+    if (ring_used(ring) > LOG_RING_SIZE / 2) {
+        pthread_cond_signal(&logger->wakeup);
+    }
+    return true;
+}
+
+// Shards log from their own threads, every thread has its own clock
+static const char *date_time(void) {
+    time_t now = time(NULL);
+    if (now != clock_second) {
+        struct tm tm = {0};
+        localtime_r(&now, &tm);
+        snprintf(clock_text,
+                 sizeof(clock_text),
+                 tyellow "[" tnormal "%02d/%02d/%02d %02d:%02d:%02d" tyellow
+                         "]" tnormal,
+                 tm.tm_mday,
+                 tm.tm_mon + 1,
+                 tm.tm_year + 1900,
+                 tm.tm_hour,
+                 tm.tm_min,
+                 tm.tm_sec);
+        clock_second = now;
+    }
+    return clock_text;
 }
 
-void logger_error(const char *fmt, ...) {
-    check_global_logger();
+static size_t format_record(char *record,
+                            cord_logger_t *logger,
+                            i32 level,
+                            const char *file,
+                            i32 line,
+                            const char *fmt,
+                            va_list args) {
+    i32 length = 0;
+    if (level == LOG_LEVEL_ERROR) {
+        length = snprintf(record,
+                          LOG_RECORD_SIZE,
+                          "%s%s (%s:%d): ",
+                          date_time(),
+                          labels[level],
+                          file,
+                          line);
+    } else if (logger->verbose) {
+        length = snprintf(record,
+                          LOG_RECORD_SIZE,
+                          "%s%s %s:%d: ",
+                          date_time(),
+                          labels[level],
+                          file,
+                          line);
+    } else {
+        length = snprintf(
+            record, LOG_RECORD_SIZE, "%s%s ", date_time(), labels[level]);
+    }
 
-    if (g_logger->log_level >= LOG_LEVEL_ERROR) {
-        for (int i = 0; i < g_logger->num_streams; i++) {
-            log_date_time(g_logger->stream[i]);
+    // One byte is kept for the newline
+    size_t used = length < 0 ? 0 : (size_t)length;
+    if (used < LOG_RECORD_SIZE - 1) {
+        i32 message = vsnprintf(
+            record + used, LOG_RECORD_SIZE - 1 - used, fmt, args);
+        used += message < 0 ? 0 : (size_t)message;
+    }
+    if (used > LOG_RECORD_SIZE - 2) {
+        used = LOG_RECORD_SIZE - 2;
+    }
+    record[used++] = '\n';
+    return used;
+}
+
+void cord_log(i32 level, const char *file, i32 line, const char *fmt, ...) {
+    cord_logger_t *logger = g_logger;
+    if (!logger) {
+        fprintf(stderr, "failed: Global Logger is null\n");
+        return;
+    }
+#ifdef NDEBUG
+    // Do not log debug logs on release builds
+    if (level == LOG_LEVEL_DEBUG) {
+        return;
+    }
+#endif
+    if (level > logger->log_level) {
+        return;
+    }
 
-            fprintf(g_logger->stream[i],
-                    tblue "[ " tred "ERROR " tblue "]" tnormal " (%s:%d): ",
-                    __FILENAME__,
-                    __LINE__);
+    char record[LOG_RECORD_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    size_t length =
+        format_record(record, logger, level, file, line, fmt, args);
+    va_end(args);
+
+    if (atomic_load_explicit(&logger->async, memory_order_acquire)) {
+        cord_log_ring_t *ring = ring_of_thread(logger);
+        if (!ring || !ring_push(logger, ring, record, length)) {
+            atomic_fetch_add_explicit(
+                &logger->dropped, 1, memory_order_relaxed);
+        }
+        return;
+    }
 
-            va_list args;
-            va_start(args, fmt);
-            vfprintf(g_logger->stream[i], fmt, args);
-            va_end(args);
-            fprintf(g_logger->stream[i], "\n");
+    for (i32 i = 0; i < logger->num_streams; i++) {
+        if (logger->stream[i]) {
+            fwrite(record, 1, length, logger->stream[i]);
         }
     }
 }
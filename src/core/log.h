@@ -3,7 +3,9 @@
 
 #include "typedefs.h"
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,24 +26,85 @@ typedef enum cord_log_level {
     LOG_LEVEL_INFO,
 } cord_log_level;
 
+// What a thread logging into a full buffer does
+typedef enum cord_log_overflow_t {
+    LOG_OVERFLOW_DROP,
+    // Wait a little for the flusher, then drop
+    LOG_OVERFLOW_BLOCK
+} cord_log_overflow_t;
+
+typedef struct cord_log_ring_t cord_log_ring_t;
+
 typedef struct cord_logger_t {
     FILE *stream[MAX_LOGGER_OUTPUT_STREAMS];
     bool verbose;
     i32 num_streams;
     i32 log_level;
+
+    /*
+     * With logger_start_async() records are formatted into a ring buffer
+     * of the thread that logs them and written by a flusher thread, all
+     * rings at once with a writev per stream
+     */
+    // Read by every thread that logs while start and stop change it
+    atomic_bool async;
+    // Only read and written with the lock held
+    bool stopping;
+    cord_log_overflow_t overflow;
+    // Tells the threads' rings of this run apart from older ones
+    _Atomic u64 generation;
+    pthread_t flusher;
+    // Held by the flusher while it writes, and to register rings
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    cord_log_ring_t *rings;
+    // Next async logger, all of them are flushed when the process exits
+    struct cord_logger_t *next_async;
+    atomic_ullong dropped;
+    // Part of dropped the flusher already wrote a note about
+    u64 reported_drops;
 } cord_logger_t;
 
 cord_logger_t *logger_create(FILE *stream, i32 log_level, bool verbose);
 void logger_add_stream(cord_logger_t *logger, FILE *stream);
 void logger_destroy(cord_logger_t *logger);
 
+/*
+ * Move writing off the threads that log. Streams can't be added after
+ * this. Returns false if the flusher thread couldn't be started, the
+ * logger keeps writing synchronously then. What is still in the rings
+ * when the process calls exit() is written by an atexit handler.
+ */
+bool logger_start_async(cord_logger_t *logger, cord_log_overflow_t overflow);
+
+/*
+ * Write everything logged so far and go back to writing synchronously.
+ * Records logged by other threads while this runs may be lost.
+ */
+void logger_stop_async(cord_logger_t *logger);
+
+// Write everything logged so far before returning
+void logger_flush(cord_logger_t *logger);
+
+// Records dropped so far because a ring was full
+u64 logger_dropped(cord_logger_t *logger);
+
 void logger_use(cord_logger_t *logger);
+cord_logger_t *global_logger(void);
 void global_logger_init(void);
 void global_logger_destroy(void);
 
-void logger_info(const char *fmt, ...);
-void logger_debug(const char *fmt, ...);
-void logger_warn(const char *fmt, ...);
-void logger_error(const char *fmt, ...);
+void cord_log(i32 level, const char *file, i32 line, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+// Only verbose loggers print where a record was logged, errors always do
+#define logger_info(...)                                                       \
+    cord_log(LOG_LEVEL_INFO, __FILENAME__, __LINE__, __VA_ARGS__)
+#define logger_debug(...)                                                      \
+    cord_log(LOG_LEVEL_DEBUG, __FILENAME__, __LINE__, __VA_ARGS__)
+#define logger_warn(...)                                                       \
+    cord_log(LOG_LEVEL_WARNING, __FILENAME__, __LINE__, __VA_ARGS__)
+#define logger_error(...)                                                      \
+    cord_log(LOG_LEVEL_ERROR, __FILENAME__, __LINE__, __VA_ARGS__)
 
 #endif
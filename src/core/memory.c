@@ -2,6 +2,7 @@
 #include "log.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdalign.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -11,28 +12,45 @@
 
 #define DEFAULT_SIZE KB(4)
 
-typedef struct block_data_t {
-    cord_bump_t *block;
-    size_t idx;
-} block_data_t;
+// Blocks are allocated with their header, data starts at the next alignment
+static size_t block_header_size(void) {
+    size_t alignment = alignof(max_align_t);
+    return (sizeof(cord_bump_t) + alignment - 1) & ~(alignment - 1);
+}
+
+static cord_bump_t *block_create(size_t size) {
+    cord_bump_t *block = calloc(1, block_header_size() + size);
+    if (!block) {
+        return NULL;
+    }
+
+    block->data = (u8 *)block + block_header_size();
+    block->capacity = size;
+    block->used = 0;
+    block->high_water = 0;
+    block->next = NULL;
+    block->tail = NULL;
+    block->free_list = NULL;
+    return block;
+}
+
+static void blocks_destroy(cord_bump_t *block) {
+    while (block) {
+        cord_bump_t *next = block->next;
+        free(block);
+        block = next;
+    }
+}
 
 cord_bump_t *cord_bump_create_with_size(size_t size) {
     assert(size > 0 && "size must be a positive integer");
 
-    cord_bump_t *bump = malloc(sizeof(cord_bump_t));
+    cord_bump_t *bump = block_create(size);
     if (!bump) {
         return NULL;
     }
 
-    bump->data = calloc(1, size);
-    if (!bump->data) {
-        free(bump);
-        return NULL;
-    }
-
-    bump->capacity = size;
-    bump->used = 0;
-    bump->next = NULL;
+    bump->tail = bump;
     return bump;
 }
 
@@ -42,105 +60,289 @@ cord_bump_t *cord_bump_create(void) {
 
 void cord_bump_destroy(cord_bump_t *bump) {
     if (bump) {
-        if (bump->data) {
-            free(bump->data);
-        }
+        blocks_destroy(bump->free_list);
+        blocks_destroy(bump->next);
         free(bump);
     }
 }
 
 void cord_bump_clear(cord_bump_t *bump) {
-    cord_bump_t *it = bump;
-    while (it->next) {
-        it->used = 0;
-        it = it->next;
-    }
+    cord_bump_restore(bump, (cord_bump_marker_t){.block = bump, .used = 0});
 }
 
 void cord_bump_pop(cord_bump_t *bump, size_t size) {
-    size_t safe_size = (size > bump->used) ? bump->used : size;
-    bump->used -= safe_size;
+    cord_bump_t *tail = bump->tail;
+    size_t safe_size = (size > tail->used) ? tail->used : size;
+    tail->used -= safe_size;
 }
 
-static block_data_t find_last_block(cord_bump_t *bump) {
-    size_t last_block_idx = 0;
-    cord_bump_t *last = bump;
-    while (last->next) {
-        last_block_idx++;
-        last = last->next;
+// First retired block that fits size, taken off the free list
+static cord_bump_t *take_free_block(cord_bump_t *bump, size_t size) {
+    cord_bump_t **it = &bump->free_list;
+    while (*it) {
+        cord_bump_t *block = *it;
+        if (block->capacity >= size) {
+            *it = block->next;
+            return block;
+        }
+        it = &block->next;
     }
-    return (block_data_t){.block = last, .idx = last_block_idx};
+    return NULL;
 }
 
-static size_t cord_bump_remaining_memory(cord_bump_t *bump) {
-    // We can only allocate memory in the latest block
-    block_data_t last_bdata = find_last_block(bump);
-    cord_bump_t *last = last_bdata.block;
+static cord_bump_t *bump_grow(cord_bump_t *bump, size_t size) {
+    cord_bump_t *block = take_free_block(bump, size);
+    if (!block) {
+        size_t capacity = bump->tail->capacity * 2;
+        capacity = min(capacity, CORD_BUMP_MAX_BLOCK_SIZE);
+        block = block_create(max(capacity, size));
+        if (!block) {
+            logger_error("Failed to grow bump allocator by %zu bytes",
+                         max(capacity, size));
+            return NULL;
+        }
+    }
 
-    return last->capacity - last->used;
+    block->used = 0;
+    block->next = NULL;
+    bump->tail->next = block;
+    bump->tail = block;
+    return block;
 }
 
-void *balloc(cord_bump_t *bump, size_t size) {
+/*
+ * Take size bytes from the tail block. dirty is how many of them were
+ * handed out before, which are the only ones that may not be zero.
+ */
+static u8 *bump_take(cord_bump_t *bump, size_t size, size_t *dirty) {
     size_t alignment = alignof(max_align_t);
     size_t aligned_size = (size + alignment - 1) & ~(alignment - 1);
 
-    if (aligned_size > cord_bump_remaining_memory(bump)) {
-        size_t bump_size = max(DEFAULT_SIZE, aligned_size);
-        cord_bump_t *new_bump = cord_bump_create_with_size(bump_size);
-        if (new_bump) {
-            bump->next = new_bump;
-        } else {
+    cord_bump_t *tail = bump->tail;
+    if (aligned_size > tail->capacity - tail->used) {
+        tail = bump_grow(bump, aligned_size);
+        if (!tail) {
             return NULL;
         }
     }
 
-    block_data_t last_bdata = find_last_block(bump);
-    cord_bump_t *last = last_bdata.block;
-    assert((last->used + size) < last->capacity);
-
-    void *memory = &last->data[last->used];
-    memset(memory, 0, aligned_size);
-    last->used += aligned_size;
+    u8 *memory = &tail->data[tail->used];
+    *dirty = tail->high_water > tail->used ? tail->high_water - tail->used : 0;
+    tail->used += aligned_size;
+    tail->high_water = max(tail->high_water, tail->used);
+    return memory;
+}
 
+void *balloc(cord_bump_t *bump, size_t size) {
+    size_t dirty = 0;
+    u8 *memory = bump_take(bump, size, &dirty);
+    if (memory && dirty > 0) {
+        memset(memory, 0, min(dirty, size));
+    }
     return memory;
 }
 
+void *balloc_uninit(cord_bump_t *bump, size_t size) {
+    size_t dirty = 0;
+    return bump_take(bump, size, &dirty);
+}
+
+bool cord_bump_extend(cord_bump_t *bump,
+                      void *memory,
+                      size_t size,
+                      size_t new_size) {
+    size_t alignment = alignof(max_align_t);
+    size_t aligned_size = (size + alignment - 1) & ~(alignment - 1);
+    size_t aligned_new_size = (new_size + alignment - 1) & ~(alignment - 1);
+
+    cord_bump_t *tail = bump->tail;
+    u8 *end = (u8 *)memory + aligned_size;
+    if (end != tail->data + tail->used || aligned_new_size < aligned_size) {
+        return false;
+    }
+
+    size_t grow = aligned_new_size - aligned_size;
+    if (grow > tail->capacity - tail->used) {
+        return false;
+    }
+
+    tail->used += grow;
+    tail->high_water = max(tail->high_water, tail->used);
+    return true;
+}
+
+void *balloc_array(cord_bump_t *bump, size_t count, size_t size) {
+    if (size > 0 && count > SIZE_MAX / size) {
+        logger_error("Array of %zu elements of %zu bytes is too large",
+                     count,
+                     size);
+        return NULL;
+    }
+    return balloc_uninit(bump, count * size);
+}
+
 void *cord_bump_index(cord_bump_t *bump, size_t index) {
     size_t alignment = alignof(max_align_t);
     size_t aligned_size = (index + alignment - 1) & ~(alignment - 1);
     return bump->data + aligned_size;
 }
 
-cord_temp_memory_t cord_temp_memory_start(cord_bump_t *bump) {
-    block_data_t last_bdata = find_last_block(bump);
+cord_bump_marker_t cord_bump_mark(cord_bump_t *bump) {
+    return (cord_bump_marker_t){.block = bump->tail, .used = bump->tail->used};
+}
+
+void cord_bump_restore(cord_bump_t *bump, cord_bump_marker_t marker) {
+    cord_bump_t *block = marker.block;
+    if (block->next) {
+        // Retire the blocks after the marker in front of the free list
+        bump->tail->next = bump->free_list;
+        bump->free_list = block->next;
+        block->next = NULL;
+    }
+    block->used = marker.used;
+    bump->tail = block;
+}
 
+cord_temp_memory_t cord_temp_memory_start(cord_bump_t *bump) {
     return (cord_temp_memory_t){.allocator = bump,
-                                .allocated = 0,
-                                .block_idx = last_bdata.idx,
-                                .block_off = last_bdata.block->used};
+                                .marker = cord_bump_mark(bump)};
 }
 
 void cord_temp_memory_end(cord_temp_memory_t temp_memory) {
-    block_data_t last_bdata = find_last_block(temp_memory.allocator);
-
-    if (last_bdata.idx == temp_memory.block_idx) {
-        cord_bump_pop(temp_memory.allocator, temp_memory.allocated);
-    } else {
-        // Find block of temp memory start
-        cord_bump_t *temp_mem_block = temp_memory.allocator;
-        for (size_t i = 0; i <= temp_memory.block_idx; i++) {
-            temp_mem_block = temp_mem_block->next;
+    cord_bump_restore(temp_memory.allocator, temp_memory.marker);
+}
+
+typedef struct scratch_arenas_t {
+    cord_bump_t *arenas[CORD_SCRATCH_ARENAS];
+} scratch_arenas_t;
+
+static _Thread_local scratch_arenas_t scratch = {0};
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_key_once = PTHREAD_ONCE_INIT;
+
+static void scratch_destroy(void *arenas) {
+    scratch_arenas_t *thread_scratch = arenas;
+    for (i32 i = 0; i < CORD_SCRATCH_ARENAS; i++) {
+        cord_bump_destroy(thread_scratch->arenas[i]);
+        thread_scratch->arenas[i] = NULL;
+    }
+}
+
+static void scratch_key_create(void) {
+    pthread_key_create(&scratch_key, scratch_destroy);
+}
+
+static cord_bump_t *scratch_arena(i32 index) {
+    if (!scratch.arenas[index]) {
+        scratch.arenas[index] = cord_bump_create_with_size(CORD_SCRATCH_SIZE);
+        if (!scratch.arenas[index]) {
+            return NULL;
         }
 
-        // Free only as much as we allocated in this temp context
-        size_t max_pop = temp_mem_block->capacity - temp_memory.block_off;
-        size_t pop_size = min(temp_memory.allocated, max_pop);
-        cord_bump_pop(temp_mem_block, pop_size);
+        // The key only has a value so that the destructor runs on exit
+        pthread_once(&scratch_key_once, scratch_key_create);
+        pthread_setspecific(scratch_key, &scratch);
+    }
+    return scratch.arenas[index];
+}
 
-        cord_bump_t *it = temp_mem_block->next;
-        while (it->next) {
-            cord_bump_pop(it, it->capacity);
-            it = it->next;
+cord_temp_memory_t cord_scratch_begin(cord_bump_t *conflict) {
+    for (i32 i = 0; i < CORD_SCRATCH_ARENAS; i++) {
+        cord_bump_t *arena = scratch_arena(i);
+        if (arena && arena != conflict) {
+            return cord_temp_memory_start(arena);
         }
     }
+
+    logger_error("Failed to create scratch arena");
+    return (cord_temp_memory_t){0};
+}
+
+void cord_scratch_end(cord_temp_memory_t scratch_memory) {
+    if (scratch_memory.allocator) {
+        cord_temp_memory_end(scratch_memory);
+    }
+}
+
+void cord_scratch_release(void) {
+    // The key keeps pointing at the emptied arenas, destroying those is a no-op
+    scratch_destroy(&scratch);
+}
+
+size_t cord_bump_used(cord_bump_t *bump) {
+    size_t used = 0;
+    for (cord_bump_t *block = bump; block; block = block->next) {
+        used += block->used;
+    }
+    return used;
+}
+
+void cord_arena_pool_destroy(cord_arena_pool_t *pool) {
+    for (size_t i = 0; i < pool->num_arenas; i++) {
+        cord_bump_destroy(pool->arenas[i]);
+        pool->arenas[i] = NULL;
+    }
+    pool->num_arenas = 0;
+}
+
+cord_bump_t *cord_arena_pool_acquire(cord_arena_pool_t *pool) {
+    pool->stats.acquires++;
+    if (pool->num_arenas > 0) {
+        pool->stats.hits++;
+        return pool->arenas[--pool->num_arenas];
+    }
+
+    size_t size = max(pool->size_class, CORD_ARENA_POOL_MIN_SIZE);
+    cord_bump_t *arena = cord_bump_create_with_size(size);
+    if (!arena) {
+        logger_error("Failed to create arena of %zu bytes", size);
+    }
+    return arena;
+}
+
+static void learn_size_class(cord_arena_pool_t *pool, size_t used) {
+    pool->recent_peaks[pool->next_peak] = used;
+    pool->next_peak = (pool->next_peak + 1) % CORD_ARENA_POOL_HISTORY;
+
+    size_t peak = 0;
+    for (i32 i = 0; i < CORD_ARENA_POOL_HISTORY; i++) {
+        peak = max(peak, pool->recent_peaks[i]);
+    }
+
+    size_t size_class = CORD_ARENA_POOL_MIN_SIZE;
+    while (size_class < peak) {
+        size_class *= 2;
+    }
+    pool->size_class = size_class;
+}
+
+void cord_arena_pool_release(cord_arena_pool_t *pool, cord_bump_t *arena) {
+    if (!arena) {
+        return;
+    }
+
+    size_t used = cord_bump_used(arena);
+    bool grew = arena->next != NULL;
+    if (grew) {
+        pool->stats.grows++;
+    }
+    pool->stats.peak_bytes = max(pool->stats.peak_bytes, used);
+    learn_size_class(pool, used);
+
+    size_t oversized = pool->size_class * 4;
+    if (grew || arena->capacity < pool->size_class ||
+        arena->capacity > oversized ||
+        pool->num_arenas == CORD_ARENA_POOL_SLOTS) {
+        cord_bump_destroy(arena);
+        return;
+    }
+
+    cord_bump_clear(arena);
+    pool->arenas[pool->num_arenas++] = arena;
+}
+
+cord_arena_pool_stats_t cord_arena_pool_stats(cord_arena_pool_t *pool) {
+    cord_arena_pool_stats_t stats = pool->stats;
+    stats.size_class = max(pool->size_class, CORD_ARENA_POOL_MIN_SIZE);
+    return stats;
 }
@@ -1,6 +1,7 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -26,19 +27,36 @@ typedef struct cord_buffer_t {
     u8 data[];
 } cord_buffer_t;
 
+// Blocks grow geometrically up to this size, larger allocations get their own
+#define CORD_BUMP_MAX_BLOCK_SIZE MB(64)
+
 /*
  * Bump memory allocator
  *
  * Suitable for allocating a lot of small object (<4kb) that can be free'd
- * all at once. When a single block is full we create a new one pointed to
- * by next. Calls to balloc will always return zeroed memory
+ * all at once. When a block is full a new one, twice as large, is linked
+ * after tail, which is where allocations are made from. Blocks released by
+ * cord_bump_clear are kept in free_list and reused before allocating new
+ * ones, so an allocator that is cleared in a loop stops calling malloc once
+ * it has grown to its working size.
+ *
+ * Calls to balloc will always return zeroed memory. Blocks start zeroed and
+ * every block tracks the high-water mark of the memory it handed out, so
+ * balloc only zeroes memory below it, which was used before the allocator
+ * was cleared or popped. balloc_uninit skips zeroing for memory the caller
+ * overwrites right away.
  */
 typedef struct cord_bump_t {
     u8 *data;
     size_t capacity;
     size_t used;
+    // Memory past it has never been handed out and is still zero
+    size_t high_water;
 
     struct cord_bump_t *next;
+    // Last block of the chain, only set on the first block
+    struct cord_bump_t *tail;
+    struct cord_bump_t *free_list;
 } cord_bump_t;
 
 cord_bump_t *cord_bump_create(void);
@@ -48,6 +66,37 @@ void cord_bump_clear(cord_bump_t *bump);
 void cord_bump_pop(cord_bump_t *bump, size_t size);
 void *cord_bump_index(cord_bump_t *bump, size_t index);
 void *balloc(cord_bump_t *bump, size_t size);
+void *balloc_uninit(cord_bump_t *bump, size_t size);
+
+/*
+ * Grow the latest allocation of bump in place to new_size bytes, which only
+ * works while nothing was allocated after it and its block has room. The
+ * added memory is not zeroed.
+ */
+bool cord_bump_extend(cord_bump_t *bump,
+                      void *memory,
+                      size_t size,
+                      size_t new_size);
+
+/*
+ * Uninitialized memory for count elements of size bytes, NULL if the size
+ * overflows
+ */
+void *balloc_array(cord_bump_t *bump, size_t count, size_t size);
+
+/*
+ * Position of a bump allocator. Restoring it releases everything allocated
+ * after it was taken, blocks added since then are retired for reuse. Markers
+ * must be restored in the reverse order they were taken and not after the
+ * allocator was cleared.
+ */
+typedef struct cord_bump_marker_t {
+    cord_bump_t *block;
+    size_t used;
+} cord_bump_marker_t;
+
+cord_bump_marker_t cord_bump_mark(cord_bump_t *bump);
+void cord_bump_restore(cord_bump_t *bump, cord_bump_marker_t marker);
 
 /*
  * Bump memory allocator wrapper for allocating/freeing short-lived objects
@@ -55,15 +104,76 @@ void *balloc(cord_bump_t *bump, size_t size);
  * Used to mark the start and end of allocations that are required by a some
  * operation, so that we can pop the memory right after the operation finishes.
  * It's backed by a bump allocator that provides and owns the actual memory.
+ * Temp memory can be nested, the inner one has to end first.
  */
 typedef struct cord_temp_memory_t {
-    size_t allocated;
     cord_bump_t *allocator;
-    size_t block_idx;
-    size_t block_off;
+    cord_bump_marker_t marker;
 } cord_temp_memory_t;
 
 cord_temp_memory_t cord_temp_memory_start(cord_bump_t *bump);
 void cord_temp_memory_end(cord_temp_memory_t temp_memory);
 
+#define CORD_SCRATCH_SIZE KB(64)
+#define CORD_SCRATCH_ARENAS 2
+
+/*
+ * Temp memory from an arena of the calling thread, for allocations that
+ * don't outlive the function making them
+ *
+ * Every thread has two scratch arenas, created on first use and destroyed
+ * when the thread exits. A function that allocates its result in an
+ * allocator it was given passes it as conflict, so that its scratch memory
+ * comes from the other arena and ending it doesn't release the result.
+ * The allocator of the returned temp memory is NULL if malloc failed.
+ */
+cord_temp_memory_t cord_scratch_begin(cord_bump_t *conflict);
+void cord_scratch_end(cord_temp_memory_t scratch);
+// Destroy the scratch arenas of the calling thread, for the main thread
+// which never runs the exit destructor
+void cord_scratch_release(void);
+
+// Bytes handed out by every block of bump
+size_t cord_bump_used(cord_bump_t *bump);
+
+#define CORD_ARENA_POOL_SLOTS 4
+#define CORD_ARENA_POOL_HISTORY 32
+#define CORD_ARENA_POOL_MIN_SIZE KB(4)
+
+typedef struct cord_arena_pool_stats_t {
+    size_t acquires;
+    // Acquires served by a recycled arena, without calling malloc
+    size_t hits;
+    // Arenas that outgrew their size class and had to add blocks
+    size_t grows;
+    // Most bytes used by an arena between acquire and release
+    size_t peak_bytes;
+    size_t size_class;
+} cord_arena_pool_stats_t;
+
+/*
+ * Recycled arenas for memory that lives as long as one event
+ *
+ * Released arenas are cleared and kept for the next acquire. New arenas
+ * are created with a size class, the smallest power of two that fits the
+ * peak usage of the last CORD_ARENA_POOL_HISTORY releases, so that events
+ * fit in a single block. Arenas that outgrew it, or are far larger than
+ * it after a spike went by, are replaced instead of kept. Once the size
+ * class settles, acquire and release don't allocate. A zeroed pool is ready
+ * to use.
+ */
+typedef struct cord_arena_pool_t {
+    cord_bump_t *arenas[CORD_ARENA_POOL_SLOTS];
+    size_t num_arenas;
+    size_t size_class;
+    size_t recent_peaks[CORD_ARENA_POOL_HISTORY];
+    size_t next_peak;
+    cord_arena_pool_stats_t stats;
+} cord_arena_pool_t;
+
+void cord_arena_pool_destroy(cord_arena_pool_t *pool);
+cord_bump_t *cord_arena_pool_acquire(cord_arena_pool_t *pool);
+void cord_arena_pool_release(cord_arena_pool_t *pool, cord_bump_t *arena);
+cord_arena_pool_stats_t cord_arena_pool_stats(cord_arena_pool_t *pool);
+
 #endif
@@ -0,0 +1,31 @@
+#include "simd.h"
+
+cord_simd_level_t cord_simd_detect(void) {
+#ifdef CORD_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return CORD_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return CORD_SIMD_SSE2;
+    }
+#endif
+    return CORD_SIMD_SCALAR;
+}
+
+cord_simd_level_t cord_simd_supported(cord_simd_level_t level) {
+    cord_simd_level_t detected = cord_simd_detect();
+    return level > detected ? detected : level;
+}
+
+const char *cord_simd_level_name(cord_simd_level_t level) {
+    switch (level) {
+        case CORD_SIMD_SCALAR:
+            return "scalar";
+        case CORD_SIMD_SSE2:
+            return "sse2";
+        case CORD_SIMD_AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
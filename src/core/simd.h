@@ -0,0 +1,28 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "typedefs.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CORD_SIMD_X86 1
+#endif
+
+/*
+ * Instruction sets the vectorized code paths are written for, in the order
+ * of preference. Code that has a SIMD path picks the best level available
+ * at runtime and falls back to scalar code on other architectures.
+ */
+typedef enum cord_simd_level_t {
+    CORD_SIMD_SCALAR,
+    CORD_SIMD_SSE2,
+    CORD_SIMD_AVX2
+} cord_simd_level_t;
+
+cord_simd_level_t cord_simd_detect(void);
+
+// Clamp a requested level to what the CPU supports
+cord_simd_level_t cord_simd_supported(cord_simd_level_t level);
+
+const char *cord_simd_level_name(cord_simd_level_t level);
+
+#endif
@@ -0,0 +1,49 @@
+#include "snowflake.h"
+
+#include <stdint.h>
+#include <string.h>
+
+cord_snowflake_t cord_snowflake_parse(cord_str_t string) {
+    if (!cord_str_valid(string) || string.length == 0 ||
+        string.length > CORD_SNOWFLAKE_MAX_LENGTH) {
+        return 0;
+    }
+
+    u64 id = 0;
+    for (ssize_t i = 0; i < string.length; i++) {
+        u8 digit = (u8)string.data[i] - '0';
+        if (digit > 9 || id > (UINT64_MAX - digit) / 10) {
+            return 0;
+        }
+        id = id * 10 + digit;
+    }
+    return id;
+}
+
+cord_str_t cord_snowflake_format(cord_snowflake_t id, char *buffer) {
+    char digits[CORD_SNOWFLAKE_MAX_LENGTH];
+    size_t length = 0;
+    do {
+        digits[CORD_SNOWFLAKE_MAX_LENGTH - ++length] = (char)('0' + id % 10);
+        id /= 10;
+    } while (id > 0);
+
+    memcpy(buffer, digits + CORD_SNOWFLAKE_MAX_LENGTH - length, length);
+    return (cord_str_t){buffer, (ssize_t)length};
+}
+
+u64 cord_snowflake_timestamp(cord_snowflake_t id) {
+    return (id >> 22) + CORD_SNOWFLAKE_EPOCH;
+}
+
+u8 cord_snowflake_worker(cord_snowflake_t id) {
+    return (u8)((id >> 17) & 0x1F);
+}
+
+u8 cord_snowflake_process(cord_snowflake_t id) {
+    return (u8)((id >> 12) & 0x1F);
+}
+
+u16 cord_snowflake_sequence(cord_snowflake_t id) {
+    return (u16)(id & 0xFFF);
+}
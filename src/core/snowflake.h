@@ -0,0 +1,44 @@
+#ifndef SNOWFLAKE_H
+#define SNOWFLAKE_H
+
+#include "strings.h"
+#include "typedefs.h"
+
+/*
+ * Discord ids are snowflakes, 64-bit integers that are sent as strings in
+ * JSON. They are parsed once when an entity is decoded and compared,
+ * hashed and stored as integers from then on.
+ *
+ * From the highest bit down a snowflake holds the milliseconds since the
+ * Discord epoch (42 bits), the worker and process that created it (5 bits
+ * each) and an increment for ids created in the same millisecond (12 bits).
+ */
+typedef u64 cord_snowflake_t;
+
+// First millisecond of 2015, in milliseconds since the Unix epoch
+#define CORD_SNOWFLAKE_EPOCH 1420070400000ull
+
+// Decimal digits of the largest snowflake
+#define CORD_SNOWFLAKE_MAX_LENGTH 20
+
+/*
+ * Parse the decimal string of a snowflake. Returns 0, which is never a
+ * valid id, when the string is missing, empty, has anything but digits or
+ * overflows.
+ */
+cord_snowflake_t cord_snowflake_parse(cord_str_t string);
+
+/*
+ * Write the decimal digits of id to buffer, which must have room for
+ * CORD_SNOWFLAKE_MAX_LENGTH bytes. The result points into buffer and is not
+ * NUL terminated.
+ */
+cord_str_t cord_snowflake_format(cord_snowflake_t id, char *buffer);
+
+// Milliseconds since the Unix epoch when the id was created
+u64 cord_snowflake_timestamp(cord_snowflake_t id);
+u8 cord_snowflake_worker(cord_snowflake_t id);
+u8 cord_snowflake_process(cord_snowflake_t id);
+u16 cord_snowflake_sequence(cord_snowflake_t id);
+
+#endif
@@ -179,6 +179,24 @@ static size_t strbuf_memory_left(cord_strbuf_t *builder) {
     return builder->capacity - builder->length;
 }
 
+static char *strbuf_grow(cord_strbuf_t *builder, size_t new_size) {
+    cord_bump_t *bump = builder->allocator;
+    if (!bump) {
+        return realloc(builder->data, new_size);
+    }
+
+    if (cord_bump_extend(bump, builder->data, builder->capacity, new_size)) {
+        return builder->data;
+    }
+
+    // The old memory stays in the allocator until it is cleared
+    char *new_memory = balloc_uninit(bump, new_size);
+    if (new_memory) {
+        memcpy(new_memory, builder->data, builder->length);
+    }
+    return new_memory;
+}
+
 cord_strbuf_t *cord_strbuf_create_with_size(size_t size) {
     cord_strbuf_t *builder = malloc(sizeof(cord_strbuf_t));
     if (!builder) {
@@ -192,6 +210,7 @@ cord_strbuf_t *cord_strbuf_create_with_size(size_t size) {
     }
     builder->length = 0;
     builder->capacity = size;
+    builder->allocator = NULL;
     return builder;
 }
 
@@ -199,8 +218,27 @@ cord_strbuf_t *cord_strbuf_create(void) {
     return cord_strbuf_create_with_size(DEFAULT_STRBUF_SIZE);
 }
 
+cord_strbuf_t *cord_strbuf_create_in(cord_bump_t *bump, size_t size) {
+    assert(size > 0 && "size must be a positive integer");
+
+    cord_strbuf_t *builder = balloc(bump, sizeof(cord_strbuf_t));
+    if (!builder) {
+        return NULL;
+    }
+
+    // Allocated last so that it can grow in place
+    builder->data = balloc_uninit(bump, size);
+    if (!builder->data) {
+        return NULL;
+    }
+    builder->length = 0;
+    builder->capacity = size;
+    builder->allocator = bump;
+    return builder;
+}
+
 void cord_strbuf_destroy(cord_strbuf_t *builder) {
-    if (builder) {
+    if (builder && !builder->allocator) {
         if (builder->data) {
             free(builder->data);
             builder->data = NULL;
@@ -227,7 +265,10 @@ cord_strbuf_t *cord_strbuf_from_cstring(const char *cstring) {
 void cord_strbuf_append(cord_strbuf_t *builder, cord_str_t string) {
     if ((size_t)string.length > strbuf_memory_left(builder)) {
         size_t new_size = builder->capacity * STRBUF_GROWTH_FACTOR;
-        char *new_memory = realloc(builder->data, new_size);
+        while (new_size - builder->length < (size_t)string.length) {
+            new_size *= STRBUF_GROWTH_FACTOR;
+        }
+        char *new_memory = strbuf_grow(builder, new_size);
         if (!new_memory) {
             return;
         }
@@ -240,6 +281,16 @@ void cord_strbuf_append(cord_strbuf_t *builder, cord_str_t string) {
     builder->length += string.length;
 }
 
+char *cord_strbuf_terminate(cord_strbuf_t *builder) {
+    size_t length = builder->length;
+    cord_strbuf_append(builder, (cord_str_t){"", 1});
+    if (builder->length == length) {
+        return NULL;
+    }
+    builder->length = length;
+    return builder->data;
+}
+
 cord_str_t cord_strbuf_to_str_idx(cord_strbuf_t builder, size_t startIdx) {
     return (cord_str_t){builder.data + startIdx, builder.length};
 }
@@ -293,7 +344,11 @@ const char *not_null_cstring_dash(const char *string) {
 }
 
 char *cstring_of(cord_strbuf_t *builder, cord_bump_t *allocator) {
-    const size_t size = builder->length + 1;
-    char *cstring = balloc(allocator, size);
-    return memcpy(cstring, builder->data, size);
+    char *cstring = balloc_uninit(allocator, builder->length + 1);
+    if (!cstring) {
+        return NULL;
+    }
+    memcpy(cstring, builder->data, builder->length);
+    cstring[builder->length] = '\0';
+    return cstring;
 }
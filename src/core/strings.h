@@ -54,16 +54,18 @@ char cord_str_last_char(cord_str_t string);
 /*
  * String builder structure
  *
- * This is a string builder backed by a bump allocator that owns and
- * manages the memory that is uses. It is suitable for creating large
- * strings of size that is not known in compile-time. When the string builder
- * is no longer needed, it must be free'd using cord_strbuf_destroy().
- *
+ * It is suitable for creating large strings of size that is not known in
+ * compile-time. A string builder created with cord_strbuf_create_in lives in
+ * a bump allocator and grows inside it, so it is released along with
+ * everything else in the allocator. Otherwise it is on the heap and, when
+ * no longer needed, it must be free'd using cord_strbuf_destroy().
  */
 typedef struct cord_strbuf_t {
     char *data;
     size_t length;
     size_t capacity;
+    // Owns data when set, NULL for the heap
+    cord_bump_t *allocator;
 } cord_strbuf_t;
 
 #define cord_strbuf_null                                                       \
@@ -72,6 +74,7 @@ typedef struct cord_strbuf_t {
     }
 
 cord_strbuf_t *cord_strbuf_create(void);
+cord_strbuf_t *cord_strbuf_create_in(cord_bump_t *bump, size_t size);
 void cord_strbuf_destroy(cord_strbuf_t *builder);
 bool cord_strbuf_valid(cord_strbuf_t *builder);
 bool cord_strbuf_empty(cord_strbuf_t *builder);
@@ -82,6 +85,9 @@ cord_strbuf_t *cord_strbuf_from_cstring(const char *cstring);
  * to cord_str_t with cstr() function.
  */
 void cord_strbuf_append(cord_strbuf_t *builder, cord_str_t string);
+
+// NUL terminate the contents in place without counting it in the length
+char *cord_strbuf_terminate(cord_strbuf_t *builder);
 cord_strbuf_t *cord_strbuf_create_with_size(size_t size);
 cord_str_t cord_strbuf_to_str(cord_strbuf_t builder);
 
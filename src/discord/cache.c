@@ -0,0 +1,1084 @@
+#include "cache.h"
+#include "../core/log.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NO_ROW UINT32_MAX
+#define CACHE_INITIAL_ROWS 64
+// Room for the index next to its table
+#define INDEX_HEADER_SIZE KB(1)
+
+cord_cache_config_t cord_cache_default_config(u32 member_limit) {
+    cord_cache_config_t config = {0};
+    config.types[CORD_CACHE_GUILDS].policy = CORD_CACHE_FULL;
+    config.types[CORD_CACHE_CHANNELS].policy = CORD_CACHE_FULL;
+    config.types[CORD_CACHE_ROLES].policy = CORD_CACHE_FULL;
+    config.types[CORD_CACHE_MEMBERS].policy = CORD_CACHE_LRU;
+    config.types[CORD_CACHE_MEMBERS].limit = member_limit;
+    return config;
+}
+
+/*
+ * Columns are reallocated through their address, whatever the type of the
+ * array they point to
+ */
+typedef struct cache_column_t {
+    void *address;
+    size_t size;
+} cache_column_t;
+
+#define CACHE_MAX_COLUMNS 9
+#define column_of(array) ((cache_column_t){&(array), sizeof(*(array))})
+
+static u32 table_columns(cord_cache_t *cache,
+                         cord_cache_type_t type,
+                         cache_column_t *columns) {
+    cord_cache_table_t *table = &cache->tables[type];
+    u32 count = 0;
+    columns[count++] = column_of(table->ids);
+    columns[count++] = column_of(table->guild_ids);
+    columns[count++] = column_of(table->same_id);
+    columns[count++] = column_of(table->prev);
+    columns[count++] = column_of(table->next);
+
+    switch (type) {
+        case CORD_CACHE_GUILDS:
+            columns[count++] = column_of(cache->guild_owner_ids);
+            columns[count++] = column_of(cache->guild_member_counts);
+            columns[count++] = column_of(cache->guild_names);
+            break;
+        case CORD_CACHE_CHANNELS:
+            columns[count++] = column_of(cache->channel_parent_ids);
+            columns[count++] = column_of(cache->channel_types);
+            columns[count++] = column_of(cache->channel_positions);
+            columns[count++] = column_of(cache->channel_names);
+            break;
+        case CORD_CACHE_ROLES:
+            columns[count++] = column_of(cache->role_permissions);
+            columns[count++] = column_of(cache->role_colors);
+            columns[count++] = column_of(cache->role_positions);
+            columns[count++] = column_of(cache->role_names);
+            break;
+        case CORD_CACHE_MEMBERS:
+            columns[count++] = column_of(cache->member_nicks);
+            columns[count++] = column_of(cache->member_roles);
+            break;
+        default:
+            break;
+    }
+
+    assert(count <= CACHE_MAX_COLUMNS);
+    return count;
+}
+
+static void *column_data(cache_column_t column) {
+    void *data = NULL;
+    memcpy(&data, column.address, sizeof(data));
+    return data;
+}
+
+static bool table_init(cord_cache_table_t *table,
+                       cord_cache_type_config_t config) {
+    table->policy = config.policy;
+    table->limit = config.limit;
+    if (table->policy == CORD_CACHE_LRU && table->limit == 0) {
+        table->policy = CORD_CACHE_NONE;
+    }
+
+    table->head = NO_ROW;
+    table->tail = NO_ROW;
+    table->free_rows = NO_ROW;
+    if (table->policy == CORD_CACHE_NONE) {
+        return true;
+    }
+
+    table->index_allocator = cord_bump_create_with_size(KB(4));
+    if (!table->index_allocator) {
+        return false;
+    }
+    table->index = cord_u64_map_create(table->index_allocator, 0);
+    return table->index != NULL;
+}
+
+cord_cache_t *cord_cache_create(cord_cache_config_t config) {
+    cord_cache_t *cache = calloc(1, sizeof(cord_cache_t));
+    if (!cache) {
+        logger_error("Failed to allocate entity cache");
+        return NULL;
+    }
+
+    cache->config = config;
+    if (!cord_interner_init(&cache->strings)) {
+        logger_error("Failed to create entity cache strings");
+        free(cache);
+        return NULL;
+    }
+
+    for (i32 i = 0; i < CORD_CACHE_TYPE_COUNT; i++) {
+        if (!table_init(&cache->tables[i], config.types[i])) {
+            logger_error("Failed to create entity cache index");
+            cord_cache_destroy(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void cord_cache_destroy(cord_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+
+    for (i32 i = 0; i < CORD_CACHE_TYPE_COUNT; i++) {
+        cache_column_t columns[CACHE_MAX_COLUMNS];
+        u32 count = table_columns(cache, i, columns);
+        for (u32 c = 0; c < count; c++) {
+            free(column_data(columns[c]));
+        }
+        if (cache->tables[i].index_allocator) {
+            cord_bump_destroy(cache->tables[i].index_allocator);
+        }
+    }
+    cord_interner_destroy(&cache->strings);
+    free(cache);
+}
+
+static bool grow_table(cord_cache_t *cache, cord_cache_type_t type) {
+    cord_cache_table_t *table = &cache->tables[type];
+    u32 capacity = table->capacity ? table->capacity * 2 : CACHE_INITIAL_ROWS;
+    if (table->policy == CORD_CACHE_LRU && capacity > table->limit) {
+        capacity = table->limit;
+    }
+
+    // Columns that did grow keep their memory if a later one fails
+    cache_column_t columns[CACHE_MAX_COLUMNS];
+    u32 count = table_columns(cache, type, columns);
+    for (u32 c = 0; c < count; c++) {
+        void *data =
+            realloc(column_data(columns[c]), capacity * columns[c].size);
+        if (!data) {
+            logger_error("Failed to grow entity cache to %u rows", capacity);
+            return false;
+        }
+        memcpy(columns[c].address, &data, sizeof(data));
+    }
+
+    // Link the new rows so that the lowest ones are used first
+    for (u32 row = capacity; row > table->capacity; row--) {
+        table->next[row - 1] = table->free_rows;
+        table->free_rows = row - 1;
+    }
+    table->capacity = capacity;
+    return true;
+}
+
+static u32 index_get(cord_u64_map_t *index, cord_snowflake_t id) {
+    uintptr_t value = (uintptr_t)cord_u64_map_get(index, id);
+    return value ? (u32)(value - 1) : NO_ROW;
+}
+
+static bool index_put(cord_u64_map_t *index, cord_snowflake_t id, u32 row) {
+    return cord_u64_map_put(index, id, (void *)((uintptr_t)row + 1));
+}
+
+static size_t index_size(cord_u64_map_t *index) {
+    return index->capacity * (sizeof(i8) + sizeof(cord_u64_item_t));
+}
+
+/*
+ * Rebuild the index into an allocator that fits its table, once a new table
+ * didn't fit in the block the index was built in. That happens whenever it
+ * grows or rehashes deleted slots away, so it never holds more than one
+ * table it outgrew.
+ *
+ * The first row put for an id is the head of its chain and the other rows
+ * are linked after it, which changes their order but not what's found.
+ */
+static void compact_index(cord_cache_table_t *table) {
+    if (!table->index_allocator->next) {
+        return;
+    }
+
+    // Half the capacity as the number of items keeps the capacity
+    size_t size = index_size(table->index) + INDEX_HEADER_SIZE;
+    cord_bump_t *allocator = cord_bump_create_with_size(size);
+    cord_u64_map_t *index =
+        allocator ? cord_u64_map_create(allocator, table->index->capacity / 2)
+                  : NULL;
+    for (u32 row = table->head; index && row != NO_ROW;
+         row = table->next[row]) {
+        if (index_get(index, table->ids[row]) == NO_ROW &&
+            !index_put(index, table->ids[row], row)) {
+            index = NULL;
+        }
+    }
+
+    if (!index) {
+        // The old index is still complete, try again on the next insert
+        logger_warn("Failed to rebuild entity cache index");
+        if (allocator) {
+            cord_bump_destroy(allocator);
+        }
+        return;
+    }
+
+    for (u32 row = table->head; row != NO_ROW; row = table->next[row]) {
+        u32 first = index_get(index, table->ids[row]);
+        if (first == row) {
+            table->same_id[row] = NO_ROW;
+        } else {
+            table->same_id[row] = table->same_id[first];
+            table->same_id[first] = row;
+        }
+    }
+
+    cord_bump_destroy(table->index_allocator);
+    table->index_allocator = allocator;
+    table->index = index;
+}
+
+static void unlink_row(cord_cache_table_t *table, u32 row) {
+    u32 prev = table->prev[row];
+    u32 next = table->next[row];
+    if (prev != NO_ROW) {
+        table->next[prev] = next;
+    } else {
+        table->head = next;
+    }
+    if (next != NO_ROW) {
+        table->prev[next] = prev;
+    } else {
+        table->tail = prev;
+    }
+}
+
+static void push_front(cord_cache_table_t *table, u32 row) {
+    table->prev[row] = NO_ROW;
+    table->next[row] = table->head;
+    if (table->head != NO_ROW) {
+        table->prev[table->head] = row;
+    } else {
+        table->tail = row;
+    }
+    table->head = row;
+}
+
+static void touch_row(cord_cache_table_t *table, u32 row) {
+    if (table->head != row) {
+        unlink_row(table, row);
+        push_front(table, row);
+    }
+}
+
+// Members are the only entities whose ids are not unique on their own
+static u32 find_row(cord_cache_table_t *table,
+                    cord_cache_type_t type,
+                    cord_snowflake_t id,
+                    cord_snowflake_t guild_id) {
+    if (table->policy == CORD_CACHE_NONE) {
+        return NO_ROW;
+    }
+
+    u32 row = index_get(table->index, id);
+    if (type == CORD_CACHE_MEMBERS) {
+        while (row != NO_ROW && table->guild_ids[row] != guild_id) {
+            row = table->same_id[row];
+        }
+    }
+    return row;
+}
+
+static void release_strings(cord_cache_t *cache,
+                            cord_cache_type_t type,
+                            u32 row) {
+    cord_interner_t *strings = &cache->strings;
+    switch (type) {
+        case CORD_CACHE_GUILDS:
+            cord_intern_release(strings, cache->guild_names[row]);
+            break;
+        case CORD_CACHE_CHANNELS:
+            cord_intern_release(strings, cache->channel_names[row]);
+            break;
+        case CORD_CACHE_ROLES:
+            cord_intern_release(strings, cache->role_names[row]);
+            break;
+        case CORD_CACHE_MEMBERS:
+            cord_intern_release(strings, cache->member_nicks[row]);
+            cord_intern_release(strings, cache->member_roles[row]);
+            break;
+        default:
+            break;
+    }
+}
+
+static void remove_row(cord_cache_t *cache, cord_cache_type_t type, u32 row) {
+    cord_cache_table_t *table = &cache->tables[type];
+    unlink_row(table, row);
+
+    cord_snowflake_t id = table->ids[row];
+    u32 first = index_get(table->index, id);
+    if (first != row) {
+        while (table->same_id[first] != row) {
+            first = table->same_id[first];
+        }
+        table->same_id[first] = table->same_id[row];
+    } else if (table->same_id[row] != NO_ROW) {
+        // Replacing the value of a key never grows the index
+        index_put(table->index, id, table->same_id[row]);
+    } else {
+        cord_u64_map_remove(table->index, id);
+    }
+
+    release_strings(cache, type, row);
+    table->next[row] = table->free_rows;
+    table->free_rows = row;
+    table->count--;
+}
+
+/*
+ * Row of the entity, created with zeroed columns when it's not cached.
+ * Returns NO_ROW when the type is not cached or memory ran out.
+ */
+static u32 upsert_row(cord_cache_t *cache,
+                      cord_cache_type_t type,
+                      cord_snowflake_t id,
+                      cord_snowflake_t guild_id) {
+    cord_cache_table_t *table = &cache->tables[type];
+    u32 row = find_row(table, type, id, guild_id);
+    if (row != NO_ROW) {
+        touch_row(table, row);
+        table->guild_ids[row] = guild_id;
+        return row;
+    }
+    if (table->policy == CORD_CACHE_NONE || id == 0) {
+        return NO_ROW;
+    }
+
+    if (table->policy == CORD_CACHE_LRU && table->count >= table->limit) {
+        remove_row(cache, type, table->tail);
+    }
+    if (table->free_rows == NO_ROW && !grow_table(cache, type)) {
+        return NO_ROW;
+    }
+
+    row = table->free_rows;
+    u32 first = index_get(table->index, id);
+    if (!index_put(table->index, id, row)) {
+        logger_error("Failed to grow entity cache index");
+        return NO_ROW;
+    }
+    table->free_rows = table->next[row];
+
+    cache_column_t columns[CACHE_MAX_COLUMNS];
+    u32 count = table_columns(cache, type, columns);
+    for (u32 c = 0; c < count; c++) {
+        u8 *data = column_data(columns[c]);
+        memset(data + row * columns[c].size, 0, columns[c].size);
+    }
+
+    table->ids[row] = id;
+    table->guild_ids[row] = guild_id;
+    table->same_id[row] = first;
+    push_front(table, row);
+    table->count++;
+
+    compact_index(table);
+    return row;
+}
+
+static void remove_entity(cord_cache_t *cache,
+                          cord_cache_type_t type,
+                          cord_snowflake_t id,
+                          cord_snowflake_t guild_id) {
+    u32 row = find_row(&cache->tables[type], type, id, guild_id);
+    if (row != NO_ROW) {
+        remove_row(cache, type, row);
+    }
+}
+
+static void remove_guild_rows(cord_cache_t *cache,
+                              cord_cache_type_t type,
+                              cord_snowflake_t guild_id) {
+    cord_cache_table_t *table = &cache->tables[type];
+    u32 row = table->head;
+    while (row != NO_ROW) {
+        u32 next = table->next[row];
+        if (table->guild_ids[row] == guild_id) {
+            remove_row(cache, type, row);
+        }
+        row = next;
+    }
+}
+
+static cord_intern_t replace_string(cord_cache_t *cache,
+                                    cord_intern_t handle,
+                                    cord_str_t string) {
+    return cord_intern_replace(&cache->strings, handle, string);
+}
+
+/*
+ * Decoding
+ *
+ * Event data is decoded into the fields the cache keeps before any of it
+ * is applied, since fields like guild_id can come after the ones they
+ * qualify.
+ */
+
+static bool next_field(cord_json_reader_t *reader,
+                       i32 depth,
+                       cord_str_t *key,
+                       cord_json_token_t *value) {
+    if (!cord_json_finish_value(reader, depth) ||
+        !cord_json_next_key(reader, key)) {
+        return false;
+    }
+    *value = cord_json_next(reader);
+    return !cord_json_failed(reader);
+}
+
+static bool is_key(cord_str_t key, const char *name) {
+    return cord_str_equals_cstring(key, (char *)name);
+}
+
+static i32 number_of(cord_json_token_t token) {
+    i64 number = 0;
+    cord_json_token_to_i64(token, &number);
+    return (i32)number;
+}
+
+// Strings of ids are parsed, anything else is 0
+static cord_snowflake_t snowflake_of(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_STRING
+               ? cord_snowflake_parse(token.value)
+               : 0;
+}
+
+static cord_str_t string_of(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_STRING ? token.value
+                                                : (cord_str_t){"", 0};
+}
+
+// Read the id of an object such as the user of a member
+static cord_snowflake_t read_object_id(cord_json_reader_t *reader,
+                                       cord_json_token_t object) {
+    cord_snowflake_t id = 0;
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return id;
+    }
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    while (next_field(reader, depth, &key, &value)) {
+        if (is_key(key, "id")) {
+            id = snowflake_of(value);
+        }
+    }
+    return id;
+}
+
+typedef struct channel_fields_t {
+    cord_snowflake_t id;
+    cord_snowflake_t guild_id;
+    cord_snowflake_t parent_id;
+    cord_str_t name;
+    i32 type;
+    i32 position;
+} channel_fields_t;
+
+static bool read_channel(cord_json_reader_t *reader,
+                         cord_json_token_t object,
+                         channel_fields_t *channel) {
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    while (next_field(reader, depth, &key, &value)) {
+        if (is_key(key, "id")) {
+            channel->id = snowflake_of(value);
+        } else if (is_key(key, "guild_id")) {
+            channel->guild_id = snowflake_of(value);
+        } else if (is_key(key, "parent_id")) {
+            channel->parent_id = snowflake_of(value);
+        } else if (is_key(key, "name")) {
+            channel->name = string_of(value);
+        } else if (is_key(key, "type")) {
+            channel->type = number_of(value);
+        } else if (is_key(key, "position")) {
+            channel->position = number_of(value);
+        }
+    }
+    return !cord_json_failed(reader);
+}
+
+typedef struct role_fields_t {
+    cord_snowflake_t id;
+    cord_str_t name;
+    u64 permissions;
+    i32 color;
+    i32 position;
+} role_fields_t;
+
+static bool read_role(cord_json_reader_t *reader,
+                      cord_json_token_t object,
+                      role_fields_t *role) {
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    while (next_field(reader, depth, &key, &value)) {
+        if (is_key(key, "id")) {
+            role->id = snowflake_of(value);
+        } else if (is_key(key, "name")) {
+            role->name = string_of(value);
+        } else if (is_key(key, "permissions")) {
+            // Permissions are a bit set serialized like an id
+            role->permissions = snowflake_of(value);
+        } else if (is_key(key, "color")) {
+            role->color = number_of(value);
+        } else if (is_key(key, "position")) {
+            role->position = number_of(value);
+        }
+    }
+    return !cord_json_failed(reader);
+}
+
+typedef struct member_fields_t {
+    cord_snowflake_t user_id;
+    cord_snowflake_t guild_id;
+    cord_str_t nick;
+    cord_snowflake_t roles[CORD_CACHE_MAX_MEMBER_ROLES];
+    u32 num_roles;
+} member_fields_t;
+
+static void read_member_roles(cord_json_reader_t *reader,
+                              cord_json_token_t array,
+                              member_fields_t *member) {
+    if (array.type != CORD_JSON_TOKEN_ARRAY_START) {
+        return;
+    }
+
+    cord_json_token_t item = {0};
+    while (cord_json_next_item(reader, &item)) {
+        cord_snowflake_t role = snowflake_of(item);
+        if (role && member->num_roles < CORD_CACHE_MAX_MEMBER_ROLES) {
+            member->roles[member->num_roles++] = role;
+        }
+        cord_json_skip(reader, item);
+    }
+}
+
+static bool read_member(cord_json_reader_t *reader,
+                        cord_json_token_t object,
+                        member_fields_t *member) {
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    while (next_field(reader, depth, &key, &value)) {
+        if (is_key(key, "user")) {
+            member->user_id = read_object_id(reader, value);
+        } else if (is_key(key, "guild_id")) {
+            member->guild_id = snowflake_of(value);
+        } else if (is_key(key, "nick")) {
+            member->nick = string_of(value);
+        } else if (is_key(key, "roles")) {
+            read_member_roles(reader, value, member);
+        }
+    }
+    return !cord_json_failed(reader);
+}
+
+/*
+ * Updating
+ */
+
+static void put_channel(cord_cache_t *cache,
+                        channel_fields_t *channel,
+                        cord_snowflake_t guild_id) {
+    u32 row = upsert_row(cache, CORD_CACHE_CHANNELS, channel->id, guild_id);
+    if (row == NO_ROW) {
+        return;
+    }
+
+    cache->channel_parent_ids[row] = channel->parent_id;
+    cache->channel_types[row] = channel->type;
+    cache->channel_positions[row] = channel->position;
+    cache->channel_names[row] =
+        replace_string(cache, cache->channel_names[row], channel->name);
+}
+
+static void put_role(cord_cache_t *cache,
+                     role_fields_t *role,
+                     cord_snowflake_t guild_id) {
+    u32 row = upsert_row(cache, CORD_CACHE_ROLES, role->id, guild_id);
+    if (row == NO_ROW) {
+        return;
+    }
+
+    cache->role_permissions[row] = role->permissions;
+    cache->role_colors[row] = role->color;
+    cache->role_positions[row] = role->position;
+    cache->role_names[row] =
+        replace_string(cache, cache->role_names[row], role->name);
+}
+
+static void put_member(cord_cache_t *cache,
+                       member_fields_t *member,
+                       cord_snowflake_t guild_id) {
+    u32 row =
+        upsert_row(cache, CORD_CACHE_MEMBERS, member->user_id, guild_id);
+    if (row == NO_ROW) {
+        return;
+    }
+
+    cord_str_t roles = {
+        (char *)member->roles,
+        (ssize_t)(member->num_roles * sizeof(cord_snowflake_t)),
+    };
+    cache->member_nicks[row] =
+        replace_string(cache, cache->member_nicks[row], member->nick);
+    cache->member_roles[row] =
+        replace_string(cache, cache->member_roles[row], roles);
+}
+
+static void add_member_count(cord_cache_t *cache,
+                             cord_snowflake_t guild_id,
+                             i32 difference) {
+    cord_cache_table_t *guilds = &cache->tables[CORD_CACHE_GUILDS];
+    u32 row = find_row(guilds, CORD_CACHE_GUILDS, guild_id, 0);
+    if (row != NO_ROW) {
+        cache->guild_member_counts[row] += difference;
+    }
+}
+
+typedef enum guild_array_t {
+    GUILD_CHANNELS,
+    GUILD_ROLES,
+    GUILD_MEMBERS,
+
+    GUILD_ARRAY_COUNT
+} guild_array_t;
+
+/*
+ * Guild objects list their channels, roles and members without the id of
+ * the guild, which may come after them. The arrays are kept as raw JSON and
+ * read again once the id is known.
+ */
+typedef struct guild_fields_t {
+    cord_snowflake_t id;
+    cord_snowflake_t owner_id;
+    cord_str_t name;
+    // -1 when not sent, only GUILD_CREATE has it
+    i32 member_count;
+    bool unavailable;
+    cord_str_t arrays[GUILD_ARRAY_COUNT];
+} guild_fields_t;
+
+static bool read_guild(cord_json_reader_t *reader,
+                       cord_json_token_t object,
+                       guild_fields_t *guild) {
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    guild->member_count = -1;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    for (;;) {
+        if (!cord_json_finish_value(reader, depth) ||
+            !cord_json_next_key(reader, &key)) {
+            break;
+        }
+
+        guild_array_t array = GUILD_ARRAY_COUNT;
+        if (is_key(key, "channels")) {
+            array = GUILD_CHANNELS;
+        } else if (is_key(key, "roles")) {
+            array = GUILD_ROLES;
+        } else if (is_key(key, "members")) {
+            array = GUILD_MEMBERS;
+        }
+        if (array != GUILD_ARRAY_COUNT) {
+            guild->arrays[array] = cord_json_read_raw(reader);
+            continue;
+        }
+
+        value = cord_json_next(reader);
+        if (is_key(key, "id")) {
+            guild->id = snowflake_of(value);
+        } else if (is_key(key, "owner_id")) {
+            guild->owner_id = snowflake_of(value);
+        } else if (is_key(key, "name")) {
+            guild->name = string_of(value);
+        } else if (is_key(key, "member_count")) {
+            guild->member_count = number_of(value);
+        } else if (is_key(key, "unavailable")) {
+            guild->unavailable = value.type == CORD_JSON_TOKEN_TRUE;
+        }
+    }
+    return !cord_json_failed(reader);
+}
+
+static bool put_guild_array(cord_cache_t *cache,
+                            cord_str_t raw,
+                            guild_array_t array,
+                            cord_snowflake_t guild_id,
+                            cord_bump_t *allocator) {
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, raw, allocator);
+    if (cord_json_next(&reader).type != CORD_JSON_TOKEN_ARRAY_START) {
+        return false;
+    }
+
+    cord_json_token_t item = {0};
+    while (cord_json_next_item(&reader, &item)) {
+        if (item.type != CORD_JSON_TOKEN_OBJECT_START) {
+            cord_json_skip(&reader, item);
+        } else if (array == GUILD_CHANNELS) {
+            channel_fields_t channel = {0};
+            if (read_channel(&reader, item, &channel)) {
+                put_channel(cache, &channel, guild_id);
+            }
+        } else if (array == GUILD_ROLES) {
+            role_fields_t role = {0};
+            if (read_role(&reader, item, &role)) {
+                put_role(cache, &role, guild_id);
+            }
+        } else {
+            member_fields_t member = {0};
+            if (read_member(&reader, item, &member)) {
+                put_member(cache, &member, guild_id);
+            }
+        }
+    }
+    return !cord_json_failed(&reader);
+}
+
+static bool apply_guild(cord_cache_t *cache,
+                        cord_json_reader_t *data,
+                        bool create) {
+    guild_fields_t guild = {0};
+    if (!read_guild(data, cord_json_next(data), &guild)) {
+        return false;
+    }
+    // Guilds in an outage are sent without their data
+    if (guild.unavailable || guild.id == 0) {
+        return true;
+    }
+
+    u32 row = upsert_row(cache, CORD_CACHE_GUILDS, guild.id, 0);
+    if (row != NO_ROW) {
+        cache->guild_owner_ids[row] = guild.owner_id;
+        cache->guild_names[row] =
+            replace_string(cache, cache->guild_names[row], guild.name);
+        if (guild.member_count >= 0) {
+            cache->guild_member_counts[row] = guild.member_count;
+        }
+    }
+
+    bool success = true;
+    for (i32 i = 0; i < GUILD_ARRAY_COUNT; i++) {
+        // Updates list roles but leave channels and members to their events
+        if (guild.arrays[i].length > 0 && (create || i == GUILD_ROLES)) {
+            success &= put_guild_array(
+                cache, guild.arrays[i], i, guild.id, data->allocator);
+        }
+    }
+    return success;
+}
+
+static bool apply_guild_delete(cord_cache_t *cache, cord_json_reader_t *data) {
+    guild_fields_t guild = {0};
+    if (!read_guild(data, cord_json_next(data), &guild)) {
+        return false;
+    }
+    // Unavailable guilds come back with GUILD_CREATE, anything else was left
+    if (guild.unavailable) {
+        return true;
+    }
+
+    remove_entity(cache, CORD_CACHE_GUILDS, guild.id, 0);
+    remove_guild_rows(cache, CORD_CACHE_CHANNELS, guild.id);
+    remove_guild_rows(cache, CORD_CACHE_ROLES, guild.id);
+    remove_guild_rows(cache, CORD_CACHE_MEMBERS, guild.id);
+    return true;
+}
+
+static bool apply_channel(cord_cache_t *cache,
+                          cord_json_reader_t *data,
+                          bool deleted) {
+    channel_fields_t channel = {0};
+    if (!read_channel(data, cord_json_next(data), &channel)) {
+        return false;
+    }
+
+    if (deleted) {
+        remove_entity(cache, CORD_CACHE_CHANNELS, channel.id, 0);
+    } else {
+        put_channel(cache, &channel, channel.guild_id);
+    }
+    return true;
+}
+
+static bool apply_role(cord_cache_t *cache, cord_json_reader_t *data) {
+    cord_json_token_t object = cord_json_next(data);
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    cord_snowflake_t guild_id = 0;
+    role_fields_t role = {0};
+    i32 depth = data->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    while (next_field(data, depth, &key, &value)) {
+        if (is_key(key, "guild_id")) {
+            guild_id = snowflake_of(value);
+        } else if (is_key(key, "role")) {
+            read_role(data, value, &role);
+        }
+    }
+
+    if (cord_json_failed(data)) {
+        return false;
+    }
+    put_role(cache, &role, guild_id);
+    return true;
+}
+
+static bool apply_role_delete(cord_cache_t *cache, cord_json_reader_t *data) {
+    cord_json_token_t object = cord_json_next(data);
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    cord_snowflake_t role_id = 0;
+    i32 depth = data->depth;
+    cord_str_t key = {0};
+    cord_json_token_t value = {0};
+    while (next_field(data, depth, &key, &value)) {
+        if (is_key(key, "role_id")) {
+            role_id = snowflake_of(value);
+        }
+    }
+
+    remove_entity(cache, CORD_CACHE_ROLES, role_id, 0);
+    return !cord_json_failed(data);
+}
+
+static bool apply_member(cord_cache_t *cache,
+                         cord_json_reader_t *data,
+                         gateway_event_t event) {
+    member_fields_t member = {0};
+    if (!read_member(data, cord_json_next(data), &member)) {
+        return false;
+    }
+
+    if (event == GATEWAY_EVENT_GUILD_MEMBER_REMOVE) {
+        remove_entity(
+            cache, CORD_CACHE_MEMBERS, member.user_id, member.guild_id);
+        add_member_count(cache, member.guild_id, -1);
+        return true;
+    }
+
+    put_member(cache, &member, member.guild_id);
+    if (event == GATEWAY_EVENT_GUILD_MEMBER_ADD) {
+        add_member_count(cache, member.guild_id, 1);
+    }
+    return true;
+}
+
+static bool apply_members_chunk(cord_cache_t *cache,
+                                cord_json_reader_t *data) {
+    cord_json_token_t object = cord_json_next(data);
+    if (object.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    cord_snowflake_t guild_id = 0;
+    cord_str_t members = {0};
+    i32 depth = data->depth;
+    cord_str_t key = {0};
+    while (cord_json_finish_value(data, depth) &&
+           cord_json_next_key(data, &key)) {
+        if (is_key(key, "members")) {
+            members = cord_json_read_raw(data);
+        } else if (is_key(key, "guild_id")) {
+            guild_id = snowflake_of(cord_json_next(data));
+        }
+    }
+
+    if (cord_json_failed(data)) {
+        return false;
+    }
+    return members.length == 0 ||
+           put_guild_array(
+               cache, members, GUILD_MEMBERS, guild_id, data->allocator);
+}
+
+bool cord_cache_wants(cord_cache_t *cache, gateway_event_t event) {
+    cord_cache_type_t type = CORD_CACHE_TYPE_COUNT;
+    switch (event) {
+        case GATEWAY_EVENT_GUILD_CREATE:
+        case GATEWAY_EVENT_GUILD_UPDATE:
+        case GATEWAY_EVENT_GUILD_DELETE:
+            // Guilds carry the other types, cache them for any of them
+            for (i32 i = 0; i < CORD_CACHE_TYPE_COUNT; i++) {
+                if (cache->tables[i].policy != CORD_CACHE_NONE) {
+                    return true;
+                }
+            }
+            return false;
+        case GATEWAY_EVENT_CHANNEL_CREATE:
+        case GATEWAY_EVENT_CHANNEL_UPDATE:
+        case GATEWAY_EVENT_CHANNEL_DELETE:
+            type = CORD_CACHE_CHANNELS;
+            break;
+        case GATEWAY_EVENT_GUILD_ROLE_CREATE:
+        case GATEWAY_EVENT_GUILD_ROLE_UPDATE:
+        case GATEWAY_EVENT_GUILD_ROLE_DELETE:
+            type = CORD_CACHE_ROLES;
+            break;
+        case GATEWAY_EVENT_GUILD_MEMBER_ADD:
+        case GATEWAY_EVENT_GUILD_MEMBER_REMOVE:
+        case GATEWAY_EVENT_GUILD_MEMBER_UPDATE:
+        case GATEWAY_EVENT_GUILD_MEMBERS_CHUNK:
+            type = CORD_CACHE_MEMBERS;
+            break;
+        default:
+            return false;
+    }
+    return cache->tables[type].policy != CORD_CACHE_NONE;
+}
+
+bool cord_cache_apply(cord_cache_t *cache,
+                      gateway_event_t event,
+                      cord_json_reader_t *data) {
+    switch (event) {
+        case GATEWAY_EVENT_GUILD_CREATE:
+            return apply_guild(cache, data, true);
+        case GATEWAY_EVENT_GUILD_UPDATE:
+            return apply_guild(cache, data, false);
+        case GATEWAY_EVENT_GUILD_DELETE:
+            return apply_guild_delete(cache, data);
+        case GATEWAY_EVENT_CHANNEL_CREATE:
+        case GATEWAY_EVENT_CHANNEL_UPDATE:
+            return apply_channel(cache, data, false);
+        case GATEWAY_EVENT_CHANNEL_DELETE:
+            return apply_channel(cache, data, true);
+        case GATEWAY_EVENT_GUILD_ROLE_CREATE:
+        case GATEWAY_EVENT_GUILD_ROLE_UPDATE:
+            return apply_role(cache, data);
+        case GATEWAY_EVENT_GUILD_ROLE_DELETE:
+            return apply_role_delete(cache, data);
+        case GATEWAY_EVENT_GUILD_MEMBER_ADD:
+        case GATEWAY_EVENT_GUILD_MEMBER_REMOVE:
+        case GATEWAY_EVENT_GUILD_MEMBER_UPDATE:
+            return apply_member(cache, data, event);
+        case GATEWAY_EVENT_GUILD_MEMBERS_CHUNK:
+            return apply_members_chunk(cache, data);
+        default:
+            return true;
+    }
+}
+
+/*
+ * Reading
+ */
+
+static u32 read_row(cord_cache_t *cache,
+                    cord_cache_type_t type,
+                    cord_snowflake_t id,
+                    cord_snowflake_t guild_id) {
+    cord_cache_table_t *table = &cache->tables[type];
+    u32 row = find_row(table, type, id, guild_id);
+    if (row != NO_ROW) {
+        touch_row(table, row);
+    }
+    return row;
+}
+
+bool cord_cache_get_guild(cord_cache_t *cache,
+                          cord_snowflake_t id,
+                          cord_cached_guild_t *guild) {
+    u32 row = read_row(cache, CORD_CACHE_GUILDS, id, 0);
+    if (row == NO_ROW) {
+        return false;
+    }
+
+    guild->id = id;
+    guild->owner_id = cache->guild_owner_ids[row];
+    guild->name = cord_interned(&cache->strings, cache->guild_names[row]);
+    guild->member_count = cache->guild_member_counts[row];
+    return true;
+}
+
+bool cord_cache_get_channel(cord_cache_t *cache,
+                            cord_snowflake_t id,
+                            cord_cached_channel_t *channel) {
+    u32 row = read_row(cache, CORD_CACHE_CHANNELS, id, 0);
+    if (row == NO_ROW) {
+        return false;
+    }
+
+    channel->id = id;
+    channel->guild_id = cache->tables[CORD_CACHE_CHANNELS].guild_ids[row];
+    channel->parent_id = cache->channel_parent_ids[row];
+    channel->name = cord_interned(&cache->strings, cache->channel_names[row]);
+    channel->type = cache->channel_types[row];
+    channel->position = cache->channel_positions[row];
+    return true;
+}
+
+bool cord_cache_get_role(cord_cache_t *cache,
+                         cord_snowflake_t id,
+                         cord_cached_role_t *role) {
+    u32 row = read_row(cache, CORD_CACHE_ROLES, id, 0);
+    if (row == NO_ROW) {
+        return false;
+    }
+
+    role->id = id;
+    role->guild_id = cache->tables[CORD_CACHE_ROLES].guild_ids[row];
+    role->name = cord_interned(&cache->strings, cache->role_names[row]);
+    role->permissions = cache->role_permissions[row];
+    role->color = cache->role_colors[row];
+    role->position = cache->role_positions[row];
+    return true;
+}
+
+bool cord_cache_get_member(cord_cache_t *cache,
+                           cord_snowflake_t guild_id,
+                           cord_snowflake_t user_id,
+                           cord_cached_member_t *member) {
+    u32 row = read_row(cache, CORD_CACHE_MEMBERS, user_id, guild_id);
+    if (row == NO_ROW) {
+        return false;
+    }
+
+    member->user_id = user_id;
+    member->guild_id = guild_id;
+    // Interned strings are aligned like any other allocation
+    cord_str_t roles = cord_interned(&cache->strings, cache->member_roles[row]);
+    member->nick = cord_interned(&cache->strings, cache->member_nicks[row]);
+    member->roles = (const cord_snowflake_t *)roles.data;
+    member->num_roles = (u32)(roles.length / sizeof(cord_snowflake_t));
+    return true;
+}
+
+u32 cord_cache_count(cord_cache_t *cache, cord_cache_type_t type) {
+    return cache->tables[type].count;
+}
@@ -0,0 +1,198 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "../core/hashmap.h"
+#include "../core/intern.h"
+#include "../core/json_reader.h"
+#include "../core/memory.h"
+#include "../core/snowflake.h"
+#include "../core/strings.h"
+#include "events.h"
+
+#include <stdbool.h>
+
+// Members with more roles keep the first ones
+#define CORD_CACHE_MAX_MEMBER_ROLES 256
+
+typedef enum cord_cache_type_t {
+    CORD_CACHE_GUILDS,
+    CORD_CACHE_CHANNELS,
+    CORD_CACHE_ROLES,
+    CORD_CACHE_MEMBERS,
+
+    CORD_CACHE_TYPE_COUNT
+} cord_cache_type_t;
+
+typedef enum cord_cache_policy_t {
+    // Entities of the type are not kept
+    CORD_CACHE_NONE,
+    // Up to limit entities are kept, the least recently used one goes first
+    CORD_CACHE_LRU,
+    // Every entity is kept until the gateway deletes it
+    CORD_CACHE_FULL
+} cord_cache_policy_t;
+
+typedef struct cord_cache_type_config_t {
+    cord_cache_policy_t policy;
+    // Only used by CORD_CACHE_LRU, 0 caches nothing
+    u32 limit;
+} cord_cache_type_config_t;
+
+typedef struct cord_cache_config_t {
+    cord_cache_type_config_t types[CORD_CACHE_TYPE_COUNT];
+} cord_cache_config_t;
+
+/*
+ * Rows of one entity type, stored as struct of arrays
+ *
+ * Every row has the id of its entity and the guild it belongs to, the
+ * columns of the type are kept by the cache next to the table. Rows are
+ * found through index, which maps an id to its first row. Members are the
+ * only rows whose ids repeat, once per guild, and same_id chains them.
+ * Used rows are linked from most to least recently used, free rows are
+ * linked through next.
+ *
+ * Tables outgrown by the index stay in index_allocator, like with every
+ * cord_u64_map_t, so the index is rebuilt into a new allocator that fits
+ * it once they don't fit in the one it has.
+ */
+typedef struct cord_cache_table_t {
+    cord_cache_policy_t policy;
+    u32 limit;
+    u32 count;
+    u32 capacity;
+
+    cord_snowflake_t *ids;
+    cord_snowflake_t *guild_ids;
+    u32 *same_id;
+    u32 *prev;
+    u32 *next;
+    u32 head;
+    u32 tail;
+    u32 free_rows;
+
+    cord_u64_map_t *index;
+    cord_bump_t *index_allocator;
+} cord_cache_table_t;
+
+/*
+ * Views of cached entities
+ *
+ * They point into the cache and are filled without allocating, so they are
+ * only valid until the cache is next updated, which only happens on the
+ * thread of the client that owns it.
+ */
+typedef struct cord_cached_guild_t {
+    cord_snowflake_t id;
+    cord_snowflake_t owner_id;
+    cord_str_t name;
+    i32 member_count;
+} cord_cached_guild_t;
+
+typedef struct cord_cached_channel_t {
+    cord_snowflake_t id;
+    cord_snowflake_t guild_id;
+    cord_snowflake_t parent_id;
+    cord_str_t name;
+    i32 type;
+    i32 position;
+} cord_cached_channel_t;
+
+typedef struct cord_cached_role_t {
+    cord_snowflake_t id;
+    cord_snowflake_t guild_id;
+    cord_str_t name;
+    u64 permissions;
+    i32 color;
+    i32 position;
+} cord_cached_role_t;
+
+typedef struct cord_cached_member_t {
+    cord_snowflake_t user_id;
+    cord_snowflake_t guild_id;
+    cord_str_t nick;
+    const cord_snowflake_t *roles;
+    u32 num_roles;
+} cord_cached_member_t;
+
+/*
+ * State of the guilds a client is in, kept up to date from gateway events
+ *
+ * Each entity type is cached according to its policy and nothing is kept
+ * for CORD_CACHE_NONE. Columns are arrays of fixed size values that grow
+ * with their table. Data of variable size, names and the role sets of
+ * members, is interned, so a column only holds its handle and the many
+ * members that share a set of roles share its copy. Deleting a guild
+ * deletes its channels, roles and members.
+ */
+typedef struct cord_cache_t {
+    cord_cache_table_t tables[CORD_CACHE_TYPE_COUNT];
+
+    // Guilds
+    cord_snowflake_t *guild_owner_ids;
+    i32 *guild_member_counts;
+    cord_intern_t *guild_names;
+
+    // Channels
+    cord_snowflake_t *channel_parent_ids;
+    i32 *channel_types;
+    i32 *channel_positions;
+    cord_intern_t *channel_names;
+
+    // Roles
+    u64 *role_permissions;
+    i32 *role_colors;
+    i32 *role_positions;
+    cord_intern_t *role_names;
+
+    // Members, roles are the bytes of their array of ids
+    cord_intern_t *member_nicks;
+    cord_intern_t *member_roles;
+
+    // Strings of every table
+    cord_interner_t strings;
+    cord_cache_config_t config;
+} cord_cache_t;
+
+/*
+ * A config that keeps every guild, channel and role, and the given number
+ * of most recently seen members
+ */
+cord_cache_config_t cord_cache_default_config(u32 member_limit);
+
+cord_cache_t *cord_cache_create(cord_cache_config_t config);
+void cord_cache_destroy(cord_cache_t *cache);
+
+// Whether events of type are used by the cache
+bool cord_cache_wants(cord_cache_t *cache, gateway_event_t event);
+
+/*
+ * Apply a gateway event to the cache, data is positioned right before the
+ * event data like for event handlers. Events the cache doesn't use are
+ * ignored. Returns false if the data could not be read.
+ */
+bool cord_cache_apply(cord_cache_t *cache,
+                      gateway_event_t event,
+                      cord_json_reader_t *data);
+
+/*
+ * Readers fill a view and return true when the entity is cached. Reading
+ * an entity marks it as recently used.
+ */
+bool cord_cache_get_guild(cord_cache_t *cache,
+                          cord_snowflake_t id,
+                          cord_cached_guild_t *guild);
+bool cord_cache_get_channel(cord_cache_t *cache,
+                            cord_snowflake_t id,
+                            cord_cached_channel_t *channel);
+bool cord_cache_get_role(cord_cache_t *cache,
+                         cord_snowflake_t id,
+                         cord_cached_role_t *role);
+bool cord_cache_get_member(cord_cache_t *cache,
+                           cord_snowflake_t guild_id,
+                           cord_snowflake_t user_id,
+                           cord_cached_member_t *member);
+
+u32 cord_cache_count(cord_cache_t *cache, cord_cache_type_t type);
+
+#endif
@@ -1,14 +1,16 @@
 #include "client.h"
 #include "../cord/cord.h"
+#include "../core/json_writer.h"
 #include "../core/log.h"
 #include "../core/typedefs.h"
+#include "cache.h"
 #include "client.h"
 #include "events.h"
 #include "serialization.h"
+#include "shard.h"
 
 #include <assert.h>
 #include <ev.h>
-#include <jansson.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,27 +18,6 @@
 #include <uwsc/config.h>
 #include <uwsc/uwsc.h>
 
-const i32 GUILDS = (1 << 0);
-const i32 GUILD_MODERATION = (1 << 2);
-const i32 GUILD_EMOJIS_AND_STICKERS = (1 << 3);
-const i32 GUILD_INTEGRATIONS = (1 << 4);
-const i32 GUILD_WEBHOOKS = (1 << 5);
-const i32 GUILD_INVITES = (1 << 6);
-const i32 GUILD_MESSAGES = (1 << 9);
-const i32 GUILD_MESSAGE_REACTIONS = (1 << 10);
-const i32 GUILD_MESSAGE_TYPING = (1 << 11);
-
-const i32 DIRECT_MESSAGES = (1 << 12);
-const i32 DIRECT_MESSAGE_REACTIONS = (1 << 13);
-const i32 DIRECT_MESSAGE_TYPING = (1 << 14);
-const i32 MESSAGE_CONTENT = (1 << 15);
-
-const i32 GUILD_SCHEDULE_EVENTS = (1 << 16);
-const i32 AUTO_MODERATION_CONFIGURATION = (1 << 20);
-const i32 AUTO_MODERATION_EXECUTION = (1 << 21);
-const i32 GUILD_MESSAGE_POLLS = (1 << 24);
-const i32 DIRECT_MESSAGE_POLLS = (1 << 25);
-
 static void load_identity_info(identity_info_t *identity) {
     identity->token = getenv("CORD_APPLICATION_TOKEN");
     if (!identity->token) {
@@ -57,78 +38,108 @@ static bool is_valid_sequence(i32 s) {
     return s >= 0;
 }
 
-static f64 heartbeat_to_double(i32 interval) {
-    i32 decimal = interval / 1000;
-    i32 floating_ms = interval % 1000;
-
-    f64 decimal_d = (f64)decimal;
-    f64 floating_d = (f64)floating_ms * 0.001;
-    return decimal_d + floating_d;
+static bool has_session(cord_client_t *client) {
+    return client->session_id[0] != '\0';
 }
 
-typedef struct buf {
-    char *data;
-    size_t length;
-} buf;
-
-static bool is_valid_payload(buf payload) {
-    return payload.data && payload.length > 0;
+// The next connection identifies with a new session
+static void clear_session(cord_client_t *client) {
+    client->session_id[0] = '\0';
+    client->resume_url[0] = '\0';
+    client->sequence = -1;
 }
 
-static buf buf_from_json(json_t *json) {
-    char *json_string = json_dumps(json, 0);
-    if (!json_string) {
-        return (buf){"", 0};
+/*
+ * Uniform in [0, 1) from xorshift64*, seeded per client so that shards
+ * don't draw the same numbers
+ */
+static f64 next_jitter(cord_client_t *client) {
+    if (!client->jitter_state) {
+        client->jitter_state =
+            ((u64)(ev_time() * 1e6) ^ ((u64)client->shard_id << 40)) | 1;
     }
 
-    size_t length = strlen(json_string);
-    return (buf){json_string, length};
+    u64 x = client->jitter_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    client->jitter_state = x;
+    return (f64)((x * 0x2545F4914F6CDD1Dull) >> 11) / (f64)(1ull << 53);
 }
 
-static void buf_destroy(buf payload) {
-    if (payload.data) {
-        free(payload.data);
-        payload.data = NULL;
+#define RECONNECT_BASE_DELAY 0.1
+#define RECONNECT_MAX_DELAY 60.0
+
+f64 cord_reconnect_delay(i32 attempt, f64 jitter) {
+    f64 ceiling = RECONNECT_BASE_DELAY;
+    for (i32 i = 0; i < attempt && ceiling < RECONNECT_MAX_DELAY; i++) {
+        ceiling *= 2.0;
     }
+    if (ceiling > RECONNECT_MAX_DELAY) {
+        ceiling = RECONNECT_MAX_DELAY;
+    }
+    // Never less than half, so that retries don't bunch up near 0
+    return ceiling * (0.5 + 0.5 * jitter);
 }
 
-static void send_buf(cord_client_t *client, buf buffer) {
-    client->ws_client->send(
-        client->ws_client, buffer.data, buffer.length, UWSC_OP_TEXT);
+static f64 heartbeat_to_double(i32 interval) {
+    i32 decimal = interval / 1000;
+    i32 floating_ms = interval % 1000;
+
+    f64 decimal_d = (f64)decimal;
+    f64 floating_d = (f64)floating_ms * 0.001;
+    return decimal_d + floating_d;
 }
 
-static json_t *heartbeat_json_create(i32 sequence) {
-    json_t *heartbeat_json = json_object();
-    if (!heartbeat_json) {
-        return NULL;
-    }
-    json_object_set_new(heartbeat_json, PAYLOAD_KEY_OPCODE, json_integer(1));
+/*
+ * Outbound gateway frames are written straight into the client's frame
+ * buffer, so sending one never allocates. Frames that don't fit are
+ * dropped.
+ */
+static void frame_start(cord_client_t *client,
+                        cord_json_writer_t *writer,
+                        i32 op) {
+    cord_json_writer_init_buffer(
+        writer, client->frame_buffer, sizeof(client->frame_buffer));
+    cord_json_write_object_start(writer);
+    cord_json_write_key(writer, cstr(PAYLOAD_KEY_OPCODE));
+    cord_json_write_integer(writer, op);
+    cord_json_write_key(writer, cstr(PAYLOAD_KEY_DATA));
+}
 
-    // Send sequence number unless we havent received one
-    json_t *sequence_json =
-        is_valid_sequence(sequence) ? json_integer(sequence) : json_null();
+static void frame_string_field(cord_json_writer_t *writer,
+                               const char *key,
+                               const char *value) {
+    cord_json_write_key(writer, cstr(key));
+    cord_json_write_string(writer, cstr(value));
+}
 
-    json_object_set_new(heartbeat_json, PAYLOAD_KEY_DATA, sequence_json);
-    return heartbeat_json;
+static bool frame_send(cord_client_t *client, cord_json_writer_t *writer) {
+    cord_json_write_object_end(writer);
+    cord_str_t frame = cord_json_writer_finish(writer);
+    if (!frame.data) {
+        logger_error("Gateway frame is larger than %zu bytes",
+                     sizeof(client->frame_buffer));
+        return false;
+    }
+    client->ws_client->send(
+        client->ws_client, frame.data, (size_t)frame.length, UWSC_OP_TEXT);
+    return true;
 }
 
 static void send_heartbeat(cord_client_t *client) {
-    json_t *heartbeat_json = heartbeat_json_create(client->sequence);
-    if (!heartbeat_json) {
-        logger_error("Failed to create heartbeat json object");
-        return;
+    cord_json_writer_t writer = {0};
+    frame_start(client, &writer, OP_HEARTBEAT);
+    // Send sequence number unless we havent received one
+    if (is_valid_sequence(client->sequence)) {
+        cord_json_write_integer(&writer, client->sequence);
+    } else {
+        cord_json_write_null(&writer);
     }
 
-    buf heartbeat = buf_from_json(heartbeat_json);
-    if (!is_valid_payload(heartbeat)) {
-        logger_error("Failed to create json payload for heartbeat");
-        return;
+    if (frame_send(client, &writer)) {
+        client->heartbeat_acknowledged = false;
     }
-    send_buf(client, heartbeat);
-    client->heartbeat_acknowledged = false;
-
-    buf_destroy(heartbeat);
-    json_decref(heartbeat_json);
 }
 
 static void heartbeat_cb(struct ev_loop *loop, ev_timer *timer, i32 revents) {
@@ -136,6 +147,14 @@ static void heartbeat_cb(struct ev_loop *loop, ev_timer *timer, i32 revents) {
 
     cord_client_t *client = timer->data;
 
+    // Nothing came back since the last one, so the connection is dead
+    if (!client->heartbeat_acknowledged) {
+        logger_warn("Heartbeat was not acknowledged, reconnecting");
+        ev_timer_stop(loop, timer);
+        client->must_reconnect = true;
+        return;
+    }
+
     send_heartbeat(client);
     ev_timer_again(loop, timer);
 
@@ -155,159 +174,278 @@ static void sigint_cb(struct ev_loop *loop, ev_signal *signal, i32 revents) {
 }
 
 static void on_open(struct uwsc_client *ws_client) {
-    (void)ws_client;
+    cord_client_t *client = ws_client->ext;
+    client->connected = true;
     logger_debug("Connection established");
 }
 
-static void on_heartbeat(cord_client_t *client, json_t *data) {
+static i64 read_heartbeat_interval(cord_json_reader_t *data) {
+    cord_json_token_t value = cord_json_next(data);
+    if (value.type != CORD_JSON_TOKEN_OBJECT_START) {
+        cord_json_skip(data, value);
+        return -1;
+    }
+
+    i64 interval = -1;
+    i32 depth = data->depth;
+    cord_str_t key = {0};
+    while (cord_json_finish_value(data, depth) &&
+           cord_json_next_key(data, &key)) {
+        if (cord_str_equals_cstring(key, "heartbeat_interval")) {
+            cord_json_token_to_i64(cord_json_next(data), &interval);
+        }
+    }
+    return interval;
+}
+
+static void on_heartbeat(cord_client_t *client, cord_json_reader_t *data) {
     cord_bump_t *allocator = client->persistent_allocator;
 
-    json_t *hb_interval_json = json_object_get(data, "heartbeat_interval");
-    if (!hb_interval_json) {
+    i64 interval = read_heartbeat_interval(data);
+    if (interval < 0) {
         logger_error("Failed to get heartbeat object");
         return;
     }
-    client->hb_interval = (int)json_integer_value(hb_interval_json);
+    client->hb_interval = (int)interval;
     send_heartbeat(client);
 
     if (!client->sent_initial_heartbeat) {
         logger_debug("Sent initial heartbeat");
         client->sent_initial_heartbeat = true;
+    }
 
-        struct ev_timer *timer_watcher =
-            balloc(allocator, sizeof(struct ev_timer));
+    // Reconnecting reuses the timer with the interval of the new connection
+    if (!client->hb_watcher) {
+        client->hb_watcher = balloc(allocator, sizeof(struct ev_timer));
+        if (!client->hb_watcher) {
+            logger_error("Failed to allocate heartbeat timer");
+            return;
+        }
+        ev_init(client->hb_watcher, heartbeat_cb);
+        client->hb_watcher->data = client;
+    }
+    client->hb_watcher->repeat = heartbeat_to_double(client->hb_interval);
+    ev_timer_again(client->ws_client->loop, client->hb_watcher);
+}
 
-        ev_init(timer_watcher, heartbeat_cb);
-        timer_watcher->data = client;
-        timer_watcher->repeat = heartbeat_to_double(client->hb_interval);
-        ev_timer_again(client->ws_client->loop, timer_watcher);
+// Subscribe to what the registered handlers need unless the user decided
+static i32 identify_intents(cord_client_t *client) {
+    if (client->intents >= 0) {
+        return client->intents;
     }
+    return cord_gateway_intents_from_handlers();
 }
 
-static i32 default_intents(void) {
-    const i32 guild_intents = GUILDS | GUILD_MODERATION |
-                              GUILD_EMOJIS_AND_STICKERS | GUILD_INTEGRATIONS |
-                              GUILD_WEBHOOKS | GUILD_INVITES | GUILD_MESSAGES |
-                              GUILD_MESSAGE_REACTIONS;
+static void send_identify(cord_client_t *client) {
+    cord_json_writer_t writer = {0};
+    frame_start(client, &writer, OP_IDENTIFY);
+    cord_json_write_object_start(&writer);
+    frame_string_field(&writer, "token", client->identity.token);
+    cord_json_write_key(&writer, cstr("intents"));
+    cord_json_write_integer(&writer, identify_intents(client));
+    cord_json_write_key(&writer, cstr("large_threshold"));
+    cord_json_write_integer(&writer, 50);
+    // Payload compression, which isn't used along with transport compression
+    cord_json_write_key(&writer, cstr("compress"));
+    cord_json_write_bool(&writer, false);
+    if (client->shard_count > 0) {
+        cord_json_write_key(&writer, cstr("shard"));
+        cord_json_write_array_start(&writer);
+        cord_json_write_integer(&writer, client->shard_id);
+        cord_json_write_integer(&writer, client->shard_count);
+        cord_json_write_array_end(&writer);
+    }
 
-    const i32 message_intents =
-        DIRECT_MESSAGES | DIRECT_MESSAGE_REACTIONS | MESSAGE_CONTENT;
+    cord_json_write_key(&writer, cstr("properties"));
+    cord_json_write_object_start(&writer);
+    frame_string_field(&writer, "os", client->identity.os);
+    frame_string_field(&writer, "browser", client->identity.library);
+    frame_string_field(&writer, "device", client->identity.device);
+    cord_json_write_object_end(&writer);
+    cord_json_write_object_end(&writer);
 
-    const i32 schedule_intents =
-        GUILD_SCHEDULE_EVENTS | AUTO_MODERATION_CONFIGURATION |
-        AUTO_MODERATION_EXECUTION | GUILD_MESSAGE_POLLS | DIRECT_MESSAGE_POLLS;
+    if (!frame_send(client, &writer)) {
+        logger_error("Failed to create identify payload");
+    }
+}
 
-    const i32 intents = guild_intents | message_intents | schedule_intents;
-    return intents;
+/*
+ * Pick the session up where the last connection left it, Discord then
+ * replays the events since sequence
+ */
+static void send_resume(cord_client_t *client) {
+    cord_json_writer_t writer = {0};
+    frame_start(client, &writer, OP_RESUME);
+    cord_json_write_object_start(&writer);
+    frame_string_field(&writer, "token", client->identity.token);
+    frame_string_field(&writer, "session_id", client->session_id);
+    cord_json_write_key(&writer, cstr("seq"));
+    cord_json_write_integer(&writer, client->sequence);
+    cord_json_write_object_end(&writer);
+
+    if (frame_send(client, &writer)) {
+        logger_info("Resuming session at sequence %d", client->sequence);
+    }
 }
 
-static json_t *json_make_child(json_t *obj, const char *key) {
-    json_t *child = json_object();
-    json_object_set_new(obj, key, child);
-    return child;
+static void identify_cb(struct ev_loop *loop, ev_timer *timer, i32 revents) {
+    (void)loop;
+    (void)revents;
+    send_identify(timer->data);
 }
 
-static void send_identify(cord_client_t *client) {
-    json_t *payload_json = json_object();
-    json_object_set_new(
-        payload_json, PAYLOAD_KEY_OPCODE, json_integer(OP_IDENTIFY));
-
-    json_t *d = json_make_child(payload_json, PAYLOAD_KEY_DATA);
-    json_object_set_new(d, "token", json_string(client->identity.token));
-    json_object_set_new(d, "intents", json_integer(default_intents()));
-    json_object_set_new(d, "large_threshold", json_integer(50));
-    json_object_set_new(d, "compress", json_boolean(false));
-
-    json_t *properties = json_make_child(d, "properties");
-    json_object_set_new(properties, "os", json_string(client->identity.os));
-    json_object_set_new(
-        properties, "browser", json_string(client->identity.library));
-    json_object_set_new(
-        properties, "device", json_string(client->identity.device));
-
-    buf payload = buf_from_json(payload_json);
-    if (!is_valid_payload(payload)) {
-        logger_error("Failed to parse identity json payload");
-        json_decref(payload_json);
+/*
+ * Identify in no less than delay seconds. Shards of the same rate limit
+ * bucket take turns to identify, a shard waits for its turn on its own
+ * loop.
+ */
+static void schedule_identify(cord_client_t *client, f64 delay) {
+    if (client->identify_gate) {
+        delay += cord_identify_gate_reserve(
+            client->identify_gate, client->shard_id, ev_time() + delay);
+    }
+
+    if (delay <= 0.0) {
+        send_identify(client);
         return;
     }
 
-    send_buf(client, payload);
-    buf_destroy(payload);
+    logger_debug("Shard %d identifies in %.1fs", client->shard_id, delay);
+    // The loop's time can be stale before it first runs
+    ev_now_update(client->loop);
+    ev_timer_stop(client->loop, &client->identify_timer);
+    ev_timer_init(&client->identify_timer, identify_cb, delay, 0.0);
+    client->identify_timer.data = client;
+    ev_timer_start(client->loop, &client->identify_timer);
 }
 
+/*
+ * Fields of a gateway frame
+ *
+ * Everything points into the frame itself, nothing is copied out of it. The
+ * event data is normally read in place, d only holds its raw text when it
+ * arrived before the fields needed to dispatch it.
+ */
 typedef struct gateway_payload_t {
-    i32 op;    // opcode
-    i32 s;     // sequence
-    char *t;   // event
-    json_t *d; // json data
+    i32 op;       // opcode
+    i32 s;        // sequence
+    cord_str_t t; // event name
+    cord_str_t d; // raw json data
 } gateway_payload_t;
 
 void gateway_payload_init(gateway_payload_t *payload) {
     payload->op = -1;
     payload->s = -1;
-    payload->t = NULL;
-    payload->d = NULL;
+    payload->t = (cord_str_t){"", 0};
+    payload->d = (cord_str_t){0};
 }
 
-i32 deserialize_payload(json_t *payload_json, gateway_payload_t *payload) {
-    json_t *opcode = json_object_get(payload_json, PAYLOAD_KEY_OPCODE);
-    if (!opcode) {
-        logger_error("Failed to get \"op\"");
-        return -1;
-    }
+static cord_str_t resolve_message_url(cord_bump_t *allocator,
+                                      cord_message_t *msg) {
+    char channel_id[CORD_SNOWFLAKE_MAX_LENGTH];
+    cord_url_builder_t url_builder = cord_url_builder_create(allocator);
+    cord_url_builder_add_route(url_builder, cstr(DISCORD_API_URL));
+    cord_url_builder_add_route(url_builder, cstr("channels"));
+    cord_url_builder_add_route(
+        url_builder, cord_snowflake_format(msg->channel_id, channel_id));
+    cord_url_builder_add_route(url_builder, cstr("messages"));
 
-    json_int_t num_opcode = json_integer_value(opcode);
-    payload->op = (int)num_opcode;
+    return cord_url_builder_build(url_builder);
+}
 
-    if (num_opcode != OP_DISPATCH) {
-        payload->t = "";
-    } else {
-        json_t *t = json_object_get(payload_json, PAYLOAD_KEY_EVENT);
-        if (!t) {
-            logger_error("Failed to get \"t\"");
-            return -1;
-        }
-        payload->t = json_string_value(t) ? strdup(json_string_value(t)) : "";
-    }
+static void on_message_sent(cord_http_result_t result, void *user_data) {
+    (void)user_data;
 
-    json_t *s = json_object_get(payload_json, PAYLOAD_KEY_SEQUENCE);
-    if (s) {
-        payload->s = json_integer_value(s);
+    if (result.error) {
+        logger_error("Failed to send message (status %d): %s",
+                     result.status,
+                     not_null_cstring(result.body));
     }
+}
 
-    json_t *d = json_object_get(payload_json, PAYLOAD_KEY_DATA);
-    if (!d) {
-        logger_error("Failed to get \"d\"");
-        return -1;
+/*
+ * POST the message as json, or as a form with the json and the files when
+ * there are any. Everything but the files is copied when it's queued.
+ */
+static void post_message(cord_client_t *client,
+                         cord_str_t url,
+                         const char *json,
+                         cord_array_t *files,
+                         cord_message_sent_cb on_sent,
+                         void *user_data) {
+    cord_http_file_t *file_data = files ? (void *)files->data : NULL;
+    i32 num_files = files ? (i32)files->num_elements : 0;
+    if (!on_sent) {
+        on_sent = on_message_sent;
     }
 
-    payload->d = json_deep_copy(d);
-    return 0;
-}
+    // Prefer the loop driven engine so the gateway is never blocked on REST
+    if (client->ratelimit) {
+        bool queued =
+            num_files > 0
+                ? cord_ratelimit_submit_multipart(client->ratelimit,
+                                                  url,
+                                                  json,
+                                                  file_data,
+                                                  num_files,
+                                                  on_sent,
+                                                  user_data)
+                : cord_ratelimit_submit(client->ratelimit,
+                                        HTTP_POST,
+                                        url,
+                                        json,
+                                        on_sent,
+                                        user_data);
+        if (!queued) {
+            on_sent((cord_http_result_t){.error = true}, user_data);
+        }
+        return;
+    }
 
-static cord_str_t resolve_message_url(cord_temp_memory_t memory,
-                                      cord_message_t *msg) {
-    cord_url_builder_t url_builder = cord_url_builder_create(memory.allocator);
-    cord_url_builder_add_route(url_builder, cstr(DISCORD_API_URL));
-    cord_url_builder_add_route(url_builder, cstr("channels"));
-    cord_url_builder_add_route(url_builder,
-                               cord_strbuf_to_str(*msg->channel_id));
-    cord_url_builder_add_route(url_builder, cstr("messages"));
-    return cord_url_builder_build(url_builder);
+    cord_http_result_t result =
+        num_files > 0 ? cord_http_post_multipart(
+                            client->http, url, json, file_data, num_files)
+                      : cord_http_post(client->http, NULL, url, json);
+    on_sent(result, user_data);
+    free(result.body);
 }
 
 void cord_client_send_message(cord_client_t *client, cord_message_t *msg) {
     assert(msg);
 
-    cord_temp_memory_t memory =
-        cord_temp_memory_start(client->persistent_allocator);
-    assert(memory.allocator);
-    cord_json_writer_t writer = cord_json_writer_create(memory.allocator);
-    char *json = cord_message_to_json(writer, msg);
-    cord_http_post(
-        client->http, memory.allocator, resolve_message_url(memory, msg), json);
-    cord_temp_memory_end(memory);
+    // The request is copied when it's queued, all of this is scratch
+    cord_temp_memory_t scratch = cord_scratch_begin(NULL);
+    assert(scratch.allocator);
+    cord_json_writer_t writer;
+    cord_json_writer_init(&writer, scratch.allocator);
+    char *json = cord_message_to_json(&writer, msg);
+    if (json) {
+        cord_str_t url = resolve_message_url(scratch.allocator, msg);
+        post_message(client, url, json, NULL, NULL, client);
+    }
+    cord_scratch_end(scratch);
+}
+
+void cord_client_send_builder(cord_client_t *client,
+                              cord_message_builder_t *builder) {
+    assert(builder);
+
+    cord_temp_memory_t scratch = cord_scratch_begin(builder->allocator);
+    assert(scratch.allocator);
+    cord_json_writer_t writer;
+    cord_json_writer_init(&writer, scratch.allocator);
+    char *json = cord_message_builder_to_json(&writer, builder);
+    if (json) {
+        cord_str_t url =
+            resolve_message_url(scratch.allocator, &builder->message);
+        post_message(client,
+                     url,
+                     json,
+                     builder->files,
+                     builder->on_sent,
+                     builder->user_data);
+    }
+    cord_scratch_end(scratch);
 }
 
 void discord_message_destroy(cord_message_t *msg) {
@@ -326,75 +464,133 @@ static void log_on_message_status(cord_client_t *client) {
     }
 }
 
-static gateway_payload_t *
-parse_gateway_payload(cord_client_t *client, void *data, size_t length) {
-    json_error_t err = {};
-
-    json_t *payload_json = json_loadb(data, length, 0, &err);
-    if (!payload_json) {
-        logger_error("Failed to serialize payload: %s", err.text);
-        return NULL;
+static bool copy_cstring(char *destination, size_t size, cord_str_t string) {
+    if (string.length <= 0 || (size_t)string.length >= size) {
+        return false;
     }
+    memcpy(destination, string.data, (size_t)string.length);
+    destination[string.length] = '\0';
+    return true;
+}
 
-    gateway_payload_t *payload =
-        balloc(client->temporary_allocator, sizeof(gateway_payload_t));
+/*
+ * Keep what a later connection needs to resume the session that READY
+ * started
+ */
+static void save_session(cord_client_t *client, cord_str_t ready) {
+    client->session_id[0] = '\0';
+    client->resume_url[0] = '\0';
+    client->reconnect_attempts = 0;
+
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, ready, client->temporary_allocator);
+    if (cord_json_next(&reader).type != CORD_JSON_TOKEN_OBJECT_START) {
+        return;
+    }
 
-    gateway_payload_init(payload);
+    i32 depth = reader.depth;
+    cord_str_t key = {0};
+    while (cord_json_finish_value(&reader, depth) &&
+           cord_json_next_key(&reader, &key)) {
+        bool is_session = cord_str_equals_cstring(key, "session_id");
+        bool is_url = cord_str_equals_cstring(key, "resume_gateway_url");
+        if (!is_session && !is_url) {
+            continue;
+        }
 
-    i32 rc = deserialize_payload(payload_json, payload);
-    if (rc < 0) {
-        logger_error("Failed to parse gateway payload");
-        json_decref(payload_json);
-        return NULL;
+        cord_json_token_t value = cord_json_next(&reader);
+        char *field = is_session ? client->session_id : client->resume_url;
+        size_t size = is_session ? sizeof(client->session_id)
+                                 : sizeof(client->resume_url);
+        if (value.type != CORD_JSON_TOKEN_STRING ||
+            !copy_cstring(field, size, value.value)) {
+            logger_warn("Failed to read %.*s from READY",
+                        (i32)key.length,
+                        key.data);
+            field[0] = '\0';
+        }
     }
+}
 
-    assert(payload_json->refcount == 1 && "payload referenced more than once");
-    json_decref(payload_json);
-    return payload;
+// The client needs these events whether anything handles them or not
+static bool is_session_event(cord_gateway_event_t *event) {
+    return event && (event == get_gateway_event(GATEWAY_EVENT_READY) ||
+                     event == get_gateway_event(GATEWAY_EVENT_RESUMED));
 }
 
-static void on_message(struct uwsc_client *ws_client,
-                       void *data,
-                       size_t length,
-                       bool binary) {
-    (void)binary;
+static void dispatch_event(cord_client_t *client,
+                           gateway_payload_t *payload,
+                           cord_json_reader_t *data) {
+    if (payload->t.length == 0) {
+        return;
+    }
 
-    cord_client_t *client = ws_client->ext;
-    gateway_payload_t *payload = parse_gateway_payload(client, data, length);
+    cord_gateway_event_t *event = get_gateway_event_from_str(payload->t);
+    cord_json_reader_t ready = {0};
+    if (event == get_gateway_event(GATEWAY_EVENT_READY)) {
+        // Once for the session and once more for the handler
+        cord_str_t raw = cord_json_read_raw(data);
+        save_session(client, raw);
+        cord_json_reader_init(&ready, raw, client->temporary_allocator);
+        data = &ready;
+    } else if (event == get_gateway_event(GATEWAY_EVENT_RESUMED)) {
+        logger_info("Resumed session");
+        client->reconnect_attempts = 0;
+    }
+
+    if (cord_gateway_event_has_handler(event)) {
+        event->handler(client, data, payload->t);
+    } else if (!event) {
+        logger_warn("Unknown event: %.*s",
+                    (i32)payload->t.length,
+                    payload->t.data);
+    }
+}
+
+/*
+ * d tells whether the session can still be resumed, which takes a new
+ * connection. Otherwise this one identifies again after the random wait
+ * of 1 to 5 seconds that Discord asks for.
+ */
+static void on_invalid_session(cord_client_t *client,
+                               cord_json_reader_t *data) {
+    if (cord_json_next(data).type == CORD_JSON_TOKEN_TRUE &&
+        has_session(client)) {
+        logger_warn("Invalid session, resuming on a new connection");
+        client->must_reconnect = true;
+        return;
+    }
 
-    char *event_name = payload->t;
-    json_t *payload_data = json_deep_copy(payload->d);
-    json_decref(payload->d);
+    logger_warn("Invalid session, identifying again");
+    clear_session(client);
+    schedule_identify(client, 1.0 + 4.0 * next_jitter(client));
+}
 
+static void handle_payload(cord_client_t *client,
+                           gateway_payload_t *payload,
+                           cord_json_reader_t *data) {
     switch (payload->op) {
         case OP_DISPATCH:
-            if (!cstring_is_empty(event_name)) {
-                cord_gateway_event_t *event =
-                    get_gateway_event_from_cstring(event_name);
-                if (cord_gateway_event_has_handler(event)) {
-                    event->handler(client, payload_data, event_name);
-                } else {
-                    logger_warn("No handler for event: %s", event);
-                }
-            }
+            dispatch_event(client, payload, data);
             break;
         case OP_HEARTBEAT:
             logger_debug("Server is requesting Hearbeat");
-            on_heartbeat(client, payload_data);
+            send_heartbeat(client);
             break;
         case OP_RECONNECT:
             logger_debug("Server is requesting Reconnect");
             client->must_reconnect = true;
             break;
         case OP_INVALID_SESSION:
-            logger_warn("Invalid Session");
+            on_invalid_session(client, data);
             break;
         case OP_HELLO:
-            if (!client->sent_initial_heartbeat) {
-                on_heartbeat(client, payload_data);
-                send_identify(client);
+            // Every connection starts with HELLO
+            on_heartbeat(client, data);
+            if (has_session(client)) {
+                send_resume(client);
             } else {
-                on_heartbeat(client, payload_data);
+                schedule_identify(client, 0.0);
             }
             break;
         case OP_HEARTBEAT_ACK:
@@ -404,21 +600,253 @@ static void on_message(struct uwsc_client *ws_client,
             logger_error("Default switch case sentinel");
             break;
     }
+}
+
+// "d" can be handled in place once the fields that route it are known
+static bool can_handle_in_place(gateway_payload_t *payload) {
+    if (payload->op == OP_DISPATCH) {
+        return payload->t.length > 0;
+    }
+    return payload->op >= 0;
+}
+
+/*
+ * Read the top level fields of a frame. Returns true if the payload was
+ * handled while reading, which is the usual case since Discord sends "d"
+ * last.
+ */
+static bool read_gateway_payload(cord_client_t *client,
+                                 cord_json_reader_t *reader,
+                                 gateway_payload_t *payload) {
+    cord_str_t key = {0};
+    bool handled = false;
+
+    while (cord_json_next_key(reader, &key)) {
+        i32 depth = reader->depth;
+        i64 number = 0;
+
+        if (cord_str_equals_cstring(key, PAYLOAD_KEY_OPCODE)) {
+            if (cord_json_token_to_i64(cord_json_next(reader), &number)) {
+                payload->op = (i32)number;
+            }
+        } else if (cord_str_equals_cstring(key, PAYLOAD_KEY_SEQUENCE)) {
+            if (cord_json_token_to_i64(cord_json_next(reader), &number)) {
+                payload->s = (i32)number;
+                client->sequence = payload->s;
+            }
+        } else if (cord_str_equals_cstring(key, PAYLOAD_KEY_EVENT)) {
+            cord_json_token_t t = cord_json_next(reader);
+            if (t.type == CORD_JSON_TOKEN_STRING) {
+                payload->t = t.value;
+            }
+        } else if (cord_str_equals_cstring(key, PAYLOAD_KEY_DATA)) {
+            if (!handled && can_handle_in_place(payload)) {
+                handle_payload(client, payload, reader);
+                handled = true;
+            } else {
+                payload->d = cord_json_read_raw(reader);
+            }
+        }
+
+        if (!cord_json_finish_value(reader, depth)) {
+            break;
+        }
+    }
+    return handled;
+}
+
+static bool wants_event(cord_str_t name) {
+    cord_gateway_event_t *event = get_gateway_event_from_str(name);
+    return cord_gateway_event_has_handler(event) || is_session_event(event);
+}
+
+/*
+ * Read the fields in front of "d", which is where Discord puts "op", "s"
+ * and "t". Returns true if they were all found, without reading any of the
+ * event data. The reader has no allocator so that large frames are not
+ * indexed for this.
+ */
+static bool sniff_gateway_payload(const char *data,
+                                  size_t length,
+                                  gateway_payload_t *payload) {
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(
+        &reader, (cord_str_t){(char *)data, (ssize_t)length}, NULL);
+    if (cord_json_next(&reader).type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+
+    cord_str_t key = {0};
+    while (cord_json_next_key(&reader, &key)) {
+        if (cord_str_equals_cstring(key, PAYLOAD_KEY_DATA)) {
+            return payload->op >= 0 && payload->s >= 0 &&
+                   payload->t.length > 0;
+        }
+
+        i64 number = 0;
+        cord_json_token_t value = cord_json_next(&reader);
+        if (cord_str_equals_cstring(key, PAYLOAD_KEY_OPCODE) &&
+            cord_json_token_to_i64(value, &number)) {
+            payload->op = (i32)number;
+        } else if (cord_str_equals_cstring(key, PAYLOAD_KEY_SEQUENCE) &&
+                   cord_json_token_to_i64(value, &number)) {
+            payload->s = (i32)number;
+        } else if (cord_str_equals_cstring(key, PAYLOAD_KEY_EVENT) &&
+                   value.type == CORD_JSON_TOKEN_STRING) {
+            payload->t = value.value;
+        } else if (!cord_json_skip(&reader, value)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void cord_client_handle_frame(cord_client_t *client,
+                              const char *data,
+                              size_t length) {
+    gateway_payload_t head = {0};
+    gateway_payload_init(&head);
+    if (sniff_gateway_payload(data, length, &head) &&
+        head.op == OP_DISPATCH && !wants_event(head.t)) {
+        client->sequence = head.s;
+        client->dropped_events++;
+        return;
+    }
+
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader,
+                          (cord_str_t){(char *)data, (ssize_t)length},
+                          client->temporary_allocator);
+
+    gateway_payload_t payload = {0};
+    gateway_payload_init(&payload);
+
+    bool handled = false;
+    if (cord_json_next(&reader).type == CORD_JSON_TOKEN_OBJECT_START) {
+        handled = read_gateway_payload(client, &reader, &payload);
+    }
+
+    if (cord_json_failed(&reader)) {
+        logger_error("Failed to parse gateway payload at %zu: %s",
+                     reader.position,
+                     reader.error);
+    } else if (!handled && payload.op < 0) {
+        logger_error("Failed to get \"op\"");
+    } else if (!handled && !cord_str_valid(payload.d)) {
+        logger_error("Failed to get \"d\"");
+    } else if (!handled) {
+        cord_json_reader_t data_reader = {0};
+        cord_json_reader_init(
+            &data_reader, payload.d, client->temporary_allocator);
+        handle_payload(client, &payload, &data_reader);
+    }
 
-    json_decref(payload_data);
     log_on_message_status(client);
     cord_bump_clear(client->temporary_allocator);
 }
 
+static void on_message(struct uwsc_client *ws_client,
+                       void *data,
+                       size_t length,
+                       bool binary) {
+    (void)binary;
+
+    cord_client_t *client = ws_client->ext;
+    if (!client->compress) {
+        cord_client_handle_frame(client, data, length);
+        return;
+    }
+
+    cord_str_t message = {0};
+    switch (cord_inflate_message(&client->inflater, data, length, &message)) {
+        case CORD_INFLATE_MESSAGE:
+            cord_client_handle_frame(
+                client, message.data, (size_t)message.length);
+            break;
+        case CORD_INFLATE_PARTIAL:
+            break;
+        case CORD_INFLATE_ERROR:
+            // The rest of the stream can't be decoded
+            client->must_reconnect = true;
+            break;
+    }
+}
+
+static bool client_open(cord_client_t *client);
+static void schedule_reconnect(cord_client_t *client);
+
+static void reconnect_cb(struct ev_loop *loop, ev_timer *timer, i32 revents) {
+    (void)loop;
+    (void)revents;
+    cord_client_t *client = timer->data;
+    logger_debug("Attempting to reconnect");
+
+    // The old connection is closed by now
+    free(client->ws_client);
+    client->ws_client = NULL;
+
+    // A new connection starts a new zlib stream
+    if (client->compress && !cord_inflate_reset(&client->inflater)) {
+        logger_error("Failed to reset zlib stream");
+    }
+
+    if (!client_open(client)) {
+        schedule_reconnect(client);
+    }
+}
+
+/*
+ * Connect again after a jittered backoff (see cord_reconnect_delay). The
+ * new connection resumes the session unless it was cleared.
+ */
+static void schedule_reconnect(cord_client_t *client) {
+    if (ev_is_active(&client->reconnect_timer)) {
+        return;
+    }
+    if (client->hb_watcher) {
+        ev_timer_stop(client->loop, client->hb_watcher);
+    }
+    ev_timer_stop(client->loop, &client->identify_timer);
+
+    f64 delay = cord_reconnect_delay(client->reconnect_attempts++,
+                                     next_jitter(client));
+    logger_info("Reconnecting to the gateway in %.2fs", delay);
+
+    ev_now_update(client->loop);
+    ev_timer_init(&client->reconnect_timer, reconnect_cb, delay, 0.0);
+    client->reconnect_timer.data = client;
+    ev_timer_start(client->loop, &client->reconnect_timer);
+}
+
 static void on_error(struct uwsc_client *ws_client, i32 err, const char *msg) {
-    (void)ws_client;
+    cord_client_t *client = ws_client->ext;
 
     logger_error("Connection error (%d): %s", err, msg);
+    client->connected = false;
+    schedule_reconnect(client);
+}
+
+// Close codes after which no connection would get further
+static bool is_fatal_close(i32 code) {
+    return code == 4004 || (code >= 4010 && code <= 4014);
 }
 
 static void on_close(struct uwsc_client *ws_client, i32 code, const char *msg) {
-    (void)ws_client;
+    cord_client_t *client = ws_client->ext;
     logger_debug("Closing connection to gateway (%d): %s", code, msg);
+    client->connected = false;
+
+    if (is_fatal_close(code)) {
+        logger_error("Gateway refused the connection (%d): %s", code, msg);
+        ev_break(client->loop, EVBREAK_ALL);
+        return;
+    }
+
+    // Invalid sequence and session timeout, the session is gone
+    if (code == 4007 || code == 4009) {
+        clear_session(client);
+    }
+    schedule_reconnect(client);
 }
 
 cord_client_t *cord_client_create(cord_bump_t *allocator) {
@@ -449,56 +877,107 @@ cord_client_t *cord_client_create(cord_bump_t *allocator) {
     client->sequence = -1;
     client->sent_initial_heartbeat = false;
     client->loop = NULL;
+    client->http_async = NULL;
+    client->ratelimit = NULL;
     client->must_reconnect = false;
-
-    cord_gateway_event_t *on_message_event =
-        get_gateway_event(GATEWAY_EVENT_MESSAGE_CREATE);
-
-    on_message_event->handler = on_message_create;
+    client->connected = false;
+    client->session_id[0] = '\0';
+    client->resume_url[0] = '\0';
+    client->reconnect_attempts = 0;
+    client->intents = -1;
+    client->dropped_events = 0;
+    client->compress = true;
+    client->inflater = (cord_inflate_t){0};
+    client->shard_id = 0;
+    client->shard_count = 0;
+    client->identify_gate = NULL;
 
     return client;
 }
 
 static const i32 ping_interval = 5;
 
-static void client_init(cord_client_t *client, const char *url) {
-    assert(client && "cord_client_t must not be null");
+// Sessions are resumed on the url READY gave
+static const char *gateway_url(cord_client_t *client) {
+    const char *url = client->resume_url[0] ? client->resume_url
+                                            : DISCORD_WS_URL;
+    const char *params =
+        client->compress ? DISCORD_WS_COMPRESSED_PARAMS : DISCORD_WS_PARAMS;
+    snprintf(client->gateway_url,
+             sizeof(client->gateway_url),
+             "%s%s",
+             url,
+             params);
+    return client->gateway_url;
+}
 
-    client->loop = ev_default_loop(0);
-    client->ws_client = uwsc_new(client->loop, url, ping_interval, NULL);
+static bool client_open(cord_client_t *client) {
+    client->ws_client =
+        uwsc_new(client->loop, gateway_url(client), ping_interval, NULL);
     if (!client->ws_client) {
         logger_error("Failed to initialize websocket client");
-        exit(1);
+        return false;
     }
 
-    client->message_allocator = cord_bump_create_with_size(MB(10));
-    client->temporary_allocator = cord_bump_create_with_size(MB(1));
-
     client->ws_client->onopen = on_open;
     client->ws_client->onmessage = on_message;
     client->ws_client->onerror = on_error;
     client->ws_client->onclose = on_close;
-    client->sent_initial_heartbeat = false;
-    client->must_reconnect = false;
     client->ws_client->ext = client;
+    client->must_reconnect = false;
+    return true;
 }
 
-static void client_reconnect_to(cord_client_t *client, const char *url) {
-    logger_debug("Attempting to reconnect");
+static void client_init(cord_client_t *client) {
+    assert(client && "cord_client_t must not be null");
 
-    // Stop heartbeat timer
-    ev_timer_stop(client->loop, client->hb_watcher);
-    free(client->ws_client);
+    client->message_allocator = cord_bump_create_with_size(MB(10));
+    client->temporary_allocator = cord_bump_create_with_size(MB(1));
 
-    client->loop = ev_default_loop(0);
-    client->ws_client = uwsc_new(client->loop, url, ping_interval, NULL);
-    if (!client->ws_client) {
-        logger_error("Failed to initialize websocket client");
+    if (client->compress &&
+        !cord_inflate_init(&client->inflater, client->message_allocator)) {
+        logger_warn("Connecting without transport compression");
+        client->compress = false;
+    }
+
+    // Shards bring a loop of their own
+    if (!client->loop) {
+        client->loop = ev_default_loop(0);
+    }
+    if (!client_open(client)) {
         exit(1);
     }
 
-    ev_run(client->loop, 0);
-    ev_timer_start(client->loop, client->hb_watcher);
+    client->http_async = cord_http_async_create(
+        client->persistent_allocator, client->loop, client->http);
+    if (client->http_async) {
+        client->ratelimit = cord_ratelimit_create_on_loop(
+            client->persistent_allocator, client->http_async);
+    }
+    if (!client->ratelimit) {
+        logger_warn("Failed to create async http engine, REST calls will "
+                    "block the event loop");
+    }
+
+    client->sent_initial_heartbeat = false;
+}
+
+/*
+ * Close the connection without ending the session, on_close then
+ * schedules the next one
+ */
+static void client_disconnect(cord_client_t *client) {
+    client->must_reconnect = false;
+    if (client->hb_watcher) {
+        ev_timer_stop(client->loop, client->hb_watcher);
+    }
+
+    if (!client->connected) {
+        schedule_reconnect(client);
+        return;
+    }
+    // 1000 and 1001 would invalidate the session
+    client->ws_client->send_close(client->ws_client, 4000, "Reconnecting");
 }
 
 static void check_reconnect_cb(struct ev_loop *loop, ev_check *w, i32 revents) {
@@ -509,7 +988,7 @@ static void check_reconnect_cb(struct ev_loop *loop, ev_check *w, i32 revents) {
 
     if (client) {
         if (client->must_reconnect) {
-            client_reconnect_to(client, DISCORD_WS_URL);
+            client_disconnect(client);
         }
     }
 }
@@ -524,6 +1003,12 @@ static void setup_event_watchers(cord_client_t *client) {
     ev_check_init(reconnect_watcher, check_reconnect_cb);
     ev_check_start(client->loop, reconnect_watcher);
     client->reconnect_watcher = reconnect_watcher;
+    client->health_report_scheduler = NULL;
+
+    // Signals are delivered to the default loop only
+    if (!ev_is_default_loop(client->loop)) {
+        return;
+    }
 
     struct ev_signal *sigint_watcher =
         balloc(allocator, sizeof(struct ev_signal));
@@ -531,35 +1016,36 @@ static void setup_event_watchers(cord_client_t *client) {
     ev_signal_init(sigint_watcher, sigint_cb, SIGINT);
     ev_signal_start(client->loop, sigint_watcher);
     client->sigint_watcher = sigint_watcher;
-
-    client->health_report_scheduler = NULL;
 }
 
 i32 cord_client_connect(cord_client_t *client) {
     logger_debug("Attempting to connect to gateway");
 
-    client_init(client, DISCORD_WS_URL);
+    client_init(client);
     setup_event_watchers(client);
     return ev_run(client->loop, 0);
 }
 
 void cord_client_destroy(cord_client_t *client) {
     if (client) {
+        // Watchers and the client itself belong to persistent_allocator
         if (client->ws_client) {
             free(client->ws_client);
         }
-        if (client->hb_watcher) {
-            free(client->hb_watcher);
+        if (client->ratelimit) {
+            cord_ratelimit_destroy(client->ratelimit);
         }
-        if (client->sigint_watcher) {
-            free(client->sigint_watcher);
+        if (client->http_async) {
+            cord_http_async_destroy(client->http_async);
         }
         if (client->http) {
             cord_http_client_destroy(client->http);
         }
 
+        cord_cache_destroy(client->cache);
+        cord_inflate_destroy(&client->inflater);
+        cord_arena_pool_destroy(&client->event_arenas);
         cord_bump_destroy(client->temporary_allocator);
         cord_bump_destroy(client->message_allocator);
-        free(client);
     }
 }
@@ -2,17 +2,29 @@
 #define CLIENT_H
 
 #include "../core/memory.h"
+#include "../http/async.h"
 #include "../http/http.h"
+#include "../http/ratelimit.h"
+#include "compression.h"
 #include "entities.h"
+#include "message_builder.h"
+#include "message_view.h"
 
 #include <ev.h>
-#include <jansson.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <uwsc/uwsc.h>
 
 #define DISCORD_API_URL "https://discord.com/api/v10"
 #define DISCORD_WS_URL "wss://gateway.discord.gg"
+#define DISCORD_WS_PARAMS "/?v=10&encoding=json"
+#define DISCORD_WS_COMPRESSED_PARAMS DISCORD_WS_PARAMS "&compress=zlib-stream"
+#define DISCORD_WS_COMPRESSED_URL DISCORD_WS_URL DISCORD_WS_COMPRESSED_PARAMS
+
+#define CORD_SESSION_ID_SIZE 64
+// Discord closes connections that send larger payloads
+#define CORD_GATEWAY_FRAME_SIZE 4096
+#define CORD_GATEWAY_URL_SIZE 256
 
 #define PAYLOAD_KEY_OPCODE "op"
 #define PAYLOAD_KEY_DATA "d"
@@ -41,11 +53,16 @@ enum {
 };
 
 typedef struct cord_t cord_t;
+typedef struct cord_identify_gate_t cord_identify_gate_t;
+typedef struct cord_cache_t cord_cache_t;
 
 typedef struct cord_gateway_event_callbacks_t {
     void (*on_message_cb)(cord_t *ctx,
                           cord_bump_t *bump,
                           cord_message_t *message);
+    void (*on_message_view_cb)(cord_t *ctx,
+                               cord_bump_t *bump,
+                               cord_message_view_t *message);
 
     // add more
 } cord_gateway_event_callbacks_t;
@@ -78,16 +95,56 @@ typedef struct cord_client_t {
 
     cord_bump_t *message_allocator;
     cord_bump_t *temporary_allocator;
+    // Memory of the objects decoded from an event, handed to the callbacks
+    cord_arena_pool_t event_arenas;
+    // Guilds, channels, roles and members seen by this client, NULL if off
+    cord_cache_t *cache;
 
     bool heartbeat_acknowledged;
     bool must_reconnect;
+    // Between the websocket opening and closing
+    bool connected;
+
+    // From READY, empty when the next connection has to identify
+    char session_id[CORD_SESSION_ID_SIZE];
+    char resume_url[CORD_GATEWAY_URL_SIZE];
+    // Where the next connection goes, resume_url and the longest params
+    char gateway_url[CORD_GATEWAY_URL_SIZE +
+                     sizeof(DISCORD_WS_COMPRESSED_PARAMS)];
+    // Failed connections since the last READY or RESUMED
+    i32 reconnect_attempts;
+    u64 jitter_state;
+    struct ev_timer reconnect_timer;
 
     i32 hb_interval;
     i32 sequence;
     bool sent_initial_heartbeat;
 
+    // Sent on identify, -1 derives them from the registered event handlers
+    i32 intents;
+    // Dispatches dropped before parsing because nothing handles them
+    size_t dropped_events;
+
+    // Sent on identify when shard_count > 0
+    i32 shard_id;
+    i32 shard_count;
+    // Paces identifies across shards, NULL identifies right away
+    cord_identify_gate_t *identify_gate;
+    struct ev_timer identify_timer;
+
+    // Outbound frames are written here, one at a time
+    char frame_buffer[CORD_GATEWAY_FRAME_SIZE];
+
+    // Use zlib-stream transport compression, on by default
+    bool compress;
+    cord_inflate_t inflater;
+
     identity_info_t identity;
     cord_http_client_t *http;
+    // non-blocking REST requests driven by loop
+    cord_http_async_t *http_async;
+    // queues REST requests per rate limit bucket on top of http_async
+    cord_ratelimit_t *ratelimit;
 
     cord_gateway_event_callbacks_t event_callbacks;
 
@@ -100,5 +157,27 @@ i32 cord_client_connect(cord_client_t *client);
 void cord_client_destroy(cord_client_t *client);
 
 void cord_client_send_message(cord_client_t *client, cord_message_t *message);
+void cord_client_send_builder(cord_client_t *client,
+                              cord_message_builder_t *builder);
+
+/*
+ * Seconds to wait before the next connection after attempt failed ones,
+ * with jitter in [0, 1). Grows exponentially up to a minute, randomized
+ * so that shards and bots that lost their connections together don't all
+ * come back at once.
+ */
+f64 cord_reconnect_delay(i32 attempt, f64 jitter);
+
+/*
+ * Decode a gateway frame and dispatch it
+ *
+ * The fields in front of the event data are sniffed first, without
+ * indexing the frame, and dispatches of events without a handler are
+ * dropped there. Everything else is then parsed once, and handlers borrow
+ * the parsed data for the duration of their call.
+ */
+void cord_client_handle_frame(cord_client_t *client,
+                              const char *data,
+                              size_t length);
 
 #endif
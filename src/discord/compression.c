@@ -0,0 +1,119 @@
+#include "compression.h"
+#include "../core/log.h"
+
+#include <assert.h>
+#include <string.h>
+
+static const u8 sync_flush_suffix[] = {0x00, 0x00, 0xFF, 0xFF};
+
+bool cord_inflate_init(cord_inflate_t *inflater, cord_bump_t *allocator) {
+    assert(inflater && "cord_inflate_t must not be null");
+
+    memset(inflater, 0, sizeof(cord_inflate_t));
+    if (inflateInit(&inflater->stream) != Z_OK) {
+        logger_error("Failed to initialize zlib stream: %s",
+                     not_null_cstring(inflater->stream.msg));
+        return false;
+    }
+
+    inflater->initialized = true;
+    inflater->allocator = allocator;
+    return true;
+}
+
+bool cord_inflate_reset(cord_inflate_t *inflater) {
+    inflater->length = 0;
+    inflater->complete = false;
+    memset(inflater->tail, 0, sizeof(inflater->tail));
+    return inflater->initialized && inflateReset(&inflater->stream) == Z_OK;
+}
+
+void cord_inflate_destroy(cord_inflate_t *inflater) {
+    if (inflater && inflater->initialized) {
+        inflateEnd(&inflater->stream);
+        inflater->initialized = false;
+    }
+}
+
+// The old buffer stays in the allocator, growing geometrically bounds that
+static bool grow_buffer(cord_inflate_t *inflater) {
+    size_t capacity = inflater->capacity ? inflater->capacity * 2
+                                         : CORD_INFLATE_BUFFER_SIZE;
+    char *buffer = balloc_uninit(inflater->allocator, capacity);
+    if (!buffer) {
+        logger_error("Failed to grow inflate buffer to %zu bytes", capacity);
+        return false;
+    }
+
+    if (inflater->length > 0) {
+        memcpy(buffer, inflater->buffer, inflater->length);
+    }
+    inflater->buffer = buffer;
+    inflater->capacity = capacity;
+    return true;
+}
+
+static bool ends_with_sync_flush(cord_inflate_t *inflater,
+                                 const u8 *data,
+                                 size_t length) {
+    size_t tail_length = sizeof(inflater->tail);
+    size_t start = length > tail_length ? length - tail_length : 0;
+    for (size_t i = start; i < length; i++) {
+        memmove(inflater->tail, inflater->tail + 1, tail_length - 1);
+        inflater->tail[tail_length - 1] = data[i];
+    }
+    return memcmp(inflater->tail, sync_flush_suffix, tail_length) == 0;
+}
+
+cord_inflate_result_t cord_inflate_message(cord_inflate_t *inflater,
+                                           const void *data,
+                                           size_t length,
+                                           cord_str_t *message) {
+    assert(inflater->initialized && "cord_inflate_t is not initialized");
+
+    if (inflater->complete) {
+        inflater->length = 0;
+        inflater->complete = false;
+    }
+
+    z_stream *stream = &inflater->stream;
+    stream->next_in = (Bytef *)data;
+    stream->avail_in = (uInt)length;
+
+    /*
+     * Inflate until zlib has room left in the buffer, which means it used
+     * all of the input and flushed everything it could
+     */
+    for (;;) {
+        if (inflater->length == inflater->capacity &&
+            !grow_buffer(inflater)) {
+            return CORD_INFLATE_ERROR;
+        }
+
+        size_t available = inflater->capacity - inflater->length;
+        stream->next_out = (Bytef *)inflater->buffer + inflater->length;
+        stream->avail_out = (uInt)available;
+
+        // Z_BUF_ERROR only means there was nothing to do
+        i32 status = inflate(stream, Z_SYNC_FLUSH);
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            logger_error("Failed to inflate gateway message (%d): %s",
+                         status,
+                         not_null_cstring(stream->msg));
+            return CORD_INFLATE_ERROR;
+        }
+
+        inflater->length += available - stream->avail_out;
+        if (stream->avail_out > 0) {
+            break;
+        }
+    }
+
+    if (!ends_with_sync_flush(inflater, data, length)) {
+        return CORD_INFLATE_PARTIAL;
+    }
+
+    inflater->complete = true;
+    *message = (cord_str_t){inflater->buffer, (ssize_t)inflater->length};
+    return CORD_INFLATE_MESSAGE;
+}
@@ -0,0 +1,63 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "../core/memory.h"
+#include "../core/strings.h"
+#include "../core/typedefs.h"
+
+#include <stdbool.h>
+#include <zlib.h>
+
+// Initial size of the inflated message buffer
+#define CORD_INFLATE_BUFFER_SIZE KB(64)
+
+typedef enum cord_inflate_result_t {
+    // A complete gateway message was inflated
+    CORD_INFLATE_MESSAGE,
+    // The message continues in the next websocket message
+    CORD_INFLATE_PARTIAL,
+    CORD_INFLATE_ERROR
+} cord_inflate_result_t;
+
+/*
+ * Gateway transport compression (compress=zlib-stream)
+ *
+ * All the messages of a connection are one zlib stream, and every gateway
+ * message ends with a Z_SYNC_FLUSH, which is the 4 byte suffix 00 00 ff ff.
+ * Websocket messages are inflated as they arrive into a buffer that is
+ * reused for every gateway message and only grows, by doubling, when a
+ * larger message comes in. The buffer comes from the allocator, so the
+ * memory is released with it.
+ */
+typedef struct cord_inflate_t {
+    z_stream stream;
+    bool initialized;
+
+    cord_bump_t *allocator;
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    // The last result was a message, the buffer starts over
+    bool complete;
+    // Last bytes of input, the suffix can be split between messages too
+    u8 tail[4];
+} cord_inflate_t;
+
+bool cord_inflate_init(cord_inflate_t *inflater, cord_bump_t *allocator);
+
+/*
+ * Start a new stream, which is needed for every new connection
+ */
+bool cord_inflate_reset(cord_inflate_t *inflater);
+void cord_inflate_destroy(cord_inflate_t *inflater);
+
+/*
+ * Inflate a websocket message. When it completes a gateway message, message
+ * points to the inflated text, which is valid until the next call.
+ */
+cord_inflate_result_t cord_inflate_message(cord_inflate_t *inflater,
+                                           const void *data,
+                                           size_t length,
+                                           cord_str_t *message);
+
+#endif
@@ -1,19 +1,18 @@
 #include "entities.h"
-#include "../core/log.h"
 
 #include <assert.h>
 
 void cord_user_init(cord_user_t *user, cord_bump_t *allocator) {
-    user->id = NULL;
-    user->username = NULL;
-    user->discriminator = NULL;
-    user->avatar = NULL;
+    user->id = 0;
+    user->username = (cord_str_t){0};
+    user->discriminator = (cord_str_t){0};
+    user->avatar = (cord_str_t){0};
     user->bot = false;
     user->system_ = false;
     user->mfa_enabled = false;
-    user->locale = NULL;
+    user->locale = (cord_str_t){0};
     user->verified = false;
-    user->email = NULL;
+    user->email = (cord_str_t){0};
     user->flags = 0;
     user->premium_type = 0;
     user->public_flags = 0;
@@ -24,11 +23,11 @@ void cord_user_init(cord_user_t *user, cord_bump_t *allocator) {
 
 void cord_guild_member_init(cord_guild_member_t *member,
                             cord_bump_t *allocator) {
-    cord_user_init(member->user, allocator);
-    member->nick = NULL;
+    member->user = NULL;
+    member->nick = (cord_str_t){0};
     member->roles = NULL;
-    member->joined_at = NULL;
-    member->premium_since = NULL;
+    member->joined_at = (cord_str_t){0};
+    member->premium_since = (cord_str_t){0};
     member->deaf = false;
     member->mute = false;
     member->pending = false;
@@ -38,14 +37,15 @@ void cord_guild_member_init(cord_guild_member_t *member,
 }
 
 void cord_role_init(cord_role_t *role, cord_bump_t *allocator) {
-    role->id = NULL;
-    role->name = NULL;
+    role->id = 0;
+    role->name = (cord_str_t){0};
     role->color = 0;
     role->hoist = false;
     role->position = 0;
-    role->permissions = NULL;
+    role->permissions = (cord_str_t){0};
     role->managed = false;
     role->mentionable = false;
+    role->tags = NULL;
 
     assert(allocator && "Allocator passed to role init must not be null");
     role->allocator = allocator;
@@ -53,30 +53,30 @@ void cord_role_init(cord_role_t *role, cord_bump_t *allocator) {
 
 void cord_role_tag_init(cord_role_tag_t *role_tag, cord_bump_t *allocator) {
     role_tag->available_for_purchase = false;
-    role_tag->bot_id = NULL;
+    role_tag->bot_id = 0;
     role_tag->guild_connections = false;
-    role_tag->integration_id = NULL;
+    role_tag->integration_id = 0;
     role_tag->premium_subscriber = false;
-    role_tag->subscription_listing_id = NULL;
+    role_tag->subscription_listing_id = 0;
     role_tag->allocator = allocator;
 }
 
 void cord_channel_mention_init(cord_channel_mention_t *mention,
                                cord_bump_t *allocator) {
-    mention->id = NULL;
-    mention->guild_id = NULL;
+    mention->id = 0;
+    mention->guild_id = 0;
     mention->type = 0;
-    mention->name = NULL;
+    mention->name = (cord_str_t){0};
     mention->allocator = allocator;
 }
 
 void cord_attachment_init(cord_attachment_t *attachment,
                           cord_bump_t *allocator) {
-    attachment->id = NULL;
-    attachment->filename = NULL;
+    attachment->id = 0;
+    attachment->filename = (cord_str_t){0};
     attachment->size = 0;
-    attachment->url = NULL;
-    attachment->proxy_url = NULL;
+    attachment->url = (cord_str_t){0};
+    attachment->proxy_url = (cord_str_t){0};
     attachment->height = 0;
     attachment->width = 0;
 
@@ -85,17 +85,17 @@ void cord_attachment_init(cord_attachment_t *attachment,
 
 void cord_embed_footer_init(cord_embed_footer_t *embed_footer,
                             cord_bump_t *allocator) {
-    embed_footer->text = NULL;
-    embed_footer->icon_url = NULL;
-    embed_footer->proxy_icon_url = NULL;
+    embed_footer->text = (cord_str_t){0};
+    embed_footer->icon_url = (cord_str_t){0};
+    embed_footer->proxy_icon_url = (cord_str_t){0};
 
     embed_footer->allocator = allocator;
 }
 
 void cord_embed_image_init(cord_embed_image_t *embed_image,
                            cord_bump_t *allocator) {
-    embed_image->url = NULL;
-    embed_image->proxy_url = NULL;
+    embed_image->url = (cord_str_t){0};
+    embed_image->proxy_url = (cord_str_t){0};
     embed_image->height = 0;
     embed_image->width = 0;
     embed_image->allocator = allocator;
@@ -103,8 +103,8 @@ void cord_embed_image_init(cord_embed_image_t *embed_image,
 
 void cord_embed_thumbnail_init(cord_embed_thumbnail_t *embed_thumbnail,
                                cord_bump_t *allocator) {
-    embed_thumbnail->url = NULL;
-    embed_thumbnail->proxy_url = NULL;
+    embed_thumbnail->url = (cord_str_t){0};
+    embed_thumbnail->proxy_url = (cord_str_t){0};
     embed_thumbnail->height = 0;
     embed_thumbnail->width = 0;
     embed_thumbnail->allocator = allocator;
@@ -112,7 +112,7 @@ void cord_embed_thumbnail_init(cord_embed_thumbnail_t *embed_thumbnail,
 
 void cord_embed_video_init(cord_embed_video_t *embed_video,
                            cord_bump_t *allocator) {
-    embed_video->url = NULL;
+    embed_video->url = (cord_str_t){0};
     embed_video->height = 0;
     embed_video->width = 0;
     embed_video->allocator = allocator;
@@ -120,35 +120,35 @@ void cord_embed_video_init(cord_embed_video_t *embed_video,
 
 void cord_embed_provider_init(cord_embed_provider_t *embed_provider,
                               cord_bump_t *allocator) {
-    embed_provider->name = NULL;
-    embed_provider->url = NULL;
+    embed_provider->name = (cord_str_t){0};
+    embed_provider->url = (cord_str_t){0};
 
     embed_provider->allocator = allocator;
 }
 
 void cord_embed_author_init(cord_embed_author_t *embed_author,
                             cord_bump_t *allocator) {
-    embed_author->name = NULL;
-    embed_author->url = NULL;
-    embed_author->icon_url = NULL;
-    embed_author->proxy_icon_url = NULL;
+    embed_author->name = (cord_str_t){0};
+    embed_author->url = (cord_str_t){0};
+    embed_author->icon_url = (cord_str_t){0};
+    embed_author->proxy_icon_url = (cord_str_t){0};
     embed_author->allocator = allocator;
 }
 
 void cord_embed_field_init(cord_embed_field_t *embed_field,
                            cord_bump_t *allocator) {
-    embed_field->name = NULL;
-    embed_field->value = NULL;
+    embed_field->name = (cord_str_t){0};
+    embed_field->value = (cord_str_t){0};
     embed_field->inline_ = false;
     embed_field->allocator = allocator;
 }
 
 void cord_embed_init(cord_embed_t *embed, cord_bump_t *allocator) {
-    embed->title = NULL;
-    embed->type = NULL;
-    embed->description = NULL;
-    embed->url = NULL;
-    embed->timestamp = NULL;
+    embed->title = (cord_str_t){0};
+    embed->type = (cord_str_t){0};
+    embed->description = (cord_str_t){0};
+    embed->url = (cord_str_t){0};
+    embed->timestamp = (cord_str_t){0};
     embed->color = 0;
     embed->footer = NULL;
     embed->image = NULL;
@@ -161,8 +161,8 @@ void cord_embed_init(cord_embed_t *embed, cord_bump_t *allocator) {
 }
 
 void cord_emoji_init(cord_emoji_t *emoji, cord_bump_t *allocator) {
-    emoji->id = NULL;
-    emoji->name = NULL;
+    emoji->id = 0;
+    emoji->name = (cord_str_t){0};
     emoji->roles = NULL;
     emoji->user = NULL;
     emoji->require_colons = false;
@@ -182,49 +182,52 @@ void cord_reaction_init(cord_reaction_t *reaction, cord_bump_t *allocator) {
 void cord_message_activity_init(cord_message_activity_t *message_activity,
                                 cord_bump_t *allocator) {
     message_activity->type = 0;
-    message_activity->party_id = NULL;
+    message_activity->party_id = (cord_str_t){0};
     message_activity->allocator = allocator;
 }
 
 void cord_message_application_init(cord_message_application_t *app,
                                    cord_bump_t *allocator) {
-    app->id = NULL;
-    app->cover_image = NULL;
-    app->description = NULL;
-    app->icon = NULL;
-    app->name = NULL;
+    app->id = 0;
+    app->cover_image = (cord_str_t){0};
+    app->description = (cord_str_t){0};
+    app->icon = (cord_str_t){0};
+    app->name = (cord_str_t){0};
     app->allocator = allocator;
 }
 
 void cord_message_sticker_init(cord_message_sticker_t *message_sticker,
                                cord_bump_t *allocator) {
-    message_sticker->id = NULL;
-    message_sticker->pack_id = NULL;
-    message_sticker->name = NULL;
-    message_sticker->description = NULL;
-    message_sticker->tags = NULL;
-    message_sticker->asset = NULL;
-    message_sticker->preview_asset = NULL;
+    message_sticker->id = 0;
+    message_sticker->pack_id = 0;
+    message_sticker->name = (cord_str_t){0};
+    message_sticker->description = (cord_str_t){0};
+    message_sticker->tags = (cord_str_t){0};
+    message_sticker->asset = (cord_str_t){0};
+    message_sticker->preview_asset = (cord_str_t){0};
     // https://discord.com/developers/docs/resources/channel#message-object-message-sticker-format-types
     message_sticker->format_type = 0;
     message_sticker->allocator = allocator;
 }
 
+void cord_message_reference_init(cord_message_reference_t *message_reference,
+                                 cord_bump_t *allocator) {
+    (void)allocator;
+    message_reference->message_id = 0;
+    message_reference->channel_id = 0;
+    message_reference->guild_id = 0;
+}
+
+// The message borrows content, it has to outlive the message
 void cord_message_set_content(cord_message_t *message, const char *content) {
-    cord_strbuf_t *builder = cord_strbuf_create();
-    if (!builder) {
-        logger_error("Failed to allocate memory for message content");
-        return;
-    }
-    cord_strbuf_append(builder, cstr(content));
-    message->content = builder;
+    message->content = cstr(content);
 }
 
 void cord_guild_init(cord_guild_t *guild, cord_bump_t *allocator) {
-    guild->id = NULL;
-    guild->name = NULL;
-    guild->icon = NULL;
-    guild->splash = NULL;
-    guild->discovery_splash = NULL;
+    guild->id = 0;
+    guild->name = (cord_str_t){0};
+    guild->icon = (cord_str_t){0};
+    guild->splash = (cord_str_t){0};
+    guild->discovery_splash = (cord_str_t){0};
     guild->allocator = allocator;
 }
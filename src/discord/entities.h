@@ -3,8 +3,16 @@
 
 #include "../core/array.h"
 #include "../core/memory.h"
+#include "../core/snowflake.h"
 #include "../core/strings.h"
 
+/*
+ * String fields of the entities are slices. Entities decoded from a gateway
+ * event point into the frame they were received in, so they are only valid
+ * until the event handler returns. Absent and null fields have a NULL data
+ * pointer. Ids are parsed into snowflakes, 0 when absent.
+ */
+
 typedef enum cord_discord_channel_type_t {
     DISCORD_CHANNEL_GUILD_TEXT,
     DISCORD_CHANNEL_DM,
@@ -43,16 +51,16 @@ typedef enum cord_discord_forum_layout_type_t {
 
 // https://discord.com/developers/docs/resources/user#user-object
 typedef struct cord_user_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *username;
-    cord_strbuf_t *discriminator;
-    cord_strbuf_t *avatar;
+    cord_snowflake_t id;
+    cord_str_t username;
+    cord_str_t discriminator;
+    cord_str_t avatar;
     bool bot;
     bool system_;
     bool mfa_enabled;
-    cord_strbuf_t *locale;
+    cord_str_t locale;
     bool verified;
-    cord_strbuf_t *email;
+    cord_str_t email;
     i32 flags;
     i32 premium_type;
     i32 public_flags;
@@ -64,17 +72,17 @@ void cord_user_init(cord_user_t *user, cord_bump_t *allocator);
 
 // https://discord.com/developers/docs/topics/permissions#role-object
 typedef struct cord_role_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *name;
+    cord_snowflake_t id;
+    cord_str_t name;
     i32 color;
     bool hoist;
-    cord_strbuf_t *icon;
-    cord_strbuf_t *unicode_emoji;
+    cord_str_t icon;
+    cord_str_t unicode_emoji;
     i32 position;
-    cord_strbuf_t *permissions;
+    cord_str_t permissions;
     bool managed;
     bool mentionable;
-    cord_array_t *tags;
+    struct cord_role_tag_t *tags;
 
     cord_bump_t *allocator;
 } cord_role_t;
@@ -83,11 +91,11 @@ void cord_role_init(cord_role_t *role, cord_bump_t *allocator);
 
 // https://discord.com/developers/docs/topics/permissions#role-object-role-tags-structure
 typedef struct cord_role_tag_t {
-    cord_strbuf_t *bot_id;
-    cord_strbuf_t *integration_id;
+    cord_snowflake_t bot_id;
+    cord_snowflake_t integration_id;
     bool premium_subscriber; // The docs mark this as of type null. Check if
                              // it's used at all
-    cord_strbuf_t *subscription_listing_id;
+    cord_snowflake_t subscription_listing_id;
     bool available_for_purchase; // null?
     bool guild_connections;      // null?
 
@@ -99,10 +107,10 @@ void cord_role_tag_init(cord_role_tag_t *role_tag, cord_bump_t *allocator);
 // https://discord.com/developers/docs/resources/guild#guild-member-object
 typedef struct cord_guild_member_t {
     cord_user_t *user;
-    cord_strbuf_t *nick;
-    cord_array_t *roles; // cord_role_t[]
-    cord_strbuf_t *joined_at;
-    cord_strbuf_t *premium_since;
+    cord_str_t nick;
+    cord_array_t *roles; // cord_snowflake_t[] (role ids)
+    cord_str_t joined_at;
+    cord_str_t premium_since;
     bool deaf;
     bool mute;
     bool pending;
@@ -115,10 +123,10 @@ void cord_guild_member_init(cord_guild_member_t *member,
 
 // https://discord.com/developers/docs/resources/channel#channel-mention-object
 typedef struct cord_channel_mention_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *guild_id;
+    cord_snowflake_t id;
+    cord_snowflake_t guild_id;
     i32 type;
-    cord_strbuf_t *name;
+    cord_str_t name;
 
     cord_bump_t *allocator;
 } cord_channel_mention_t;
@@ -128,11 +136,11 @@ void cord_channel_mention_init(cord_channel_mention_t *mention,
 
 // https://discord.com/developers/docs/resources/channel#attachment-object
 typedef struct cord_attachment_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *filename;
+    cord_snowflake_t id;
+    cord_str_t filename;
     i32 size;
-    cord_strbuf_t *url;
-    cord_strbuf_t *proxy_url;
+    cord_str_t url;
+    cord_str_t proxy_url;
     i32 height;
     i32 width;
 
@@ -144,9 +152,9 @@ void cord_attachment_init(cord_attachment_t *attachment,
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-footer-structure
 typedef struct cord_embed_footer_t {
-    cord_strbuf_t *text;
-    cord_strbuf_t *icon_url;
-    cord_strbuf_t *proxy_icon_url;
+    cord_str_t text;
+    cord_str_t icon_url;
+    cord_str_t proxy_icon_url;
 
     cord_bump_t *allocator;
 } cord_embed_footer_t;
@@ -156,8 +164,8 @@ void cord_embed_footer_init(cord_embed_footer_t *efooter,
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-image-structure
 typedef struct cord_embed_image_t {
-    cord_strbuf_t *url;
-    cord_strbuf_t *proxy_url;
+    cord_str_t url;
+    cord_str_t proxy_url;
     i32 height;
     i32 width;
 
@@ -168,8 +176,8 @@ void cord_embed_image_init(cord_embed_image_t *eimage, cord_bump_t *allocator);
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-thumbnail-structure
 typedef struct cord_embed_thumbnail_t {
-    cord_strbuf_t *url;
-    cord_strbuf_t *proxy_url;
+    cord_str_t url;
+    cord_str_t proxy_url;
     i32 height;
     i32 width;
 
@@ -181,7 +189,7 @@ void cord_embed_thumbnail_init(cord_embed_thumbnail_t *ethumbnail,
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-video-structure
 typedef struct cord_embed_video_t {
-    cord_strbuf_t *url;
+    cord_str_t url;
     i32 height;
     i32 width;
 
@@ -192,8 +200,8 @@ void cord_embed_video_init(cord_embed_video_t *evideo, cord_bump_t *allocator);
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-provider-structure
 typedef struct cord_embed_provider_t {
-    cord_strbuf_t *name;
-    cord_strbuf_t *url;
+    cord_str_t name;
+    cord_str_t url;
 
     cord_bump_t *allocator;
 } cord_embed_provider_t;
@@ -203,10 +211,10 @@ void cord_embed_provider_init(cord_embed_provider_t *eprovider,
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-author-structure
 typedef struct cord_embed_author_t {
-    cord_strbuf_t *name;
-    cord_strbuf_t *url;
-    cord_strbuf_t *icon_url;
-    cord_strbuf_t *proxy_icon_url;
+    cord_str_t name;
+    cord_str_t url;
+    cord_str_t icon_url;
+    cord_str_t proxy_icon_url;
 
     cord_bump_t *allocator;
 } cord_embed_author_t;
@@ -216,8 +224,8 @@ void cord_embed_author_init(cord_embed_author_t *eauthor,
 
 // https://discord.com/developers/docs/resources/channel#embed-object-embed-field-structure
 typedef struct cord_embed_field_t {
-    cord_strbuf_t *name;
-    cord_strbuf_t *value;
+    cord_str_t name;
+    cord_str_t value;
     bool inline_;
 
     cord_bump_t *allocator;
@@ -227,11 +235,11 @@ void cord_embed_field_init(cord_embed_field_t *efield, cord_bump_t *allocator);
 
 // https://discord.com/developers/docs/resources/channel#embed-object
 typedef struct cord_embed_t {
-    cord_strbuf_t *title;
-    cord_strbuf_t *type;
-    cord_strbuf_t *description;
-    cord_strbuf_t *url;
-    cord_strbuf_t *timestamp;
+    cord_str_t title;
+    cord_str_t type;
+    cord_str_t description;
+    cord_str_t url;
+    cord_str_t timestamp;
     i32 color;
     cord_embed_footer_t *footer;
     cord_embed_image_t *image;
@@ -248,9 +256,9 @@ void cord_embed_init(cord_embed_t *emb, cord_bump_t *allocator);
 
 // (Emoji) - https://discord.com/developers/docs/resources/emoji#emoji-object
 typedef struct cord_emoji_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *name;
-    cord_array_t *roles; // cord_role_t[]
+    cord_snowflake_t id;
+    cord_str_t name;
+    cord_array_t *roles; // cord_snowflake_t[] (role ids)
     cord_user_t *user;
     bool require_colons;
     bool managed;
@@ -276,7 +284,7 @@ void cord_reaction_init(cord_reaction_t *reactio, cord_bump_t *allocator);
 // https://discord.com/developers/docs/resources/channel#message-object-message-activity-structure
 typedef struct cord_message_activity_t {
     i32 type;
-    cord_strbuf_t *party_id;
+    cord_str_t party_id;
 
     cord_bump_t *allocator;
 } cord_message_activity_t;
@@ -287,11 +295,11 @@ void cord_message_activity_init(cord_message_activity_t *mactivity,
 // (Message Application) -
 // https://discord.com/developers/docs/resources/channel#message-object-message-application-structure
 typedef struct cord_message_application_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *cover_image;
-    cord_strbuf_t *description;
-    cord_strbuf_t *icon;
-    cord_strbuf_t *name;
+    cord_snowflake_t id;
+    cord_str_t cover_image;
+    cord_str_t description;
+    cord_str_t icon;
+    cord_str_t name;
 
     cord_bump_t *allocator;
 } cord_message_application_t;
@@ -302,9 +310,9 @@ void cord_message_application_init(cord_message_application_t *mapplication,
 // (Message Reference) -
 // https://discord.com/developers/docs/resources/channel#message-object-message-reference-structure
 typedef struct cord_message_reference_t {
-    cord_strbuf_t *message_id;
-    cord_strbuf_t *channel_id;
-    cord_strbuf_t *guild_id;
+    cord_snowflake_t message_id;
+    cord_snowflake_t channel_id;
+    cord_snowflake_t guild_id;
 } cord_message_reference_t;
 
 void cord_message_reference_init(cord_message_reference_t *mreference,
@@ -313,13 +321,13 @@ void cord_message_reference_init(cord_message_reference_t *mreference,
 // (Message Sticker) -
 // https://discord.com/developers/docs/resources/channel#message-object-message-sticker-structure
 typedef struct cord_message_sticker_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *pack_id;
-    cord_strbuf_t *name;
-    cord_strbuf_t *description;
-    cord_strbuf_t *tags;
-    cord_strbuf_t *asset;
-    cord_strbuf_t *preview_asset;
+    cord_snowflake_t id;
+    cord_snowflake_t pack_id;
+    cord_str_t name;
+    cord_str_t description;
+    cord_str_t tags;
+    cord_str_t asset;
+    cord_str_t preview_asset;
     i32 format_type;
 
     cord_bump_t *allocator;
@@ -331,35 +339,33 @@ void cord_message_sticker_init(cord_message_sticker_t *msticker,
 // (Message) -
 // https://discord.com/developers/docs/resources/channel#message-object
 typedef struct cord_message_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *channel_id;
-    cord_strbuf_t *guild_id;
+    cord_snowflake_t id;
+    cord_snowflake_t channel_id;
+    cord_snowflake_t guild_id;
     cord_user_t *author;
     cord_guild_member_t *member;
-    cord_strbuf_t *content;
-    cord_strbuf_t *timestamp;
-    cord_strbuf_t *edited_timestamp;
+    cord_str_t content;
+    cord_str_t timestamp;
+    cord_str_t edited_timestamp;
     bool *tts;
     bool *mention_everyone;
 
-    // BUG: cord_array_t is supposed to store POD
-    // We can't allow resizing of the bump
-    cord_array_t *mentions;
-    cord_array_t *mention_roles;
-    cord_array_t *mention_channels;
-    cord_array_t *attachments;
-    cord_array_t *embeds;
-    cord_array_t *reactions;
+    cord_array_t *mentions;         // cord_user_t[]
+    cord_array_t *mention_roles;    // cord_snowflake_t[] (role ids)
+    cord_array_t *mention_channels; // cord_channel_mention_t[]
+    cord_array_t *attachments;      // cord_attachment_t[]
+    cord_array_t *embeds;           // cord_embed_t[]
+    cord_array_t *reactions;        // cord_reaction_t[]
 
-    cord_strbuf_t *nonce;
+    cord_str_t nonce;
     bool *pinned;
-    cord_strbuf_t *webhook_id;
+    cord_snowflake_t webhook_id;
     i32 *type;
     cord_message_activity_t *activity;
     cord_message_application_t *application;
     cord_message_reference_t *message_reference;
     i32 *flags;
-    cord_array_t *stickers;
+    cord_array_t *stickers; // cord_message_sticker_t[]
 
     /*
     This field is only returned for messages with a type of 19 (REPLY).
@@ -376,11 +382,11 @@ typedef struct cord_message_t {
 void cord_message_set_content(cord_message_t *message, const char *content);
 
 typedef struct cord_guild_t {
-    cord_strbuf_t *id;
-    cord_strbuf_t *name;
-    cord_strbuf_t *icon;
-    cord_strbuf_t *splash;
-    cord_strbuf_t *discovery_splash;
+    cord_snowflake_t id;
+    cord_str_t name;
+    cord_str_t icon;
+    cord_str_t splash;
+    cord_str_t discovery_splash;
 
     cord_bump_t *allocator;
 } cord_guild_t;
@@ -0,0 +1,31 @@
+#ifndef EVENT_HASH_H
+#define EVENT_HASH_H
+
+#include "../core/typedefs.h"
+
+// Generated by tools/gen_event_hash.c from GATEWAY_EVENTS, do not edit
+
+#define EVENT_HASH_EVENT_COUNT 75
+#define EVENT_HASH_MULTIPLIER 0xd894ad751ce0eedbULL
+
+// Event + 1 by slot, 0 is an empty slot
+static const u8 event_slots[256] = {
+    38,  0, 48,  0, 26, 69,  9, 47,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0, 16,  0, 33,  0, 29,  0,  0,  0,  0,  3,  0, 34, 54,
+     0,  0,  8,  0,  0, 60,  0,  0,  0,  0,  0,  0,  0,  0,  0, 61,
+    65,  0,  0,  0,  0,  0, 21, 15, 40,  0, 39, 50,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0, 36, 14,  0,  0,  5,  0, 46, 30,  0,  0,
+     0,  0,  0,  0,  0, 11, 42, 57,  0,  0, 28,  0,  0,  0,  0,  0,
+     4,  0,  0,  0,  0, 27,  0,  0,  0,  0,  0,  0,  0, 63, 75,  0,
+    71,  0,  0,  0,  0,  0, 70, 72, 64,  0,  0,  0, 73,  0, 62,  0,
+    74,  0, 52, 35,  0,  0,  0, 53,  0,  0,  0, 25,  0, 23,  0,  0,
+     2,  0,  0,  0,  0, 59,  0, 68,  0,  0,  0, 19,  0,  0, 41,  0,
+     0,  0,  0,  0,  0,  0, 58,  0, 31,  0, 12,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  7,  0,  6, 55,  0, 49,  0,  0, 43,  0,  0,  0,
+     0,  0, 13,  0,  0,  0, 32, 67,  0,  0,  0,  0, 24,  0,  0,  0,
+     1,  0,  0, 56,  0, 10,  0,  0,  0, 18,  0,  0, 20,  0,  0,  0,
+    22,  0,  0, 45,  0,  0,  0,  0,  0,  0, 37,  0, 17,  0, 51,  0,
+     0,  0,  0, 66,  0, 44,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+#endif
@@ -1,63 +1,52 @@
 #include "events.h"
 #include "../core/errors.h"
 #include "../core/log.h"
+#include "cache.h"
 #include "client.h"
+#include "event_hash.h"
 #include "serialization.h"
 
 #include <assert.h>
-#include <jansson.h>
+#include <string.h>
+
+#define GATEWAY_EVENT_ENTRY(name, intents)                                     \
+    {{(char *)#name, sizeof(#name) - 1}, (intents), NULL},
 
 /*
  *  Dictionary of all the possible discord gateway events
  */
 static cord_gateway_event_t gateway_events[] = {
-    {"CHANNEL_CREATE", NULL},
-    {"CHANNEL_UPDATE", NULL},
-    {"CHANNEL_DELETE", NULL},
-    {"CHANNEL_PINS_UPDATE", NULL},
-    {"GUILD_CREATE", NULL},
-    {"GUILD_UPDATE", NULL},
-    {"GUILD_DELETE", NULL},
-    {"GUILD_BAN_ADD", NULL},
-    {"GUILD_BAN_REMOVE", NULL},
-    {"GUILD_EMOJIS_UPDATE", NULL},
-    {"GUILD_MEMBER_ADD", NULL},
-    {"GUILD_MEMBER_UPDATE", NULL},
-    {"GUILD_MEMBERS_CHUNK", NULL},
-    {"GUILD_ROLE_CREATE", NULL},
-    {"GUILD_ROLE_UPDATE", NULL},
-    {"GUILD_ROLE_DELETE", NULL},
-    {"INVITE_CREATE", NULL},
-    {"INVITE_DELETE", NULL},
-    {"MESSAGE_CREATE", NULL},
-    {"MESSAGE_UPDATE", NULL},
-    {"MESSAGE_DELETE_BULK", NULL},
-    {"MESSAGE_REACTION_ADD", NULL},
-    {"MESSAGE_REACTION_REMOVE", NULL},
-    {"MESSAGE_REACTION_REMOVE_ALL", NULL},
-    {"MESSAGE_REACTION_REMOVE_EMOJI", NULL},
-    {"PRESENCE_UPDATE", NULL},
-
-    {"", NULL}};
+    GATEWAY_EVENTS(GATEWAY_EVENT_ENTRY)};
+
+// Events added or removed without regenerating, the tests catch renames
+static_assert(EVENT_HASH_EVENT_COUNT == GATEWAY_EVENT_COUNT,
+              "Regenerate event_hash.h with the event_hash target");
+
+static inline u8 event_hash(cord_str_t name) {
+    u64 key = gateway_event_key(name.data, (size_t)name.length);
+    return gateway_event_slot(key, EVENT_HASH_MULTIPLIER);
+}
 
 bool cord_gateway_event_has_handler(cord_gateway_event_t *event) {
     return event && event->handler;
 }
 
-static inline bool is_last_event(cord_gateway_event_t *event) {
-    return cstring_is_empty(event->name) && event->handler == NULL;
-}
+cord_gateway_event_t *get_gateway_event_from_str(cord_str_t event) {
+    if (event.length < EVENT_NAME_MIN_LENGTH ||
+        event.length > EVENT_NAME_MAX_LENGTH) {
+        return NULL;
+    }
 
-cord_gateway_event_t *get_gateway_event_from_cstring(char *event) {
-    cord_gateway_event_t *event_iterator = gateway_events;
-    while (!is_last_event(event_iterator)) {
-        if (cstring_is_equal(event_iterator->name, event)) {
-            return event_iterator;
-        }
-        event_iterator++;
+    u8 slot = event_slots[event_hash(event)];
+    if (slot == 0) {
+        return NULL;
     }
 
-    return NULL;
+    cord_gateway_event_t *candidate = &gateway_events[slot - 1];
+    if (!cord_str_equals(candidate->name, event)) {
+        return NULL;
+    }
+    return candidate;
 }
 
 cord_gateway_event_t *get_gateway_event(gateway_event_t event) {
@@ -68,174 +57,243 @@ cord_gateway_event_t *get_gateway_event(gateway_event_t event) {
     return &gateway_events[event_table_index];
 }
 
-static void log_event(char *event) {
-    logger_info("Received event: %s", event);
+void cord_gateway_event_set_handler(gateway_event_t event,
+                                    event_handler handler) {
+    get_gateway_event(event)->handler = handler;
+}
+
+i32 cord_gateway_intents_from_handlers(void) {
+    i32 intents = 0;
+    for (i32 i = 0; i < GATEWAY_EVENT_COUNT; i++) {
+        if (cord_gateway_event_has_handler(&gateway_events[i])) {
+            intents |= gateway_events[i].intents;
+        }
+    }
+    return intents;
+}
+
+static void log_event(cord_str_t event) {
+    logger_info("Received event: %.*s", (int)event.length, event.data);
+}
+
+// Events of entities are only handled to keep the cache up to date
+static void update_cache(cord_client_t *client,
+                         cord_json_reader_t *data,
+                         cord_str_t event,
+                         gateway_event_t type) {
+    if (client->cache && !cord_cache_apply(client->cache, type, data)) {
+        logger_error("Failed to cache %.*s: %s",
+                     (int)event.length,
+                     event.data,
+                     not_null_cstring_dash(data->error));
+    }
 }
 
 /**
- * json_t *data is a borrowed reference
+ * cord_json_reader_t *data reads from the frame's receive buffer
  *
- * The callback methods MUST NOT attempt to free/decref it
+ * Anything decoded from it, including strings, is only valid until the
+ * handler returns
  */
 
-void on_channel_create(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_channel_create(cord_client_t *client,
+                       cord_json_reader_t *data,
+                       cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_CHANNEL_CREATE);
 }
 
-void on_channel_update(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_channel_update(cord_client_t *client,
+                       cord_json_reader_t *data,
+                       cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_CHANNEL_UPDATE);
 }
 
-void on_channel_delete(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_channel_delete(cord_client_t *client,
+                       cord_json_reader_t *data,
+                       cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_CHANNEL_DELETE);
 }
 
-void on_channel_pins_update(cord_client_t *client, json_t *data, char *event) {
+void on_channel_pins_update(cord_client_t *client,
+                            cord_json_reader_t *data,
+                            cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_guild_create(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_create(cord_client_t *client,
+                     cord_json_reader_t *data,
+                     cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_CREATE);
 }
 
-void on_guild_update(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_update(cord_client_t *client,
+                     cord_json_reader_t *data,
+                     cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_UPDATE);
 }
 
-void on_guild_delete(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_delete(cord_client_t *client,
+                     cord_json_reader_t *data,
+                     cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_DELETE);
 }
 
-void on_guild_ban_add(cord_client_t *client, json_t *data, char *event) {
+void on_guild_ban_add(cord_client_t *client,
+                      cord_json_reader_t *data,
+                      cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_guild_ban_remove(cord_client_t *client, json_t *data, char *event) {
+void on_guild_ban_remove(cord_client_t *client,
+                         cord_json_reader_t *data,
+                         cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_guild_emojis_update(cord_client_t *client, json_t *data, char *event) {
+void on_guild_emojis_update(cord_client_t *client,
+                            cord_json_reader_t *data,
+                            cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_guild_member_add(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_member_add(cord_client_t *client,
+                         cord_json_reader_t *data,
+                         cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_MEMBER_ADD);
 }
 
-void on_guild_member_update(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_member_remove(cord_client_t *client,
+                            cord_json_reader_t *data,
+                            cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_MEMBER_REMOVE);
 }
 
-void on_guild_members_chunk(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_member_update(cord_client_t *client,
+                            cord_json_reader_t *data,
+                            cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_MEMBER_UPDATE);
 }
 
-void on_guild_role_create(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_members_chunk(cord_client_t *client,
+                            cord_json_reader_t *data,
+                            cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_MEMBERS_CHUNK);
 }
 
-void on_guild_role_update(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_role_create(cord_client_t *client,
+                          cord_json_reader_t *data,
+                          cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_ROLE_CREATE);
 }
 
-void on_guild_role_delete(cord_client_t *client, json_t *data, char *event) {
-    assert(false && "Not Implemented");
-    (void)data;
-    (void)client;
-    (void)event;
+void on_guild_role_update(cord_client_t *client,
+                          cord_json_reader_t *data,
+                          cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_ROLE_UPDATE);
+}
+
+void on_guild_role_delete(cord_client_t *client,
+                          cord_json_reader_t *data,
+                          cord_str_t event) {
+    update_cache(client, data, event, GATEWAY_EVENT_GUILD_ROLE_DELETE);
 }
 
-void on_invite_create(cord_client_t *client, json_t *data, char *event) {
+void on_invite_create(cord_client_t *client,
+                      cord_json_reader_t *data,
+                      cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_invite_delete(cord_client_t *client, json_t *data, char *event) {
+void on_invite_delete(cord_client_t *client,
+                      cord_json_reader_t *data,
+                      cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_message_create(cord_client_t *client, json_t *data, char *event) {
+void on_message_create(cord_client_t *client,
+                       cord_json_reader_t *data,
+                       cord_str_t event) {
     cord_t *cord = (cord_t *)client->user_data;
     log_event(event);
 
-    cord_bump_t *bump = cord_bump_create();
-    cord_serialize_result_t message = cord_message_serialize(data, bump);
+    cord_bump_t *bump = cord_arena_pool_acquire(&client->event_arenas);
+    if (!bump) {
+        return;
+    }
+
+    cord_gateway_event_callbacks_t *callbacks = &client->event_callbacks;
+    if (!callbacks->on_message_view_cb) {
+        cord_serialize_result_t message =
+            cord_message_serialize(data, cord_json_next(data), bump);
+
+        if (message.error) {
+            char *err = cord_error(message.error);
+            logger_error("Failed to serialize message: %s", err);
+            cord_arena_pool_release(&client->event_arenas, bump);
+            return;
+        }
 
-    if (message.error) {
-        char *err = cord_error(message.error);
-        logger_error("Failed to serialize message: %s", err);
+        callbacks->on_message_cb(cord, bump, message.obj);
+        cord_arena_pool_release(&client->event_arenas, bump);
         return;
     }
 
-    client->event_callbacks.on_message_cb(cord, bump, message.obj);
-    cord_bump_destroy(bump);
+    cord_message_view_t view = {0};
+    if (!cord_message_view_init(&view, data, bump)) {
+        logger_error("Failed to read message");
+        cord_arena_pool_release(&client->event_arenas, bump);
+        return;
+    }
+
+    callbacks->on_message_view_cb(cord, bump, &view);
+    // Whatever the view already decoded is reused
+    cord_message_t *message =
+        callbacks->on_message_cb ? cord_message_view_decode(&view) : NULL;
+    if (message) {
+        callbacks->on_message_cb(cord, bump, message);
+    }
+    cord_arena_pool_release(&client->event_arenas, bump);
 }
 
-void on_message_update(cord_client_t *client, json_t *data, char *event) {
+void on_message_update(cord_client_t *client,
+                       cord_json_reader_t *data,
+                       cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_message_delete_bulk(cord_client_t *client, json_t *data, char *event) {
+void on_message_delete_bulk(cord_client_t *client,
+                            cord_json_reader_t *data,
+                            cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_message_reaction_add(cord_client_t *client, json_t *data, char *event) {
+void on_message_reaction_add(cord_client_t *client,
+                             cord_json_reader_t *data,
+                             cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
@@ -243,8 +301,8 @@ void on_message_reaction_add(cord_client_t *client, json_t *data, char *event) {
 }
 
 void on_message_reaction_remove(cord_client_t *client,
-                                json_t *data,
-                                char *event) {
+                                cord_json_reader_t *data,
+                                cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
@@ -252,8 +310,8 @@ void on_message_reaction_remove(cord_client_t *client,
 }
 
 void on_message_reaction_remove_all(cord_client_t *client,
-                                    json_t *data,
-                                    char *event) {
+                                    cord_json_reader_t *data,
+                                    cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
@@ -261,15 +319,17 @@ void on_message_reaction_remove_all(cord_client_t *client,
 }
 
 void on_message_reaction_remove_emoji(cord_client_t *client,
-                                      json_t *data,
-                                      char *event) {
+                                      cord_json_reader_t *data,
+                                      cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
     (void)event;
 }
 
-void on_presence_update(cord_client_t *client, json_t *data, char *event) {
+void on_presence_update(cord_client_t *client,
+                        cord_json_reader_t *data,
+                        cord_str_t event) {
     assert(false && "Not Implemented");
     (void)data;
     (void)client;
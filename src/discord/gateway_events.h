@@ -0,0 +1,159 @@
+#ifndef GATEWAY_EVENTS_H
+#define GATEWAY_EVENTS_H
+
+#include "../core/typedefs.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Gateway intents, the groups of events a connection subscribes to when it
+ * identifies
+ */
+typedef enum gateway_intent_t {
+    INTENT_GUILDS = (1 << 0),
+    INTENT_GUILD_MEMBERS = (1 << 1),
+    INTENT_GUILD_MODERATION = (1 << 2),
+    INTENT_GUILD_EXPRESSIONS = (1 << 3),
+    INTENT_GUILD_INTEGRATIONS = (1 << 4),
+    INTENT_GUILD_WEBHOOKS = (1 << 5),
+    INTENT_GUILD_INVITES = (1 << 6),
+    INTENT_GUILD_VOICE_STATES = (1 << 7),
+    INTENT_GUILD_PRESENCES = (1 << 8),
+    INTENT_GUILD_MESSAGES = (1 << 9),
+    INTENT_GUILD_MESSAGE_REACTIONS = (1 << 10),
+    INTENT_GUILD_MESSAGE_TYPING = (1 << 11),
+    INTENT_DIRECT_MESSAGES = (1 << 12),
+    INTENT_DIRECT_MESSAGE_REACTIONS = (1 << 13),
+    INTENT_DIRECT_MESSAGE_TYPING = (1 << 14),
+    INTENT_MESSAGE_CONTENT = (1 << 15),
+    INTENT_GUILD_SCHEDULED_EVENTS = (1 << 16),
+    INTENT_AUTO_MODERATION_CONFIGURATION = (1 << 20),
+    INTENT_AUTO_MODERATION_EXECUTION = (1 << 21),
+    INTENT_GUILD_MESSAGE_POLLS = (1 << 24),
+    INTENT_DIRECT_MESSAGE_POLLS = (1 << 25),
+
+    // Events that are sent for both guilds and direct messages
+    INTENT_MESSAGES = INTENT_GUILD_MESSAGES | INTENT_DIRECT_MESSAGES,
+    INTENT_REACTIONS =
+        INTENT_GUILD_MESSAGE_REACTIONS | INTENT_DIRECT_MESSAGE_REACTIONS,
+    INTENT_TYPING = INTENT_GUILD_MESSAGE_TYPING | INTENT_DIRECT_MESSAGE_TYPING,
+    INTENT_POLLS = INTENT_GUILD_MESSAGE_POLLS | INTENT_DIRECT_MESSAGE_POLLS
+} gateway_intent_t;
+
+/*
+ * Every event the gateway dispatches, with the intents that subscribe to it
+ *
+ * Events are looked up by name through the perfect hash in event_hash.h.
+ * After changing this list, regenerate it with the event_hash target.
+ */
+#define GATEWAY_EVENTS(event)                                                  \
+    event(READY, 0)                                                            \
+    event(RESUMED, 0)                                                          \
+    event(APPLICATION_COMMAND_PERMISSIONS_UPDATE, 0)                           \
+    event(AUTO_MODERATION_RULE_CREATE, INTENT_AUTO_MODERATION_CONFIGURATION)   \
+    event(AUTO_MODERATION_RULE_UPDATE, INTENT_AUTO_MODERATION_CONFIGURATION)   \
+    event(AUTO_MODERATION_RULE_DELETE, INTENT_AUTO_MODERATION_CONFIGURATION)   \
+    event(AUTO_MODERATION_ACTION_EXECUTION, INTENT_AUTO_MODERATION_EXECUTION)  \
+    event(CHANNEL_CREATE, INTENT_GUILDS)                                       \
+    event(CHANNEL_UPDATE, INTENT_GUILDS)                                       \
+    event(CHANNEL_DELETE, INTENT_GUILDS)                                       \
+    event(CHANNEL_PINS_UPDATE, INTENT_GUILDS | INTENT_DIRECT_MESSAGES)         \
+    event(THREAD_CREATE, INTENT_GUILDS)                                        \
+    event(THREAD_UPDATE, INTENT_GUILDS)                                        \
+    event(THREAD_DELETE, INTENT_GUILDS)                                        \
+    event(THREAD_LIST_SYNC, INTENT_GUILDS)                                     \
+    event(THREAD_MEMBER_UPDATE, INTENT_GUILDS)                                 \
+    event(THREAD_MEMBERS_UPDATE, INTENT_GUILDS | INTENT_GUILD_MEMBERS)         \
+    event(ENTITLEMENT_CREATE, 0)                                               \
+    event(ENTITLEMENT_UPDATE, 0)                                               \
+    event(ENTITLEMENT_DELETE, 0)                                               \
+    event(GUILD_CREATE, INTENT_GUILDS)                                         \
+    event(GUILD_UPDATE, INTENT_GUILDS)                                         \
+    event(GUILD_DELETE, INTENT_GUILDS)                                         \
+    event(GUILD_AUDIT_LOG_ENTRY_CREATE, INTENT_GUILD_MODERATION)               \
+    event(GUILD_BAN_ADD, INTENT_GUILD_MODERATION)                              \
+    event(GUILD_BAN_REMOVE, INTENT_GUILD_MODERATION)                           \
+    event(GUILD_EMOJIS_UPDATE, INTENT_GUILD_EXPRESSIONS)                       \
+    event(GUILD_STICKERS_UPDATE, INTENT_GUILD_EXPRESSIONS)                     \
+    event(GUILD_INTEGRATIONS_UPDATE, INTENT_GUILD_INTEGRATIONS)                \
+    event(GUILD_MEMBER_ADD, INTENT_GUILD_MEMBERS)                              \
+    event(GUILD_MEMBER_REMOVE, INTENT_GUILD_MEMBERS)                           \
+    event(GUILD_MEMBER_UPDATE, INTENT_GUILD_MEMBERS)                           \
+    event(GUILD_MEMBERS_CHUNK, 0)                                              \
+    event(GUILD_ROLE_CREATE, INTENT_GUILDS)                                    \
+    event(GUILD_ROLE_UPDATE, INTENT_GUILDS)                                    \
+    event(GUILD_ROLE_DELETE, INTENT_GUILDS)                                    \
+    event(GUILD_SCHEDULED_EVENT_CREATE, INTENT_GUILD_SCHEDULED_EVENTS)         \
+    event(GUILD_SCHEDULED_EVENT_UPDATE, INTENT_GUILD_SCHEDULED_EVENTS)         \
+    event(GUILD_SCHEDULED_EVENT_DELETE, INTENT_GUILD_SCHEDULED_EVENTS)         \
+    event(GUILD_SCHEDULED_EVENT_USER_ADD, INTENT_GUILD_SCHEDULED_EVENTS)       \
+    event(GUILD_SCHEDULED_EVENT_USER_REMOVE, INTENT_GUILD_SCHEDULED_EVENTS)    \
+    event(GUILD_SOUNDBOARD_SOUND_CREATE, INTENT_GUILD_EXPRESSIONS)             \
+    event(GUILD_SOUNDBOARD_SOUND_UPDATE, INTENT_GUILD_EXPRESSIONS)             \
+    event(GUILD_SOUNDBOARD_SOUND_DELETE, INTENT_GUILD_EXPRESSIONS)             \
+    event(GUILD_SOUNDBOARD_SOUNDS_UPDATE, INTENT_GUILD_EXPRESSIONS)            \
+    event(SOUNDBOARD_SOUNDS, 0)                                                \
+    event(INTEGRATION_CREATE, INTENT_GUILD_INTEGRATIONS)                       \
+    event(INTEGRATION_UPDATE, INTENT_GUILD_INTEGRATIONS)                       \
+    event(INTEGRATION_DELETE, INTENT_GUILD_INTEGRATIONS)                       \
+    event(INTERACTION_CREATE, 0)                                               \
+    event(INVITE_CREATE, INTENT_GUILD_INVITES)                                 \
+    event(INVITE_DELETE, INTENT_GUILD_INVITES)                                 \
+    event(MESSAGE_CREATE, INTENT_MESSAGES | INTENT_MESSAGE_CONTENT)            \
+    event(MESSAGE_UPDATE, INTENT_MESSAGES | INTENT_MESSAGE_CONTENT)            \
+    event(MESSAGE_DELETE, INTENT_MESSAGES)                                     \
+    event(MESSAGE_DELETE_BULK, INTENT_GUILD_MESSAGES)                          \
+    event(MESSAGE_REACTION_ADD, INTENT_REACTIONS)                              \
+    event(MESSAGE_REACTION_REMOVE, INTENT_REACTIONS)                           \
+    event(MESSAGE_REACTION_REMOVE_ALL, INTENT_REACTIONS)                       \
+    event(MESSAGE_REACTION_REMOVE_EMOJI, INTENT_REACTIONS)                     \
+    event(MESSAGE_POLL_VOTE_ADD, INTENT_POLLS)                                 \
+    event(MESSAGE_POLL_VOTE_REMOVE, INTENT_POLLS)                              \
+    event(PRESENCE_UPDATE, INTENT_GUILD_PRESENCES)                             \
+    event(STAGE_INSTANCE_CREATE, INTENT_GUILDS)                                \
+    event(STAGE_INSTANCE_UPDATE, INTENT_GUILDS)                                \
+    event(STAGE_INSTANCE_DELETE, INTENT_GUILDS)                                \
+    event(SUBSCRIPTION_CREATE, 0)                                              \
+    event(SUBSCRIPTION_UPDATE, 0)                                              \
+    event(SUBSCRIPTION_DELETE, 0)                                              \
+    event(TYPING_START, INTENT_TYPING)                                         \
+    event(USER_UPDATE, 0)                                                      \
+    event(VOICE_CHANNEL_EFFECT_SEND, INTENT_GUILD_VOICE_STATES)                \
+    event(VOICE_STATE_UPDATE, INTENT_GUILD_VOICE_STATES)                       \
+    event(VOICE_SERVER_UPDATE, 0)                                              \
+    event(WEBHOOKS_UPDATE, INTENT_GUILD_WEBHOOKS)
+
+/*
+ * Event names are reduced to a key made of their length and three 4 byte
+ * loads, at the start, at offset 4 and at the end, which is distinct for
+ * every event. The top 8 bits of the key times a multiplier index the slots
+ * of the perfect hash, tools/gen_event_hash.c searches for a multiplier
+ * that keeps them distinct too.
+ */
+#define EVENT_NAME_MIN_LENGTH 4
+#define EVENT_NAME_MAX_LENGTH 64
+
+static inline u64 gateway_event_load_u32(const char *data) {
+    u32 value = 0;
+    memcpy(&value, data, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+// Only for names of EVENT_NAME_MIN_LENGTH to EVENT_NAME_MAX_LENGTH
+static inline u64 gateway_event_key(const char *name, size_t length) {
+    size_t middle = length < 8 ? length - 4 : 4;
+    u64 key = gateway_event_load_u32(name) |
+              gateway_event_load_u32(name + middle) << 32;
+    key ^= gateway_event_load_u32(name + length - 4) * 0x9E3779B1ULL;
+    return key ^ length;
+}
+
+static inline u8 gateway_event_slot(u64 key, u64 multiplier) {
+    return (u8)((key * multiplier) >> 56);
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include "message_builder.h"
+#include "../core/log.h"
+
+#include <assert.h>
+#include <string.h>
+
+void cord_message_builder_init(cord_message_builder_t *builder,
+                               cord_bump_t *allocator,
+                               cord_snowflake_t channel_id) {
+    assert(builder && "cord_message_builder_t must not be null");
+    assert(allocator && "allocator must not be null");
+
+    memset(builder, 0, sizeof(cord_message_builder_t));
+    builder->message.channel_id = channel_id;
+    builder->message.allocator = allocator;
+    builder->allocator = allocator;
+}
+
+void cord_message_builder_set_content(cord_message_builder_t *builder,
+                                      cord_str_t content) {
+    builder->message.content = content;
+}
+
+bool cord_message_builder_set_tts(cord_message_builder_t *builder, bool tts) {
+    bool *value = balloc(builder->allocator, sizeof(bool));
+    if (!value) {
+        logger_error("Failed to allocate message tts");
+        return false;
+    }
+    *value = tts;
+    builder->message.tts = value;
+    return true;
+}
+
+bool cord_message_builder_set_flags(cord_message_builder_t *builder,
+                                    i32 flags) {
+    i32 *value = balloc(builder->allocator, sizeof(i32));
+    if (!value) {
+        logger_error("Failed to allocate message flags");
+        return false;
+    }
+    *value = flags;
+    builder->message.flags = value;
+    return true;
+}
+
+bool cord_message_builder_reply_to(cord_message_builder_t *builder,
+                                   cord_snowflake_t message_id) {
+    cord_message_reference_t *reference =
+        balloc(builder->allocator, sizeof(cord_message_reference_t));
+    if (!reference) {
+        logger_error("Failed to allocate message reference");
+        return false;
+    }
+    *reference = (cord_message_reference_t){.message_id = message_id};
+    builder->message.message_reference = reference;
+    return true;
+}
+
+void cord_message_builder_on_sent(cord_message_builder_t *builder,
+                                  cord_message_sent_cb on_sent,
+                                  void *user_data) {
+    builder->on_sent = on_sent;
+    builder->user_data = user_data;
+}
+
+// Next slot of *array, creating the array the first time
+static void *push(cord_bump_t *allocator,
+                  cord_array_t **array,
+                  size_t element_size) {
+    if (!*array) {
+        *array = cord_array_create(allocator, element_size);
+    }
+    return *array ? cord_array_push(*array) : NULL;
+}
+
+cord_embed_t *cord_message_builder_add_embed(cord_message_builder_t *builder) {
+    cord_embed_t *embed = push(
+        builder->allocator, &builder->message.embeds, sizeof(cord_embed_t));
+    if (!embed) {
+        logger_error("Failed to allocate embed");
+        return NULL;
+    }
+    cord_embed_init(embed, builder->allocator);
+    return embed;
+}
+
+bool cord_embed_add_field(cord_embed_t *embed,
+                          cord_str_t name,
+                          cord_str_t value,
+                          bool inline_) {
+    cord_embed_field_t *field =
+        push(embed->allocator, &embed->fields, sizeof(cord_embed_field_t));
+    if (!field) {
+        logger_error("Failed to allocate embed field");
+        return false;
+    }
+    *field = (cord_embed_field_t){name, value, inline_, embed->allocator};
+    return true;
+}
+
+cord_allowed_mentions_t *
+cord_message_builder_allowed_mentions(cord_message_builder_t *builder,
+                                      u32 parse) {
+    cord_allowed_mentions_t *mentions =
+        balloc(builder->allocator, sizeof(cord_allowed_mentions_t));
+    if (!mentions) {
+        logger_error("Failed to allocate allowed mentions");
+        return NULL;
+    }
+    *mentions = (cord_allowed_mentions_t){
+        .parse = parse,
+        .allocator = builder->allocator,
+    };
+    builder->allowed_mentions = mentions;
+    return mentions;
+}
+
+static bool push_id(cord_bump_t *allocator,
+                    cord_array_t **ids,
+                    cord_snowflake_t id) {
+    cord_snowflake_t *slot = push(allocator, ids, sizeof(cord_snowflake_t));
+    if (!slot) {
+        logger_error("Failed to allocate allowed mention");
+        return false;
+    }
+    *slot = id;
+    return true;
+}
+
+bool cord_allowed_mentions_add_user(cord_allowed_mentions_t *mentions,
+                                    cord_snowflake_t user_id) {
+    return push_id(mentions->allocator, &mentions->users, user_id);
+}
+
+bool cord_allowed_mentions_add_role(cord_allowed_mentions_t *mentions,
+                                    cord_snowflake_t role_id) {
+    return push_id(mentions->allocator, &mentions->roles, role_id);
+}
+
+cord_component_t *
+cord_message_builder_add_row(cord_message_builder_t *builder) {
+    cord_component_t *row = push(
+        builder->allocator, &builder->components, sizeof(cord_component_t));
+    if (!row) {
+        logger_error("Failed to allocate action row");
+        return NULL;
+    }
+    *row = (cord_component_t){
+        .type = CORD_COMPONENT_ACTION_ROW,
+        .allocator = builder->allocator,
+    };
+    return row;
+}
+
+cord_component_t *cord_component_add_button(cord_component_t *row,
+                                            cord_button_style_t style,
+                                            cord_str_t label,
+                                            cord_str_t id) {
+    assert(row->type == CORD_COMPONENT_ACTION_ROW && "Buttons go in rows");
+
+    cord_component_t *button =
+        push(row->allocator, &row->components, sizeof(cord_component_t));
+    if (!button) {
+        logger_error("Failed to allocate button");
+        return NULL;
+    }
+    *button = (cord_component_t){
+        .type = CORD_COMPONENT_BUTTON,
+        .style = style,
+        .label = label,
+        .allocator = row->allocator,
+    };
+    if (style == CORD_BUTTON_LINK) {
+        button->url = id;
+    } else {
+        button->custom_id = id;
+    }
+    return button;
+}
+
+static bool attach(cord_message_builder_t *builder,
+                   cord_http_file_t file,
+                   cord_str_t description) {
+    cord_http_file_t *slot =
+        push(builder->allocator, &builder->files, sizeof(cord_http_file_t));
+    cord_str_t *description_slot = slot ? push(builder->allocator,
+                                               &builder->file_descriptions,
+                                               sizeof(cord_str_t))
+                                        : NULL;
+    if (!description_slot) {
+        logger_error("Failed to allocate attachment");
+        // Keep the files and their descriptions in step
+        if (slot) {
+            builder->files->num_elements--;
+        }
+        return false;
+    }
+    *slot = file;
+    *description_slot = description;
+    return true;
+}
+
+bool cord_message_builder_attach_file(cord_message_builder_t *builder,
+                                      const char *filename,
+                                      const char *path,
+                                      cord_str_t description) {
+    assert(filename && path && "Attached files need a name and a path");
+    return attach(builder,
+                  (cord_http_file_t){.filename = filename, .path = path},
+                  description);
+}
+
+bool cord_message_builder_attach_data(cord_message_builder_t *builder,
+                                      const char *filename,
+                                      const char *data,
+                                      size_t length,
+                                      cord_str_t description) {
+    assert(filename && data && "Attached data needs a name and data");
+    return attach(builder,
+                  (cord_http_file_t){
+                      .filename = filename,
+                      .data = data,
+                      .length = length,
+                  },
+                  description);
+}
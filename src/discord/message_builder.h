@@ -0,0 +1,138 @@
+#ifndef MESSAGE_BUILDER_H
+#define MESSAGE_BUILDER_H
+
+#include "../core/array.h"
+#include "../core/memory.h"
+#include "../core/snowflake.h"
+#include "../core/strings.h"
+#include "../http/http.h"
+#include "entities.h"
+
+#include <stdbool.h>
+
+// Mentions that are parsed from the content, for allowed mentions
+typedef enum cord_mention_parse_t {
+    CORD_MENTION_USERS = 1 << 0,
+    CORD_MENTION_ROLES = 1 << 1,
+    CORD_MENTION_EVERYONE = 1 << 2
+} cord_mention_parse_t;
+
+// https://discord.com/developers/docs/resources/channel#allowed-mentions-object
+typedef struct cord_allowed_mentions_t {
+    u32 parse;                  // cord_mention_parse_t flags
+    cord_array_t *users;        // cord_snowflake_t[]
+    cord_array_t *roles;        // cord_snowflake_t[]
+    bool replied_user;
+
+    cord_bump_t *allocator;
+} cord_allowed_mentions_t;
+
+typedef enum cord_component_type_t {
+    CORD_COMPONENT_ACTION_ROW = 1,
+    CORD_COMPONENT_BUTTON = 2
+} cord_component_type_t;
+
+typedef enum cord_button_style_t {
+    CORD_BUTTON_PRIMARY = 1,
+    CORD_BUTTON_SECONDARY = 2,
+    CORD_BUTTON_SUCCESS = 3,
+    CORD_BUTTON_DANGER = 4,
+    CORD_BUTTON_LINK = 5
+} cord_button_style_t;
+
+// https://discord.com/developers/docs/interactions/message-components
+typedef struct cord_component_t {
+    cord_component_type_t type;
+    cord_button_style_t style;
+    cord_str_t label;
+    cord_str_t custom_id;
+    cord_str_t url;
+    bool disabled;
+    cord_array_t *components; // cord_component_t[] of an action row
+
+    cord_bump_t *allocator;
+} cord_component_t;
+
+typedef void (*cord_message_sent_cb)(cord_http_result_t result,
+                                     void *user_data);
+
+/*
+ * Message to send, with what only outgoing messages have
+ *
+ * Everything is allocated in allocator, usually the bump of the event
+ * being handled, and strings are not copied until the message is sent.
+ * Files are never copied: files on disk are read and files in memory are
+ * sent from where they are as the request goes out, so the data of those
+ * has to stay valid until on_sent is called.
+ */
+typedef struct cord_message_builder_t {
+    cord_message_t message;
+    cord_allowed_mentions_t *allowed_mentions;
+    cord_array_t *components;        // cord_component_t[] action rows
+    cord_array_t *files;             // cord_http_file_t[]
+    cord_array_t *file_descriptions; // cord_str_t[] of the files
+
+    cord_message_sent_cb on_sent;
+    void *user_data;
+    cord_bump_t *allocator;
+} cord_message_builder_t;
+
+void cord_message_builder_init(cord_message_builder_t *builder,
+                               cord_bump_t *allocator,
+                               cord_snowflake_t channel_id);
+
+void cord_message_builder_set_content(cord_message_builder_t *builder,
+                                      cord_str_t content);
+bool cord_message_builder_set_tts(cord_message_builder_t *builder, bool tts);
+bool cord_message_builder_set_flags(cord_message_builder_t *builder,
+                                    i32 flags);
+bool cord_message_builder_reply_to(cord_message_builder_t *builder,
+                                   cord_snowflake_t message_id);
+void cord_message_builder_on_sent(cord_message_builder_t *builder,
+                                  cord_message_sent_cb on_sent,
+                                  void *user_data);
+
+// Returns an empty embed to fill in, NULL if it couldn't be allocated
+cord_embed_t *cord_message_builder_add_embed(cord_message_builder_t *builder);
+bool cord_embed_add_field(cord_embed_t *embed,
+                          cord_str_t name,
+                          cord_str_t value,
+                          bool inline_);
+
+/*
+ * Only the mentions parsed as given by parse and the users and roles added
+ * to the result ping anyone. Without this the content decides.
+ */
+cord_allowed_mentions_t *
+cord_message_builder_allowed_mentions(cord_message_builder_t *builder,
+                                      u32 parse);
+bool cord_allowed_mentions_add_user(cord_allowed_mentions_t *mentions,
+                                    cord_snowflake_t user_id);
+bool cord_allowed_mentions_add_role(cord_allowed_mentions_t *mentions,
+                                    cord_snowflake_t role_id);
+
+cord_component_t *cord_message_builder_add_row(cord_message_builder_t *builder);
+
+// Link buttons open id as their url, the others send it as their custom id
+cord_component_t *cord_component_add_button(cord_component_t *row,
+                                            cord_button_style_t style,
+                                            cord_str_t label,
+                                            cord_str_t id);
+
+/*
+ * Attach the file at path, read as the message is sent. Names are only
+ * borrowed until then. description can be empty.
+ */
+bool cord_message_builder_attach_file(cord_message_builder_t *builder,
+                                      const char *filename,
+                                      const char *path,
+                                      cord_str_t description);
+
+// Attach length bytes of data, which are sent from where they are
+bool cord_message_builder_attach_data(cord_message_builder_t *builder,
+                                      const char *filename,
+                                      const char *data,
+                                      size_t length,
+                                      cord_str_t description);
+
+#endif
@@ -0,0 +1,376 @@
+#include "message_view.h"
+#include "../core/log.h"
+#include "serialization.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define CORD_MESSAGE_FIELD_KEY(name, key) {key, sizeof(key) - 1},
+
+static const cord_str_t field_keys[] = {
+    CORD_MESSAGE_FIELDS(CORD_MESSAGE_FIELD_KEY)};
+
+static i32 field_of(cord_str_t key) {
+    for (i32 field = 0; field < CORD_MESSAGE_FIELD_COUNT; field++) {
+        if (field_keys[field].length == key.length &&
+            memcmp(field_keys[field].data, key.data, (size_t)key.length) ==
+                0) {
+            return field;
+        }
+    }
+    return -1;
+}
+
+bool cord_message_view_init(cord_message_view_t *view,
+                            cord_json_reader_t *data,
+                            cord_bump_t *allocator) {
+    assert(view && "cord_message_view_t must not be null");
+
+    memset(view, 0, sizeof(cord_message_view_t));
+    view->allocator = allocator;
+    view->reader = data;
+
+    cord_json_token_t start = cord_json_next(data);
+    if (start.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return false;
+    }
+    view->start = start.value.data;
+    view->depth = data->depth;
+    return true;
+}
+
+/*
+ * Read the top level up to field unless it was passed already. Fields of
+ * no interest are skipped without being decoded.
+ */
+static bool find_field(cord_message_view_t *view,
+                       cord_message_field_t field,
+                       cord_str_t *value) {
+    cord_json_reader_t *reader = view->reader;
+    while (!(view->found & (1u << field)) && !view->end) {
+        cord_str_t key = {0};
+        if (!cord_json_finish_value(reader, view->depth) ||
+            !cord_json_next_key(reader, &key)) {
+            view->end = cord_json_failed(reader)
+                            ? view->start
+                            : reader->data + reader->position;
+            break;
+        }
+
+        i32 found = field_of(key);
+        if (found < 0) {
+            continue;
+        }
+
+        cord_str_t raw = cord_json_read_raw(reader);
+        if (cord_json_failed(reader)) {
+            view->end = view->start;
+            break;
+        }
+        view->offsets[found] = (u32)(raw.data - view->start);
+        view->lengths[found] = (u32)raw.length;
+        view->found |= 1u << found;
+    }
+
+    if (!(view->found & (1u << field))) {
+        return false;
+    }
+    *value = (cord_str_t){(char *)view->start + view->offsets[field],
+                          (ssize_t)view->lengths[field]};
+    return true;
+}
+
+// Reader of the value of field, positioned after its first token
+static bool read_field(cord_message_view_t *view,
+                       cord_message_field_t field,
+                       cord_json_reader_t *reader,
+                       cord_json_token_t *token) {
+    cord_str_t value = {0};
+    if (!find_field(view, field, &value)) {
+        return false;
+    }
+
+    cord_json_reader_init(reader, value, view->allocator);
+    *token = cord_json_next(reader);
+    return !cord_json_failed(reader);
+}
+
+static cord_snowflake_t snowflake_field(cord_message_view_t *view,
+                                        cord_message_field_t field) {
+    cord_str_t value = {0};
+    // Ids are digits in quotes, never with escapes
+    if (!find_field(view, field, &value) || value.length < 2 ||
+        value.data[0] != '"') {
+        return 0;
+    }
+    return cord_snowflake_parse(
+        (cord_str_t){value.data + 1, value.length - 2});
+}
+
+static cord_str_t string_field(cord_message_view_t *view,
+                               cord_message_field_t field) {
+    cord_str_t *decoded = view->decoded[field];
+    if (decoded) {
+        return *decoded;
+    }
+
+    cord_json_reader_t reader = {0};
+    cord_json_token_t token = {0};
+    if (!read_field(view, field, &reader, &token) ||
+        token.type != CORD_JSON_TOKEN_STRING) {
+        return (cord_str_t){"", 0};
+    }
+
+    // Only strings with escapes are copied, the rest are slices of the frame
+    decoded = balloc(view->allocator, sizeof(cord_str_t));
+    if (decoded) {
+        *decoded = token.value;
+        view->decoded[field] = decoded;
+    }
+    return token.value;
+}
+
+cord_snowflake_t cord_message_get_id(cord_message_view_t *view) {
+    return snowflake_field(view, CORD_MESSAGE_FIELD_ID);
+}
+
+cord_snowflake_t cord_message_get_channel_id(cord_message_view_t *view) {
+    return snowflake_field(view, CORD_MESSAGE_FIELD_CHANNEL_ID);
+}
+
+cord_snowflake_t cord_message_get_guild_id(cord_message_view_t *view) {
+    return snowflake_field(view, CORD_MESSAGE_FIELD_GUILD_ID);
+}
+
+cord_snowflake_t cord_message_get_webhook_id(cord_message_view_t *view) {
+    return snowflake_field(view, CORD_MESSAGE_FIELD_WEBHOOK_ID);
+}
+
+cord_str_t cord_message_get_content(cord_message_view_t *view) {
+    return string_field(view, CORD_MESSAGE_FIELD_CONTENT);
+}
+
+cord_str_t cord_message_get_timestamp(cord_message_view_t *view) {
+    return string_field(view, CORD_MESSAGE_FIELD_TIMESTAMP);
+}
+
+cord_str_t cord_message_get_edited_timestamp(cord_message_view_t *view) {
+    return string_field(view, CORD_MESSAGE_FIELD_EDITED_TIMESTAMP);
+}
+
+cord_snowflake_t cord_message_get_author_id(cord_message_view_t *view) {
+    cord_user_t *author = view->decoded[CORD_MESSAGE_FIELD_AUTHOR];
+    if (author) {
+        return author->id;
+    }
+
+    cord_json_reader_t reader = {0};
+    cord_json_token_t token = {0};
+    if (!read_field(view, CORD_MESSAGE_FIELD_AUTHOR, &reader, &token) ||
+        token.type != CORD_JSON_TOKEN_OBJECT_START) {
+        return 0;
+    }
+
+    i32 depth = reader.depth;
+    cord_str_t key = {0};
+    while (cord_json_finish_value(&reader, depth) &&
+           cord_json_next_key(&reader, &key)) {
+        if (cord_str_equals_cstring(key, "id")) {
+            token = cord_json_next(&reader);
+            return token.type == CORD_JSON_TOKEN_STRING
+                       ? cord_snowflake_parse(token.value)
+                       : 0;
+        }
+    }
+    return 0;
+}
+
+static void log_decode_error(cord_message_field_t field,
+                             cord_serialize_result_t result) {
+    logger_error("Failed to decode message %.*s: %s",
+                 (int)field_keys[field].length,
+                 field_keys[field].data,
+                 cord_error(result.error));
+}
+
+/*
+ * Decode the object of field with serialize, which takes (reader, value,
+ * allocator) like the decoders of objects that are never in arrays
+ */
+#define decode_object(view, field, entity, serialize)                          \
+    do {                                                                       \
+        if (view->decoded[field]) {                                            \
+            return view->decoded[field];                                       \
+        }                                                                      \
+        cord_json_reader_t __reader = {0};                                     \
+        cord_json_token_t __value = {0};                                       \
+        if (!read_field(view, field, &__reader, &__value) ||                   \
+            __value.type != CORD_JSON_TOKEN_OBJECT_START) {                    \
+            return NULL;                                                       \
+        }                                                                      \
+        cord_serialize_result_t __result =                                     \
+            serialize(&__reader, __value, view->allocator);                    \
+        if (__result.error != CORD_OK) {                                       \
+            log_decode_error(field, __result);                                 \
+            return NULL;                                                       \
+        }                                                                      \
+        view->decoded[field] = __result.obj;                                   \
+        return (entity *)__result.obj;                                         \
+    } while (0)
+
+static cord_serialize_result_t serialize_user(cord_json_reader_t *reader,
+                                              cord_json_token_t value,
+                                              cord_bump_t *allocator) {
+    return cord_user_serialize(reader, value, allocator, NULL);
+}
+
+cord_user_t *cord_message_get_author(cord_message_view_t *view) {
+    decode_object(view, CORD_MESSAGE_FIELD_AUTHOR, cord_user_t, serialize_user);
+}
+
+cord_guild_member_t *cord_message_get_member(cord_message_view_t *view) {
+    decode_object(view,
+                  CORD_MESSAGE_FIELD_MEMBER,
+                  cord_guild_member_t,
+                  cord_guild_member_serialize);
+}
+
+cord_message_reference_t *
+cord_message_get_message_reference(cord_message_view_t *view) {
+    decode_object(view,
+                  CORD_MESSAGE_FIELD_MESSAGE_REFERENCE,
+                  cord_message_reference_t,
+                  cord_message_reference_serialize);
+}
+
+cord_message_t *cord_message_get_referenced_message(cord_message_view_t *view) {
+    decode_object(view,
+                  CORD_MESSAGE_FIELD_REFERENCED_MESSAGE,
+                  cord_message_t,
+                  cord_message_serialize);
+}
+
+/*
+ * Decode the array of field into a cord_array_t of entity, item by item
+ */
+#define decode_array(view, field, entity, serialize)                           \
+    do {                                                                       \
+        if (view->decoded[field]) {                                            \
+            return view->decoded[field];                                       \
+        }                                                                      \
+        cord_json_reader_t __reader = {0};                                     \
+        cord_json_token_t __value = {0};                                       \
+        if (!read_field(view, field, &__reader, &__value) ||                   \
+            __value.type != CORD_JSON_TOKEN_ARRAY_START) {                     \
+            return NULL;                                                       \
+        }                                                                      \
+        cord_array_t *__array =                                                \
+            cord_array_create(view->allocator, sizeof(entity));                \
+        cord_json_token_t __item = {0};                                        \
+        while (__array && cord_json_next_item(&__reader, &__item)) {           \
+            entity *__slot = cord_array_push(__array);                         \
+            if (!__slot) {                                                     \
+                logger_error("Failed to allocate " #entity);                   \
+                return NULL;                                                   \
+            }                                                                  \
+            cord_serialize_result_t __result =                                 \
+                serialize(&__reader, __item, view->allocator, __slot);         \
+            if (__result.error != CORD_OK) {                                   \
+                log_decode_error(field, __result);                             \
+                return NULL;                                                   \
+            }                                                                  \
+        }                                                                      \
+        view->decoded[field] = __array;                                        \
+        return __array;                                                        \
+    } while (0)
+
+cord_array_t *cord_message_get_mentions(cord_message_view_t *view) {
+    decode_array(
+        view, CORD_MESSAGE_FIELD_MENTIONS, cord_user_t, cord_user_serialize);
+}
+
+cord_array_t *cord_message_get_attachments(cord_message_view_t *view) {
+    decode_array(view,
+                 CORD_MESSAGE_FIELD_ATTACHMENTS,
+                 cord_attachment_t,
+                 cord_attachment_serialize);
+}
+
+cord_array_t *cord_message_get_embeds(cord_message_view_t *view) {
+    decode_array(
+        view, CORD_MESSAGE_FIELD_EMBEDS, cord_embed_t, cord_embed_serialize);
+}
+
+cord_array_t *cord_message_get_reactions(cord_message_view_t *view) {
+    decode_array(view,
+                 CORD_MESSAGE_FIELD_REACTIONS,
+                 cord_reaction_t,
+                 cord_reaction_serialize);
+}
+
+cord_array_t *cord_message_get_stickers(cord_message_view_t *view) {
+    decode_array(view,
+                 CORD_MESSAGE_FIELD_STICKER_ITEMS,
+                 cord_message_sticker_t,
+                 cord_message_sticker_serialize);
+}
+
+cord_array_t *cord_message_get_mention_roles(cord_message_view_t *view) {
+    cord_message_field_t field = CORD_MESSAGE_FIELD_MENTION_ROLES;
+    if (view->decoded[field]) {
+        return view->decoded[field];
+    }
+
+    cord_json_reader_t reader = {0};
+    cord_json_token_t value = {0};
+    if (!read_field(view, field, &reader, &value) ||
+        value.type != CORD_JSON_TOKEN_ARRAY_START) {
+        return NULL;
+    }
+
+    cord_array_t *roles =
+        cord_array_create(view->allocator, sizeof(cord_snowflake_t));
+    cord_json_token_t item = {0};
+    while (roles && cord_json_next_item(&reader, &item)) {
+        cord_snowflake_t *slot = cord_array_push(roles);
+        if (!slot) {
+            logger_error("Failed to allocate id array item");
+            return NULL;
+        }
+        *slot = item.type == CORD_JSON_TOKEN_STRING
+                    ? cord_snowflake_parse(item.value)
+                    : 0;
+        cord_json_skip(&reader, item);
+    }
+    view->decoded[field] = roles;
+    return roles;
+}
+
+cord_message_t *cord_message_view_decode(cord_message_view_t *view) {
+    if (view->message) {
+        return view->message;
+    }
+
+    // No field has the bit of the count, so this reads to the end
+    cord_str_t value = {0};
+    find_field(view, CORD_MESSAGE_FIELD_COUNT, &value);
+    if (view->end == view->start) {
+        logger_error("Failed to read message");
+        return NULL;
+    }
+
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(
+        &reader,
+        (cord_str_t){(char *)view->start, view->end - view->start},
+        view->allocator);
+    cord_serialize_result_t result = cord_message_serialize(
+        &reader, cord_json_next(&reader), view->allocator);
+    if (result.error != CORD_OK) {
+        logger_error("Failed to decode message: %s", cord_error(result.error));
+        return NULL;
+    }
+
+    view->message = result.obj;
+    return view->message;
+}
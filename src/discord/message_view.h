@@ -0,0 +1,114 @@
+#ifndef MESSAGE_VIEW_H
+#define MESSAGE_VIEW_H
+
+#include "../core/array.h"
+#include "../core/json_reader.h"
+#include "../core/memory.h"
+#include "../core/snowflake.h"
+#include "../core/strings.h"
+#include "entities.h"
+
+#include <stdbool.h>
+
+/*
+ * Top level fields of a message that a view can return
+ */
+#define CORD_MESSAGE_FIELDS(field)                                             \
+    field(ID, "id")                                                            \
+    field(CHANNEL_ID, "channel_id")                                            \
+    field(GUILD_ID, "guild_id")                                                \
+    field(WEBHOOK_ID, "webhook_id")                                            \
+    field(AUTHOR, "author")                                                    \
+    field(MEMBER, "member")                                                    \
+    field(CONTENT, "content")                                                  \
+    field(TIMESTAMP, "timestamp")                                              \
+    field(EDITED_TIMESTAMP, "edited_timestamp")                                \
+    field(MENTIONS, "mentions")                                                \
+    field(MENTION_ROLES, "mention_roles")                                      \
+    field(ATTACHMENTS, "attachments")                                          \
+    field(EMBEDS, "embeds")                                                    \
+    field(REACTIONS, "reactions")                                              \
+    field(STICKER_ITEMS, "sticker_items")                                      \
+    field(MESSAGE_REFERENCE, "message_reference")                              \
+    field(REFERENCED_MESSAGE, "referenced_message")
+
+#define CORD_MESSAGE_FIELD_ENUM(name, key) CORD_MESSAGE_FIELD_##name,
+
+typedef enum cord_message_field_t {
+    CORD_MESSAGE_FIELDS(CORD_MESSAGE_FIELD_ENUM)
+
+    CORD_MESSAGE_FIELD_COUNT
+} cord_message_field_t;
+
+/*
+ * Message that is decoded as its fields are asked for
+ *
+ * The view reads the top level of the message with the reader it came in,
+ * only as far as the field it's asked for, remembering where every field
+ * it passed on the way is. Objects and arrays are decoded into allocator
+ * the first time they are asked for and returned again after that, so a
+ * callback that only looks at the content, the channel and the author id
+ * never decodes the rest, and the frame is read once.
+ *
+ * Like entities the view and everything it returns point into the frame
+ * it was received in, so they are only valid until the callback returns.
+ */
+typedef struct cord_message_view_t {
+    cord_json_reader_t *reader;
+    i32 depth;
+    // The message's JSON, end is only known once the reader got there
+    const char *start;
+    const char *end;
+
+    // Bit per field found so far, with where its value is from start
+    u32 found;
+    u32 offsets[CORD_MESSAGE_FIELD_COUNT];
+    u32 lengths[CORD_MESSAGE_FIELD_COUNT];
+
+    void *decoded[CORD_MESSAGE_FIELD_COUNT];
+    cord_message_t *message;
+    cord_bump_t *allocator;
+} cord_message_view_t;
+
+/*
+ * Take the message that data is positioned before. The view reads on with
+ * data, which has to stay valid and not be read by anything else until the
+ * view is no longer used.
+ */
+bool cord_message_view_init(cord_message_view_t *view,
+                            cord_json_reader_t *data,
+                            cord_bump_t *allocator);
+
+// Ids are 0 and strings empty when the message doesn't have them
+cord_snowflake_t cord_message_get_id(cord_message_view_t *view);
+cord_snowflake_t cord_message_get_channel_id(cord_message_view_t *view);
+cord_snowflake_t cord_message_get_guild_id(cord_message_view_t *view);
+cord_snowflake_t cord_message_get_webhook_id(cord_message_view_t *view);
+cord_str_t cord_message_get_content(cord_message_view_t *view);
+cord_str_t cord_message_get_timestamp(cord_message_view_t *view);
+cord_str_t cord_message_get_edited_timestamp(cord_message_view_t *view);
+
+// Id of the author without decoding the rest of it
+cord_snowflake_t cord_message_get_author_id(cord_message_view_t *view);
+
+// Objects and arrays are NULL when the message doesn't have them
+cord_user_t *cord_message_get_author(cord_message_view_t *view);
+cord_guild_member_t *cord_message_get_member(cord_message_view_t *view);
+cord_message_reference_t *
+cord_message_get_message_reference(cord_message_view_t *view);
+cord_message_t *cord_message_get_referenced_message(cord_message_view_t *view);
+
+cord_array_t *cord_message_get_mentions(cord_message_view_t *view);
+cord_array_t *cord_message_get_mention_roles(cord_message_view_t *view);
+cord_array_t *cord_message_get_attachments(cord_message_view_t *view);
+cord_array_t *cord_message_get_embeds(cord_message_view_t *view);
+cord_array_t *cord_message_get_reactions(cord_message_view_t *view);
+cord_array_t *cord_message_get_stickers(cord_message_view_t *view);
+
+/*
+ * Decode all of the message, for code that takes a cord_message_t.
+ * Returns NULL if it's not valid.
+ */
+cord_message_t *cord_message_view_decode(cord_message_view_t *view);
+
+#endif
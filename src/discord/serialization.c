@@ -3,155 +3,279 @@
 #include "../core/log.h"
 #include "entities.h"
 
-#include <assert.h>
-#include <jansson.h>
-#include <stdio.h>
-
-static void append_quote(cord_json_writer_t writer) {
-    cord_strbuf_append(writer.buffer, cstr("\""));
+#include <string.h>
+
+static void write_string_field(cord_json_writer_t *writer,
+                               const char *key,
+                               cord_str_t value) {
+    if (cord_str_valid(value)) {
+        cord_json_write_key(writer, cstr(key));
+        cord_json_write_string(writer, value);
+    }
 }
 
-static void append_key_name(cord_json_writer_t writer, cord_str_t key) {
-    cord_strbuf_append(writer.buffer, key);
+static void write_integer_field(cord_json_writer_t *writer,
+                                const char *key,
+                                i64 value) {
+    if (value) {
+        cord_json_write_key(writer, cstr(key));
+        cord_json_write_integer(writer, value);
+    }
 }
 
-static void append_colon(cord_json_writer_t writer) {
-    cord_strbuf_append(writer.buffer, cstr(": "));
+static void write_snowflake_field(cord_json_writer_t *writer,
+                                  const char *key,
+                                  cord_snowflake_t id) {
+    if (id) {
+        cord_json_write_key(writer, cstr(key));
+        cord_json_write_snowflake(writer, id);
+    }
 }
 
-static void append_key(cord_json_writer_t writer, cord_str_t key) {
-    append_quote(writer);
-    append_key_name(writer, key);
-    append_quote(writer);
-    append_colon(writer);
+static void write_embed_image(cord_json_writer_t *writer,
+                              const char *key,
+                              cord_str_t url,
+                              i32 height,
+                              i32 width) {
+    cord_json_write_key(writer, cstr(key));
+    cord_json_write_object_start(writer);
+    write_string_field(writer, "url", url);
+    write_integer_field(writer, "height", height);
+    write_integer_field(writer, "width", width);
+    cord_json_write_object_end(writer);
 }
 
-static void append_comma(cord_json_writer_t writer) {
-    cord_strbuf_append(writer.buffer, cstr(","));
+static void write_embed_fields(cord_json_writer_t *writer,
+                               cord_array_t *fields) {
+    cord_json_write_key(writer, cstr("fields"));
+    cord_json_write_array_start(writer);
+    for (size_t i = 0; i < fields->num_elements; i++) {
+        cord_embed_field_t *field = cord_array_get(fields, (int)i);
+        cord_json_write_object_start(writer);
+        write_string_field(writer, "name", field->name);
+        write_string_field(writer, "value", field->value);
+        if (field->inline_) {
+            cord_json_write_key(writer, cstr("inline"));
+            cord_json_write_bool(writer, true);
+        }
+        cord_json_write_object_end(writer);
+    }
+    cord_json_write_array_end(writer);
 }
 
-static void append_final_value(cord_json_writer_t writer, char *cstring) {
-    cord_strbuf_append(writer.buffer, cstr(cstring));
+static void write_embed(cord_json_writer_t *writer, cord_embed_t *embed) {
+    cord_json_write_object_start(writer);
+    write_string_field(writer, "title", embed->title);
+    write_string_field(writer, "description", embed->description);
+    write_string_field(writer, "url", embed->url);
+    write_string_field(writer, "timestamp", embed->timestamp);
+    write_integer_field(writer, "color", embed->color);
+
+    if (embed->footer) {
+        cord_json_write_key(writer, cstr("footer"));
+        cord_json_write_object_start(writer);
+        write_string_field(writer, "text", embed->footer->text);
+        write_string_field(writer, "icon_url", embed->footer->icon_url);
+        cord_json_write_object_end(writer);
+    }
+    if (embed->image) {
+        cord_embed_image_t *image = embed->image;
+        write_embed_image(
+            writer, "image", image->url, image->height, image->width);
+    }
+    if (embed->thumbnail) {
+        cord_embed_thumbnail_t *thumbnail = embed->thumbnail;
+        write_embed_image(writer,
+                          "thumbnail",
+                          thumbnail->url,
+                          thumbnail->height,
+                          thumbnail->width);
+    }
+    if (embed->author) {
+        cord_json_write_key(writer, cstr("author"));
+        cord_json_write_object_start(writer);
+        write_string_field(writer, "name", embed->author->name);
+        write_string_field(writer, "url", embed->author->url);
+        write_string_field(writer, "icon_url", embed->author->icon_url);
+        cord_json_write_object_end(writer);
+    }
+    if (embed->fields) {
+        write_embed_fields(writer, embed->fields);
+    }
+    cord_json_write_object_end(writer);
 }
 
-static void append_non_final_value(cord_json_writer_t writer, char *cstring) {
-    append_final_value(writer, cstring);
-    append_comma(writer);
+static void write_snowflakes(cord_json_writer_t *writer,
+                             const char *key,
+                             cord_array_t *ids) {
+    cord_json_write_key(writer, cstr(key));
+    cord_json_write_array_start(writer);
+    for (size_t i = 0; ids && i < ids->num_elements; i++) {
+        cord_snowflake_t *id = cord_array_get(ids, (int)i);
+        cord_json_write_snowflake(writer, *id);
+    }
+    cord_json_write_array_end(writer);
 }
 
-#define MAX_FORMAT_BUFFER_LENGTH 64
+static void write_message_fields(cord_json_writer_t *writer,
+                                 cord_message_t *message) {
+    write_string_field(writer, "content", message->content);
+    write_string_field(writer, "nonce", message->nonce);
+    if (message->tts) {
+        cord_json_write_key(writer, cstr("tts"));
+        cord_json_write_bool(writer, *message->tts);
+    }
+    if (message->flags) {
+        cord_json_write_key(writer, cstr("flags"));
+        cord_json_write_integer(writer, *message->flags);
+    }
 
-static bool copy_i64_to_string(char *format, i64 value) {
-    if (value > MAX_FORMAT_BUFFER_LENGTH) {
-        return false;
+    if (message->embeds && message->embeds->num_elements > 0) {
+        cord_json_write_key(writer, cstr("embeds"));
+        cord_json_write_array_start(writer);
+        for (size_t i = 0; i < message->embeds->num_elements; i++) {
+            write_embed(writer, cord_array_get(message->embeds, (int)i));
+        }
+        cord_json_write_array_end(writer);
     }
 
-    i32 rc = snprintf(format, MAX_FORMAT_BUFFER_LENGTH, "%ld", value);
-    return !is_posix_error(rc);
-}
+    cord_message_reference_t *reference = message->message_reference;
+    if (reference) {
+        cord_json_write_key(writer, cstr("message_reference"));
+        cord_json_write_object_start(writer);
+        write_snowflake_field(writer, "message_id", reference->message_id);
+        write_snowflake_field(writer, "channel_id", reference->channel_id);
+        write_snowflake_field(writer, "guild_id", reference->guild_id);
+        cord_json_write_object_end(writer);
+    }
 
-cord_json_writer_t cord_json_writer_create(cord_bump_t *allocator) {
-    return (cord_json_writer_t){.buffer = cord_strbuf_create(),
-                                .allocator = allocator};
+    if (message->stickers && message->stickers->num_elements > 0) {
+        cord_json_write_key(writer, cstr("sticker_ids"));
+        cord_json_write_array_start(writer);
+        for (size_t i = 0; i < message->stickers->num_elements; i++) {
+            cord_message_sticker_t *sticker =
+                cord_array_get(message->stickers, (int)i);
+            cord_json_write_snowflake(writer, sticker->id);
+        }
+        cord_json_write_array_end(writer);
+    }
 }
 
-void cord_json_writer_start(cord_json_writer_t writer) {
-    cord_strbuf_append(writer.buffer, cstr("{"));
+static char *finish_message_json(cord_json_writer_t *writer) {
+    cord_str_t json = cord_json_writer_finish(writer);
+    if (!json.data) {
+        logger_error("Failed to write message json");
+    }
+    return json.data;
 }
 
-void cord_json_writer_end(cord_json_writer_t writer) {
-    cord_strbuf_append(writer.buffer, cstr("}"));
+char *cord_message_to_json(cord_json_writer_t *writer,
+                           cord_message_t *message) {
+    cord_json_write_object_start(writer);
+    write_message_fields(writer, message);
+    cord_json_write_object_end(writer);
+    return finish_message_json(writer);
 }
 
-bool cord_json_writer_write_string(cord_json_writer_t writer,
-                                   cord_str_t key,
-                                   cord_str_t value) {
-    append_key(writer, key);
-    append_quote(writer);
-    cord_strbuf_append(writer.buffer, value);
-    append_quote(writer);
-    return true;
-}
+static void write_allowed_mentions(cord_json_writer_t *writer,
+                                   cord_allowed_mentions_t *mentions) {
+    cord_json_write_key(writer, cstr("allowed_mentions"));
+    cord_json_write_object_start(writer);
 
-static bool copy_bool_to_string(char *format, bool value) {
-    i32 rc = snprintf(
-        format, MAX_FORMAT_BUFFER_LENGTH, "%s", bool_to_cstring(value));
-    if (is_posix_error(rc)) {
-        logger_warn("Could not convert bool (%s) to string",
-                    bool_to_cstring(value));
+    cord_json_write_key(writer, cstr("parse"));
+    cord_json_write_array_start(writer);
+    if (mentions->parse & CORD_MENTION_USERS) {
+        cord_json_write_string(writer, cstr("users"));
     }
-    return is_posix_error(rc);
-}
+    if (mentions->parse & CORD_MENTION_ROLES) {
+        cord_json_write_string(writer, cstr("roles"));
+    }
+    if (mentions->parse & CORD_MENTION_EVERYONE) {
+        cord_json_write_string(writer, cstr("everyone"));
+    }
+    cord_json_write_array_end(writer);
 
-bool cord_json_writer_write_number(cord_json_writer_t writer,
-                                   cord_str_t key,
-                                   i64 value) {
-    append_key(writer, key);
-    char format[MAX_FORMAT_BUFFER_LENGTH] = {0};
-    bool success = copy_i64_to_string(format, value);
-    if (!success) {
-        logger_warn("Failed to convert i64: %ld to string", value);
-        return false;
+    if (mentions->users) {
+        write_snowflakes(writer, "users", mentions->users);
+    }
+    if (mentions->roles) {
+        write_snowflakes(writer, "roles", mentions->roles);
     }
-    append_non_final_value(writer, format);
-    return true;
+    cord_json_write_key(writer, cstr("replied_user"));
+    cord_json_write_bool(writer, mentions->replied_user);
+    cord_json_write_object_end(writer);
 }
 
-bool cord_json_writer_write_boolean(cord_json_writer_t writer,
-                                    cord_str_t key,
-                                    bool value) {
-    append_key(writer, key);
-    char format[MAX_FORMAT_BUFFER_LENGTH] = {0};
-    bool success = copy_bool_to_string(format, value);
-    if (!success) {
-        logger_warn("Failed to convert bool: %s to string",
-                    bool_to_cstring(value));
-        return false;
+static void write_component(cord_json_writer_t *writer,
+                            cord_component_t *component) {
+    cord_json_write_object_start(writer);
+    write_integer_field(writer, "type", component->type);
+    write_integer_field(writer, "style", component->style);
+    write_string_field(writer, "label", component->label);
+    write_string_field(writer, "custom_id", component->custom_id);
+    write_string_field(writer, "url", component->url);
+    if (component->disabled) {
+        cord_json_write_key(writer, cstr("disabled"));
+        cord_json_write_bool(writer, true);
     }
-    append_non_final_value(writer, format);
-    return true;
-}
 
-bool cord_json_writer_write_null(cord_json_writer_t writer, cord_str_t key) {
-    append_key(writer, key);
-    append_non_final_value(writer, "null");
-    return true;
+    if (component->type == CORD_COMPONENT_ACTION_ROW) {
+        cord_array_t *children = component->components;
+        cord_json_write_key(writer, cstr("components"));
+        cord_json_write_array_start(writer);
+        for (size_t i = 0; children && i < children->num_elements; i++) {
+            write_component(writer, cord_array_get(children, (int)i));
+        }
+        cord_json_write_array_end(writer);
+    }
+    cord_json_write_object_end(writer);
 }
 
-bool cord_json_writer_write_object(cord_json_writer_t writer,
-                                   cord_str_t key,
-                                   json_t *object) {
-    (void)object;
-    append_key(writer, key);
-    // foreach field write using write functions
-    // for each object write using itself
-    assert(0 && "Not Implemented");
-    return false;
+// Attachment i describes the form part files[i]
+static void write_attachments(cord_json_writer_t *writer,
+                              cord_message_builder_t *builder) {
+    cord_json_write_key(writer, cstr("attachments"));
+    cord_json_write_array_start(writer);
+    for (size_t i = 0; i < builder->files->num_elements; i++) {
+        cord_http_file_t *file = cord_array_get(builder->files, (int)i);
+        cord_str_t *description =
+            cord_array_get(builder->file_descriptions, (int)i);
+
+        cord_json_write_object_start(writer);
+        cord_json_write_key(writer, cstr("id"));
+        cord_json_write_integer(writer, (i64)i);
+        write_string_field(writer, "filename", cstr(file->filename));
+        if (description->length > 0) {
+            write_string_field(writer, "description", *description);
+        }
+        cord_json_write_object_end(writer);
+    }
+    cord_json_write_array_end(writer);
 }
 
-bool cord_json_writer_write_array(cord_json_writer_t writer,
-                                  cord_str_t key,
-                                  cord_array_t *array) {
-    (void)writer;
-    (void)key;
-    (void)array;
-    assert(0 && "Not Implemented");
-    return false;
-}
+char *cord_message_builder_to_json(cord_json_writer_t *writer,
+                                   cord_message_builder_t *builder) {
+    cord_json_write_object_start(writer);
+    write_message_fields(writer, &builder->message);
 
-#define serialize_string(writer, string, obj, field)                           \
-    if (obj->field) {                                                          \
-        cord_json_writer_write_string(                                         \
-            writer, cstr(string), cord_strbuf_to_str(*((obj)->field)));        \
+    if (builder->allowed_mentions) {
+        write_allowed_mentions(writer, builder->allowed_mentions);
+    }
+    if (builder->components && builder->components->num_elements > 0) {
+        cord_json_write_key(writer, cstr("components"));
+        cord_json_write_array_start(writer);
+        for (size_t i = 0; i < builder->components->num_elements; i++) {
+            write_component(writer,
+                            cord_array_get(builder->components, (int)i));
+        }
+        cord_json_write_array_end(writer);
+    }
+    if (builder->files && builder->files->num_elements > 0) {
+        write_attachments(writer, builder);
     }
 
-char *cord_message_to_json(cord_json_writer_t writer, cord_message_t *message) {
-    cord_json_writer_start(writer);
-
-    serialize_string(writer, "content", message, content);
-
-    cord_json_writer_end(writer);
-    return cstring_of(writer.buffer, writer.allocator);
+    cord_json_write_object_end(writer);
+    return finish_message_json(writer);
 }
 
 /*
@@ -159,22 +283,29 @@ char *cord_message_to_json(cord_json_writer_t writer, cord_message_t *message) {
  */
 #define map_property(obj, prop, prop_str, key, val)                            \
     do {                                                                       \
-        if (cstring_is_equal(key, prop_str)) {                                 \
+        if (cord_str_equals_cstring(key, prop_str)) {                          \
             obj->prop = val;                                                   \
         }                                                                      \
     } while (0)
 
+// Ids are parsed once here, only for the field that matches
+#define map_snowflake(obj, prop, prop_str, key, val)                           \
+    map_property(obj, prop, prop_str, key, cord_snowflake_parse(val))
+
 #define map_property_array(                                                    \
-    object, property, property_str, key, value, allocator, type, serialize)    \
+    object, property, property_str, key, reader, allocator, type, serialize)   \
     do {                                                                       \
-        if (cstring_is_equal(key, property_str)) {                             \
-            size_t __idx = 0;                                                  \
-            json_t *__item = NULL;                                             \
+        if (cord_str_equals_cstring(key, property_str)) {                      \
+            cord_json_token_t __item = {0};                                    \
             object->property = cord_array_create(allocator, sizeof(type));     \
-            json_array_foreach(value, __idx, __item) {                         \
+            while (object->property && cord_json_next_item(reader, &__item)) { \
                 type *__array_slot = cord_array_push(object->property);        \
+                if (!__array_slot) {                                           \
+                    logger_error("Failed to allocate " #type);                 \
+                    break;                                                     \
+                }                                                              \
                 cord_serialize_result_t __result =                             \
-                    serialize(__item, allocator, __array_slot);                \
+                    serialize(reader, __item, allocator, __array_slot);        \
                 if (has_serialization_error(__result)) {                       \
                     logger_error("Failed to serialize " #type ": %s",          \
                                  cord_error(__result.error));                  \
@@ -196,160 +327,221 @@ static cord_serialize_result_t serialize_error(cord_error_t error) {
     return (cord_serialize_result_t){NULL, error};
 }
 
-static void
-user_read_boolean_json_field(cord_user_t *author, const char *key, bool value) {
-    map_property(author, bot, "bot", key, value);
-    map_property(author, system_, "system", key, value);
-    map_property(author, mfa_enabled, "mfa_enabled", key, value);
-    map_property(author, verified, "varified", key, value);
+static bool is_object(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_OBJECT_START;
 }
 
-static void user_read_string_json_field(cord_user_t *user,
-                                        string_ref key,
-                                        string_ref value) {
-    cord_strbuf_t *field_value = cord_strbuf_create();
-    cord_strbuf_append(field_value, cstr(value));
+static bool is_array(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_ARRAY_START;
+}
 
-    map_property(user, id, "id", key, field_value);
-    map_property(user, username, "username", key, field_value);
-    map_property(user, discriminator, "discriminator", key, field_value);
-    map_property(user, avatar, "avatar", key, field_value);
-    map_property(user, locale, "locale", key, field_value);
-    map_property(user, email, "email", key, field_value);
+static bool is_string(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_STRING;
 }
 
-static void
-user_read_integer_json_field(cord_user_t *user, string_ref key, i64 value) {
+static bool is_number(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_NUMBER;
+}
+
+static bool is_true(cord_json_token_t token) {
+    return token.type == CORD_JSON_TOKEN_TRUE;
+}
+
+static i64 number_of(cord_json_token_t token) {
+    i64 number = 0;
+    cord_json_token_to_i64(token, &number);
+    return number;
+}
+
+/*
+ * Read the next field of the object opened at depth. Whatever the decoder
+ * left unread of the previous value is skipped first, so decoders only look
+ * at the fields they know about.
+ */
+static bool next_field(cord_json_reader_t *reader,
+                       i32 depth,
+                       cord_str_t *key,
+                       cord_json_token_t *value) {
+    if (!cord_json_finish_value(reader, depth) ||
+        !cord_json_next_key(reader, key)) {
+        return false;
+    }
+    *value = cord_json_next(reader);
+    return !cord_json_failed(reader);
+}
+
+static cord_serialize_result_t decoded(cord_json_reader_t *reader, void *obj) {
+    if (cord_json_failed(reader)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+    return serialized(obj);
+}
+
+// Arrays of ids, e.g. the roles of a guild member
+static cord_array_t *read_snowflake_array(cord_json_reader_t *reader,
+                                          cord_bump_t *allocator) {
+    cord_array_t *array =
+        cord_array_create(allocator, sizeof(cord_snowflake_t));
+    cord_json_token_t item = {0};
+    while (array && cord_json_next_item(reader, &item)) {
+        if (!is_string(item)) {
+            cord_json_skip(reader, item);
+            continue;
+        }
+
+        cord_snowflake_t *slot = cord_array_push(array);
+        if (!slot) {
+            logger_error("Failed to allocate id array item");
+            break;
+        }
+        *slot = cord_snowflake_parse(item.value);
+    }
+    return array;
+}
+
+static void user_booleans(cord_user_t *user, cord_str_t key, bool value) {
+    map_property(user, bot, "bot", key, value);
+    map_property(user, system_, "system", key, value);
+    map_property(user, mfa_enabled, "mfa_enabled", key, value);
+    map_property(user, verified, "verified", key, value);
+}
+
+static void user_strings(cord_user_t *user, cord_str_t key, cord_str_t value) {
+    map_snowflake(user, id, "id", key, value);
+    map_property(user, username, "username", key, value);
+    map_property(user, discriminator, "discriminator", key, value);
+    map_property(user, avatar, "avatar", key, value);
+    map_property(user, locale, "locale", key, value);
+    map_property(user, email, "email", key, value);
+}
+
+static void user_numbers(cord_user_t *user, cord_str_t key, i64 value) {
     map_property(user, flags, "flags", key, value);
     map_property(user, premium_type, "premium_type", key, value);
     map_property(user, public_flags, "public_flags", key, value);
 }
 
-cord_serialize_result_t cord_user_serialize(json_t *json_obj,
-                                            cord_bump_t *allocator) {
+cord_serialize_result_t cord_user_serialize(cord_json_reader_t *reader,
+                                            cord_json_token_t value,
+                                            cord_bump_t *allocator,
+                                            cord_user_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
 
-    cord_user_t *author = balloc(allocator, sizeof(cord_user_t));
-    if (!author) {
-        json_decref(json_obj);
+    cord_user_t *user =
+        array_slot ? array_slot : balloc(allocator, sizeof(cord_user_t));
+    if (!user) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
-    cord_user_init(author, allocator);
-    const char *key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_obj, key, value) {
-        if (json_is_string(value)) {
-            string_ref cstring = json_string_value(value);
-            user_read_string_json_field(author, key, cstring);
-        } else if (json_is_boolean(value)) {
-            bool builder = json_boolean(value);
-            user_read_boolean_json_field(author, key, builder);
-        } else if (json_is_integer(value)) {
-            i64 builder = (i64)json_integer_value(value);
-            user_read_integer_json_field(author, key, builder);
+    cord_user_init(user, allocator);
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            user_strings(user, key, field.value);
+        } else if (cord_json_token_is_bool(field)) {
+            user_booleans(user, key, is_true(field));
+        } else if (is_number(field)) {
+            user_numbers(user, key, number_of(field));
         }
     }
 
-    return serialized(author);
+    return decoded(reader, user);
 }
 
 static void
-guild_member_booleans(cord_guild_member_t *member, string_ref key, bool value) {
+guild_member_booleans(cord_guild_member_t *member, cord_str_t key, bool value) {
     map_property(member, deaf, "deaf", key, value);
     map_property(member, mute, "mute", key, value);
     map_property(member, pending, "pending", key, value);
 }
 
 static void guild_member_strings(cord_guild_member_t *member,
-                                 string_ref key,
-                                 string_ref cstring) {
-    cord_strbuf_t *builder = cord_strbuf_create();
-    cord_strbuf_append(builder, cstr(cstring));
-
-    map_property(member, nick, "nick", key, builder);
-    map_property(member, joined_at, "joined_at", key, builder);
-    map_property(member, premium_since, "premium_since", key, builder);
-}
-
-static void guild_member_arrays(cord_guild_member_t *member,
-                                string_ref key,
-                                json_t *value) {
-    map_property_array(member,
-                       roles,
-                       "roles",
-                       key,
-                       value,
-                       member->allocator,
-                       cord_role_t,
-                       cord_role_serialize);
+                                 cord_str_t key,
+                                 cord_str_t value) {
+    map_property(member, nick, "nick", key, value);
+    map_property(member, joined_at, "joined_at", key, value);
+    map_property(member, premium_since, "premium_since", key, value);
 }
 
-cord_serialize_result_t cord_guild_member_serialize(json_t *json_message,
+cord_serialize_result_t cord_guild_member_serialize(cord_json_reader_t *reader,
+                                                    cord_json_token_t value,
                                                     cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_guild_member_t *member =
         balloc(allocator, sizeof(cord_guild_member_t));
     if (!member) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
-    cord_guild_member_init(member, member->allocator);
-
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_message, key, value) {
-        if (json_is_string(value)) {
-            guild_member_strings(member, key, json_string_value(value));
-        } else if (json_is_boolean(value)) {
-            guild_member_booleans(member, key, json_boolean(value));
-        } else if (json_is_array(value)) {
-            guild_member_arrays(member, key, value);
-        } else if (json_is_object(value)) {
-            if (cstring_is_equal(key, "user")) {
-                cord_serialize_result_t result =
-                    cord_user_serialize(value, allocator);
-                if (is_posix_error(result.error)) {
-                    // Skip field and keep serializing the rest of the object
-                    logger_error("Failed to serialize user as part of guild "
-                                 "member serialize (%s)",
-                                 cord_error(result.error));
-                } else {
-                    member->user = (cord_user_t *)result.obj;
-                }
-            }
+    cord_guild_member_init(member, allocator);
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            guild_member_strings(member, key, field.value);
+        } else if (cord_json_token_is_bool(field)) {
+            guild_member_booleans(member, key, is_true(field));
+        } else if (is_array(field)) {
+            map_property(member,
+                         roles,
+                         "roles",
+                         key,
+                         read_snowflake_array(reader, allocator));
+        } else if (is_object(field)) {
+            map_property_object_collectible(member,
+                                            user,
+                                            "user",
+                                            key,
+                                            reader,
+                                            field,
+                                            allocator,
+                                            cord_user_t,
+                                            cord_user_serialize);
         }
     }
 
-    return serialized(member);
+    return decoded(reader, member);
 }
 
-static void
-role_strings(cord_role_t *role, string_ref key, string_ref cstring) {
-    cord_strbuf_t *builder = cord_strbuf_create();
-    cord_strbuf_append(builder, cstr(cstring));
-
-    map_property(role, id, "id", key, builder);
-    map_property(role, name, "name", key, builder);
-    map_property(role, icon, "icon", key, builder);
-    map_property(role, unicode_emoji, "unicode_emoji", key, builder);
-    map_property(role, permissions, "permissions", key, builder);
+static void role_strings(cord_role_t *role, cord_str_t key, cord_str_t value) {
+    map_snowflake(role, id, "id", key, value);
+    map_property(role, name, "name", key, value);
+    map_property(role, icon, "icon", key, value);
+    map_property(role, unicode_emoji, "unicode_emoji", key, value);
+    map_property(role, permissions, "permissions", key, value);
 }
 
-static void role_booleans(cord_role_t *role, string_ref key, bool value) {
+static void role_booleans(cord_role_t *role, cord_str_t key, bool value) {
     map_property(role, hoist, "hoist", key, value);
     map_property(role, managed, "managed", key, value);
     map_property(role, mentionable, "mentionable", key, value);
 }
 
-static void role_numbers(cord_role_t *role, string_ref key, i64 number) {
+static void role_numbers(cord_role_t *role, cord_str_t key, i64 number) {
     map_property(role, color, "color", key, number);
     map_property(role, position, "position", key, number);
 }
 
-cord_serialize_result_t cord_role_serialize(json_t *json_message,
+cord_serialize_result_t cord_role_serialize(cord_json_reader_t *reader,
+                                            cord_json_token_t value,
                                             cord_bump_t *allocator,
                                             cord_role_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_role_t *role =
         array_slot ? array_slot : balloc(allocator, sizeof(cord_role_t));
     if (!role) {
@@ -358,190 +550,190 @@ cord_serialize_result_t cord_role_serialize(json_t *json_message,
 
     cord_role_init(role, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_message, key, value) {
-        if (json_is_string(value)) {
-            string_ref cstring = json_string_value(value);
-            role_strings(role, key, cstring);
-        } else if (json_is_boolean(value)) {
-            bool builder = json_boolean(value);
-            role_booleans(role, key, builder);
-        } else if (json_is_integer(value)) {
-            i32 number = (i32)json_integer_value(value);
-            role_numbers(role, key, number);
-        } else if (json_is_array(value)) {
-            size_t index = 0;
-            json_t *item = NULL;
-
-            if (cstring_is_equal(key, "tags")) {
-                role->tags =
-                    cord_array_create(allocator, sizeof(cord_role_tag_t));
-                json_array_foreach(value, index, item) {
-
-                    cord_role_tag_t *array_slot = cord_array_push(role->tags);
-                    cord_serialize_result_t role_tag =
-                        cord_role_tag_serialize(item, allocator, array_slot);
-
-                    if (has_serialization_error(role_tag)) {
-                        logger_error("Failed to serialize cord_role_tag_t: %s",
-                                     cord_error(role_tag.error));
-                        break;
-                    }
-                }
-            }
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            role_strings(role, key, field.value);
+        } else if (cord_json_token_is_bool(field)) {
+            role_booleans(role, key, is_true(field));
+        } else if (is_number(field)) {
+            role_numbers(role, key, number_of(field));
+        } else if (is_object(field)) {
+            map_property_object_collectible(role,
+                                            tags,
+                                            "tags",
+                                            key,
+                                            reader,
+                                            field,
+                                            allocator,
+                                            cord_role_tag_t,
+                                            cord_role_tag_serialize);
         }
     }
-    return serialized(role);
+    return decoded(reader, role);
 }
 
 static void role_tag_strings(cord_role_tag_t *role_tag,
-                             string_ref key,
-                             string_ref cstring) {
-    cord_strbuf_t *builder = cord_strbuf_create();
-    cord_strbuf_append(builder, cstr(cstring));
-
-    map_property(role_tag, bot_id, "bot_id", key, builder);
-    map_property(role_tag, integration_id, "integration_id", key, builder);
-    map_property(role_tag,
+                             cord_str_t key,
+                             cord_str_t value) {
+    map_snowflake(role_tag, bot_id, "bot_id", key, value);
+    map_snowflake(role_tag, integration_id, "integration_id", key, value);
+    map_snowflake(role_tag,
                  subscription_listing_id,
                  "subscription_listing_id",
                  key,
-                 builder);
+                 value);
 }
 
-static void
-role_tag_booleans(cord_role_tag_t *role_tag, string_ref key, bool builder) {
-    map_property(
-        role_tag, premium_subscriber, "premium_subscriber", key, builder);
-    map_property(role_tag,
-                 available_for_purchase,
-                 "available_for_purchase",
-                 key,
-                 builder);
+/*
+ * Discord sends these flags as null when they are set and leaves them out
+ * otherwise, so any value means true
+ */
+static void role_tag_flags(cord_role_tag_t *role_tag, cord_str_t key) {
+    map_property(role_tag, premium_subscriber, "premium_subscriber", key, true);
     map_property(
-        role_tag, guild_connections, "guild_connections", key, builder);
+        role_tag, available_for_purchase, "available_for_purchase", key, true);
+    map_property(role_tag, guild_connections, "guild_connections", key, true);
 }
 
-cord_serialize_result_t cord_role_tag_serialize(json_t *json_role_tag,
+cord_serialize_result_t cord_role_tag_serialize(cord_json_reader_t *reader,
+                                                cord_json_token_t value,
                                                 cord_bump_t *allocator,
                                                 cord_role_tag_t *array_slot) {
-    cord_role_tag_t *role_tag =
-        array_slot ? array_slot : balloc(allocator, sizeof(cord_role_t));
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
 
+    cord_role_tag_t *role_tag =
+        array_slot ? array_slot : balloc(allocator, sizeof(cord_role_tag_t));
     if (!role_tag) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_role_tag_init(role_tag, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-    json_object_foreach(json_role_tag, key, value) {
-        if (json_is_string(value)) {
-            string_ref cstring = json_string_value(value);
-            role_tag_strings(role_tag, key, cstring);
-        } else if (json_is_boolean(value)) {
-            bool builder = json_boolean(value);
-            role_tag_booleans(role_tag, key, builder);
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            role_tag_strings(role_tag, key, field.value);
+        } else {
+            role_tag_flags(role_tag, key);
         }
     }
 
-    return serialized(role_tag);
+    return decoded(reader, role_tag);
 }
 
 static void channel_mention_strings(cord_channel_mention_t *mention,
-                                    string_ref key,
-                                    string_ref value) {
-    cord_strbuf_t *string_buffer = cord_strbuf_create();
-    cord_strbuf_append(string_buffer, cstr(value));
-
-    map_property(mention, id, "id", key, string_buffer);
-    map_property(mention, guild_id, "guild_id", key, string_buffer);
-    map_property(mention, name, "name", key, string_buffer);
+                                    cord_str_t key,
+                                    cord_str_t value) {
+    map_snowflake(mention, id, "id", key, value);
+    map_snowflake(mention, guild_id, "guild_id", key, value);
+    map_property(mention, name, "name", key, value);
 }
 
 static void channel_mention_numbers(cord_channel_mention_t *mention,
-                                    string_ref key,
+                                    cord_str_t key,
                                     i64 value) {
     map_property(mention, type, "type", key, value);
 }
 
-cord_serialize_result_t cord_channel_mention_serialize(json_t *json_mention,
-                                                       cord_bump_t *allocator) {
+cord_serialize_result_t
+cord_channel_mention_serialize(cord_json_reader_t *reader,
+                               cord_json_token_t value,
+                               cord_bump_t *allocator,
+                               cord_channel_mention_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_channel_mention_t *mention =
-        balloc(allocator, sizeof(cord_channel_mention_t));
+        array_slot ? array_slot
+                   : balloc(allocator, sizeof(cord_channel_mention_t));
     if (!mention) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_channel_mention_init(mention, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-    json_object_foreach(json_mention, key, value) {
-        if (json_is_string(value)) {
-            string_ref cstring = json_string_value(value);
-            channel_mention_strings(mention, key, cstring);
-        } else if (json_is_integer(value)) {
-            i64 number = json_integer_value(json_mention);
-            channel_mention_numbers(mention, key, number);
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            channel_mention_strings(mention, key, field.value);
+        } else if (is_number(field)) {
+            channel_mention_numbers(mention, key, number_of(field));
         }
     }
 
-    return serialized(mention);
+    return decoded(reader, mention);
 }
 
 static void attachment_strings(cord_attachment_t *attachment,
-                               string_ref key,
-                               string_ref cstring) {
-    cord_strbuf_t *builder = cord_strbuf_create();
-    cord_strbuf_append(builder, cstr(cstring));
-
-    map_property(attachment, id, "id", key, builder);
-    map_property(attachment, filename, "filename", key, builder);
-    map_property(attachment, url, "url", key, builder);
-    map_property(attachment, proxy_url, "proxy_url", key, builder);
+                               cord_str_t key,
+                               cord_str_t value) {
+    map_snowflake(attachment, id, "id", key, value);
+    map_property(attachment, filename, "filename", key, value);
+    map_property(attachment, url, "url", key, value);
+    map_property(attachment, proxy_url, "proxy_url", key, value);
 }
 
 static void
-attachment_numbers(cord_attachment_t *attachment, string_ref key, i32 number) {
+attachment_numbers(cord_attachment_t *attachment, cord_str_t key, i64 number) {
     map_property(attachment, size, "size", key, number);
     map_property(attachment, height, "height", key, number);
     map_property(attachment, width, "width", key, number);
 }
 
-cord_serialize_result_t cord_attachment_serialize(json_t *json_attachment,
-                                                  cord_bump_t *allocator) {
+cord_serialize_result_t
+cord_attachment_serialize(cord_json_reader_t *reader,
+                          cord_json_token_t value,
+                          cord_bump_t *allocator,
+                          cord_attachment_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_attachment_t *attachment =
-        balloc(allocator, sizeof(cord_attachment_t));
+        array_slot ? array_slot : balloc(allocator, sizeof(cord_attachment_t));
     if (!attachment) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_attachment_init(attachment, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-    json_object_foreach(json_attachment, key, value) {
-        if (json_is_string(value)) {
-            attachment_strings(attachment, key, json_string_value(value));
-        } else if (json_is_integer(value)) {
-            attachment_numbers(attachment, key, json_integer_value(value));
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            attachment_strings(attachment, key, field.value);
+        } else if (is_number(field)) {
+            attachment_numbers(attachment, key, number_of(field));
         }
     }
 
-    return serialized(attachment);
+    return decoded(reader, attachment);
 }
 
 cord_serialize_result_t
-cord_embed_footer_serialize(json_t *json_embed_footer,
+cord_embed_footer_serialize(cord_json_reader_t *reader,
+                            cord_json_token_t value,
                             cord_bump_t *allocator,
                             cord_embed_footer_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_footer_t *embed_footer =
         array_slot ? array_slot
                    : balloc(allocator, sizeof(cord_embed_footer_t));
@@ -551,28 +743,34 @@ cord_embed_footer_serialize(json_t *json_embed_footer,
 
     cord_embed_footer_init(embed_footer, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_embed_footer, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed_footer, text, "text", key, builder);
-            map_property(embed_footer, icon_url, "icon_url", key, builder);
-            map_property(
-                embed_footer, proxy_icon_url, "proxy_icon_url", key, builder);
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_footer, text, "text", key, field.value);
+            map_property(embed_footer, icon_url, "icon_url", key, field.value);
+            map_property(embed_footer,
+                         proxy_icon_url,
+                         "proxy_icon_url",
+                         key,
+                         field.value);
         }
     }
 
-    return serialized(embed_footer);
+    return decoded(reader, embed_footer);
 }
 
 cord_serialize_result_t
-cord_embed_image_serialize(json_t *json_embed_image,
+cord_embed_image_serialize(cord_json_reader_t *reader,
+                           cord_json_token_t value,
                            cord_bump_t *allocator,
                            cord_embed_image_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_image_t *embed_image =
         array_slot ? array_slot : balloc(allocator, sizeof(cord_embed_image_t));
     if (!embed_image) {
@@ -581,78 +779,70 @@ cord_embed_image_serialize(json_t *json_embed_image,
 
     cord_embed_image_init(embed_image, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_embed_image, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed_image, url, "url", key, builder);
-            map_property(embed_image, proxy_url, "proxy_url", key, builder);
-        } else if (json_is_integer(value)) {
-            map_property(embed_image,
-                         height,
-                         "height",
-                         key,
-                         (i32)json_integer_value(value));
-            map_property(embed_image,
-                         width,
-                         "width",
-                         key,
-                         (i32)json_integer_value(value));
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_image, url, "url", key, field.value);
+            map_property(embed_image, proxy_url, "proxy_url", key, field.value);
+        } else if (is_number(field)) {
+            map_property(embed_image, height, "height", key, number_of(field));
+            map_property(embed_image, width, "width", key, number_of(field));
         }
     }
 
-    return serialized(embed_image);
+    return decoded(reader, embed_image);
 }
 
 cord_serialize_result_t
-cord_embed_thumbnail_serialize(json_t *json_embed_thumbnail,
+cord_embed_thumbnail_serialize(cord_json_reader_t *reader,
+                               cord_json_token_t value,
                                cord_bump_t *allocator,
                                cord_embed_thumbnail_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_thumbnail_t *embed_thumbnail =
         array_slot ? array_slot
                    : balloc(allocator, sizeof(cord_embed_thumbnail_t));
-
     if (!embed_thumbnail) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_embed_thumbnail_init(embed_thumbnail, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-    json_object_foreach(json_embed_thumbnail, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed_thumbnail, url, "url", key, builder);
-            map_property(embed_thumbnail, proxy_url, "proxy_url", key, builder);
-        } else if (json_is_integer(value)) {
-            map_property(embed_thumbnail,
-                         height,
-                         "height",
-                         key,
-                         (i32)json_integer_value((value)));
-            map_property(embed_thumbnail,
-                         width,
-                         "width",
-                         key,
-                         (i32)json_integer_value((value)));
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_thumbnail, url, "url", key, field.value);
+            map_property(
+                embed_thumbnail, proxy_url, "proxy_url", key, field.value);
+        } else if (is_number(field)) {
+            map_property(
+                embed_thumbnail, height, "height", key, number_of(field));
+            map_property(
+                embed_thumbnail, width, "width", key, number_of(field));
         }
     }
 
-    return serialized(embed_thumbnail);
+    return decoded(reader, embed_thumbnail);
 }
 
 cord_serialize_result_t
-cord_embed_video_serialize(json_t *json_embed_video,
+cord_embed_video_serialize(cord_json_reader_t *reader,
+                           cord_json_token_t value,
                            cord_bump_t *allocator,
                            cord_embed_video_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_video_t *embed_video =
         array_slot ? array_slot : balloc(allocator, sizeof(cord_embed_video_t));
     if (!embed_video) {
@@ -661,35 +851,30 @@ cord_embed_video_serialize(json_t *json_embed_video,
 
     cord_embed_video_init(embed_video, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-    json_object_foreach(json_embed_video, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed_video, url, "url", key, builder);
-        } else if (json_is_integer(value)) {
-            map_property(embed_video,
-                         height,
-                         "height",
-                         key,
-                         (i32)json_integer_value(value));
-            map_property(embed_video,
-                         width,
-                         "width",
-                         key,
-                         (i32)json_integer_value(value));
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_video, url, "url", key, field.value);
+        } else if (is_number(field)) {
+            map_property(embed_video, height, "height", key, number_of(field));
+            map_property(embed_video, width, "width", key, number_of(field));
         }
     }
-    return serialized(embed_video);
+    return decoded(reader, embed_video);
 }
 
 cord_serialize_result_t
-cord_embed_provider_serialize(json_t *json_message,
+cord_embed_provider_serialize(cord_json_reader_t *reader,
+                              cord_json_token_t value,
                               cord_bump_t *allocator,
                               cord_embed_provider_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_provider_t *embed_provider =
         array_slot ? array_slot
                    : balloc(allocator, sizeof(cord_embed_provider_t));
@@ -699,25 +884,28 @@ cord_embed_provider_serialize(json_t *json_message,
 
     cord_embed_provider_init(embed_provider, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-    json_object_foreach(json_message, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed_provider, name, "name", key, builder);
-            map_property(embed_provider, url, "url", key, builder);
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_provider, name, "name", key, field.value);
+            map_property(embed_provider, url, "url", key, field.value);
         }
     }
-    return serialized(embed_provider);
+    return decoded(reader, embed_provider);
 }
 
 cord_serialize_result_t
-cord_embed_author_serialize(json_t *json_embed_author,
+cord_embed_author_serialize(cord_json_reader_t *reader,
+                            cord_json_token_t value,
                             cord_bump_t *allocator,
                             cord_embed_author_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_author_t *embed_author =
         array_slot ? array_slot
                    : balloc(allocator, sizeof(cord_embed_author_t));
@@ -727,28 +915,34 @@ cord_embed_author_serialize(json_t *json_embed_author,
 
     cord_embed_author_init(embed_author, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_embed_author, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed_author, name, "name", key, builder);
-            map_property(embed_author, url, "url", key, builder);
-            map_property(embed_author, icon_url, "icon_url", key, builder);
-            map_property(
-                embed_author, proxy_icon_url, "proxy_icon_url", key, builder);
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_author, name, "name", key, field.value);
+            map_property(embed_author, url, "url", key, field.value);
+            map_property(embed_author, icon_url, "icon_url", key, field.value);
+            map_property(embed_author,
+                         proxy_icon_url,
+                         "proxy_icon_url",
+                         key,
+                         field.value);
         }
     }
-    return serialized(embed_author);
+    return decoded(reader, embed_author);
 }
 
 cord_serialize_result_t
-cord_embed_field_serialize(json_t *json_embed_field,
+cord_embed_field_serialize(cord_json_reader_t *reader,
+                           cord_json_token_t value,
                            cord_bump_t *allocator,
                            cord_embed_field_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_embed_field_t *embed_field =
         array_slot ? array_slot : balloc(allocator, sizeof(cord_embed_field_t));
     if (!embed_field) {
@@ -757,120 +951,153 @@ cord_embed_field_serialize(json_t *json_embed_field,
 
     cord_embed_field_init(embed_field, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_embed_field, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-            map_property(embed_field, name, "name", key, builder);
-            map_property(embed_field, value, "value", key, builder);
-        } else if (json_is_boolean(value)) {
-            map_property(
-                embed_field, inline_, "inline", key, (bool)json_boolean(value));
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_property(embed_field, name, "name", key, field.value);
+            map_property(embed_field, value, "value", key, field.value);
+        } else if (cord_json_token_is_bool(field)) {
+            map_property(embed_field, inline_, "inline", key, is_true(field));
         }
     }
-    return serialized(embed_field);
+    return decoded(reader, embed_field);
 }
 
-cord_serialize_result_t cord_embed_serialize(json_t *json_embed,
-                                             cord_bump_t *allocator) {
-    cord_embed_t *embed = balloc(allocator, sizeof(cord_embed_t));
+static void
+embed_strings(cord_embed_t *embed, cord_str_t key, cord_str_t value) {
+    map_property(embed, title, "title", key, value);
+    map_property(embed, type, "type", key, value);
+    map_property(embed, description, "description", key, value);
+    map_property(embed, url, "url", key, value);
+    map_property(embed, timestamp, "timestamp", key, value);
+}
+
+static void embed_objects(cord_json_reader_t *reader,
+                          cord_embed_t *embed,
+                          cord_str_t key,
+                          cord_json_token_t value) {
+    cord_bump_t *allocator = embed->allocator;
+
+    map_property_object_collectible(embed,
+                                    footer,
+                                    "footer",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_embed_footer_t,
+                                    cord_embed_footer_serialize);
+
+    map_property_object_collectible(embed,
+                                    image,
+                                    "image",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_embed_image_t,
+                                    cord_embed_image_serialize);
+
+    map_property_object_collectible(embed,
+                                    thumbnail,
+                                    "thumbnail",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_embed_thumbnail_t,
+                                    cord_embed_thumbnail_serialize);
+
+    map_property_object_collectible(embed,
+                                    video,
+                                    "video",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_embed_video_t,
+                                    cord_embed_video_serialize);
+
+    map_property_object_collectible(embed,
+                                    provider,
+                                    "provider",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_embed_provider_t,
+                                    cord_embed_provider_serialize);
+
+    map_property_object_collectible(embed,
+                                    author,
+                                    "author",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_embed_author_t,
+                                    cord_embed_author_serialize);
+}
+
+cord_serialize_result_t cord_embed_serialize(cord_json_reader_t *reader,
+                                             cord_json_token_t value,
+                                             cord_bump_t *allocator,
+                                             cord_embed_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
+    cord_embed_t *embed =
+        array_slot ? array_slot : balloc(allocator, sizeof(cord_embed_t));
     if (!embed) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_embed_init(embed, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_embed, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(embed, title, "title", key, builder);
-            map_property(embed, type, "type", key, builder);
-            map_property(embed, description, "description", key, builder);
-            map_property(embed, url, "url", key, builder);
-            map_property(embed, timestamp, "timestamp", key, builder);
-        } else if (json_is_integer(value)) {
-            map_property(
-                embed, color, "color", key, (i32)json_integer_value(value));
-        } else if (json_is_object(value)) {
-            map_property_object_collectible(embed,
-                                            footer,
-                                            "footer",
-                                            key,
-                                            value,
-                                            allocator,
-                                            cord_embed_footer_t,
-                                            cord_embed_footer_serialize);
-
-            map_property_object_collectible(embed,
-                                            image,
-                                            "image",
-                                            key,
-                                            value,
-                                            allocator,
-                                            cord_embed_image_t,
-                                            cord_embed_image_serialize);
-
-            map_property_object_collectible(embed,
-                                            thumbnail,
-                                            "thumbnail",
-                                            key,
-                                            value,
-                                            allocator,
-                                            cord_embed_thumbnail_t,
-                                            cord_embed_thumbnail_serialize);
-
-            map_property_object_collectible(embed,
-                                            video,
-                                            "video",
-                                            key,
-                                            value,
-                                            allocator,
-                                            cord_embed_video_serialize_t,
-                                            cord_embed_video_serialize);
-
-            map_property_object_collectible(embed,
-                                            provider,
-                                            "provider",
-                                            key,
-                                            value,
-                                            allocator,
-                                            cord_embed_provider_t,
-                                            cord_embed_provider_serialize);
-
-            map_property_object_collectible(embed,
-                                            author,
-                                            "author",
-                                            key,
-                                            value,
-                                            allocator,
-                                            cord_embed_author_t,
-                                            cord_embed_author_serialize);
-        } else if (json_is_array(value)) {
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            embed_strings(embed, key, field.value);
+        } else if (is_number(field)) {
+            map_property(embed, color, "color", key, number_of(field));
+        } else if (is_object(field)) {
+            embed_objects(reader, embed, key, field);
+        } else if (is_array(field)) {
             map_property_array(embed,
                                fields,
                                "fields",
                                key,
-                               value,
+                               reader,
                                allocator,
                                cord_embed_field_t,
                                cord_embed_field_serialize);
         }
     }
 
-    return serialized(embed);
+    return decoded(reader, embed);
+}
+
+static void emoji_booleans(cord_emoji_t *emoji, cord_str_t key, bool value) {
+    map_property(emoji, require_colons, "require_colons", key, value);
+    map_property(emoji, managed, "managed", key, value);
+    map_property(emoji, animated, "animated", key, value);
+    map_property(emoji, available, "available", key, value);
 }
 
-cord_serialize_result_t cord_emoji_serialize(json_t *json_emoji,
+cord_serialize_result_t cord_emoji_serialize(cord_json_reader_t *reader,
+                                             cord_json_token_t value,
                                              cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_emoji_t *emoji = balloc(allocator, sizeof(cord_emoji_t));
     if (!emoji) {
         return serialize_error(CORD_ERR_MALLOC);
@@ -878,85 +1105,85 @@ cord_serialize_result_t cord_emoji_serialize(json_t *json_emoji,
 
     cord_emoji_init(emoji, allocator);
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_emoji, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(emoji, id, "id", key, builder);
-            map_property(emoji, name, "name", key, builder);
-        } else if (json_is_boolean(value)) {
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_snowflake(emoji, id, "id", key, field.value);
+            map_property(emoji, name, "name", key, field.value);
+        } else if (cord_json_token_is_bool(field)) {
+            emoji_booleans(emoji, key, is_true(field));
+        } else if (is_object(field)) {
+            map_property_object_collectible(emoji,
+                                            user,
+                                            "user",
+                                            key,
+                                            reader,
+                                            field,
+                                            allocator,
+                                            cord_user_t,
+                                            cord_user_serialize);
+        } else if (is_array(field)) {
             map_property(emoji,
-                         require_colons,
-                         "require_colons",
+                         roles,
+                         "roles",
                          key,
-                         (bool)json_boolean(value));
-            map_property(
-                emoji, managed, "managed", key, (bool)json_boolean(value));
-            map_property(
-                emoji, animated, "animated", key, (bool)json_boolean(value));
-            map_property(
-                emoji, available, "available", key, (bool)json_boolean(value));
-        } else if (json_is_object(value)) {
-            map_property_object(emoji,
-                                user,
-                                "user",
-                                key,
-                                value,
-                                allocator,
-                                cord_user_t,
-                                cord_user_serialize);
-        } else if (json_is_array(value)) {
-            map_property_array(emoji,
-                               roles,
-                               "roles",
-                               key,
-                               value,
-                               allocator,
-                               cord_role_t,
-                               cord_role_serialize);
+                         read_snowflake_array(reader, allocator));
         }
     }
-    return serialized(emoji);
+    return decoded(reader, emoji);
 }
 
-cord_serialize_result_t cord_reaction_serialize(json_t *json_reaction,
-                                                cord_bump_t *allocator) {
-    cord_reaction_t *reaction = balloc(allocator, sizeof(cord_reaction_t));
+cord_serialize_result_t cord_reaction_serialize(cord_json_reader_t *reader,
+                                                cord_json_token_t value,
+                                                cord_bump_t *allocator,
+                                                cord_reaction_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
+    cord_reaction_t *reaction =
+        array_slot ? array_slot : balloc(allocator, sizeof(cord_reaction_t));
     if (!reaction) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_reaction_init(reaction, allocator);
-    string_ref key = NULL;
-    json_t *value = NULL;
 
-    json_object_foreach(json_reaction, key, value) {
-        if (json_is_integer(value)) {
-            map_property(
-                reaction, count, "count", key, (i32)json_integer_value(value));
-        } else if (json_is_boolean(value)) {
-            map_property(reaction, me, "me", key, (bool)json_boolean(value));
-        } else if (json_is_object(value)) {
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_number(field)) {
+            map_property(reaction, count, "count", key, number_of(field));
+        } else if (cord_json_token_is_bool(field)) {
+            map_property(reaction, me, "me", key, is_true(field));
+        } else if (is_object(field)) {
             map_property_object(reaction,
                                 emoji,
                                 "emoji",
                                 key,
-                                value,
+                                reader,
+                                field,
                                 allocator,
                                 cord_emoji_t,
                                 cord_emoji_serialize);
         }
     }
-    return serialized(reaction);
+    return decoded(reader, reaction);
 }
 
 cord_serialize_result_t
-cord_message_activity_serialize(json_t *json_message_activity,
+cord_message_activity_serialize(cord_json_reader_t *reader,
+                                cord_json_token_t value,
                                 cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_message_activity_t *message_activity =
         balloc(allocator, sizeof(cord_message_activity_t));
     if (!message_activity) {
@@ -964,29 +1191,40 @@ cord_message_activity_serialize(json_t *json_message_activity,
     }
 
     cord_message_activity_init(message_activity, allocator);
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_message_activity, key, value) {
-        if (json_is_integer(value)) {
-            map_property(message_activity,
-                         type,
-                         "type",
-                         key,
-                         (i32)json_integer_value(value));
-        } else if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
 
-            map_property(message_activity, party_id, "party_id", key, builder);
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_number(field)) {
+            map_property(message_activity, type, "type", key, number_of(field));
+        } else if (is_string(field)) {
+            map_property(
+                message_activity, party_id, "party_id", key, field.value);
         }
     }
-    return serialized(message_activity);
+    return decoded(reader, message_activity);
+}
+
+static void message_application_strings(cord_message_application_t *app,
+                                        cord_str_t key,
+                                        cord_str_t value) {
+    map_snowflake(app, id, "id", key, value);
+    map_property(app, cover_image, "cover_image", key, value);
+    map_property(app, description, "description", key, value);
+    map_property(app, icon, "icon", key, value);
+    map_property(app, name, "name", key, value);
 }
 
 cord_serialize_result_t
-cord_message_application_serialize(json_t *json_message,
+cord_message_application_serialize(cord_json_reader_t *reader,
+                                   cord_json_token_t value,
                                    cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_message_application_t *message_app =
         balloc(allocator, sizeof(cord_message_application_t));
     if (!message_app) {
@@ -994,80 +1232,118 @@ cord_message_application_serialize(json_t *json_message,
     }
 
     cord_message_application_init(message_app, allocator);
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_message, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(message_app, id, "id", key, builder);
-            map_property(message_app, cover_image, "cover_image", key, builder);
-            map_property(message_app, description, "description", key, builder);
-            map_property(message_app, icon, "icon", key, builder);
-            map_property(message_app, name, "name", key, builder);
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            message_application_strings(message_app, key, field.value);
         }
     }
-    return serialized(message_app);
+    return decoded(reader, message_app);
 }
 
 cord_serialize_result_t
-cord_message_sticker_serialize(json_t *json_message_sticker,
-                               cord_bump_t *allocator) {
+cord_message_reference_serialize(cord_json_reader_t *reader,
+                                 cord_json_token_t value,
+                                 cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
+    cord_message_reference_t *message_reference =
+        balloc(allocator, sizeof(cord_message_reference_t));
+    if (!message_reference) {
+        return serialize_error(CORD_ERR_MALLOC);
+    }
+
+    cord_message_reference_init(message_reference, allocator);
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            map_snowflake(
+                message_reference, message_id, "message_id", key, field.value);
+            map_snowflake(
+                message_reference, channel_id, "channel_id", key, field.value);
+            map_snowflake(
+                message_reference, guild_id, "guild_id", key, field.value);
+        }
+    }
+    return decoded(reader, message_reference);
+}
+
+static void message_sticker_strings(cord_message_sticker_t *message_sticker,
+                                    cord_str_t key,
+                                    cord_str_t value) {
+    map_snowflake(message_sticker, id, "id", key, value);
+    map_snowflake(message_sticker, pack_id, "pack_id", key, value);
+    map_property(message_sticker, name, "name", key, value);
+    map_property(message_sticker, description, "description", key, value);
+    map_property(message_sticker, tags, "tags", key, value);
+    map_property(message_sticker, asset, "asset", key, value);
+    map_property(message_sticker, preview_asset, "preview_asset", key, value);
+}
+
+cord_serialize_result_t
+cord_message_sticker_serialize(cord_json_reader_t *reader,
+                               cord_json_token_t value,
+                               cord_bump_t *allocator,
+                               cord_message_sticker_t *array_slot) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_message_sticker_t *message_sticker =
-        balloc(allocator, sizeof(cord_message_sticker_t));
+        array_slot ? array_slot
+                   : balloc(allocator, sizeof(cord_message_sticker_t));
     if (!message_sticker) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_message_sticker_init(message_sticker, allocator);
-    string_ref key = NULL;
-    json_t *value = NULL;
 
-    json_object_foreach(json_message_sticker, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
 
-            map_property(message_sticker, id, "id", key, builder);
-            map_property(message_sticker, pack_id, "pack_id", key, builder);
-            map_property(message_sticker, name, "name", key, builder);
-            map_property(
-                message_sticker, description, "description", key, builder);
-            map_property(message_sticker, tags, "tags", key, builder);
-            map_property(message_sticker, asset, "asset", key, builder);
-            map_property(
-                message_sticker, preview_asset, "preview_asset", key, builder);
-        } else if (json_is_integer(value)) {
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            message_sticker_strings(message_sticker, key, field.value);
+        } else if (is_number(field)) {
             map_property(message_sticker,
                          format_type,
                          "format_type",
                          key,
-                         (i32)json_integer_value(value));
+                         number_of(field));
         }
     }
-    return serialized(message_sticker);
+    return decoded(reader, message_sticker);
 }
 
 static void
-message_strings(cord_message_t *message, string_ref key, string_ref cstring) {
-    cord_strbuf_t *builder = cord_strbuf_create();
-    cord_strbuf_append(builder, cstr(cstring));
-
-    map_property(message, id, "id", key, builder);
-    map_property(message, channel_id, "channel_id", key, builder);
-    map_property(message, guild_id, "guild_id", key, builder);
-    map_property(message, content, "content", key, builder);
-    map_property(message, timestamp, "timestamp", key, builder);
-    map_property(message, edited_timestamp, "edited_timestamp", key, builder);
-    map_property(message, nonce, "nonce", key, builder);
-    map_property(message, webhook_id, "webhook_id", key, builder);
+message_strings(cord_message_t *message, cord_str_t key, cord_str_t value) {
+    map_snowflake(message, id, "id", key, value);
+    map_snowflake(message, channel_id, "channel_id", key, value);
+    map_snowflake(message, guild_id, "guild_id", key, value);
+    map_property(message, content, "content", key, value);
+    map_property(message, timestamp, "timestamp", key, value);
+    map_property(message, edited_timestamp, "edited_timestamp", key, value);
+    map_property(message, nonce, "nonce", key, value);
+    map_snowflake(message, webhook_id, "webhook_id", key, value);
 }
 
 static void
-message_booleans(cord_message_t *message, string_ref key, bool value) {
+message_booleans(cord_message_t *message, cord_str_t key, bool value) {
     bool *boolean = balloc(message->allocator, sizeof(bool));
+    if (!boolean) {
+        return;
+    }
     *boolean = value;
 
     map_property(message, tts, "tts", key, boolean);
@@ -1076,35 +1352,146 @@ message_booleans(cord_message_t *message, string_ref key, bool value) {
 }
 
 static void
-message_numbers(cord_message_t *message, string_ref key, i32 value) {
+message_numbers(cord_message_t *message, cord_str_t key, i32 value) {
     i32 *number = balloc(message->allocator, sizeof(i32));
+    if (!number) {
+        return;
+    }
     *number = value;
 
     map_property(message, type, "type", key, number);
     map_property(message, flags, "flags", key, number);
 }
 
-static void
-message_arrays(cord_message_t *message, string_ref key, json_t *value) {
-    (void)message;
-    (void)key;
-    (void)value;
+static void message_arrays(cord_json_reader_t *reader,
+                           cord_message_t *message,
+                           cord_str_t key) {
+    cord_bump_t *allocator = message->allocator;
+
+    map_property_array(message,
+                       mentions,
+                       "mentions",
+                       key,
+                       reader,
+                       allocator,
+                       cord_user_t,
+                       cord_user_serialize);
+    map_property(message,
+                 mention_roles,
+                 "mention_roles",
+                 key,
+                 read_snowflake_array(reader, allocator));
+    map_property_array(message,
+                       mention_channels,
+                       "mention_channels",
+                       key,
+                       reader,
+                       allocator,
+                       cord_channel_mention_t,
+                       cord_channel_mention_serialize);
+    map_property_array(message,
+                       attachments,
+                       "attachments",
+                       key,
+                       reader,
+                       allocator,
+                       cord_attachment_t,
+                       cord_attachment_serialize);
+    map_property_array(message,
+                       embeds,
+                       "embeds",
+                       key,
+                       reader,
+                       allocator,
+                       cord_embed_t,
+                       cord_embed_serialize);
+    map_property_array(message,
+                       reactions,
+                       "reactions",
+                       key,
+                       reader,
+                       allocator,
+                       cord_reaction_t,
+                       cord_reaction_serialize);
+    map_property_array(message,
+                       stickers,
+                       "sticker_items",
+                       key,
+                       reader,
+                       allocator,
+                       cord_message_sticker_t,
+                       cord_message_sticker_serialize);
 }
 
-static void
-message_objects(cord_message_t *message, string_ref key, json_t *value) {
+static void message_objects(cord_json_reader_t *reader,
+                            cord_message_t *message,
+                            cord_str_t key,
+                            cord_json_token_t value) {
+    cord_bump_t *allocator = message->allocator;
+
+    map_property_object_collectible(message,
+                                    author,
+                                    "author",
+                                    key,
+                                    reader,
+                                    value,
+                                    allocator,
+                                    cord_user_t,
+                                    cord_user_serialize);
+    map_property_object(message,
+                        member,
+                        "member",
+                        key,
+                        reader,
+                        value,
+                        allocator,
+                        cord_guild_member_t,
+                        cord_guild_member_serialize);
     map_property_object(message,
-                        author,
-                        "author",
+                        activity,
+                        "activity",
                         key,
+                        reader,
                         value,
-                        message->allocator,
-                        cord_user_t,
-                        cord_user_serialize);
+                        allocator,
+                        cord_message_activity_t,
+                        cord_message_activity_serialize);
+    map_property_object(message,
+                        application,
+                        "application",
+                        key,
+                        reader,
+                        value,
+                        allocator,
+                        cord_message_application_t,
+                        cord_message_application_serialize);
+    map_property_object(message,
+                        message_reference,
+                        "message_reference",
+                        key,
+                        reader,
+                        value,
+                        allocator,
+                        cord_message_reference_t,
+                        cord_message_reference_serialize);
+    map_property_object(message,
+                        referenced_message,
+                        "referenced_message",
+                        key,
+                        reader,
+                        value,
+                        allocator,
+                        cord_message_t,
+                        cord_message_serialize);
 }
 
-cord_serialize_result_t cord_message_serialize(json_t *json_message,
+cord_serialize_result_t cord_message_serialize(cord_json_reader_t *reader,
+                                               cord_json_token_t value,
                                                cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_message_t *message = balloc(allocator, sizeof(cord_message_t));
     if (!message) {
         logger_error("Failed to allocate discord message");
@@ -1114,50 +1501,57 @@ cord_serialize_result_t cord_message_serialize(json_t *json_message,
     memset(message, 0, sizeof(cord_message_t));
     message->allocator = allocator;
 
-    string_ref key = NULL;
-    json_t *value = NULL;
-    json_object_foreach(json_message, key, value) {
-        if (json_is_string(value)) {
-            message_strings(message, key, json_string_value(value));
-        } else if (json_is_boolean(value)) {
-            message_booleans(message, key, (bool)json_boolean(value));
-        } else if (json_is_integer(value)) {
-            message_numbers(message, key, (i32)json_integer_value(value));
-        } else if (json_is_array(value)) {
-            message_arrays(message, key, value);
-        } else if (json_is_object(value)) {
-            message_objects(message, key, value);
-        } else {
-            // TODO: Should this return error or fallthrough?
-            // return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            message_strings(message, key, field.value);
+        } else if (cord_json_token_is_bool(field)) {
+            message_booleans(message, key, is_true(field));
+        } else if (is_number(field)) {
+            message_numbers(message, key, (i32)number_of(field));
+        } else if (is_array(field)) {
+            message_arrays(reader, message, key);
+        } else if (is_object(field)) {
+            message_objects(reader, message, key, field);
         }
     }
-    return serialized(message);
+    return decoded(reader, message);
 }
 
-cord_serialize_result_t cord_guild_serialize(json_t *json_message,
+static void
+guild_strings(cord_guild_t *guild, cord_str_t key, cord_str_t value) {
+    map_snowflake(guild, id, "id", key, value);
+    map_property(guild, name, "name", key, value);
+    map_property(guild, icon, "icon", key, value);
+    map_property(guild, splash, "splash", key, value);
+    map_property(guild, discovery_splash, "discovery_splash", key, value);
+}
+
+cord_serialize_result_t cord_guild_serialize(cord_json_reader_t *reader,
+                                             cord_json_token_t value,
                                              cord_bump_t *allocator) {
+    if (!is_object(value)) {
+        return serialize_error(CORD_ERR_OBJ_SERIALIZE);
+    }
+
     cord_guild_t *guild = balloc(allocator, sizeof(cord_guild_t));
     if (!guild) {
         return serialize_error(CORD_ERR_MALLOC);
     }
 
     cord_guild_init(guild, allocator);
-    string_ref key = NULL;
-    json_t *value = NULL;
-
-    json_object_foreach(json_message, key, value) {
-        if (json_is_string(value)) {
-            cord_strbuf_t *builder = cord_strbuf_create();
-            cord_strbuf_append(builder, cstr(json_string_value(value)));
-
-            map_property(guild, id, "id", key, builder);
-            map_property(guild, name, "name", key, builder);
-            map_property(guild, icon, "icon", key, builder);
-            map_property(guild, splash, "splash", key, builder);
-            map_property(
-                guild, discovery_splash, "discovery_splash", key, builder);
+
+    i32 depth = reader->depth;
+    cord_str_t key = {0};
+    cord_json_token_t field = {0};
+
+    while (next_field(reader, depth, &key, &field)) {
+        if (is_string(field)) {
+            guild_strings(guild, key, field.value);
         }
     }
-    return serialized(guild);
+    return decoded(reader, guild);
 }
@@ -3,69 +3,59 @@
 
 #include "../core/array.h"
 #include "../core/errors.h"
+#include "../core/json_reader.h"
+#include "../core/json_writer.h"
 #include "../core/memory.h"
 #include "../core/strings.h"
 #include "entities.h"
+#include "message_builder.h"
 
-#include <jansson.h>
+/*
+ * Write the fields of message that can be sent to create it. The json lives
+ * in the writer's allocator, NULL if it couldn't be written.
+ */
+char *cord_message_to_json(cord_json_writer_t *writer,
+                           cord_message_t *message);
+
+// The same for a message with its files, allowed mentions and components
+char *cord_message_builder_to_json(cord_json_writer_t *writer,
+                                   cord_message_builder_t *builder);
 
 /*
-   json_payload_t *payload_from_cord_message(writer *w, cord_message_t *m);
-*/
-
-typedef enum cord_json_writer_field_type_t {
-    JSON_WRITER_FIELD_STRING,
-    JSON_WRITER_FIELD_BOOL,
-    JSON_WRITER_FIELD_NUMBER,
-    JSON_WRITER_FIELD_OBJECT,
-    JSON_WRITER_FIELD_ARRAY,
-    JSON_WRITER_FIELD_NULL
-} cord_json_writer_field_type_t;
-
-typedef struct cord_json_writer_t {
-    cord_strbuf_t *buffer;
-    cord_bump_t *allocator;
-} cord_json_writer_t;
-
-cord_json_writer_t cord_json_writer_create(cord_bump_t *allocator);
-
-void cord_json_writer_start(cord_json_writer_t writer);
-void cord_json_writer_end(cord_json_writer_t writer);
-bool cord_json_writer_write_string(cord_json_writer_t writer,
-                                   cord_str_t key,
-                                   cord_str_t value);
-bool cord_json_writer_write_number(cord_json_writer_t writer,
-                                   cord_str_t key,
-                                   i64 value);
-bool cord_json_writer_write_boolean(cord_json_writer_t writer,
-                                    cord_str_t key,
-                                    bool value);
-bool cord_json_writer_write_object(cord_json_writer_t writer,
-                                   cord_str_t key,
-                                   json_t *object);
-bool cord_json_writer_write_null(cord_json_writer_t writer, cord_str_t key);
-bool cord_json_writer_write_array(cord_json_writer_t writer,
-                                  cord_str_t key,
-                                  cord_array_t *array);
-
-char *cord_message_to_json(cord_json_writer_t writer, cord_message_t *message);
-
-#define map_property_object_collectible(                                       \
-    object, property, property_str, key, value, allocator, type, serialize)    \
-    if (cstring_is_equal(key, property_str)) {                                 \
-        cord_serialize_result_t __result = serialize(value, allocator, NULL);  \
+ * Decode the object that starts with value into object->property when the
+ * key matches. Collectible entities can also be decoded into array slots.
+ */
+#define map_property_object_collectible(object,                                \
+                                        property,                              \
+                                        property_str,                          \
+                                        key,                                   \
+                                        reader,                                \
+                                        value,                                 \
+                                        allocator,                             \
+                                        type,                                  \
+                                        serialize)                             \
+    if (cord_str_equals_cstring(key, property_str)) {                          \
+        cord_serialize_result_t __result =                                     \
+            serialize(reader, value, allocator, NULL);                         \
         if (has_serialization_error(__result)) {                               \
             logger_error("Failed to serialize " #type ": %s",                  \
                          cord_error(__result.error));                          \
-            continue;                                                          \
         }                                                                      \
         object->property = __result.obj;                                       \
     }
 
-#define map_property_object(                                                   \
-    object, property, property_str, key, value, allocator, type, serialize)    \
-    if (cstring_is_equal(key, property_str)) {                                 \
-        cord_serialize_result_t __result = serialize(value, allocator);        \
+#define map_property_object(object,                                            \
+                            property,                                          \
+                            property_str,                                      \
+                            key,                                               \
+                            reader,                                            \
+                            value,                                             \
+                            allocator,                                         \
+                            type,                                              \
+                            serialize)                                         \
+    if (cord_str_equals_cstring(key, property_str)) {                          \
+        cord_serialize_result_t __result =                                     \
+            serialize(reader, value, allocator);                               \
         if (has_serialization_error(__result)) {                               \
             logger_error("Failed to serialize " #type ": %s",                  \
                          cord_error(__result.error));                          \
@@ -79,62 +69,126 @@ typedef struct cord_serialize_result_t {
 } cord_serialize_result_t;
 
 bool cord_serialize_result_is_valid(cord_serialize_result_t result);
-cord_serialize_result_t cord_user_serialize(json_t *data,
-                                            cord_bump_t *allocator);
-cord_serialize_result_t cord_role_serialize(json_t *data,
+
+/*
+ * Entities are decoded from a reader, starting at value which has to be the
+ * start of the entity's object. Strings are not copied, they are slices of
+ * the reader's input (see entities.h).
+ */
+cord_serialize_result_t cord_user_serialize(cord_json_reader_t *reader,
+                                            cord_json_token_t value,
+                                            cord_bump_t *allocator,
+                                            cord_user_t *array_slot);
+
+cord_serialize_result_t cord_role_serialize(cord_json_reader_t *reader,
+                                            cord_json_token_t value,
                                             cord_bump_t *allocator,
                                             cord_role_t *array_slot);
 
-cord_serialize_result_t cord_role_tag_serialize(json_t *json_role_tag,
+cord_serialize_result_t cord_role_tag_serialize(cord_json_reader_t *reader,
+                                                cord_json_token_t value,
                                                 cord_bump_t *allocator,
                                                 cord_role_tag_t *array_slot);
 
-cord_serialize_result_t cord_guild_member_serialize(json_t *data,
+cord_serialize_result_t cord_guild_member_serialize(cord_json_reader_t *reader,
+                                                    cord_json_token_t value,
                                                     cord_bump_t *allocator);
-cord_serialize_result_t cord_channel_mention_serialize(json_t *data,
-                                                       cord_bump_t *allocator);
 
-cord_serialize_result_t cord_attachment_serialize(json_t *data,
-                                                  cord_bump_t *allocator);
-cord_serialize_result_t cord_embed_footer_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_footer_t *array_slot);
+cord_serialize_result_t
+cord_channel_mention_serialize(cord_json_reader_t *reader,
+                               cord_json_token_t value,
+                               cord_bump_t *allocator,
+                               cord_channel_mention_t *array_slot);
 
-cord_serialize_result_t cord_embed_image_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_image_t *array_slot);
+cord_serialize_result_t
+cord_attachment_serialize(cord_json_reader_t *reader,
+                          cord_json_token_t value,
+                          cord_bump_t *allocator,
+                          cord_attachment_t *array_slot);
 
-cord_serialize_result_t cord_embed_thumbnail_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_thumbnail_t *array_slot);
+cord_serialize_result_t
+cord_embed_footer_serialize(cord_json_reader_t *reader,
+                            cord_json_token_t value,
+                            cord_bump_t *allocator,
+                            cord_embed_footer_t *array_slot);
 
-cord_serialize_result_t cord_embed_video_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_video_t *array_slot);
+cord_serialize_result_t
+cord_embed_image_serialize(cord_json_reader_t *reader,
+                           cord_json_token_t value,
+                           cord_bump_t *allocator,
+                           cord_embed_image_t *array_slot);
 
-cord_serialize_result_t cord_embed_provider_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_provider_t *array_slot);
+cord_serialize_result_t
+cord_embed_thumbnail_serialize(cord_json_reader_t *reader,
+                               cord_json_token_t value,
+                               cord_bump_t *allocator,
+                               cord_embed_thumbnail_t *array_slot);
 
-cord_serialize_result_t cord_embed_author_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_author_t *array_slot);
+cord_serialize_result_t
+cord_embed_video_serialize(cord_json_reader_t *reader,
+                           cord_json_token_t value,
+                           cord_bump_t *allocator,
+                           cord_embed_video_t *array_slot);
 
-cord_serialize_result_t cord_embed_field_serialize(
-    json_t *data, cord_bump_t *allocator, cord_embed_field_t *array_slot);
+cord_serialize_result_t
+cord_embed_provider_serialize(cord_json_reader_t *reader,
+                              cord_json_token_t value,
+                              cord_bump_t *allocator,
+                              cord_embed_provider_t *array_slot);
 
-cord_serialize_result_t cord_embed_serialize(json_t *data,
-                                             cord_bump_t *allocator);
-cord_serialize_result_t cord_emoji_serialize(json_t *data,
+cord_serialize_result_t
+cord_embed_author_serialize(cord_json_reader_t *reader,
+                            cord_json_token_t value,
+                            cord_bump_t *allocator,
+                            cord_embed_author_t *array_slot);
+
+cord_serialize_result_t
+cord_embed_field_serialize(cord_json_reader_t *reader,
+                           cord_json_token_t value,
+                           cord_bump_t *allocator,
+                           cord_embed_field_t *array_slot);
+
+cord_serialize_result_t cord_embed_serialize(cord_json_reader_t *reader,
+                                             cord_json_token_t value,
+                                             cord_bump_t *allocator,
+                                             cord_embed_t *array_slot);
+
+cord_serialize_result_t cord_emoji_serialize(cord_json_reader_t *reader,
+                                             cord_json_token_t value,
                                              cord_bump_t *allocator);
-cord_serialize_result_t cord_reaction_serialize(json_t *data,
-                                                cord_bump_t *allocator);
-cord_serialize_result_t cord_message_activity_serialize(json_t *data,
-                                                        cord_bump_t *allocator);
+
+cord_serialize_result_t cord_reaction_serialize(cord_json_reader_t *reader,
+                                                cord_json_token_t value,
+                                                cord_bump_t *allocator,
+                                                cord_reaction_t *array_slot);
 
 cord_serialize_result_t
-cord_message_application_serialize(json_t *data, cord_bump_t *allocator);
+cord_message_activity_serialize(cord_json_reader_t *reader,
+                                cord_json_token_t value,
+                                cord_bump_t *allocator);
 
-cord_serialize_result_t cord_message_sticker_serialize(json_t *data,
-                                                       cord_bump_t *allocator);
+cord_serialize_result_t
+cord_message_application_serialize(cord_json_reader_t *reader,
+                                   cord_json_token_t value,
+                                   cord_bump_t *allocator);
+
+cord_serialize_result_t
+cord_message_reference_serialize(cord_json_reader_t *reader,
+                                 cord_json_token_t value,
+                                 cord_bump_t *allocator);
 
-cord_serialize_result_t cord_message_serialize(json_t *data,
+cord_serialize_result_t
+cord_message_sticker_serialize(cord_json_reader_t *reader,
+                               cord_json_token_t value,
+                               cord_bump_t *allocator,
+                               cord_message_sticker_t *array_slot);
+
+cord_serialize_result_t cord_message_serialize(cord_json_reader_t *reader,
+                                               cord_json_token_t value,
                                                cord_bump_t *allocator);
-cord_serialize_result_t cord_guild_serialize(json_t *data,
+
+cord_serialize_result_t cord_guild_serialize(cord_json_reader_t *reader,
+                                             cord_json_token_t value,
                                              cord_bump_t *allocator);
 
 #endif
@@ -0,0 +1,231 @@
+#include "shard.h"
+#include "../core/log.h"
+
+#include <assert.h>
+#include <signal.h>
+
+bool cord_identify_gate_init(cord_identify_gate_t *gate,
+                             cord_bump_t *allocator,
+                             i32 max_concurrency) {
+    assert(gate && "cord_identify_gate_t must not be null");
+
+    // Every bot can identify at least one shard at a time
+    max_concurrency = max(max_concurrency, 1);
+    gate->next_identify = balloc(allocator, sizeof(f64) * max_concurrency);
+    if (!gate->next_identify) {
+        logger_error("Failed to allocate %d identify buckets", max_concurrency);
+        return false;
+    }
+
+    gate->max_concurrency = max_concurrency;
+    gate->interval = CORD_IDENTIFY_INTERVAL;
+    pthread_mutex_init(&gate->lock, NULL);
+    return true;
+}
+
+void cord_identify_gate_destroy(cord_identify_gate_t *gate) {
+    if (gate && gate->next_identify) {
+        pthread_mutex_destroy(&gate->lock);
+        gate->next_identify = NULL;
+    }
+}
+
+f64 cord_identify_gate_reserve(cord_identify_gate_t *gate,
+                               i32 shard_id,
+                               f64 now) {
+    i32 bucket = shard_id % gate->max_concurrency;
+
+    pthread_mutex_lock(&gate->lock);
+    f64 slot = max(now, gate->next_identify[bucket]);
+    gate->next_identify[bucket] = slot + gate->interval;
+    pthread_mutex_unlock(&gate->lock);
+
+    return slot - now;
+}
+
+static void shard_stop_cb(struct ev_loop *loop, ev_async *w, i32 revents) {
+    (void)w;
+    (void)revents;
+    ev_break(loop, EVBREAK_ALL);
+}
+
+static void shard_destroy(cord_shard_t *shard) {
+    if (shard->client) {
+        cord_client_destroy(shard->client);
+    }
+    if (shard->loop) {
+        ev_async_stop(shard->loop, &shard->stop_watcher);
+        ev_loop_destroy(shard->loop);
+    }
+    cord_bump_destroy(shard->allocator);
+    *shard = (cord_shard_t){0};
+}
+
+static bool
+shard_init(cord_shards_t *shards, cord_shard_t *shard, i32 id, i32 count) {
+    shard->shards = shards;
+    shard->allocator = cord_bump_create_with_size(KB(64));
+    shard->loop = ev_loop_new(EVFLAG_AUTO);
+    if (!shard->allocator || !shard->loop) {
+        logger_error("Failed to create event loop of shard %d", id);
+        shard_destroy(shard);
+        return false;
+    }
+
+    shard->client = cord_client_create(shard->allocator);
+    if (!shard->client) {
+        logger_error("Failed to create client of shard %d", id);
+        shard_destroy(shard);
+        return false;
+    }
+
+    cord_client_t *client = shard->client;
+    client->loop = shard->loop;
+    client->shard_id = id;
+    client->shard_count = count;
+    client->identify_gate = &shards->gate;
+
+    ev_async_init(&shard->stop_watcher, shard_stop_cb);
+    ev_async_start(shard->loop, &shard->stop_watcher);
+    return true;
+}
+
+cord_shards_t *
+cord_shards_create(cord_bump_t *allocator, i32 count, i32 max_concurrency) {
+    if (count <= 0 || count > CORD_MAX_SHARDS) {
+        logger_error("Invalid shard count %d", count);
+        return NULL;
+    }
+
+    cord_shards_t *shards = balloc(allocator, sizeof(cord_shards_t));
+    cord_shard_t *list = balloc(allocator, sizeof(cord_shard_t) * count);
+    if (!shards || !list) {
+        logger_error("Failed to allocate %d shards", count);
+        return NULL;
+    }
+
+    if (!cord_identify_gate_init(&shards->gate, allocator, max_concurrency)) {
+        return NULL;
+    }
+
+    shards->shards = list;
+    shards->count = 0;
+    shards->run = cord_client_connect;
+    atomic_init(&shards->running, 0);
+
+    for (i32 i = 0; i < count; i++) {
+        if (!shard_init(shards, &list[i], i, count)) {
+            cord_shards_destroy(shards);
+            return NULL;
+        }
+        shards->count++;
+    }
+    return shards;
+}
+
+static void *shard_main(void *arg) {
+    cord_shard_t *shard = arg;
+    cord_shards_t *shards = shard->shards;
+
+    logger_debug("Starting shard %d", shard->client->shard_id);
+    shard->result = shards->run(shard->client);
+
+    atomic_fetch_sub(&shards->running, 1);
+    ev_async_send(shards->supervisor, &shards->finished_watcher);
+    return NULL;
+}
+
+static void shards_finished_cb(struct ev_loop *loop, ev_async *w, i32 revents) {
+    (void)revents;
+
+    cord_shards_t *shards = w->data;
+    if (atomic_load(&shards->running) == 0) {
+        ev_break(loop, EVBREAK_ALL);
+    }
+}
+
+static void shards_sigint_cb(struct ev_loop *loop, ev_signal *w, i32 revents) {
+    (void)loop;
+    (void)revents;
+
+    logger_debug("Stopping shards");
+    cord_shards_stop(w->data);
+}
+
+static void start_supervisor(cord_shards_t *shards) {
+    shards->supervisor = ev_default_loop(0);
+
+    ev_async_init(&shards->finished_watcher, shards_finished_cb);
+    shards->finished_watcher.data = shards;
+    ev_async_start(shards->supervisor, &shards->finished_watcher);
+
+    ev_signal_init(&shards->sigint_watcher, shards_sigint_cb, SIGINT);
+    shards->sigint_watcher.data = shards;
+    ev_signal_start(shards->supervisor, &shards->sigint_watcher);
+}
+
+bool cord_shards_run(cord_shards_t *shards) {
+    assert(shards && "cord_shards_t must not be null");
+
+    start_supervisor(shards);
+
+    // Shard threads inherit a mask without SIGINT, the supervisor takes it
+    sigset_t signals;
+    sigset_t previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+    bool started = true;
+    for (i32 i = 0; i < shards->count; i++) {
+        cord_shard_t *shard = &shards->shards[i];
+
+        atomic_fetch_add(&shards->running, 1);
+        if (pthread_create(&shard->thread, NULL, shard_main, shard) != 0) {
+            atomic_fetch_sub(&shards->running, 1);
+            logger_error("Failed to start thread of shard %d", i);
+            started = false;
+            break;
+        }
+        shard->started = true;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (!started) {
+        cord_shards_stop(shards);
+    }
+
+    // Shards that already stopped have left finished_watcher pending
+    if (shards->count > 0 && shards->shards[0].started) {
+        ev_run(shards->supervisor, 0);
+    }
+
+    for (i32 i = 0; i < shards->count; i++) {
+        cord_shard_t *shard = &shards->shards[i];
+        if (shard->started) {
+            pthread_join(shard->thread, NULL);
+            shard->started = false;
+        }
+    }
+
+    ev_signal_stop(shards->supervisor, &shards->sigint_watcher);
+    ev_async_stop(shards->supervisor, &shards->finished_watcher);
+    return started;
+}
+
+void cord_shards_stop(cord_shards_t *shards) {
+    for (i32 i = 0; i < shards->count; i++) {
+        cord_shard_t *shard = &shards->shards[i];
+        ev_async_send(shard->loop, &shard->stop_watcher);
+    }
+}
+
+void cord_shards_destroy(cord_shards_t *shards) {
+    if (shards) {
+        for (i32 i = 0; i < shards->count; i++) {
+            shard_destroy(&shards->shards[i]);
+        }
+        shards->count = 0;
+        cord_identify_gate_destroy(&shards->gate);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "../core/memory.h"
+#include "../core/typedefs.h"
+#include "client.h"
+
+#include <ev.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Seconds between identifies of the same rate limit bucket
+#define CORD_IDENTIFY_INTERVAL 5.0
+#define CORD_MAX_SHARDS 4096
+
+/*
+ * Identify rate limit shared by the shards of a bot
+ *
+ * Shards are grouped in max_concurrency buckets by shard_id %
+ * max_concurrency, and every bucket allows one identify per interval.
+ * Shards ask for a slot when they receive HELLO and wait on their own loop
+ * until it comes, so a shard waiting doesn't hold back any other.
+ */
+typedef struct cord_identify_gate_t {
+    pthread_mutex_t lock;
+    i32 max_concurrency;
+    f64 interval;
+    // When each bucket can identify next, in ev_time() seconds
+    f64 *next_identify;
+} cord_identify_gate_t;
+
+bool cord_identify_gate_init(cord_identify_gate_t *gate,
+                             cord_bump_t *allocator,
+                             i32 max_concurrency);
+void cord_identify_gate_destroy(cord_identify_gate_t *gate);
+
+/*
+ * Reserve the next identify slot of the shard's bucket. Returns the seconds
+ * to wait for it, 0 when the shard can identify right away.
+ */
+f64 cord_identify_gate_reserve(cord_identify_gate_t *gate,
+                               i32 shard_id,
+                               f64 now);
+
+typedef struct cord_shards_t cord_shards_t;
+
+// Runs the connection of a shard on its thread until it stops
+typedef i32 (*cord_shard_run_t)(cord_client_t *client);
+
+/*
+ * A gateway connection running on its own thread
+ *
+ * The client, its event loop and its allocators belong to the shard's
+ * thread once it starts, nothing of it is shared with other shards.
+ */
+typedef struct cord_shard_t {
+    cord_shards_t *shards;
+    cord_client_t *client;
+    struct ev_loop *loop;
+    cord_bump_t *allocator;
+
+    // Breaks the loop from other threads
+    struct ev_async stop_watcher;
+    pthread_t thread;
+    bool started;
+    i32 result;
+} cord_shard_t;
+
+typedef struct cord_shards_t {
+    cord_shard_t *shards;
+    i32 count;
+    cord_identify_gate_t gate;
+
+    // cord_client_connect unless replaced, e.g. by a websocket stand-in
+    cord_shard_run_t run;
+
+    // The calling thread waits on the default loop for the shards or SIGINT
+    struct ev_loop *supervisor;
+    struct ev_async finished_watcher;
+    struct ev_signal sigint_watcher;
+    atomic_int running;
+} cord_shards_t;
+
+/*
+ * Create count shards, each with a client of its own. The clients can be
+ * configured before the shards are started.
+ */
+cord_shards_t *cord_shards_create(cord_bump_t *allocator,
+                                  i32 count,
+                                  i32 max_concurrency);
+
+/*
+ * Start every shard on a thread and wait until they all stop, which they do
+ * on SIGINT or cord_shards_stop. Returns false if a shard failed to start.
+ */
+bool cord_shards_run(cord_shards_t *shards);
+
+// Ask every shard to stop, safe to call from any thread
+void cord_shards_stop(cord_shards_t *shards);
+void cord_shards_destroy(cord_shards_t *shards);
+
+#endif
@@ -0,0 +1,412 @@
+#include "async.h"
+#include "../core/log.h"
+#include "http.h"
+
+#include <assert.h>
+#include <curl/curl.h>
+#include <ev.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Per-socket watcher handed to curl through curl_multi_assign()
+ */
+typedef struct socket_watcher_t {
+    struct ev_io io;
+    cord_http_async_t *engine;
+    curl_socket_t fd;
+} socket_watcher_t;
+
+static void track_future(cord_http_async_t *engine, cord_http_future_t *f) {
+    f->prev = NULL;
+    f->next = engine->pending;
+    if (engine->pending) {
+        engine->pending->prev = f;
+    }
+    engine->pending = f;
+}
+
+static void untrack_future(cord_http_async_t *engine, cord_http_future_t *f) {
+    if (f->prev) {
+        f->prev->next = f->next;
+    } else {
+        engine->pending = f->next;
+    }
+    if (f->next) {
+        f->next->prev = f->prev;
+    }
+    f->prev = NULL;
+    f->next = NULL;
+}
+
+static void future_destroy(cord_http_future_t *future) {
+    if (future) {
+        if (future->curl) {
+            curl_easy_cleanup(future->curl);
+        }
+        cord_strbuf_destroy(future->response);
+        cord_strbuf_destroy(future->response_headers);
+        free(future);
+    }
+}
+
+/*
+ * Give the handle back to the client's pool and keep the future itself
+ * (with its response buffer) for the next request
+ */
+static void future_recycle(cord_http_future_t *future) {
+    cord_http_async_t *engine = future->engine;
+    cord_http_client_release_handle(engine->client, future->curl);
+    future->curl = NULL;
+    curl_mime_free(future->mime);
+    future->mime = NULL;
+    future->on_complete = NULL;
+    future->user_data = NULL;
+    future->response->length = 0;
+    future->response_headers->length = 0;
+
+    future->prev = NULL;
+    future->next = engine->idle;
+    engine->idle = future;
+}
+
+static cord_http_future_t *future_acquire(cord_http_async_t *engine) {
+    cord_http_future_t *future = engine->idle;
+    if (future) {
+        engine->idle = future->next;
+        future->next = NULL;
+        return future;
+    }
+
+    future = calloc(1, sizeof(cord_http_future_t));
+    if (!future) {
+        return NULL;
+    }
+    future->engine = engine;
+    future->response = cord_strbuf_create();
+    future->response_headers = cord_strbuf_create();
+    if (!future->response || !future->response_headers) {
+        future_destroy(future);
+        return NULL;
+    }
+    return future;
+}
+
+static void complete_future(cord_http_future_t *future, CURLcode rc) {
+    cord_http_async_t *engine = future->engine;
+
+    long status = 0;
+    curl_easy_getinfo(future->curl, CURLINFO_RESPONSE_CODE, &status);
+    future->result.status = (i32)status;
+    future->result.error = rc != CURLE_OK || status != HTTP_OK;
+
+    if (rc != CURLE_OK) {
+        logger_error("Could not perform async HTTP request: %s",
+                     curl_easy_strerror(rc));
+    }
+
+    // Null terminate in place, the body is only borrowed by the callback
+    cord_strbuf_append(future->response, (cord_str_t){"", 1});
+    future->response->length--;
+    future->result.body = future->response->data;
+    future->result.length = future->response->length;
+    future->result.headers = cord_strbuf_to_str(*future->response_headers);
+
+    curl_multi_remove_handle(engine->multi, future->curl);
+    untrack_future(engine, future);
+
+    if (future->on_complete) {
+        future->completing = true;
+        future->on_complete(future, future->result, future->user_data);
+        future->completing = false;
+    }
+
+    future_recycle(future);
+}
+
+static void check_multi_info(cord_http_async_t *engine) {
+    CURLMsg *message = NULL;
+    i32 pending = 0;
+
+    while ((message = curl_multi_info_read(engine->multi, &pending))) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        cord_http_future_t *future = NULL;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &future);
+        assert(future && "Finished easy handle without a future");
+        complete_future(future, message->data.result);
+    }
+}
+
+static void socket_event_cb(struct ev_loop *loop, ev_io *io, i32 revents) {
+    (void)loop;
+
+    socket_watcher_t *watcher = io->data;
+    cord_http_async_t *engine = watcher->engine;
+
+    i32 action = ((revents & EV_READ) ? CURL_CSELECT_IN : 0) |
+                 ((revents & EV_WRITE) ? CURL_CSELECT_OUT : 0);
+
+    curl_multi_socket_action(
+        engine->multi, watcher->fd, action, &engine->running);
+    // Completion callbacks may queue new requests, which re-arm the timer
+    // through multi_timer_cb, so the timer is left for curl to manage
+    check_multi_info(engine);
+}
+
+static void timer_event_cb(struct ev_loop *loop, ev_timer *timer, i32 revents) {
+    (void)loop;
+    (void)revents;
+
+    cord_http_async_t *engine = timer->data;
+    curl_multi_socket_action(
+        engine->multi, CURL_SOCKET_TIMEOUT, 0, &engine->running);
+    check_multi_info(engine);
+}
+
+static i32 socket_cb(CURL *easy,
+                     curl_socket_t fd,
+                     i32 what,
+                     void *userp,
+                     void *socketp) {
+    (void)easy;
+
+    cord_http_async_t *engine = userp;
+    socket_watcher_t *watcher = socketp;
+
+    if (what == CURL_POLL_REMOVE) {
+        if (watcher) {
+            ev_io_stop(engine->loop, &watcher->io);
+            free(watcher);
+        }
+        curl_multi_assign(engine->multi, fd, NULL);
+        return 0;
+    }
+
+    if (!watcher) {
+        watcher = calloc(1, sizeof(socket_watcher_t));
+        if (!watcher) {
+            logger_error("Failed to allocate socket watcher");
+            return -1;
+        }
+        watcher->engine = engine;
+        watcher->fd = fd;
+        watcher->io.data = watcher;
+        curl_multi_assign(engine->multi, fd, watcher);
+    }
+
+    i32 events = ((what & CURL_POLL_IN) ? EV_READ : 0) |
+                 ((what & CURL_POLL_OUT) ? EV_WRITE : 0);
+
+    ev_io_stop(engine->loop, &watcher->io);
+    ev_io_init(&watcher->io, socket_event_cb, fd, events);
+    watcher->io.data = watcher;
+    ev_io_start(engine->loop, &watcher->io);
+    return 0;
+}
+
+static i32 multi_timer_cb(CURLM *multi, long timeout_ms, void *userp) {
+    (void)multi;
+
+    cord_http_async_t *engine = userp;
+    ev_timer_stop(engine->loop, &engine->timer);
+
+    // -1 means curl wants the timer deleted
+    if (timeout_ms >= 0) {
+        ev_timer_set(&engine->timer, (f64)timeout_ms / 1000.0, 0.0);
+        ev_timer_start(engine->loop, &engine->timer);
+    }
+    return 0;
+}
+
+cord_http_async_t *cord_http_async_create(cord_bump_t *allocator,
+                                          struct ev_loop *loop,
+                                          cord_http_client_t *client) {
+    assert(loop && "Async http engine needs an event loop");
+    assert(client && "Async http engine needs an http client");
+
+    cord_http_async_t *engine = balloc(allocator, sizeof(cord_http_async_t));
+    if (!engine) {
+        logger_error("Failed to allocate async http engine");
+        return NULL;
+    }
+
+    engine->multi = curl_multi_init();
+    if (!engine->multi) {
+        logger_error("Failed to init curl multi handle");
+        return NULL;
+    }
+
+    engine->loop = loop;
+    engine->client = client;
+    engine->pending = NULL;
+    engine->idle = NULL;
+    engine->running = 0;
+
+    ev_init(&engine->timer, timer_event_cb);
+    engine->timer.data = engine;
+
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETFUNCTION, socket_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERFUNCTION, multi_timer_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    return engine;
+}
+
+void cord_http_async_destroy(cord_http_async_t *engine) {
+    if (engine) {
+        while (engine->pending) {
+            cord_http_future_cancel(engine->pending);
+        }
+        while (engine->idle) {
+            cord_http_future_t *next = engine->idle->next;
+            future_destroy(engine->idle);
+            engine->idle = next;
+        }
+        ev_timer_stop(engine->loop, &engine->timer);
+        if (engine->multi) {
+            curl_multi_cleanup(engine->multi);
+            engine->multi = NULL;
+        }
+    }
+}
+
+static size_t async_write_cb(void *data, size_t size, size_t nmemb, void *ud) {
+    cord_http_future_t *future = ud;
+    size_t length = size * nmemb;
+    cord_strbuf_append(future->response,
+                       (cord_str_t){.data = data, .length = length});
+    return length;
+}
+
+static size_t async_header_cb(char *data, size_t size, size_t nmemb, void *ud) {
+    cord_http_future_t *future = ud;
+    size_t length = size * nmemb;
+    cord_strbuf_append(future->response_headers,
+                       (cord_str_t){.data = data, .length = length});
+    return length;
+}
+
+static cord_http_future_t *start_future(cord_http_async_t *engine,
+                                        cord_http_future_cb on_complete,
+                                        void *user_data) {
+    cord_http_future_t *future = future_acquire(engine);
+    if (!future) {
+        logger_error("Failed to allocate http future");
+        return NULL;
+    }
+
+    future->on_complete = on_complete;
+    future->user_data = user_data;
+    future->result = (cord_http_result_t){0};
+    future->curl = cord_http_client_acquire_handle(engine->client);
+    return future;
+}
+
+// Hand a prepared future to curl, recycling it if that fails
+static cord_http_future_t *queue_future(cord_http_future_t *future,
+                                        bool prepared) {
+    cord_http_async_t *engine = future->engine;
+    if (!prepared) {
+        logger_error("Failed to create async http request");
+        future_recycle(future);
+        return NULL;
+    }
+
+    CURL *curl = future->curl;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, async_write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, future);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, async_header_cb);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, future);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, future);
+
+    CURLMcode rc = curl_multi_add_handle(engine->multi, curl);
+    if (rc != CURLM_OK) {
+        logger_error("Failed to queue async http request: %s",
+                     curl_multi_strerror(rc));
+        future_recycle(future);
+        return NULL;
+    }
+
+    track_future(engine, future);
+    return future;
+}
+
+cord_http_future_t *cord_http_async_request(cord_http_async_t *engine,
+                                            i32 type,
+                                            cord_str_t url,
+                                            const char *body,
+                                            cord_http_future_cb on_complete,
+                                            void *user_data) {
+    cord_http_future_t *future = start_future(engine, on_complete, user_data);
+    if (!future) {
+        return NULL;
+    }
+
+    bool prepared = future->curl && cord_http_prepare_handle(
+                                        future->curl, type, url, body);
+    return queue_future(future, prepared);
+}
+
+cord_http_future_t *
+cord_http_async_post_multipart(cord_http_async_t *engine,
+                               cord_str_t url,
+                               const char *json,
+                               const cord_http_file_t *files,
+                               i32 num_files,
+                               cord_http_future_cb on_complete,
+                               void *user_data) {
+    cord_http_future_t *future = start_future(engine, on_complete, user_data);
+    if (!future) {
+        return NULL;
+    }
+
+    if (future->curl) {
+        future->mime = cord_http_multipart_create(
+            future->curl, json, files, num_files);
+    }
+    bool prepared = future->mime && cord_http_prepare_multipart(engine->client,
+                                                                future->curl,
+                                                                url,
+                                                                future->mime);
+    return queue_future(future, prepared);
+}
+
+cord_http_future_t *cord_http_async_get(cord_http_async_t *engine,
+                                        cord_str_t url,
+                                        cord_http_future_cb on_complete,
+                                        void *user_data) {
+    return cord_http_async_request(
+        engine, HTTP_GET, url, NULL, on_complete, user_data);
+}
+
+cord_http_future_t *cord_http_async_post(cord_http_async_t *engine,
+                                         cord_str_t url,
+                                         const char *body,
+                                         cord_http_future_cb on_complete,
+                                         void *user_data) {
+    return cord_http_async_request(
+        engine, HTTP_POST, url, body, on_complete, user_data);
+}
+
+void cord_http_future_cancel(cord_http_future_t *future) {
+    // The future is recycled once its callback returns
+    if (future && !future->completing) {
+        cord_http_async_t *engine = future->engine;
+        curl_multi_remove_handle(engine->multi, future->curl);
+        untrack_future(engine, future);
+        future_recycle(future);
+    }
+}
+
+size_t cord_http_async_in_flight(cord_http_async_t *engine) {
+    size_t count = 0;
+    for (cord_http_future_t *it = engine->pending; it; it = it->next) {
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,118 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include "http.h"
+
+#include <curl/curl.h>
+#include <ev.h>
+#include <stdbool.h>
+
+typedef struct cord_http_future_t cord_http_future_t;
+
+/*
+ * Called from the event loop once a request completes
+ *
+ * result.body is owned by the future and is free'd right after the callback
+ * returns. Copy it if it needs to outlive the callback.
+ */
+typedef void (*cord_http_future_cb)(cord_http_future_t *future,
+                                    cord_http_result_t result,
+                                    void *user_data);
+
+/*
+ * Non-blocking HTTP engine driven by a libev loop
+ *
+ * Requests are added to a curl multi handle whose sockets and timeouts are
+ * watched by the loop that also runs the gateway connection, so a REST call
+ * never stalls heartbeats or incoming frames. Any number of requests can be
+ * in flight at the same time.
+ */
+typedef struct cord_http_async_t {
+    CURLM *multi;
+    struct ev_loop *loop;
+    struct ev_timer timer;
+    cord_http_client_t *client;
+
+    // in-flight requests
+    cord_http_future_t *pending;
+    // completed futures kept around for reuse
+    cord_http_future_t *idle;
+    i32 running;
+} cord_http_async_t;
+
+/*
+ * Handle to an in-flight request
+ *
+ * The handle is owned by the engine and stays valid until the completion
+ * callback returns or until it's cancelled
+ */
+struct cord_http_future_t {
+    CURL *curl;
+    // Form of a multipart request
+    curl_mime *mime;
+    cord_http_async_t *engine;
+    cord_strbuf_t *response;
+    cord_strbuf_t *response_headers;
+    cord_http_result_t result;
+
+    cord_http_future_cb on_complete;
+    void *user_data;
+    // set while on_complete runs
+    bool completing;
+
+    struct cord_http_future_t *prev;
+    struct cord_http_future_t *next;
+};
+
+cord_http_async_t *cord_http_async_create(cord_bump_t *allocator,
+                                          struct ev_loop *loop,
+                                          cord_http_client_t *client);
+void cord_http_async_destroy(cord_http_async_t *engine);
+
+/*
+ * Queue a request and return immediately
+ *
+ * The url and body are copied, so they can be released as soon as the call
+ * returns. Returns NULL if the request could not be queued.
+ */
+cord_http_future_t *cord_http_async_request(cord_http_async_t *engine,
+                                            i32 type,
+                                            cord_str_t url,
+                                            const char *body,
+                                            cord_http_future_cb on_complete,
+                                            void *user_data);
+
+/*
+ * Queue a POST of json as payload_json with the files in a form. Only
+ * the url and json are copied, the files are streamed while the request
+ * is sent, so data in memory has to stay valid until it completes.
+ */
+cord_http_future_t *
+cord_http_async_post_multipart(cord_http_async_t *engine,
+                               cord_str_t url,
+                               const char *json,
+                               const cord_http_file_t *files,
+                               i32 num_files,
+                               cord_http_future_cb on_complete,
+                               void *user_data);
+
+cord_http_future_t *cord_http_async_get(cord_http_async_t *engine,
+                                        cord_str_t url,
+                                        cord_http_future_cb on_complete,
+                                        void *user_data);
+
+cord_http_future_t *cord_http_async_post(cord_http_async_t *engine,
+                                         cord_str_t url,
+                                         const char *body,
+                                         cord_http_future_cb on_complete,
+                                         void *user_data);
+
+/*
+ * Abort an in-flight request. The completion callback is not called.
+ * Cancelling a future from its own completion callback does nothing.
+ */
+void cord_http_future_cancel(cord_http_future_t *future);
+
+size_t cord_http_async_in_flight(cord_http_async_t *engine);
+
+#endif
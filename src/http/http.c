@@ -10,6 +10,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Fits every route of the API without growing
+#define URL_BUILDER_SIZE 256
+
 static bool is_curl_error(CURLcode code) {
     return code != CURLE_OK;
 }
@@ -23,8 +26,9 @@ bool cord_http_is_success(cord_http_result_t result) {
 }
 
 cord_url_builder_t cord_url_builder_create(cord_bump_t *allocator) {
-    return (cord_url_builder_t){.string_builder = cord_strbuf_create(),
-                                .allocator = allocator};
+    return (cord_url_builder_t){
+        .string_builder = cord_strbuf_create_in(allocator, URL_BUILDER_SIZE),
+        .allocator = allocator};
 }
 
 void cord_url_builder_add_route(cord_url_builder_t url_builder,
@@ -42,6 +46,46 @@ cord_str_t cord_url_builder_build(cord_url_builder_t url_builder) {
     return cord_strbuf_to_str(*url_builder.string_builder);
 }
 
+// curl_global_init() is not cheap and must only run once per process
+static i32 curl_global_users = 0;
+
+static void curl_global_acquire(void) {
+    if (curl_global_users++ == 0) {
+        curl_global_init(CURL_GLOBAL_ALL);
+    }
+}
+
+static void curl_global_release(void) {
+    if (curl_global_users > 0 && --curl_global_users == 0) {
+        curl_global_cleanup();
+    }
+}
+
+static CURLSH *create_share(void) {
+    CURLSH *share = curl_share_init();
+    if (!share) {
+        return NULL;
+    }
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    return share;
+}
+
+static struct curl_slist *api_headers(const char *bot_token, bool json) {
+    struct curl_slist *list = NULL;
+    char auth[256] = {0};
+    snprintf(auth, 256, "Authorization: Bot %s", bot_token);
+    list = curl_slist_append(list, auth);
+    list = curl_slist_append(list, "Accept: application/json");
+    list = curl_slist_append(list, "charset: utf-8");
+    if (json) {
+        list = curl_slist_append(list, "Content-Type: application/json");
+    }
+
+    return list;
+}
+
 cord_http_client_t *cord_http_client_create(cord_bump_t *allocator,
                                             const char *bot_token) {
     cord_http_client_t *client = balloc(allocator, sizeof(cord_http_client_t));
@@ -51,34 +95,50 @@ cord_http_client_t *cord_http_client_create(cord_bump_t *allocator,
     }
     client->allocator = cord_bump_create_with_size(KB(1));
     client->last_error = NULL;
+    client->pool.num_idle = 0;
 
     size_t token_buf_size = strlen(bot_token) + 1;
-    client->bot_token = balloc(allocator, token_buf_size);
+    client->bot_token = balloc_uninit(allocator, token_buf_size);
     if (!client->bot_token) {
         logger_error("Failed to allocate bot_token");
-        free(client);
         return NULL;
     }
     memcpy(client->bot_token, bot_token, token_buf_size);
 
-    curl_global_init(CURL_GLOBAL_ALL);
-    client->curl = curl_easy_init();
-    if (!client->curl) {
+    curl_global_acquire();
+    client->share = create_share();
+    client->headers = discord_api_headers(client->bot_token);
+    client->multipart_headers = api_headers(client->bot_token, false);
+    if (!client->share || !client->headers || !client->multipart_headers) {
         logger_error("Failed to init curl");
-        free(client);
-        curl_global_cleanup();
+        cord_http_client_destroy(client);
         return NULL;
     }
-    curl_easy_setopt(client->curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
 
     return client;
 }
 
 void cord_http_client_destroy(cord_http_client_t *client) {
     if (client) {
-        if (client->curl) {
-            curl_easy_cleanup(client->curl);
+        for (i32 i = 0; i < client->pool.num_idle; i++) {
+            curl_easy_cleanup(client->pool.handles[i]);
+        }
+        client->pool.num_idle = 0;
+
+        if (client->share) {
+            curl_share_cleanup(client->share);
+            client->share = NULL;
+        }
+        if (client->headers) {
+            curl_slist_free_all(client->headers);
+            client->headers = NULL;
+        }
+        if (client->multipart_headers) {
+            curl_slist_free_all(client->multipart_headers);
+            client->multipart_headers = NULL;
         }
+        cord_bump_destroy(client->allocator);
+        client->allocator = NULL;
     }
 
     /*
@@ -86,48 +146,251 @@ void cord_http_client_destroy(cord_http_client_t *client) {
      * when permanent allocator is destroyed
      */
 
-    curl_global_cleanup();
+    curl_global_release();
 }
 
 struct curl_slist *discord_api_headers(const char *bot_token) {
-    struct curl_slist *list = NULL;
-    char auth[256] = {0};
-    snprintf(auth, 256, "Authorization: Bot %s", bot_token);
-    list = curl_slist_append(list, auth);
-    list = curl_slist_append(list, "Accept: application/json");
-    list = curl_slist_append(list, "charset: utf-8");
-    list = curl_slist_append(list, "Content-Type: application/json");
+    return api_headers(bot_token, true);
+}
 
-    return list;
+static CURL *create_pooled_handle(cord_http_client_t *client) {
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        return NULL;
+    }
+
+    // Options that never change between requests
+    curl_easy_setopt(curl, CURLOPT_SHARE, client->share);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->headers);
+    curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    return curl;
+}
+
+CURL *cord_http_client_acquire_handle(cord_http_client_t *client) {
+    if (client->pool.num_idle > 0) {
+        return client->pool.handles[--client->pool.num_idle];
+    }
+    return create_pooled_handle(client);
 }
 
-static cord_http_request_t *cord_http_request_create(cord_bump_t *bump,
-                                                     int type,
-                                                     const char *url,
-                                                     const char *body) {
+void cord_http_client_release_handle(cord_http_client_t *client, CURL *curl) {
+    if (!curl) {
+        return;
+    }
+
+    if (client->pool.num_idle == HTTP_HANDLE_POOL_SIZE) {
+        curl_easy_cleanup(curl);
+        return;
+    }
+    // A multipart request leaves its form and headers behind
+    curl_easy_setopt(curl, CURLOPT_MIMEPOST, NULL);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->headers);
+    client->pool.handles[client->pool.num_idle++] = curl;
+}
+
+bool cord_http_prepare_handle(CURL *curl,
+                              i32 type,
+                              cord_str_t url,
+                              const char *body) {
+    char *request_type = cord_http_type_cstring(type);
+    assert(request_type && "Request type can not be null");
+
+    // libcurl copies string options so a stack buffer is enough
+    char cstr_url[HTTP_MAX_URL_LENGTH];
+    if (url.length < 0 || (size_t)url.length >= sizeof(cstr_url)) {
+        logger_error("Url is too long (%ld bytes)", url.length);
+        return false;
+    }
+    memcpy(cstr_url, url.data, url.length);
+    cstr_url[url.length] = '\0';
+
+    // HTTPGET drops the body state left behind by a previous request
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    if (body) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(body));
+        curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, body);
+    }
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request_type);
+    curl_easy_setopt(curl, CURLOPT_URL, cstr_url);
 
-    cord_http_request_t *request = balloc(bump, sizeof(cord_http_request_t));
-    if (!request) {
-        logger_error("Failed to allocate http request");
+    // Handles move between the sync and async paths, drop the header sink
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+    return true;
+}
+
+bool cord_http_prepare_multipart(cord_http_client_t *client,
+                                 CURL *curl,
+                                 cord_str_t url,
+                                 curl_mime *mime) {
+    if (!cord_http_prepare_handle(curl, HTTP_POST, url, NULL)) {
+        return false;
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->multipart_headers);
+    curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
+    return true;
+}
+
+/*
+ * Part data read straight out of the caller's memory, curl_mime_data()
+ * would copy it
+ */
+typedef struct memory_reader_t {
+    const char *data;
+    size_t length;
+    size_t offset;
+} memory_reader_t;
+
+static size_t memory_read_cb(char *buffer,
+                             size_t size,
+                             size_t nitems,
+                             void *arg) {
+    memory_reader_t *reader = arg;
+    size_t length = min(size * nitems, reader->length - reader->offset);
+    memcpy(buffer, reader->data + reader->offset, length);
+    reader->offset += length;
+    return length;
+}
+
+// curl rewinds parts when it has to send the form again
+static i32 memory_seek_cb(void *arg, curl_off_t offset, i32 origin) {
+    memory_reader_t *reader = arg;
+    if (origin != SEEK_SET || offset < 0 || (size_t)offset > reader->length) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    reader->offset = (size_t)offset;
+    return CURL_SEEKFUNC_OK;
+}
+
+static bool add_file(curl_mime *mime, const cord_http_file_t *file, i32 index) {
+    char name[32];
+    snprintf(name, sizeof(name), "files[%d]", index);
+
+    curl_mimepart *part = curl_mime_addpart(mime);
+    if (!part || curl_mime_name(part, name) != CURLE_OK ||
+        curl_mime_filename(part, file->filename) != CURLE_OK) {
+        return false;
+    }
+    if (file->content_type &&
+        curl_mime_type(part, file->content_type) != CURLE_OK) {
+        return false;
+    }
+
+    // Read from disk as the request is sent
+    if (file->path) {
+        CURLcode rc = curl_mime_filedata(part, file->path);
+        if (rc != CURLE_OK) {
+            logger_error("Could not attach %s: %s", file->path, curl_error(rc));
+            return false;
+        }
+        // filedata names the part after the path, the given name wins
+        return curl_mime_filename(part, file->filename) == CURLE_OK;
+    }
+
+    memory_reader_t *reader = malloc(sizeof(memory_reader_t));
+    if (!reader) {
+        return false;
+    }
+    *reader = (memory_reader_t){file->data, file->length, 0};
+    CURLcode rc = curl_mime_data_cb(part,
+                                    (curl_off_t)file->length,
+                                    memory_read_cb,
+                                    memory_seek_cb,
+                                    free,
+                                    reader);
+    if (rc != CURLE_OK) {
+        free(reader);
+        return false;
+    }
+    return true;
+}
+
+curl_mime *cord_http_multipart_create(CURL *curl,
+                                      const char *json,
+                                      const cord_http_file_t *files,
+                                      i32 num_files) {
+    curl_mime *mime = curl_mime_init(curl);
+    if (!mime) {
+        logger_error("Failed to create multipart form");
+        return NULL;
+    }
+
+    curl_mimepart *payload = curl_mime_addpart(mime);
+    bool ok = payload &&
+              curl_mime_name(payload, "payload_json") == CURLE_OK &&
+              curl_mime_data(payload, json, CURL_ZERO_TERMINATED) ==
+                  CURLE_OK &&
+              curl_mime_type(payload, "application/json") == CURLE_OK;
+    for (i32 i = 0; ok && i < num_files; i++) {
+        ok = add_file(mime, &files[i], i);
+    }
+
+    if (!ok) {
+        logger_error("Failed to create multipart form");
+        curl_mime_free(mime);
         return NULL;
     }
+    return mime;
+}
+
+static bool is_header_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+cord_str_t cord_http_header_value(cord_str_t headers, cord_str_t name) {
+    ssize_t line_start = 0;
+    while (line_start < headers.length) {
+        ssize_t line_end = line_start;
+        while (line_end < headers.length && headers.data[line_end] != '\n') {
+            line_end++;
+        }
 
-    request->url = url;
-    request->header = NULL;
-    request->type = type;
-    request->body = body;
-    request->result =
-        (cord_http_result_t){.body = NULL, .status = 0, .error = false};
+        cord_str_t line = cord_str_substring(headers, line_start, line_end);
+        bool has_name = line.length > name.length &&
+                        line.data[name.length] == ':' &&
+                        cord_str_equals_ignore_case(
+                            cord_str_substring(line, 0, name.length), name);
+        if (has_name) {
+            ssize_t begin = name.length + 1;
+            ssize_t end = line.length;
+            while (begin < end && is_header_space(line.data[begin])) {
+                begin++;
+            }
+            while (end > begin && is_header_space(line.data[end - 1])) {
+                end--;
+            }
+            return cord_str_substring(line, begin, end);
+        }
+        line_start = line_end + 1;
+    }
+    return (cord_str_t){.data = "", .length = 0};
+}
 
-    return request;
+static cord_http_request_t cord_http_request_create(int type,
+                                                    cord_str_t url,
+                                                    const char *body) {
+    return (cord_http_request_t){
+        .url = url,
+        .header = NULL,
+        .type = type,
+        .body = body,
+        .files = NULL,
+        .num_files = 0,
+        .result = {.body = NULL,
+                   .length = 0,
+                   .headers = {NULL, 0},
+                   .status = 0,
+                   .error = false}};
 }
 
-static char *get_request_type_cstring(cord_http_request_t *request) {
+char *cord_http_type_cstring(i32 type) {
     static char *GET = "GET";
     static char *POST = "POST";
     static char *DELETE = "DELETE";
     static char *PATCH = "PATCH";
-    switch (request->type) {
+    switch (type) {
         case HTTP_GET:
             return GET;
         case HTTP_POST:
@@ -145,68 +408,85 @@ static size_t write_cb(void *data, size_t size, size_t nmemb, void *udata) {
     cord_http_result_t *result = udata;
     assert(result);
 
-    size_t string_size = nmemb * size;
-    result->body = calloc(1, string_size + 1);
-    memcpy(result->body, data, string_size);
-    return size * nmemb;
+    // The body can arrive in several chunks
+    size_t chunk_size = nmemb * size;
+    char *body = realloc(result->body, result->length + chunk_size + 1);
+    if (!body) {
+        return 0;
+    }
+    memcpy(body + result->length, data, chunk_size);
+    result->length += chunk_size;
+    body[result->length] = '\0';
+    result->body = body;
+    return chunk_size;
 }
 
-static void prepare_request_with_headers(cord_http_client_t *client,
-                                         cord_http_request_t *request,
-                                         struct curl_slist *headers) {
-
-    char *request_type = get_request_type_cstring(request);
-    assert(request_type && "Request type can not be null");
+// The form of a multipart request is freed once it has been sent
+static bool prepare_request(cord_http_client_t *client,
+                            CURL *curl,
+                            cord_http_request_t *request,
+                            curl_mime **mime) {
+    if (!request->files) {
+        return cord_http_prepare_handle(
+            curl, request->type, request->url, request->body);
+    }
 
-    request->header = headers;
-    curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, request_type);
-    curl_easy_setopt(client->curl, CURLOPT_URL, request->url);
-    curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, request->header);
+    *mime = cord_http_multipart_create(
+        curl, request->body, request->files, request->num_files);
+    return *mime &&
+           cord_http_prepare_multipart(client, curl, request->url, *mime);
+}
 
-    assert(&request->result.body != NULL);
-    curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_cb);
-    curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, &request->result);
+static cord_http_result_t perform(cord_http_client_t *client,
+                                  cord_http_request_t *request) {
+    CURL *curl = cord_http_client_acquire_handle(client);
+    if (!curl) {
+        logger_error("Failed to acquire curl handle");
+        request->result.error = true;
+        return request->result;
+    }
 
-    if (request->type == HTTP_POST) {
-        curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, request->body);
+    curl_mime *mime = NULL;
+    if (!prepare_request(client, curl, request, &mime)) {
+        curl_mime_free(mime);
+        cord_http_client_release_handle(client, curl);
+        request->result.error = true;
+        return request->result;
     }
-}
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &request->result);
 
-static cord_http_result_t perform_with_headers(cord_http_client_t *client,
-                                               cord_http_request_t *request,
-                                               struct curl_slist *headers) {
-    prepare_request_with_headers(client, request, headers);
-    CURLcode rc = curl_easy_perform(client->curl);
-    long *status = (long *)&request->result.status;
-    curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, status);
+    CURLcode rc = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    request->result.status = (i32)status;
     if (request->result.status != HTTP_OK) {
         request->result.error = true;
     }
 
     if (is_curl_error(rc)) {
-        logger_error("Could not perform HTTP %s request: %s", curl_error(rc));
+        logger_error("Could not perform HTTP %s request: %s",
+                     cord_http_type_cstring(request->type),
+                     curl_error(rc));
     }
-    return request->result;
-}
 
-static cord_http_result_t perform(cord_http_client_t *client,
-                                  cord_http_request_t *request) {
-    curl_easy_reset(client->curl);
-    struct curl_slist *headers = discord_api_headers(client->bot_token);
-    return perform_with_headers(client, request, headers);
+    cord_http_client_release_handle(client, curl);
+    curl_mime_free(mime);
+    return request->result;
 }
 
 cord_http_result_t cord_http_get(cord_http_client_t *client,
                                  cord_bump_t *allocator,
                                  cord_str_t url) {
-    char *cstr_url = calloc(1, url.length + 1);
-    memcpy(cstr_url, url.data, url.length);
-    cord_http_result_t result = perform(
-        client, cord_http_request_create(allocator, HTTP_GET, cstr_url, NULL));
-    free(cstr_url);
+    (void)allocator;
+    cord_http_request_t request = cord_http_request_create(HTTP_GET, url, NULL);
+    cord_http_result_t result = perform(client, &request);
 
     if (result.error) {
-        logger_error("GET %s responded with status %d", url, result.status);
+        logger_error("GET %.*s responded with status %d",
+                     (int)url.length,
+                     url.data,
+                     result.status);
     }
 
     return result;
@@ -216,33 +496,33 @@ cord_http_result_t cord_http_post(cord_http_client_t *client,
                                   cord_bump_t *allocator,
                                   cord_str_t url,
                                   const char *body) {
-    char *cstr_url = calloc(1, url.length + 1);
-    memcpy(cstr_url, url.data, url.length);
-    cord_http_result_t result = perform(
-        client, cord_http_request_create(allocator, HTTP_POST, cstr_url, body));
-    free(cstr_url);
-    return result;
+    (void)allocator;
+    cord_http_request_t request =
+        cord_http_request_create(HTTP_POST, url, body);
+    return perform(client, &request);
+}
+
+cord_http_result_t cord_http_post_multipart(cord_http_client_t *client,
+                                            cord_str_t url,
+                                            const char *json,
+                                            const cord_http_file_t *files,
+                                            i32 num_files) {
+    cord_http_request_t request =
+        cord_http_request_create(HTTP_POST, url, json);
+    request.files = files;
+    request.num_files = num_files;
+    return perform(client, &request);
 }
 
 cord_http_result_t cord_http_delete(cord_http_client_t *client,
                                     cord_str_t url) {
-    char *cstr_url = calloc(1, url.length + 1);
-    memcpy(cstr_url, url.data, url.length);
-    cord_http_result_t result =
-        perform(client,
-                cord_http_request_create(
-                    client->allocator, HTTP_DELETE, cstr_url, NULL));
-    free(cstr_url);
-    return result;
+    cord_http_request_t request =
+        cord_http_request_create(HTTP_DELETE, url, NULL);
+    return perform(client, &request);
 }
 
 cord_http_result_t cord_http_patch(cord_http_client_t *client, cord_str_t url) {
-    char *cstr_url = calloc(1, url.length + 1);
-    memcpy(cstr_url, url.data, url.length);
-    cord_http_result_t result =
-        perform(client,
-                cord_http_request_create(
-                    client->allocator, HTTP_PATCH, cstr_url, NULL));
-    free(cstr_url);
-    return result;
+    cord_http_request_t request =
+        cord_http_request_create(HTTP_PATCH, url, NULL);
+    return perform(client, &request);
 }
@@ -7,10 +7,36 @@
 #include "../core/memory.h"
 #include "../core/strings.h"
 
-typedef enum http_code_t { HTTP_OK = 200 } http_code_t;
-
+typedef enum http_code_t {
+    HTTP_OK = 200,
+    HTTP_TOO_MANY_REQUESTS = 429
+} http_code_t;
+
+#define HTTP_HANDLE_POOL_SIZE 32
+#define HTTP_MAX_URL_LENGTH 2048
+
+/*
+ * Stack of idle, pre-configured curl easy handles
+ *
+ * Handles keep their options between requests, so a hot call only sets the
+ * url, method and body. Released handles keep their connections warm.
+ */
+typedef struct cord_http_pool_t {
+    CURL *handles[HTTP_HANDLE_POOL_SIZE];
+    i32 num_idle;
+} cord_http_pool_t;
+
+/*
+ * Every handle created by the client shares DNS, TLS sessions and
+ * connections through share and uses the same immutable header list.
+ * The client is meant to be used from a single thread.
+ */
 typedef struct cord_http_client_t {
-    CURL *curl;
+    CURLSH *share;
+    struct curl_slist *headers;
+    // Same without the json content type, which curl sets for forms
+    struct curl_slist *multipart_headers;
+    cord_http_pool_t pool;
     char *last_error;
     char *bot_token;
     cord_bump_t *allocator;
@@ -23,6 +49,7 @@ typedef struct cord_url_builder_t {
     cord_bump_t *allocator;
 } cord_url_builder_t;
 
+// The url lives in allocator and is released with it
 cord_url_builder_t cord_url_builder_create(cord_bump_t *allocator);
 void cord_url_builder_add_route(cord_url_builder_t url_builder,
                                 cord_str_t route);
@@ -30,15 +57,35 @@ cord_str_t cord_url_builder_build(cord_url_builder_t url_builder);
 
 typedef struct cord_http_result_t {
     char *body;
+    size_t length;
+    // raw response header block, only filled for async requests
+    cord_str_t headers;
     i32 status;
     bool error;
 } cord_http_result_t;
 
+/*
+ * File sent with a multipart request, read from path on disk or from data
+ * in memory while the request is sent. Neither is copied or read into
+ * memory up front, so data has to stay valid until the request completes.
+ */
+typedef struct cord_http_file_t {
+    const char *filename;
+    // NULL to let curl go by the extension of filename
+    const char *content_type;
+    const char *path;
+    const char *data;
+    size_t length;
+} cord_http_file_t;
+
 typedef struct cord_http_request_t {
     i32 type;
     struct curl_slist *header;
     const char *body;
-    const char *url;
+    // Sent as a form with body as payload_json when set
+    const cord_http_file_t *files;
+    i32 num_files;
+    cord_str_t url;
     cord_http_result_t result;
 } cord_http_request_t;
 
@@ -58,8 +105,61 @@ cord_http_result_t cord_http_post(cord_http_client_t *client,
                                   cord_str_t url,
                                   const char *body);
 
+/*
+ * POST json as the payload_json part of a form, followed by the files as
+ * files[0], files[1] and so on
+ */
+cord_http_result_t cord_http_post_multipart(cord_http_client_t *client,
+                                            cord_str_t url,
+                                            const char *json,
+                                            const cord_http_file_t *files,
+                                            i32 num_files);
+
 cord_http_result_t cord_http_delete(cord_http_client_t *client, cord_str_t url);
 
 bool cord_http_is_success(cord_http_result_t result);
 
+struct curl_slist *discord_api_headers(const char *bot_token);
+char *cord_http_type_cstring(i32 type);
+
+/*
+ * Returns the trimmed value of a header in a raw header block or an empty
+ * string when the header is not present. Header names are case insensitive.
+ */
+cord_str_t cord_http_header_value(cord_str_t headers, cord_str_t name);
+
+/*
+ * Take a warm easy handle from the client's pool, creating one if the pool
+ * is empty. Handles must be given back with cord_http_client_release_handle()
+ */
+CURL *cord_http_client_acquire_handle(cord_http_client_t *client);
+void cord_http_client_release_handle(cord_http_client_t *client, CURL *curl);
+
+/*
+ * Set the per-request options (method, url, body) on a pooled handle
+ */
+bool cord_http_prepare_handle(CURL *curl,
+                              i32 type,
+                              cord_str_t url,
+                              const char *body);
+
+/*
+ * Form with json as payload_json and the files for curl to send, to be
+ * freed with curl_mime_free() once it's done with it. Only json is copied,
+ * the files are streamed from where they are.
+ */
+curl_mime *cord_http_multipart_create(CURL *curl,
+                                      const char *json,
+                                      const cord_http_file_t *files,
+                                      i32 num_files);
+
+/*
+ * Set up a pooled handle to POST mime. Releasing the handle puts back the
+ * options of a json request.
+ */
+bool cord_http_prepare_multipart(cord_http_client_t *client,
+                                 CURL *curl,
+                                 cord_str_t url,
+                                 curl_mime *mime);
+
 #endif
@@ -0,0 +1,742 @@
+#include "ratelimit.h"
+#include "../core/log.h"
+#include "async.h"
+#include "http.h"
+
+#include <assert.h>
+#include <ev.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// Used when a 429 comes without any hint of how long to wait
+#define RATELIMIT_DEFAULT_RETRY_AFTER 1.0
+
+static u64 fnv1a(u64 hash, cord_str_t string) {
+    for (ssize_t i = 0; i < string.length; i++) {
+        hash ^= (u8)string.data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static bool is_snowflake(cord_str_t segment) {
+    if (segment.length == 0) {
+        return false;
+    }
+    for (ssize_t i = 0; i < segment.length; i++) {
+        if (segment.data[i] < '0' || segment.data[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_major_resource(cord_str_t segment) {
+    return cord_str_equals_cstring(segment, "channels") ||
+           cord_str_equals_cstring(segment, "guilds") ||
+           cord_str_equals_cstring(segment, "webhooks");
+}
+
+static bool is_api_prefix(cord_str_t segment, i32 index) {
+    if (index == 0) {
+        return cord_str_equals_cstring(segment, "api");
+    }
+    return index == 1 && segment.length > 1 && segment.data[0] == 'v' &&
+           is_snowflake(cord_str_substring(segment, 1, segment.length));
+}
+
+static cord_str_t url_path(cord_str_t url) {
+    ssize_t begin = 0;
+    for (ssize_t i = 0; i + 2 < url.length; i++) {
+        if (memcmp(url.data + i, "://", 3) == 0) {
+            begin = i + 3;
+            while (begin < url.length && url.data[begin] != '/') {
+                begin++;
+            }
+            break;
+        }
+    }
+
+    ssize_t end = begin;
+    while (end < url.length && url.data[end] != '?') {
+        end++;
+    }
+    return cord_str_substring(url, begin, end);
+}
+
+static cord_str_t next_segment(cord_str_t *path) {
+    ssize_t begin = 0;
+    while (begin < path->length && path->data[begin] == '/') {
+        begin++;
+    }
+    ssize_t end = begin;
+    while (end < path->length && path->data[end] != '/') {
+        end++;
+    }
+
+    cord_str_t segment = cord_str_substring(*path, begin, end);
+    *path = cord_str_substring(*path, end, path->length);
+    return segment;
+}
+
+u64 cord_ratelimit_route_key(i32 type, cord_str_t url, u64 *major) {
+    u64 route = fnv1a(FNV_OFFSET_BASIS, cstr(cord_http_type_cstring(type)));
+    u64 major_key = FNV_OFFSET_BASIS;
+
+    cord_str_t path = url_path(url);
+    cord_str_t previous = {"", 0};
+    i32 index = 0;
+    i32 resource_index = 0;
+    bool webhook = false;
+
+    for (;;) {
+        cord_str_t segment = next_segment(&path);
+        if (segment.length == 0) {
+            break;
+        }
+        if (is_api_prefix(segment, index++)) {
+            continue;
+        }
+
+        // channels/{id}, guilds/{id} and webhooks/{id}/{token} are major
+        bool major_param =
+            (resource_index == 1 && is_major_resource(previous) &&
+             is_snowflake(segment)) ||
+            (resource_index == 2 && webhook);
+        if (resource_index == 0) {
+            webhook = cord_str_equals_cstring(segment, "webhooks");
+        }
+
+        cord_str_t placeholder = segment;
+        if (major_param) {
+            major_key = fnv1a(fnv1a(major_key, segment), cstr("/"));
+            placeholder = cstr(":major");
+        } else if (cord_str_equals_cstring(previous, "reactions")) {
+            placeholder = cstr(":emoji");
+        } else if (is_snowflake(segment)) {
+            placeholder = cstr(":id");
+        }
+
+        route = fnv1a(fnv1a(route, cstr("/")), placeholder);
+        previous = segment;
+        resource_index++;
+    }
+
+    *major = major_key;
+    return route;
+}
+
+static f64 parse_number(cord_str_t value) {
+    char buffer[32] = {0};
+    if (value.length == 0 || value.length >= (ssize_t)sizeof(buffer)) {
+        return 0.0;
+    }
+    memcpy(buffer, value.data, value.length);
+    return strtod(buffer, NULL);
+}
+
+cord_ratelimit_headers_t cord_ratelimit_parse_headers(cord_str_t headers) {
+    cord_ratelimit_headers_t parsed = {0};
+
+    cord_str_t limit =
+        cord_http_header_value(headers, cstr("X-RateLimit-Limit"));
+    if (limit.length > 0) {
+        parsed.present = true;
+        parsed.limit = (i32)parse_number(limit);
+        parsed.remaining = (i32)parse_number(cord_http_header_value(
+            headers, cstr("X-RateLimit-Remaining")));
+        parsed.reset_after = parse_number(cord_http_header_value(
+            headers, cstr("X-RateLimit-Reset-After")));
+    }
+
+    parsed.bucket =
+        cord_http_header_value(headers, cstr("X-RateLimit-Bucket"));
+    parsed.retry_after =
+        parse_number(cord_http_header_value(headers, cstr("Retry-After")));
+
+    cord_str_t global =
+        cord_http_header_value(headers, cstr("X-RateLimit-Global"));
+    cord_str_t scope =
+        cord_http_header_value(headers, cstr("X-RateLimit-Scope"));
+    parsed.global = cord_str_equals_ignore_case(global, cstr("true")) ||
+                    cord_str_equals_ignore_case(scope, cstr("global"));
+    parsed.shared = cord_str_equals_ignore_case(scope, cstr("shared"));
+    return parsed;
+}
+
+static void bucket_push_back(cord_ratelimit_bucket_t *bucket,
+                             cord_ratelimit_request_t *request) {
+    request->bucket = bucket;
+    request->prev = NULL;
+    request->next = NULL;
+    if (bucket->tail) {
+        bucket->tail->next = request;
+    } else {
+        bucket->head = request;
+    }
+    bucket->tail = request;
+}
+
+static void bucket_push_front(cord_ratelimit_bucket_t *bucket,
+                              cord_ratelimit_request_t *request) {
+    request->bucket = bucket;
+    request->prev = NULL;
+    request->next = bucket->head;
+    bucket->head = request;
+    if (!bucket->tail) {
+        bucket->tail = request;
+    }
+}
+
+static cord_ratelimit_request_t *bucket_pop(cord_ratelimit_bucket_t *bucket) {
+    cord_ratelimit_request_t *request = bucket->head;
+    if (request) {
+        bucket->head = request->next;
+        if (!bucket->head) {
+            bucket->tail = NULL;
+        }
+        request->next = NULL;
+    }
+    return request;
+}
+
+static void track_in_flight(cord_ratelimit_t *limiter,
+                            cord_ratelimit_request_t *request) {
+    request->prev = NULL;
+    request->next = limiter->in_flight;
+    if (limiter->in_flight) {
+        limiter->in_flight->prev = request;
+    }
+    limiter->in_flight = request;
+}
+
+static void untrack_in_flight(cord_ratelimit_t *limiter,
+                              cord_ratelimit_request_t *request) {
+    if (request->prev) {
+        request->prev->next = request->next;
+    } else {
+        limiter->in_flight = request->next;
+    }
+    if (request->next) {
+        request->next->prev = request->prev;
+    }
+    request->prev = NULL;
+    request->next = NULL;
+}
+
+static void request_destroy(cord_ratelimit_request_t *request) {
+    if (request) {
+        for (i32 i = 0; i < request->num_files; i++) {
+            free((char *)request->files[i].filename);
+            free((char *)request->files[i].content_type);
+            free((char *)request->files[i].path);
+        }
+        free(request->files);
+        free(request->url);
+        free(request->body);
+        free(request);
+    }
+}
+
+static void finish_request(cord_ratelimit_request_t *request,
+                           cord_http_result_t result) {
+    if (request->on_complete) {
+        request->on_complete(result, request->user_data);
+    }
+    request_destroy(request);
+}
+
+static cord_ratelimit_bucket_t *create_bucket(cord_ratelimit_t *limiter,
+                                              u64 key) {
+    cord_ratelimit_bucket_t *bucket =
+        balloc(limiter->allocator, sizeof(cord_ratelimit_bucket_t));
+    cord_ratelimit_bucket_t **slot = cord_array_push(limiter->buckets);
+    if (!bucket || !slot) {
+        logger_error("Failed to allocate rate limit bucket");
+        return NULL;
+    }
+    *bucket = (cord_ratelimit_bucket_t){.key = key};
+    *slot = bucket;
+    return bucket;
+}
+
+static cord_ratelimit_route_t *find_route(cord_ratelimit_t *limiter,
+                                          u64 route,
+                                          u64 major) {
+    cord_ratelimit_route_t *routes = (void *)limiter->routes->data;
+    for (size_t i = 0; i < limiter->routes->num_elements; i++) {
+        if (routes[i].route == route && routes[i].major == major) {
+            return &routes[i];
+        }
+    }
+    return NULL;
+}
+
+static cord_ratelimit_bucket_t *find_hashed_bucket(cord_ratelimit_t *limiter,
+                                                   u64 key) {
+    cord_ratelimit_bucket_t **buckets = (void *)limiter->buckets->data;
+    for (size_t i = 0; i < limiter->buckets->num_elements; i++) {
+        if (buckets[i]->hashed && buckets[i]->key == key) {
+            return buckets[i];
+        }
+    }
+    return NULL;
+}
+
+static cord_ratelimit_bucket_t *route_bucket(cord_ratelimit_t *limiter,
+                                             u64 route,
+                                             u64 major) {
+    cord_ratelimit_route_t *entry = find_route(limiter, route, major);
+    if (entry) {
+        return entry->bucket;
+    }
+
+    entry = cord_array_push(limiter->routes);
+    if (!entry) {
+        logger_error("Failed to allocate rate limit route");
+        return NULL;
+    }
+    entry->route = route;
+    entry->major = major;
+    entry->bucket = create_bucket(limiter, route ^ major);
+    return entry->bucket;
+}
+
+/*
+ * Routes that report the same bucket hash (for the same major parameter)
+ * share their limits, so the route is moved over to the existing bucket
+ */
+static void bind_bucket_hash(cord_ratelimit_t *limiter,
+                             cord_ratelimit_request_t *request,
+                             cord_str_t hash) {
+    cord_str_t major = {(char *)&request->major, sizeof(u64)};
+    u64 key = fnv1a(fnv1a(FNV_OFFSET_BASIS, hash), major);
+
+    cord_ratelimit_bucket_t *current = request->bucket;
+    if (current->hashed && current->key == key) {
+        return;
+    }
+
+    cord_ratelimit_bucket_t *existing = find_hashed_bucket(limiter, key);
+    if (!existing) {
+        current->key = key;
+        current->hashed = true;
+        return;
+    }
+
+    cord_ratelimit_route_t *entry =
+        find_route(limiter, request->route, request->major);
+    if (entry) {
+        entry->bucket = existing;
+    }
+    request->bucket = existing;
+
+    // Queued requests of the route follow it to the shared bucket
+    cord_ratelimit_request_t *queued = current->head;
+    current->head = NULL;
+    current->tail = NULL;
+    while (queued) {
+        cord_ratelimit_request_t *next = queued->next;
+        bool same_route = queued->route == request->route &&
+                          queued->major == request->major;
+        bucket_push_back(same_route ? existing : current, queued);
+        queued = next;
+    }
+}
+
+static void schedule_wakeup(cord_ratelimit_t *limiter, f64 at) {
+    if (limiter->next_wakeup > 0 && limiter->next_wakeup <= at) {
+        return;
+    }
+    limiter->next_wakeup = at;
+    limiter->env.schedule(limiter->env.ctx, at);
+}
+
+static bool global_allows(cord_ratelimit_t *limiter, f64 now, f64 *wait) {
+    if (now < limiter->global_reset_at) {
+        *wait = limiter->global_reset_at;
+        return false;
+    }
+
+    // The oldest of the last N sends has to be at least a second old
+    f64 oldest = limiter->global_sends[limiter->global_cursor];
+    if (now - oldest < 1.0) {
+        *wait = oldest + 1.0;
+        return false;
+    }
+    return true;
+}
+
+static bool bucket_allows(cord_ratelimit_bucket_t *bucket, f64 now, f64 *wait) {
+    if (bucket->reset_at > 0) {
+        if (now >= bucket->reset_at) {
+            bucket->remaining = bucket->limit;
+            bucket->reset_at = 0;
+        } else if (bucket->remaining <= 0) {
+            *wait = bucket->reset_at;
+            return false;
+        }
+    }
+
+    // Completions of in-flight requests drain the bucket again
+    if (!bucket->known) {
+        return bucket->in_flight == 0;
+    }
+    return bucket->remaining > 0 || bucket->in_flight == 0;
+}
+
+static void drain_bucket(cord_ratelimit_t *limiter,
+                         cord_ratelimit_bucket_t *bucket) {
+    cord_ratelimit_env_t *env = &limiter->env;
+    f64 now = env->now(env->ctx);
+
+    while (bucket->head) {
+        f64 wait = 0;
+        if (!global_allows(limiter, now, &wait) ||
+            !bucket_allows(bucket, now, &wait)) {
+            if (wait > 0) {
+                schedule_wakeup(limiter, wait);
+            }
+            return;
+        }
+
+        cord_ratelimit_request_t *request = bucket_pop(bucket);
+        bucket->in_flight++;
+        bucket->remaining--;
+        limiter->global_sends[limiter->global_cursor] = now;
+        limiter->global_cursor =
+            (limiter->global_cursor + 1) % RATELIMIT_GLOBAL_REQUESTS_PER_SECOND;
+        limiter->num_sent++;
+
+        track_in_flight(limiter, request);
+        if (!env->send(env->ctx, request)) {
+            logger_error("Failed to send rate limited request to %s",
+                         request->url);
+            untrack_in_flight(limiter, request);
+            bucket->in_flight--;
+            finish_request(request, (cord_http_result_t){.error = true});
+        }
+    }
+}
+
+static void apply_headers(cord_ratelimit_bucket_t *bucket,
+                          cord_ratelimit_headers_t headers,
+                          f64 now) {
+    bucket->known = true;
+    bucket->limit = headers.limit;
+
+    // Requests still in flight were not counted by the server yet
+    i32 remaining = headers.remaining - bucket->in_flight;
+    bucket->remaining = remaining > 0 ? remaining : 0;
+    bucket->reset_at = now + headers.reset_after;
+}
+
+cord_ratelimit_t *cord_ratelimit_create(cord_bump_t *allocator,
+                                        cord_ratelimit_env_t env) {
+    assert(env.now && env.schedule && env.send);
+
+    cord_ratelimit_t *limiter = balloc(allocator, sizeof(cord_ratelimit_t));
+    if (!limiter) {
+        logger_error("Failed to allocate rate limiter");
+        return NULL;
+    }
+
+    *limiter = (cord_ratelimit_t){
+        .allocator = allocator,
+        .routes = cord_array_create(allocator, sizeof(cord_ratelimit_route_t)),
+        .buckets =
+            cord_array_create(allocator, sizeof(cord_ratelimit_bucket_t *)),
+        .env = env,
+    };
+    if (!limiter->routes || !limiter->buckets) {
+        logger_error("Failed to allocate rate limiter routes");
+        return NULL;
+    }
+
+    // Start with a window that is already over
+    for (i32 i = 0; i < RATELIMIT_GLOBAL_REQUESTS_PER_SECOND; i++) {
+        limiter->global_sends[i] = -1.0;
+    }
+    return limiter;
+}
+
+void cord_ratelimit_destroy(cord_ratelimit_t *limiter) {
+    if (limiter) {
+        limiter->env.schedule(limiter->env.ctx, 0);
+        // Callbacks of the failed requests can't queue new ones from here on
+        limiter->closed = true;
+
+        cord_http_result_t failed = {.error = true};
+        cord_ratelimit_bucket_t **buckets = (void *)limiter->buckets->data;
+        for (size_t i = 0; i < limiter->buckets->num_elements; i++) {
+            cord_ratelimit_request_t *request = NULL;
+            while ((request = bucket_pop(buckets[i]))) {
+                finish_request(request, failed);
+            }
+        }
+        while (limiter->in_flight) {
+            cord_ratelimit_request_t *request = limiter->in_flight;
+            untrack_in_flight(limiter, request);
+            finish_request(request, failed);
+        }
+    }
+}
+
+static cord_ratelimit_request_t *request_create(cord_ratelimit_t *limiter,
+                                                i32 type,
+                                                cord_str_t url,
+                                                const char *body,
+                                                cord_ratelimit_cb on_complete,
+                                                void *user_data) {
+    cord_ratelimit_request_t *request =
+        calloc(1, sizeof(cord_ratelimit_request_t));
+    if (!request) {
+        logger_error("Failed to allocate rate limited request");
+        return NULL;
+    }
+
+    request->type = type;
+    request->url = strndup(url.data, url.length);
+    request->body = body ? strdup(body) : NULL;
+    request->on_complete = on_complete;
+    request->user_data = user_data;
+    request->limiter = limiter;
+    request->route = cord_ratelimit_route_key(type, url, &request->major);
+    return request;
+}
+
+static char *copy_cstring(const char *string, bool *ok) {
+    char *copy = string ? strdup(string) : NULL;
+    *ok = *ok && (!string || copy);
+    return copy;
+}
+
+static bool copy_files(cord_ratelimit_request_t *request,
+                       const cord_http_file_t *files,
+                       i32 num_files) {
+    request->files = calloc((size_t)num_files, sizeof(cord_http_file_t));
+    if (!request->files) {
+        return false;
+    }
+    request->num_files = num_files;
+
+    bool ok = true;
+    for (i32 i = 0; i < num_files; i++) {
+        request->files[i] = (cord_http_file_t){
+            .filename = copy_cstring(files[i].filename, &ok),
+            .content_type = copy_cstring(files[i].content_type, &ok),
+            .path = copy_cstring(files[i].path, &ok),
+            .data = files[i].data,
+            .length = files[i].length,
+        };
+    }
+    return ok;
+}
+
+static bool queue_request(cord_ratelimit_t *limiter,
+                          cord_ratelimit_request_t *request,
+                          bool copied) {
+    if (limiter->closed) {
+        logger_error("Rate limiter is shutting down");
+        request_destroy(request);
+        return false;
+    }
+
+    cord_ratelimit_bucket_t *bucket =
+        route_bucket(limiter, request->route, request->major);
+    if (!copied || !request->url || !bucket) {
+        logger_error("Failed to queue rate limited request");
+        request_destroy(request);
+        return false;
+    }
+
+    bucket_push_back(bucket, request);
+    drain_bucket(limiter, bucket);
+    return true;
+}
+
+bool cord_ratelimit_submit(cord_ratelimit_t *limiter,
+                           i32 type,
+                           cord_str_t url,
+                           const char *body,
+                           cord_ratelimit_cb on_complete,
+                           void *user_data) {
+    cord_ratelimit_request_t *request =
+        request_create(limiter, type, url, body, on_complete, user_data);
+    if (!request) {
+        return false;
+    }
+    return queue_request(limiter, request, !body || request->body);
+}
+
+bool cord_ratelimit_submit_multipart(cord_ratelimit_t *limiter,
+                                     cord_str_t url,
+                                     const char *json,
+                                     const cord_http_file_t *files,
+                                     i32 num_files,
+                                     cord_ratelimit_cb on_complete,
+                                     void *user_data) {
+    cord_ratelimit_request_t *request =
+        request_create(limiter, HTTP_POST, url, json, on_complete, user_data);
+    if (!request) {
+        return false;
+    }
+
+    bool copied = request->body &&
+                  (num_files == 0 || copy_files(request, files, num_files));
+    return queue_request(limiter, request, copied);
+}
+
+void cord_ratelimit_complete(cord_ratelimit_t *limiter,
+                             cord_ratelimit_request_t *request,
+                             cord_http_result_t result) {
+    untrack_in_flight(limiter, request);
+    request->bucket->in_flight--;
+
+    f64 now = limiter->env.now(limiter->env.ctx);
+    cord_ratelimit_headers_t headers =
+        cord_ratelimit_parse_headers(result.headers);
+    if (headers.bucket.length > 0) {
+        bind_bucket_hash(limiter, request, headers.bucket);
+    }
+
+    cord_ratelimit_bucket_t *bucket = request->bucket;
+    if (headers.present) {
+        apply_headers(bucket, headers, now);
+    }
+
+    if (result.status == HTTP_TOO_MANY_REQUESTS) {
+        limiter->num_rate_limited++;
+
+        f64 retry_after = headers.retry_after > 0 ? headers.retry_after
+                                                  : headers.reset_after;
+        if (retry_after <= 0) {
+            retry_after = RATELIMIT_DEFAULT_RETRY_AFTER;
+        }
+
+        logger_warn("Rate limited (%s) on %s, retrying in %.3fs",
+                    headers.global ? "global"
+                                   : (headers.shared ? "shared" : "bucket"),
+                    request->url,
+                    retry_after);
+
+        if (headers.global) {
+            limiter->global_reset_at = now + retry_after;
+        } else {
+            bucket->remaining = 0;
+            if (bucket->reset_at < now + retry_after) {
+                bucket->reset_at = now + retry_after;
+            }
+        }
+
+        bucket_push_front(bucket, request);
+        drain_bucket(limiter, bucket);
+        return;
+    }
+
+    finish_request(request, result);
+    drain_bucket(limiter, bucket);
+}
+
+void cord_ratelimit_wakeup(cord_ratelimit_t *limiter) {
+    limiter->next_wakeup = 0;
+
+    for (size_t i = 0; i < limiter->buckets->num_elements; i++) {
+        // Callbacks of failed sends can add buckets, which moves the array
+        cord_ratelimit_bucket_t **buckets = (void *)limiter->buckets->data;
+        if (buckets[i]->head) {
+            drain_bucket(limiter, buckets[i]);
+        }
+    }
+}
+
+/*
+ * Environment backed by the async engine and its event loop
+ */
+typedef struct loop_env_t {
+    cord_ratelimit_t *limiter;
+    cord_http_async_t *engine;
+    struct ev_timer timer;
+} loop_env_t;
+
+static f64 loop_now(void *ctx) {
+    loop_env_t *env = ctx;
+    return ev_now(env->engine->loop);
+}
+
+static void loop_schedule(void *ctx, f64 at) {
+    loop_env_t *env = ctx;
+    struct ev_loop *loop = env->engine->loop;
+
+    ev_timer_stop(loop, &env->timer);
+    if (at > 0) {
+        f64 delay = at - ev_now(loop);
+        ev_timer_set(&env->timer, delay > 0 ? delay : 0.0, 0.0);
+        ev_timer_start(loop, &env->timer);
+    }
+}
+
+static void loop_timer_cb(struct ev_loop *loop, ev_timer *timer, i32 revents) {
+    (void)loop;
+    (void)revents;
+
+    loop_env_t *env = timer->data;
+    cord_ratelimit_wakeup(env->limiter);
+}
+
+static void on_future_complete(cord_http_future_t *future,
+                               cord_http_result_t result,
+                               void *user_data) {
+    (void)future;
+
+    cord_ratelimit_request_t *request = user_data;
+    cord_ratelimit_complete(request->limiter, request, result);
+}
+
+static bool loop_send(void *ctx, cord_ratelimit_request_t *request) {
+    loop_env_t *env = ctx;
+    if (request->num_files > 0) {
+        // The form is built again for every attempt, rereading the files
+        return cord_http_async_post_multipart(env->engine,
+                                              cstr(request->url),
+                                              request->body,
+                                              request->files,
+                                              request->num_files,
+                                              on_future_complete,
+                                              request) != NULL;
+    }
+
+    cord_http_future_t *future = cord_http_async_request(env->engine,
+                                                         request->type,
+                                                         cstr(request->url),
+                                                         request->body,
+                                                         on_future_complete,
+                                                         request);
+    return future != NULL;
+}
+
+cord_ratelimit_t *cord_ratelimit_create_on_loop(cord_bump_t *allocator,
+                                                cord_http_async_t *engine) {
+    assert(engine && "Rate limiter needs an async http engine");
+
+    loop_env_t *env = balloc(allocator, sizeof(loop_env_t));
+    if (!env) {
+        logger_error("Failed to allocate rate limiter environment");
+        return NULL;
+    }
+    env->engine = engine;
+    ev_init(&env->timer, loop_timer_cb);
+    env->timer.data = env;
+
+    env->limiter = cord_ratelimit_create(allocator,
+                                         (cord_ratelimit_env_t){
+                                             .now = loop_now,
+                                             .schedule = loop_schedule,
+                                             .send = loop_send,
+                                             .ctx = env,
+                                         });
+    return env->limiter;
+}
@@ -0,0 +1,190 @@
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include "../core/array.h"
+#include "../core/memory.h"
+#include "../core/strings.h"
+#include "async.h"
+#include "http.h"
+
+#include <ev.h>
+#include <stdbool.h>
+
+#define RATELIMIT_GLOBAL_REQUESTS_PER_SECOND 50
+
+/*
+ * Called once a request got a response that was not rate limited
+ *
+ * result.body is only valid until the callback returns
+ */
+typedef void (*cord_ratelimit_cb)(cord_http_result_t result, void *user_data);
+
+typedef struct cord_ratelimit_t cord_ratelimit_t;
+typedef struct cord_ratelimit_bucket_t cord_ratelimit_bucket_t;
+
+/*
+ * REST request waiting for its bucket to allow it through
+ *
+ * The url and body are owned copies since a request can stay queued for
+ * as long as the bucket is exhausted. So are the names and paths of files,
+ * but not the data of files in memory.
+ */
+typedef struct cord_ratelimit_request_t {
+    i32 type;
+    char *url;
+    char *body;
+    // Sent as a form with body as payload_json when there are any
+    cord_http_file_t *files;
+    i32 num_files;
+    u64 route;
+    u64 major;
+
+    cord_ratelimit_cb on_complete;
+    void *user_data;
+
+    cord_ratelimit_t *limiter;
+    cord_ratelimit_bucket_t *bucket;
+    // bucket queue while waiting, in-flight list once sent
+    struct cord_ratelimit_request_t *prev;
+    struct cord_ratelimit_request_t *next;
+} cord_ratelimit_request_t;
+
+/*
+ * A Discord rate limit bucket
+ *
+ * Until the first response arrives we don't know the limits of a bucket,
+ * so only a single request is allowed in flight to discover them.
+ */
+struct cord_ratelimit_bucket_t {
+    // route key until the server tells us the bucket hash
+    u64 key;
+    bool hashed;
+    bool known;
+
+    i32 limit;
+    i32 remaining;
+    f64 reset_at;
+    i32 in_flight;
+
+    cord_ratelimit_request_t *head;
+    cord_ratelimit_request_t *tail;
+};
+
+typedef struct cord_ratelimit_route_t {
+    u64 route;
+    u64 major;
+    cord_ratelimit_bucket_t *bucket;
+} cord_ratelimit_route_t;
+
+/*
+ * Values of the X-RateLimit-* headers (and Retry-After) of a response
+ */
+typedef struct cord_ratelimit_headers_t {
+    cord_str_t bucket;
+    i32 limit;
+    i32 remaining;
+    f64 reset_after;
+    f64 retry_after;
+    bool global;
+    bool shared;
+    bool present;
+} cord_ratelimit_headers_t;
+
+/*
+ * Hooks through which the limiter reads the time, asks to be woken up
+ * and hands requests to a transport. The event loop implementation is
+ * created by cord_ratelimit_create_on_loop(), tests can plug in a fake clock.
+ *
+ * The transport must report every sent request back through
+ * cord_ratelimit_complete() and must not do so from inside send().
+ * Scheduling a time of 0 cancels the pending wakeup.
+ */
+typedef struct cord_ratelimit_env_t {
+    f64 (*now)(void *ctx);
+    void (*schedule)(void *ctx, f64 at);
+    bool (*send)(void *ctx, cord_ratelimit_request_t *request);
+    void *ctx;
+} cord_ratelimit_env_t;
+
+/*
+ * Per-route rate limit scheduler for REST traffic
+ *
+ * Requests are queued per bucket and released as the bucket and the global
+ * limit allow, so under load requests are delayed instead of rejected
+ */
+struct cord_ratelimit_t {
+    cord_bump_t *allocator;
+    cord_array_t *routes;  // cord_ratelimit_route_t
+    cord_array_t *buckets; // cord_ratelimit_bucket_t *
+    cord_ratelimit_env_t env;
+    cord_ratelimit_request_t *in_flight;
+
+    // set by a global 429
+    f64 global_reset_at;
+    // send times of the last second, used as a ring buffer
+    f64 global_sends[RATELIMIT_GLOBAL_REQUESTS_PER_SECOND];
+    i32 global_cursor;
+
+    // time of the earliest wakeup requested through env.schedule, 0 if none
+    f64 next_wakeup;
+
+    u64 num_sent;
+    u64 num_rate_limited;
+
+    // set by destroy, submits fail from then on
+    bool closed;
+};
+
+cord_ratelimit_t *cord_ratelimit_create(cord_bump_t *allocator,
+                                        cord_ratelimit_env_t env);
+// Queued and in-flight requests complete with .error set
+void cord_ratelimit_destroy(cord_ratelimit_t *limiter);
+
+bool cord_ratelimit_submit(cord_ratelimit_t *limiter,
+                           i32 type,
+                           cord_str_t url,
+                           const char *body,
+                           cord_ratelimit_cb on_complete,
+                           void *user_data);
+
+/*
+ * Queue a POST of json with files (see cord_http_post_multipart). Data of
+ * files in memory has to stay valid until on_complete is called.
+ */
+bool cord_ratelimit_submit_multipart(cord_ratelimit_t *limiter,
+                                     cord_str_t url,
+                                     const char *json,
+                                     const cord_http_file_t *files,
+                                     i32 num_files,
+                                     cord_ratelimit_cb on_complete,
+                                     void *user_data);
+
+/*
+ * Report the response of a request handed out through env.send. Requests
+ * that were rate limited are queued again, the rest are completed.
+ */
+void cord_ratelimit_complete(cord_ratelimit_t *limiter,
+                             cord_ratelimit_request_t *request,
+                             cord_http_result_t result);
+
+/*
+ * Called when a time requested through env.schedule is reached
+ */
+void cord_ratelimit_wakeup(cord_ratelimit_t *limiter);
+
+cord_ratelimit_headers_t cord_ratelimit_parse_headers(cord_str_t headers);
+
+/*
+ * Key of the route a url belongs to. Ids are collapsed into placeholders
+ * except for the major parameters (channel, guild, webhook) which are
+ * returned through major since Discord keeps a bucket per major parameter.
+ */
+u64 cord_ratelimit_route_key(i32 type, cord_str_t url, u64 *major);
+
+/*
+ * Limiter that runs on the async engine's event loop
+ */
+cord_ratelimit_t *cord_ratelimit_create_on_loop(cord_bump_t *allocator,
+                                                cord_http_async_t *engine);
+
+#endif
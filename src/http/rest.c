@@ -6,16 +6,21 @@
 #include "../discord/serialization.h"
 #include "http.h"
 #include <curl/curl.h>
+#include <stdlib.h>
+#include <string.h>
 
-static json_t *parse_and_free_json(char *json) {
-    json_error_t error = {};
-    json_t *json_obj = json_loads(json, 0, &error);
-    if (!json_obj) {
-        logger_error(
-            "Failed to parse json. (line:%d): %s", error.line, error.text);
+/*
+ * Move the response body into the allocator so decoded entities, which point
+ * into it, live as long as the allocator does
+ */
+static cord_str_t move_body(char *body, cord_bump_t *allocator) {
+    size_t length = strlen(body);
+    char *copy = balloc_uninit(allocator, length + 1);
+    if (copy) {
+        memcpy(copy, body, length + 1);
     }
-    free(json);
-    return json_obj;
+    free(body);
+    return copy ? (cord_str_t){copy, (ssize_t)length} : (cord_str_t){0};
 }
 
 cord_user_t *cord_api_get_current_user(cord_http_client_t *client,
@@ -31,16 +36,18 @@ cord_user_t *cord_api_get_current_user(cord_http_client_t *client,
         return NULL;
     }
 
-    json_t *json = parse_and_free_json(result.body);
-    if (!json) {
+    cord_str_t body = move_body(result.body, allocator);
+    if (!cord_str_valid(body)) {
+        logger_error("Failed to allocate response body");
         return NULL;
     }
 
-    //cord_bump_t *serialize_bump = cord_bump_create();
-    cord_serialize_result_t user = cord_user_serialize(json, allocator);
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, body, allocator);
+    cord_serialize_result_t user =
+        cord_user_serialize(&reader, cord_json_next(&reader), allocator, NULL);
     if (user.error) {
         logger_error("Failed to serialize user: %s", cord_error(user.error));
-        //cord_bump_destroy(serialize_bump);
         return NULL;
     }
 
@@ -50,7 +57,8 @@ cord_user_t *cord_api_get_current_user(cord_http_client_t *client,
 cord_http_result_t cord_http_get_user(cord_http_client_t *http,
                                       cord_bump_t *allocator,
                                       const char *user_id) {
-    cord_strbuf_t *url = cord_strbuf_from_cstring("/users/");
+    cord_strbuf_t *url = cord_strbuf_create_in(allocator, 64);
+    cord_strbuf_append(url, cstr("/users/"));
     cord_strbuf_append(url, cstr(user_id));
     cord_str_t str_url = cord_strbuf_to_str(*url);
 
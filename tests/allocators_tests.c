@@ -1,7 +1,11 @@
 #include "minunit.h"
 
+#include "../src/core/log.h"
 #include "../src/core/memory.h"
 
+#include <pthread.h>
+#include <string.h>
+
 static const size_t f64_size = sizeof(f64);
 static const size_t SIZE = KB(1);
 static cord_bump_t *bump_allocator = NULL;
@@ -53,13 +57,274 @@ MU_TEST(test_cord_bump_memory_correctness) {
     mu_assert_double_eq(20.0, *twenty);
 }
 
+static size_t count_blocks(cord_bump_t *bump) {
+    size_t count = 0;
+    for (cord_bump_t *it = bump; it; it = it->next) {
+        count++;
+    }
+    return count;
+}
+
+MU_TEST(test_cord_bump_growth) {
+    u8 *allocations[256] = {0};
+    for (size_t i = 0; i < array_length(allocations); i++) {
+        allocations[i] = balloc(bump_allocator, 100);
+        mu_check(allocations[i]);
+        memset(allocations[i], (int)i, 100);
+    }
+
+    // Earlier blocks are still linked and their memory untouched
+    for (size_t i = 0; i < array_length(allocations); i++) {
+        mu_check(allocations[i][0] == (u8)i && allocations[i][99] == (u8)i);
+    }
+
+    // 1KB, 2KB, 4KB, ... holds the 28KB allocated in 5 blocks
+    mu_assert_int_eq(5, count_blocks(bump_allocator));
+    size_t capacity = bump_allocator->capacity;
+    for (cord_bump_t *it = bump_allocator->next; it; it = it->next) {
+        mu_assert_int_eq(capacity * 2, it->capacity);
+        capacity = it->capacity;
+    }
+    mu_check(bump_allocator->tail->next == NULL);
+
+    // Larger than the next block gets a block of its own size
+    u8 *large = balloc(bump_allocator, KB(100));
+    mu_check(large);
+    mu_assert_int_eq(KB(100), bump_allocator->tail->capacity);
+}
+
+MU_TEST(test_cord_bump_clear_reuses_blocks) {
+    cord_bump_t *blocks[8] = {0};
+    for (size_t i = 0; i < 64; i++) {
+        balloc(bump_allocator, 200);
+    }
+
+    size_t count = 0;
+    for (cord_bump_t *it = bump_allocator->next; it; it = it->next) {
+        blocks[count++] = it;
+    }
+    mu_check(count > 1 && count < array_length(blocks));
+
+    cord_bump_clear(bump_allocator);
+    mu_assert_int_eq(0, bump_allocator->used);
+    mu_check(bump_allocator->next == NULL);
+    mu_check(bump_allocator->tail == bump_allocator);
+
+    // The same allocations are served by the retired blocks, zeroed
+    for (size_t i = 0; i < 64; i++) {
+        u8 *memory = balloc(bump_allocator, 200);
+        mu_check(memory[0] == 0 && memory[199] == 0);
+        memset(memory, 0xff, 200);
+    }
+
+    size_t reused = 0;
+    for (cord_bump_t *it = bump_allocator->next; it; it = it->next) {
+        mu_check(it == blocks[reused]);
+        reused++;
+    }
+    mu_assert_int_eq(count, reused);
+    mu_check(bump_allocator->free_list == NULL);
+}
+
+static bool is_zero(const u8 *memory, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (memory[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MU_TEST(test_cord_bump_zeroes_below_high_water) {
+    u8 *dirty = balloc_uninit(bump_allocator, 256);
+    mu_check(is_zero(dirty, 256));
+    memset(dirty, 0xff, 256);
+    mu_assert_int_eq(256, bump_allocator->high_water);
+
+    // Popped memory is handed out again zeroed by balloc only
+    cord_bump_pop(bump_allocator, 256);
+    u8 *zeroed = balloc(bump_allocator, 128);
+    mu_check(zeroed == dirty && is_zero(zeroed, 128));
+    u8 *uninit = balloc_uninit(bump_allocator, 128);
+    mu_check(uninit[0] == 0xff && uninit[127] == 0xff);
+
+    // Same after a clear, memory past the high-water mark was never used
+    memset(zeroed, 0xff, 128);
+    cord_bump_clear(bump_allocator);
+    zeroed = balloc(bump_allocator, 512);
+    mu_check(is_zero(zeroed, 512));
+    mu_assert_int_eq(512, bump_allocator->high_water);
+}
+
+MU_TEST(test_balloc_array) {
+    f64 *values = balloc_array(bump_allocator, 16, sizeof(f64));
+    mu_check(values);
+    mu_assert_int_eq(16 * sizeof(f64), bump_allocator->used);
+
+    mu_check(balloc_array(bump_allocator, SIZE_MAX / 2, 4) == NULL);
+    mu_assert_int_eq(16 * sizeof(f64), bump_allocator->used);
+}
+
+MU_TEST(test_cord_bump_marker_restore) {
+    u8 *before = balloc(bump_allocator, 100);
+    cord_bump_marker_t marker = cord_bump_mark(bump_allocator);
+    size_t used = bump_allocator->used;
+
+    // Spans several blocks, which are all retired by restoring
+    for (size_t i = 0; i < 64; i++) {
+        balloc(bump_allocator, 200);
+    }
+    mu_check(bump_allocator->next != NULL);
+
+    cord_bump_restore(bump_allocator, marker);
+    mu_check(bump_allocator->tail == bump_allocator);
+    mu_check(bump_allocator->next == NULL);
+    mu_check(bump_allocator->free_list != NULL);
+    mu_assert_int_eq(used, bump_allocator->used);
+
+    u8 *after = balloc(bump_allocator, 16);
+    mu_check(after == before + 112);
+}
+
+MU_TEST(test_cord_temp_memory_nested) {
+    cord_temp_memory_t outer = cord_temp_memory_start(bump_allocator);
+    u8 *outer_memory = balloc(bump_allocator, 600);
+    memset(outer_memory, 0xaa, 600);
+
+    // The inner scope starts in the first block and ends in another one
+    cord_temp_memory_t inner = cord_temp_memory_start(bump_allocator);
+    for (size_t i = 0; i < 16; i++) {
+        balloc(bump_allocator, 300);
+    }
+    cord_bump_t *inner_tail = bump_allocator->tail;
+    mu_check(inner_tail != bump_allocator);
+    cord_temp_memory_end(inner);
+
+    mu_check(bump_allocator->tail == bump_allocator);
+    mu_check(outer_memory[0] == 0xaa && outer_memory[599] == 0xaa);
+    u8 *next = balloc(bump_allocator, 16);
+    mu_check(next == outer_memory + 608);
+
+    cord_temp_memory_end(outer);
+    mu_assert_int_eq(0, bump_allocator->used);
+}
+
+MU_TEST(test_cord_scratch_conflict) {
+    cord_temp_memory_t first = cord_scratch_begin(NULL);
+    mu_check(first.allocator);
+
+    // Scratch of a function that allocates its result in first's arena
+    cord_temp_memory_t second = cord_scratch_begin(first.allocator);
+    mu_check(second.allocator && second.allocator != first.allocator);
+
+    u8 *result = balloc(first.allocator, 64);
+    memset(result, 0x55, 64);
+    balloc(second.allocator, KB(256));
+    cord_scratch_end(second);
+    mu_check(result[0] == 0x55 && result[63] == 0x55);
+
+    cord_scratch_end(first);
+    mu_assert_int_eq(0, first.allocator->used);
+    mu_check(first.allocator->next == NULL);
+}
+
+static void *scratch_of_thread(void *arg) {
+    cord_temp_memory_t scratch = cord_scratch_begin(NULL);
+    *(cord_bump_t **)arg = scratch.allocator;
+    balloc(scratch.allocator, 64);
+    cord_scratch_end(scratch);
+    return NULL;
+}
+
+MU_TEST(test_cord_scratch_per_thread) {
+    cord_temp_memory_t scratch = cord_scratch_begin(NULL);
+    cord_bump_t *other = NULL;
+
+    pthread_t thread;
+    mu_check(pthread_create(&thread, NULL, scratch_of_thread, &other) == 0);
+    pthread_join(thread, NULL);
+    mu_check(other && other != scratch.allocator);
+
+    cord_scratch_end(scratch);
+}
+
+MU_TEST(test_cord_scratch_release) {
+    cord_temp_memory_t scratch = cord_scratch_begin(NULL);
+    balloc(scratch.allocator, 64);
+    cord_scratch_end(scratch);
+    cord_scratch_release();
+
+    // Released arenas are created again on the next use
+    scratch = cord_scratch_begin(NULL);
+    mu_check(scratch.allocator);
+    mu_assert_int_eq(0, scratch.allocator->used);
+    cord_scratch_end(scratch);
+    cord_scratch_release();
+}
+
+MU_TEST(test_cord_arena_pool) {
+    cord_arena_pool_t pool = {0};
+
+    cord_bump_t *first = cord_arena_pool_acquire(&pool);
+    balloc(first, KB(1));
+    cord_arena_pool_release(&pool, first);
+    mu_check(cord_arena_pool_acquire(&pool) == first);
+
+    // An event that outgrows the arena raises the size class
+    balloc(first, KB(10));
+    cord_arena_pool_release(&pool, first);
+    cord_arena_pool_stats_t stats = cord_arena_pool_stats(&pool);
+    mu_assert_int_eq(1, stats.grows);
+    mu_assert_int_eq(KB(16), stats.size_class);
+
+    cord_bump_t *sized = cord_arena_pool_acquire(&pool);
+    mu_assert_int_eq(KB(16), sized->capacity);
+    balloc(sized, KB(10));
+    cord_arena_pool_release(&pool, sized);
+    mu_check(cord_arena_pool_acquire(&pool) == sized);
+    mu_check(sized->next == NULL);
+
+    // Once a spike is forgotten its oversized arena is replaced
+    balloc(sized, KB(100));
+    cord_arena_pool_release(&pool, sized);
+    mu_assert_int_eq(KB(128), cord_arena_pool_stats(&pool).size_class);
+    for (i32 i = 0; i < CORD_ARENA_POOL_HISTORY; i++) {
+        cord_bump_t *arena = cord_arena_pool_acquire(&pool);
+        balloc(arena, KB(1));
+        cord_arena_pool_release(&pool, arena);
+    }
+    stats = cord_arena_pool_stats(&pool);
+    mu_assert_int_eq(KB(4), stats.size_class);
+    mu_assert_int_eq(36, stats.acquires);
+    mu_assert_int_eq(33, stats.hits);
+    mu_assert_int_eq(2, stats.grows);
+    mu_check(stats.peak_bytes >= KB(100));
+
+    cord_bump_t *last = cord_arena_pool_acquire(&pool);
+    mu_assert_int_eq(KB(4), last->capacity);
+    cord_arena_pool_release(&pool, last);
+    cord_arena_pool_destroy(&pool);
+}
+
 MU_TEST_SUITE(test_suite) {
     MU_SUITE_CONFIGURE(&test_setup, &test_teardown);
     MU_RUN_TEST(test_cord_bump_memory_correctness);
+    MU_RUN_TEST(test_cord_bump_growth);
+    MU_RUN_TEST(test_cord_bump_clear_reuses_blocks);
+    MU_RUN_TEST(test_cord_bump_zeroes_below_high_water);
+    MU_RUN_TEST(test_balloc_array);
+    MU_RUN_TEST(test_cord_bump_marker_restore);
+    MU_RUN_TEST(test_cord_temp_memory_nested);
+    MU_RUN_TEST(test_cord_scratch_conflict);
+    MU_RUN_TEST(test_cord_scratch_per_thread);
+    MU_RUN_TEST(test_cord_scratch_release);
+    MU_RUN_TEST(test_cord_arena_pool);
 }
 
 int main(void) {
+    global_logger_init();
     MU_RUN_SUITE(test_suite);
     MU_REPORT();
+    cord_scratch_release();
     return MU_EXIT_CODE;
 }
\ No newline at end of file
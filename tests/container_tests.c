@@ -143,10 +143,10 @@ void assert_user_values(user *u, int id, char *name, float time_logged_in) {
 }
 
 MU_TEST(test_cord_hashmap_put) {
-    my_user1 = cord_hashmap_put(users_map, "first");
-    my_user2 = cord_hashmap_put(users_map, "second");
-    my_user3 = cord_hashmap_put(users_map, "third");
-    my_user4 = cord_hashmap_put(users_map, "fourth");
+    my_user1 = cord_hashmap_put(users_map, cstr("first"));
+    my_user2 = cord_hashmap_put(users_map, cstr("second"));
+    my_user3 = cord_hashmap_put(users_map, cstr("third"));
+    my_user4 = cord_hashmap_put(users_map, cstr("fourth"));
 
     assert_all_users_not_null("cord_hashmap_put() shouldn't return NULL");
 
@@ -162,10 +162,10 @@ MU_TEST(test_cord_hashmap_put) {
 }
 
 MU_TEST(test_cord_hashmap_get) {
-    my_user1 = cord_hashmap_put(users_map, "first");
-    my_user2 = cord_hashmap_put(users_map, "second");
-    my_user3 = cord_hashmap_put(users_map, "third");
-    my_user4 = cord_hashmap_put(users_map, "fourth");
+    my_user1 = cord_hashmap_put(users_map, cstr("first"));
+    my_user2 = cord_hashmap_put(users_map, cstr("second"));
+    my_user3 = cord_hashmap_put(users_map, cstr("third"));
+    my_user4 = cord_hashmap_put(users_map, cstr("fourth"));
 
     assert_all_users_not_null("cord_hashmap_put() shouldn't return NULL");
 
@@ -174,10 +174,10 @@ MU_TEST(test_cord_hashmap_get) {
     update_user(my_user3, 3, "third", 3);
     update_user(my_user4, 4, "fourth", 4);
 
-    user *returned1 = cord_hashmap_get(users_map, "first");
-    user *returned2 = cord_hashmap_get(users_map, "second");
-    user *returned3 = cord_hashmap_get(users_map, "third");
-    user *returned4 = cord_hashmap_get(users_map, "fourth");
+    user *returned1 = cord_hashmap_get(users_map, cstr("first"));
+    user *returned2 = cord_hashmap_get(users_map, cstr("second"));
+    user *returned3 = cord_hashmap_get(users_map, cstr("third"));
+    user *returned4 = cord_hashmap_get(users_map, cstr("fourth"));
 
     assert_user_values(returned1, 1, "first", 1);
     assert_user_values(returned2, 2, "second", 2);
@@ -185,6 +185,107 @@ MU_TEST(test_cord_hashmap_get) {
     assert_user_values(returned4, 4, "fourth", 4);
 }
 
+MU_TEST(test_cord_hashmap_long_keys) {
+    cord_str_t long_key =
+        cstr("a key that is a lot longer than the 32 bytes keys used to have");
+    cord_str_t other_key =
+        cstr("a key that is a lot longer than the 32 bytes keys used to HAVE");
+
+    my_user1 = cord_hashmap_put(users_map, long_key);
+    update_user(my_user1, 1, "long", 1);
+    mu_check(cord_hashmap_get(users_map, long_key) == my_user1);
+    mu_check(cord_hashmap_get(users_map, other_key) == NULL);
+
+    // Putting a key again replaces its value
+    my_user2 = cord_hashmap_put(users_map, long_key);
+    mu_check(my_user2 != my_user1);
+    mu_check(cord_hashmap_get(users_map, long_key) == my_user2);
+    mu_assert_int_eq(1, users_map->num_items);
+}
+
+static cord_str_t numbered_key(char *buffer, size_t size, i32 number) {
+    i32 length = snprintf(buffer, size, "user-%d", number);
+    return (cord_str_t){buffer, length};
+}
+
+MU_TEST(test_cord_hashmap_growth) {
+    const i32 count = 100000;
+    char buffer[32];
+
+    for (i32 i = 0; i < count; i++) {
+        user *u = cord_hashmap_put(users_map, numbered_key(buffer, 32, i));
+        mu_check(u);
+        u->id = i;
+    }
+    mu_assert_int_eq(count, users_map->num_items);
+    mu_check(users_map->capacity >= (size_t)count);
+
+    for (i32 i = 0; i < count; i++) {
+        user *u = cord_hashmap_get(users_map, numbered_key(buffer, 32, i));
+        mu_check(u && u->id == i);
+    }
+    mu_check(!cord_hashmap_get(users_map, numbered_key(buffer, 32, count)));
+}
+
+MU_TEST(test_cord_hashmap_remove) {
+    char buffer[32];
+
+    mu_check(!cord_hashmap_remove(users_map, cstr("missing")));
+    for (i32 i = 0; i < 40; i++) {
+        cord_hashmap_put(users_map, numbered_key(buffer, 32, i));
+    }
+    for (i32 i = 0; i < 40; i += 2) {
+        mu_check(cord_hashmap_remove(users_map, numbered_key(buffer, 32, i)));
+    }
+    mu_assert_int_eq(20, users_map->num_items);
+    for (i32 i = 0; i < 40; i++) {
+        user *u = cord_hashmap_get(users_map, numbered_key(buffer, 32, i));
+        mu_check(i % 2 == 0 ? u == NULL : u != NULL);
+    }
+
+    // Churn leaves deleted slots behind, which are compacted in place
+    size_t capacity = users_map->capacity;
+    for (i32 i = 1000; i < 100000; i++) {
+        cord_hashmap_put(users_map, numbered_key(buffer, 32, i));
+        cord_hashmap_remove(users_map, numbered_key(buffer, 32, i));
+    }
+    mu_assert_int_eq(capacity, users_map->capacity);
+    mu_assert_int_eq(20, users_map->num_items);
+    mu_check(users_map->num_items + users_map->num_deleted <
+             users_map->capacity);
+}
+
+MU_TEST(test_cord_u64_map) {
+    cord_u64_map_t *map = cord_u64_map_create(allocator, 0);
+    mu_check(map);
+
+    // Snowflakes of one worker a few milliseconds apart
+    const u64 count = 100000;
+    const u64 first = 175928847299117063ull;
+    for (u64 i = 0; i < count; i++) {
+        mu_check(cord_u64_map_put(map, first + (i << 22), (void *)(i + 1)));
+    }
+    mu_assert_int_eq(count, map->num_items);
+
+    for (u64 i = 0; i < count; i++) {
+        mu_check(cord_u64_map_get(map, first + (i << 22)) == (void *)(i + 1));
+    }
+    mu_check(cord_u64_map_get(map, first + 1) == NULL);
+    mu_check(cord_u64_map_get(map, 0) == NULL);
+
+    // Replacing a value keeps a single key
+    mu_check(cord_u64_map_put(map, first, (void *)7));
+    mu_check(cord_u64_map_get(map, first) == (void *)7);
+    mu_assert_int_eq(count, map->num_items);
+
+    for (u64 i = 0; i < count; i += 2) {
+        mu_check(cord_u64_map_remove(map, first + (i << 22)));
+    }
+    mu_check(!cord_u64_map_remove(map, first));
+    mu_assert_int_eq(count / 2, map->num_items);
+    mu_check(cord_u64_map_get(map, first + (1ull << 22)) == (void *)2);
+}
+
 MU_TEST_SUITE(cord_array_test_suite) {
     MU_SUITE_CONFIGURE(&cord_array_test_setup, &cord_array_test_teardown);
     MU_RUN_TEST(test_cord_array_push);
@@ -196,6 +297,10 @@ MU_TEST_SUITE(cord_hashmap_test_suite) {
     MU_SUITE_CONFIGURE(&cord_hashmap_test_setup, &cord_hashmap_test_teardown);
     MU_RUN_TEST(test_cord_hashmap_put);
     MU_RUN_TEST(test_cord_hashmap_get);
+    MU_RUN_TEST(test_cord_hashmap_long_keys);
+    MU_RUN_TEST(test_cord_hashmap_growth);
+    MU_RUN_TEST(test_cord_hashmap_remove);
+    MU_RUN_TEST(test_cord_u64_map);
 }
 
 int main(void) {
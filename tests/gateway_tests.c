@@ -0,0 +1,996 @@
+#define _GNU_SOURCE
+
+#include "minunit.h"
+
+#include "../src/core/log.h"
+#include "../src/discord/cache.h"
+#include "../src/discord/client.h"
+#include "../src/discord/compression.h"
+#include "../src/discord/events.h"
+#include "../src/discord/message_view.h"
+#include "../src/discord/serialization.h"
+#include "../src/discord/shard.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TEST_DATA_DIR
+#define TEST_DATA_DIR "data"
+#endif
+
+#define GATEWAY_EVENT_NAME(name, intents) #name,
+
+static const char *event_names[] = {GATEWAY_EVENTS(GATEWAY_EVENT_NAME)};
+
+static i32 handled = 0;
+
+static void handler(cord_client_t *client,
+                    cord_json_reader_t *data,
+                    cord_str_t event) {
+    (void)client;
+    (void)data;
+    (void)event;
+    handled++;
+}
+
+static void remove_handlers(void) {
+    for (i32 i = 0; i < GATEWAY_EVENT_COUNT; i++) {
+        cord_gateway_event_set_handler((gateway_event_t)i, NULL);
+    }
+}
+
+static void handle_frame(cord_client_t *client, const char *frame) {
+    cord_client_handle_frame(client, frame, strlen(frame));
+}
+
+MU_TEST(test_gateway_event_lookup) {
+    mu_assert_int_eq(GATEWAY_EVENT_COUNT,
+                     sizeof(event_names) / sizeof(event_names[0]));
+
+    for (i32 i = 0; i < GATEWAY_EVENT_COUNT; i++) {
+        cord_gateway_event_t *event =
+            get_gateway_event_from_str(cstr(event_names[i]));
+        mu_assert(event == get_gateway_event((gateway_event_t)i),
+                  event_names[i]);
+        mu_assert(cord_str_equals_cstring(event->name, event_names[i]),
+                  "event name");
+    }
+}
+
+MU_TEST(test_gateway_event_lookup_unknown) {
+    const char *unknown[] = {
+        "",
+        "T",
+        "READ",
+        "READY_",
+        "ready",
+        "MESSAGE_CREATF",
+        "INTEGRATION_CREATED",
+        "GUILD_MEMBER_UPDATE_",
+        "GUILD_SCHEDULED_EVENT_USER_ADDED",
+        "SOME_EVENT_FROM_A_NEWER_GATEWAY_VERSION_THAT_IS_VERY_LONG_"
+        "AND_MORE",
+    };
+
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        mu_assert(get_gateway_event_from_str(cstr(unknown[i])) == NULL,
+                  unknown[i]);
+    }
+
+    // Names are matched by length, not up to a terminator
+    cord_str_t prefix = {(char *)"MESSAGE_CREATE", 7};
+    mu_assert(get_gateway_event_from_str(prefix) == NULL, "prefix");
+}
+
+MU_TEST(test_gateway_event_set_handler) {
+    cord_gateway_event_t *event = get_gateway_event(GATEWAY_EVENT_TYPING_START);
+    mu_assert(!cord_gateway_event_has_handler(event), "no handler by default");
+
+    cord_gateway_event_set_handler(GATEWAY_EVENT_TYPING_START, handler);
+    event = get_gateway_event_from_str(cstr("TYPING_START"));
+    mu_assert(event->handler == handler, "registered handler");
+
+    cord_gateway_event_set_handler(GATEWAY_EVENT_TYPING_START, NULL);
+    mu_assert(!cord_gateway_event_has_handler(event), "handler removed");
+}
+
+MU_TEST(test_gateway_intents_from_handlers) {
+    remove_handlers();
+    mu_assert_int_eq(0, cord_gateway_intents_from_handlers());
+
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE, handler);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_TYPING_START, handler);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_READY, handler);
+    mu_assert_int_eq(INTENT_MESSAGES | INTENT_MESSAGE_CONTENT | INTENT_TYPING,
+                     cord_gateway_intents_from_handlers());
+
+    remove_handlers();
+}
+
+MU_TEST(test_gateway_drop_unhandled_events) {
+    remove_handlers();
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE, handler);
+
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    handled = 0;
+
+    handle_frame(&client,
+                 "{\"t\":\"PRESENCE_UPDATE\",\"s\":3,\"op\":0,"
+                 "\"d\":{\"user\":{\"id\":\"1\"},\"status\":\"idle\"}}");
+    mu_assert_int_eq(1, client.dropped_events);
+    mu_assert_int_eq(3, client.sequence);
+
+    // Unknown events have no handler either, the rest of the frame is
+    // never read
+    handle_frame(&client, "{\"t\":\"NEW_EVENT\",\"s\":4,\"op\":0,\"d\":{");
+    mu_assert_int_eq(2, client.dropped_events);
+    mu_assert_int_eq(4, client.sequence);
+
+    handle_frame(&client,
+                 "{\"t\":\"MESSAGE_CREATE\",\"s\":5,\"op\":0,"
+                 "\"d\":{\"id\":\"1\"}}");
+    mu_assert_int_eq(2, client.dropped_events);
+    mu_assert_int_eq(1, handled);
+
+    // Fields after "d" can only be found by parsing the frame
+    handle_frame(&client,
+                 "{\"op\":0,\"d\":{\"id\":\"1\"},\"s\":6,"
+                 "\"t\":\"TYPING_START\"}");
+    mu_assert_int_eq(2, client.dropped_events);
+    mu_assert_int_eq(6, client.sequence);
+    mu_assert_int_eq(1, handled);
+
+    cord_bump_destroy(client.temporary_allocator);
+    remove_handlers();
+}
+
+static const char *borrowed_frame = NULL;
+static bool borrowed_event = false;
+static bool borrowed_data = false;
+
+static void borrowing_handler(cord_client_t *client,
+                              cord_json_reader_t *data,
+                              cord_str_t event) {
+    (void)client;
+    size_t length = strlen(borrowed_frame);
+    const char *end = borrowed_frame + length;
+    borrowed_event = cord_str_equals_cstring(event, "MESSAGE_CREATE") &&
+                     event.data > borrowed_frame && event.data < end;
+    cord_str_t raw = cord_json_read_raw(data);
+    borrowed_data =
+        cord_str_equals_cstring(raw, "{\"id\":\"1\",\"content\":\"hi\"}") &&
+        raw.data > borrowed_frame && raw.data < end;
+    handled++;
+}
+
+MU_TEST(test_gateway_dispatch_borrows_frame) {
+    remove_handlers();
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE,
+                                   borrowing_handler);
+
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    handled = 0;
+
+    // The handler sees the event name and data where they are in the frame
+    borrowed_frame = "{\"t\":\"MESSAGE_CREATE\",\"s\":7,\"op\":0,"
+                     "\"d\":{\"id\":\"1\",\"content\":\"hi\"}}";
+    handle_frame(&client, borrowed_frame);
+    mu_assert_int_eq(1, handled);
+    mu_check(borrowed_event);
+    mu_check(borrowed_data);
+    mu_assert_int_eq(7, client.sequence);
+    // What was parsed is gone once the frame is dispatched
+    mu_assert_int_eq(0, client.temporary_allocator->used);
+
+    cord_bump_destroy(client.temporary_allocator);
+    remove_handlers();
+}
+
+static size_t message_bytes = 0;
+static cord_snowflake_t last_channel_id = 0;
+
+static void on_message(cord_t *ctx, cord_bump_t *bump, cord_message_t *msg) {
+    (void)ctx;
+    message_bytes += (size_t)msg->content.length;
+    last_channel_id = msg->channel_id;
+    balloc(bump, KB(6));
+    handled++;
+}
+
+MU_TEST(test_gateway_message_arenas) {
+    remove_handlers();
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE,
+                                   on_message_create);
+
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    client.event_callbacks.on_message_cb = on_message;
+    handled = 0;
+    message_bytes = 0;
+
+    for (i32 i = 0; i < 100; i++) {
+        handle_frame(&client,
+                     "{\"t\":\"MESSAGE_CREATE\",\"s\":5,\"op\":0,"
+                     "\"d\":{\"id\":\"1\",\"content\":\"hello\","
+                     "\"channel_id\":\"381870553235193857\"}}");
+    }
+    mu_assert_int_eq(100, handled);
+    mu_assert_int_eq(500, message_bytes);
+    mu_check(last_channel_id == 381870553235193857ull);
+
+    // The first message grows the size class, every other one is a hit
+    cord_arena_pool_stats_t stats = cord_arena_pool_stats(&client.event_arenas);
+    mu_assert_int_eq(100, stats.acquires);
+    mu_assert_int_eq(98, stats.hits);
+    mu_assert_int_eq(1, stats.grows);
+    mu_assert_int_eq(KB(8), stats.size_class);
+    mu_check(stats.peak_bytes > KB(6));
+
+    cord_arena_pool_destroy(&client.event_arenas);
+    cord_bump_destroy(client.temporary_allocator);
+    remove_handlers();
+}
+
+static const char *view_message =
+    "{\"id\":\"1\",\"type\":0,\"tts\":false,"
+    "\"author\":{\"username\":\"cord\",\"id\":\"80351110224678912\"},"
+    "\"mentions\":[{\"id\":\"2\",\"username\":\"a\"},{\"id\":\"3\"}],"
+    "\"mention_roles\":[\"4\",\"5\"],"
+    "\"content\":\"say \\\"hi\\\"\","
+    "\"channel_id\":\"381870553235193857\","
+    "\"embeds\":[]}";
+
+MU_TEST(test_gateway_message_view) {
+    cord_bump_t *bump = cord_bump_create_with_size(KB(4));
+    cord_json_reader_t data = {0};
+    cord_json_reader_init(&data, cstr(view_message), bump);
+
+    cord_message_view_t view = {0};
+    mu_check(cord_message_view_init(&view, &data, bump));
+    mu_check(cord_message_get_id(&view) == 1);
+
+    // The author id is read without decoding the author
+    mu_check(cord_message_get_author_id(&view) == 80351110224678912ull);
+    mu_check(!view.decoded[CORD_MESSAGE_FIELD_AUTHOR]);
+    mu_check(!view.decoded[CORD_MESSAGE_FIELD_MENTIONS]);
+
+    cord_str_t content = cord_message_get_content(&view);
+    mu_check(cord_str_equals_cstring(content, "say \"hi\""));
+    mu_check(cord_message_get_channel_id(&view) == 381870553235193857ull);
+    mu_check(!view.end);
+    mu_check(cord_message_get_guild_id(&view) == 0);
+    mu_check(view.end);
+
+    cord_user_t *author = cord_message_get_author(&view);
+    mu_check(author && cord_str_equals_cstring(author->username, "cord"));
+    mu_check(cord_message_get_author(&view) == author);
+    mu_check(cord_message_get_author_id(&view) == author->id);
+
+    cord_array_t *mentions = cord_message_get_mentions(&view);
+    mu_check(mentions && mentions->num_elements == 2);
+    mu_check(((cord_user_t *)cord_array_get(mentions, 1))->id == 3);
+    cord_array_t *roles = cord_message_get_mention_roles(&view);
+    mu_check(roles && roles->num_elements == 2);
+    mu_check(*(cord_snowflake_t *)cord_array_get(roles, 1) == 5);
+    mu_check(cord_message_get_embeds(&view)->num_elements == 0);
+    mu_check(!cord_message_get_member(&view));
+    mu_check(!cord_message_get_reactions(&view));
+
+    cord_message_t *message = cord_message_view_decode(&view);
+    mu_check(message && message->id == 1);
+    mu_check(cord_str_equals(message->content, content));
+    mu_check(cord_message_view_decode(&view) == message);
+
+    cord_bump_destroy(bump);
+}
+
+MU_TEST(test_gateway_message_view_truncated) {
+    cord_bump_t *bump = cord_bump_create_with_size(KB(4));
+    cord_json_reader_t data = {0};
+    cord_json_reader_init(
+        &data, cstr("{\"id\":\"1\",\"content\":\"cut of"), bump);
+
+    cord_message_view_t view = {0};
+    mu_check(cord_message_view_init(&view, &data, bump));
+    mu_check(cord_message_get_id(&view) == 1);
+
+    // A value that fails to read is not recorded as found
+    cord_str_t content = cord_message_get_content(&view);
+    mu_assert_int_eq(0, (i32)content.length);
+    mu_check(!(view.found & (1u << CORD_MESSAGE_FIELD_CONTENT)));
+    mu_check(view.end == view.start);
+    mu_check(!cord_message_view_decode(&view));
+
+    cord_bump_destroy(bump);
+}
+
+static cord_snowflake_t last_author_id = 0;
+static size_t view_arena_bytes = 0;
+
+static void on_message_view(cord_t *ctx,
+                            cord_bump_t *bump,
+                            cord_message_view_t *msg) {
+    (void)ctx;
+    message_bytes += (size_t)cord_message_get_content(msg).length;
+    last_channel_id = cord_message_get_channel_id(msg);
+    last_author_id = cord_message_get_author_id(msg);
+    view_arena_bytes = max(view_arena_bytes, cord_bump_used(bump));
+    handled++;
+}
+
+MU_TEST(test_gateway_message_view_handler) {
+    remove_handlers();
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE,
+                                   on_message_create);
+
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    client.event_callbacks.on_message_view_cb = on_message_view;
+    handled = 0;
+    message_bytes = 0;
+
+    const char *frame = "{\"t\":\"MESSAGE_CREATE\",\"s\":5,\"op\":0,"
+                        "\"d\":{\"id\":\"1\",\"content\":\"hello\","
+                        "\"author\":{\"id\":\"7\",\"username\":\"a\"},"
+                        "\"channel_id\":\"381870553235193857\"}}";
+    handle_frame(&client, frame);
+    mu_assert_int_eq(1, handled);
+    mu_assert_int_eq(5, message_bytes);
+    mu_check(last_channel_id == 381870553235193857ull);
+    mu_check(last_author_id == 7);
+    // Nothing but the memo of the content was allocated
+    mu_check(view_arena_bytes <= 64);
+
+    // With both callbacks the message is decoded after the view
+    client.event_callbacks.on_message_cb = on_message;
+    handle_frame(&client, frame);
+    mu_assert_int_eq(3, handled);
+    mu_assert_int_eq(15, message_bytes);
+
+    cord_arena_pool_destroy(&client.event_arenas);
+    cord_bump_destroy(client.temporary_allocator);
+    remove_handlers();
+}
+
+static void set_cache_handlers(void) {
+    remove_handlers();
+    cord_gateway_event_set_handler(GATEWAY_EVENT_GUILD_CREATE,
+                                   on_guild_create);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_GUILD_DELETE,
+                                   on_guild_delete);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_CHANNEL_UPDATE,
+                                   on_channel_update);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_GUILD_ROLE_DELETE,
+                                   on_guild_role_delete);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_GUILD_MEMBER_ADD,
+                                   on_guild_member_add);
+    cord_gateway_event_set_handler(GATEWAY_EVENT_GUILD_MEMBER_REMOVE,
+                                   on_guild_member_remove);
+}
+
+MU_TEST(test_gateway_cache) {
+    set_cache_handlers();
+
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    client.cache = cord_cache_create(cord_cache_default_config(100));
+    mu_check(client.cache);
+
+    // The arrays come before the id of the guild they belong to
+    handle_frame(&client,
+                 "{\"t\":\"GUILD_CREATE\",\"s\":1,\"op\":0,\"d\":{"
+                 "\"channels\":[{\"id\":\"20\",\"type\":0,\"position\":3,"
+                 "\"name\":\"general\",\"parent_id\":\"21\"}],"
+                 "\"roles\":[{\"id\":\"30\",\"name\":\"mods\",\"color\":255,"
+                 "\"position\":1,\"permissions\":\"8\"},"
+                 "{\"id\":\"31\",\"name\":\"caf\\u00e9\"}],"
+                 "\"members\":[{\"user\":{\"id\":\"40\",\"username\":\"a\"},"
+                 "\"nick\":\"alice\",\"roles\":[\"30\",\"31\"]},"
+                 "{\"user\":{\"id\":\"41\"},\"nick\":null,\"roles\":[]}],"
+                 "\"id\":\"10\",\"name\":\"cord\",\"owner_id\":\"40\","
+                 "\"member_count\":2}}");
+
+    cord_cached_guild_t guild = {0};
+    mu_check(cord_cache_get_guild(client.cache, 10, &guild));
+    mu_check(cord_str_equals_cstring(guild.name, "cord"));
+    mu_check(guild.owner_id == 40);
+    mu_assert_int_eq(2, guild.member_count);
+
+    cord_cached_channel_t channel = {0};
+    mu_check(cord_cache_get_channel(client.cache, 20, &channel));
+    mu_check(channel.guild_id == 10);
+    mu_check(channel.parent_id == 21);
+    mu_check(cord_str_equals_cstring(channel.name, "general"));
+    mu_assert_int_eq(3, channel.position);
+
+    cord_cached_role_t role = {0};
+    mu_check(cord_cache_get_role(client.cache, 30, &role));
+    mu_check(role.permissions == 8);
+    mu_assert_int_eq(255, role.color);
+    mu_check(cord_cache_get_role(client.cache, 31, &role));
+    mu_check(cord_str_equals_cstring(role.name, "caf\xc3\xa9"));
+
+    cord_cached_member_t member = {0};
+    mu_check(cord_cache_get_member(client.cache, 10, 40, &member));
+    mu_check(cord_str_equals_cstring(member.nick, "alice"));
+    mu_assert_int_eq(2, member.num_roles);
+    mu_check(member.roles[0] == 30 && member.roles[1] == 31);
+    mu_check(cord_cache_get_member(client.cache, 10, 41, &member));
+    mu_assert_int_eq(0, member.nick.length);
+    mu_check(!cord_cache_get_member(client.cache, 11, 40, &member));
+
+    // The same user in another guild is another member
+    handle_frame(&client,
+                 "{\"t\":\"GUILD_MEMBER_ADD\",\"s\":2,\"op\":0,\"d\":{"
+                 "\"user\":{\"id\":\"40\"},\"nick\":\"al\",\"roles\":[],"
+                 "\"guild_id\":\"11\"}}");
+    mu_check(cord_cache_get_member(client.cache, 11, 40, &member));
+    mu_check(cord_str_equals_cstring(member.nick, "al"));
+    mu_check(cord_cache_get_member(client.cache, 10, 40, &member));
+    mu_check(cord_str_equals_cstring(member.nick, "alice"));
+
+    handle_frame(&client,
+                 "{\"t\":\"CHANNEL_UPDATE\",\"s\":3,\"op\":0,\"d\":{"
+                 "\"id\":\"20\",\"guild_id\":\"10\",\"name\":\"chat\"}}");
+    mu_check(cord_cache_get_channel(client.cache, 20, &channel));
+    mu_check(cord_str_equals_cstring(channel.name, "chat"));
+
+    handle_frame(&client,
+                 "{\"t\":\"GUILD_ROLE_DELETE\",\"s\":4,\"op\":0,\"d\":{"
+                 "\"guild_id\":\"10\",\"role_id\":\"31\"}}");
+    mu_check(!cord_cache_get_role(client.cache, 31, &role));
+
+    handle_frame(&client,
+                 "{\"t\":\"GUILD_MEMBER_REMOVE\",\"s\":5,\"op\":0,\"d\":{"
+                 "\"guild_id\":\"10\",\"user\":{\"id\":\"41\"}}}");
+    mu_check(!cord_cache_get_member(client.cache, 10, 41, &member));
+    mu_check(cord_cache_get_guild(client.cache, 10, &guild));
+    mu_assert_int_eq(1, guild.member_count);
+
+    // An outage keeps the guild, leaving it drops everything in it
+    handle_frame(&client,
+                 "{\"t\":\"GUILD_DELETE\",\"s\":6,\"op\":0,\"d\":{"
+                 "\"id\":\"10\",\"unavailable\":true}}");
+    mu_check(cord_cache_get_guild(client.cache, 10, &guild));
+    handle_frame(&client,
+                 "{\"t\":\"GUILD_DELETE\",\"s\":7,\"op\":0,\"d\":{"
+                 "\"id\":\"10\"}}");
+    mu_check(!cord_cache_get_guild(client.cache, 10, &guild));
+    mu_check(!cord_cache_get_channel(client.cache, 20, &channel));
+    mu_check(!cord_cache_get_member(client.cache, 10, 40, &member));
+    mu_check(cord_cache_get_member(client.cache, 11, 40, &member));
+    mu_assert_int_eq(0, cord_cache_count(client.cache, CORD_CACHE_ROLES));
+    mu_assert_int_eq(1, cord_cache_count(client.cache, CORD_CACHE_MEMBERS));
+
+    cord_cache_destroy(client.cache);
+    cord_bump_destroy(client.temporary_allocator);
+    remove_handlers();
+}
+
+static void add_member(cord_client_t *client, u64 user_id) {
+    char frame[256];
+    snprintf(frame,
+             sizeof(frame),
+             "{\"t\":\"GUILD_MEMBER_ADD\",\"s\":1,\"op\":0,\"d\":{"
+             "\"guild_id\":\"10\",\"user\":{\"id\":\"%lu\"},"
+             "\"roles\":[\"%lu\"]}}",
+             user_id,
+             user_id + 1);
+    handle_frame(client, frame);
+}
+
+MU_TEST(test_gateway_cache_lru) {
+    set_cache_handlers();
+
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    client.cache = cord_cache_create(cord_cache_default_config(100));
+    mu_check(client.cache);
+
+    cord_cached_member_t member = {0};
+    for (u64 id = 1; id <= 100; id++) {
+        add_member(&client, id);
+    }
+    // Reading the first member keeps it over the ones added after it
+    mu_check(cord_cache_get_member(client.cache, 10, 1, &member));
+    add_member(&client, 101);
+    mu_check(cord_cache_get_member(client.cache, 10, 1, &member));
+    mu_check(!cord_cache_get_member(client.cache, 10, 2, &member));
+    mu_assert_int_eq(100, cord_cache_count(client.cache, CORD_CACHE_MEMBERS));
+
+    // Churn leaves deleted slots in the index until it is rebuilt
+    for (u64 id = 1000; id < 101000; id++) {
+        add_member(&client, id);
+    }
+    mu_assert_int_eq(100, cord_cache_count(client.cache, CORD_CACHE_MEMBERS));
+    for (u64 id = 100900; id < 101000; id++) {
+        mu_check(cord_cache_get_member(client.cache, 10, id, &member));
+        mu_assert_int_eq(1, member.num_roles);
+        mu_check(member.roles[0] == id + 1);
+    }
+    mu_check(!cord_cache_get_member(client.cache, 10, 1, &member));
+
+    cord_cache_table_t *members = &client.cache->tables[CORD_CACHE_MEMBERS];
+    mu_check(cord_bump_used(members->index_allocator) < KB(16));
+
+    cord_cache_destroy(client.cache);
+    cord_bump_destroy(client.temporary_allocator);
+    remove_handlers();
+}
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = malloc((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    if (data) {
+        data[size] = '\0';
+        *length = (size_t)size;
+    }
+    return data;
+}
+
+static u32 record_length(const u8 *record) {
+    return (u32)record[0] | (u32)record[1] << 8 | (u32)record[2] << 16 |
+           (u32)record[3] << 24;
+}
+
+/*
+ * Feed a recorded zlib-stream, a sequence of websocket messages each
+ * prefixed with its length as u32 little endian, and compare the gateway
+ * messages it inflates to the expected lines
+ */
+static i32 inflate_recording(cord_inflate_t *inflater,
+                             const u8 *recording,
+                             size_t recording_length,
+                             char *expected) {
+    i32 messages = 0;
+    size_t position = 0;
+    char *line = strtok(expected, "\n");
+
+    while (position + 4 <= recording_length) {
+        u32 length = record_length(recording + position);
+        position += 4;
+
+        cord_str_t message = {0};
+        cord_inflate_result_t result = cord_inflate_message(
+            inflater, recording + position, length, &message);
+        position += length;
+
+        if (result == CORD_INFLATE_ERROR) {
+            return -1;
+        }
+        if (result == CORD_INFLATE_MESSAGE) {
+            if (!line || !cord_str_equals_cstring(message, line)) {
+                return -1;
+            }
+            line = strtok(NULL, "\n");
+            messages++;
+        }
+    }
+    return messages;
+}
+
+MU_TEST(test_gateway_inflate_recorded_stream) {
+    size_t recording_length = 0;
+    size_t expected_length = 0;
+    u8 *recording = (u8 *)read_file(TEST_DATA_DIR "/gateway_zlib_stream.bin",
+                                    &recording_length);
+    char *expected =
+        read_file(TEST_DATA_DIR "/gateway_frames.jsonl", &expected_length);
+    mu_assert(recording && expected, "recorded stream should be readable");
+
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+    cord_inflate_t inflater = {0};
+    mu_assert(cord_inflate_init(&inflater, allocator), "inflate init");
+
+    // Some messages span several websocket messages
+    char *copy = strdup(expected);
+    mu_assert_int_eq(
+        15, inflate_recording(&inflater, recording, recording_length, copy));
+    mu_assert(inflater.capacity > CORD_INFLATE_BUFFER_SIZE,
+              "buffer should grow for the 70KB GUILD_CREATE");
+    free(copy);
+
+    // A new connection starts the stream over
+    mu_assert(cord_inflate_reset(&inflater), "inflate reset");
+    copy = strdup(expected);
+    mu_assert_int_eq(
+        15, inflate_recording(&inflater, recording, recording_length, copy));
+    free(copy);
+
+    // Without the start of the stream the rest can't be inflated
+    mu_assert(cord_inflate_reset(&inflater), "inflate reset");
+    size_t first = 4 + record_length(recording);
+    copy = strdup(expected);
+    mu_assert_int_eq(-1,
+                     inflate_recording(&inflater,
+                                       recording + first,
+                                       recording_length - first,
+                                       copy));
+    free(copy);
+
+    cord_inflate_destroy(&inflater);
+    cord_bump_destroy(allocator);
+    free(expected);
+    free(recording);
+}
+
+MU_TEST(test_gateway_identify_gate) {
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(4));
+    cord_identify_gate_t gate = {0};
+    mu_assert(cord_identify_gate_init(&gate, allocator, 2), "gate init");
+
+    // Shards 0 and 2 share a bucket, 1 and 3 the other
+    mu_assert_double_eq(0.0, cord_identify_gate_reserve(&gate, 0, 100.0));
+    mu_assert_double_eq(0.0, cord_identify_gate_reserve(&gate, 1, 100.0));
+    mu_assert_double_eq(5.0, cord_identify_gate_reserve(&gate, 2, 100.0));
+    mu_assert_double_eq(7.0, cord_identify_gate_reserve(&gate, 0, 103.0));
+    mu_assert_double_eq(3.0, cord_identify_gate_reserve(&gate, 3, 102.0));
+
+    // A bucket that was idle for long enough doesn't wait
+    mu_assert_double_eq(0.0, cord_identify_gate_reserve(&gate, 1, 200.0));
+    cord_identify_gate_destroy(&gate);
+
+    // No concurrency given is one at a time
+    mu_assert(cord_identify_gate_init(&gate, allocator, 0), "gate init");
+    mu_assert_double_eq(0.0, cord_identify_gate_reserve(&gate, 5, 10.0));
+    mu_assert_double_eq(5.0, cord_identify_gate_reserve(&gate, 6, 10.0));
+    cord_identify_gate_destroy(&gate);
+
+    cord_bump_destroy(allocator);
+}
+
+static char resume_sent[512];
+
+static i32 resume_send(struct uwsc_client *ws_client,
+                       const void *data,
+                       size_t length,
+                       i32 op) {
+    (void)ws_client;
+    (void)op;
+    size_t copied = min(length, sizeof(resume_sent) - 1);
+    memcpy(resume_sent, data, copied);
+    resume_sent[copied] = '\0';
+    return (i32)length;
+}
+
+MU_TEST(test_gateway_resume) {
+    remove_handlers();
+
+    struct uwsc_client ws_client = {0};
+    ws_client.send = resume_send;
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.loop = ev_loop_new(0);
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    client.persistent_allocator = cord_bump_create_with_size(KB(4));
+    client.identity.token = "test-token";
+    client.ws_client = &ws_client;
+    ws_client.loop = client.loop;
+    ws_client.ext = &client;
+
+    // Nothing handles READY, the client reads it anyway
+    handle_frame(&client,
+                 "{\"t\":\"READY\",\"s\":1,\"op\":0,"
+                 "\"d\":{\"v\":10,\"session_id\":\"8ac7f1a2\","
+                 "\"resume_gateway_url\":\"wss://resume.discord.gg\"}}");
+    mu_assert_string_eq("8ac7f1a2", client.session_id);
+    mu_assert_string_eq("wss://resume.discord.gg", client.resume_url);
+    mu_assert_int_eq(0, (i32)client.dropped_events);
+
+    handle_frame(&client,
+                 "{\"t\":\"TYPING_START\",\"s\":5,\"op\":0,\"d\":{}}");
+    mu_assert_int_eq(5, client.sequence);
+
+    // A new connection resumes where the last one stopped
+    handle_frame(&client, "{\"op\":10,\"d\":{\"heartbeat_interval\":41250}}");
+    mu_assert_string_eq("{\"op\":6,\"d\":{\"token\":\"test-token\","
+                        "\"session_id\":\"8ac7f1a2\",\"seq\":5}}",
+                        resume_sent);
+    mu_check(ev_is_active(client.hb_watcher));
+
+    // A session that can be resumed takes a new connection
+    handle_frame(&client, "{\"op\":9,\"d\":true}");
+    mu_check(client.must_reconnect);
+    mu_assert_string_eq("8ac7f1a2", client.session_id);
+    client.must_reconnect = false;
+
+    // Otherwise the client identifies again after a while
+    handle_frame(&client, "{\"op\":9,\"d\":false}");
+    mu_check(!client.must_reconnect);
+    mu_assert_string_eq("", client.session_id);
+    mu_assert_int_eq(-1, client.sequence);
+    mu_check(ev_is_active(&client.identify_timer));
+    f64 remaining = ev_timer_remaining(client.loop, &client.identify_timer);
+    mu_check(remaining >= 0.9 && remaining <= 5.0);
+
+    ev_timer_stop(client.loop, &client.identify_timer);
+    ev_timer_stop(client.loop, client.hb_watcher);
+    ev_loop_destroy(client.loop);
+    cord_bump_destroy(client.persistent_allocator);
+    cord_bump_destroy(client.temporary_allocator);
+}
+
+MU_TEST(test_gateway_control_frames) {
+    remove_handlers();
+
+    struct uwsc_client ws_client = {0};
+    ws_client.send = resume_send;
+    cord_client_t client = {0};
+    client.sequence = -1;
+    client.intents = 513;
+    client.loop = ev_loop_new(0);
+    client.temporary_allocator = cord_bump_create_with_size(KB(64));
+    client.persistent_allocator = cord_bump_create_with_size(KB(4));
+    client.identity = (identity_info_t){"to\"ken\n", "linux", "cord", "cord"};
+    client.shard_id = 1;
+    client.shard_count = 2;
+    client.ws_client = &ws_client;
+    ws_client.loop = client.loop;
+    ws_client.ext = &client;
+
+    handle_frame(&client, "{\"op\":10,\"d\":{\"heartbeat_interval\":41250}}");
+    mu_assert_string_eq(
+        "{\"op\":2,\"d\":{\"token\":\"to\\\"ken\\n\",\"intents\":513,"
+        "\"large_threshold\":50,\"compress\":false,\"shard\":[1,2],"
+        "\"properties\":{\"os\":\"linux\",\"browser\":\"cord\","
+        "\"device\":\"cord\"}}}",
+        resume_sent);
+
+    handle_frame(&client, "{\"op\":1,\"d\":null}");
+    mu_assert_string_eq("{\"op\":1,\"d\":null}", resume_sent);
+    handle_frame(&client,
+                 "{\"t\":\"TYPING_START\",\"s\":2147483647,\"op\":0,\"d\":{}}");
+    handle_frame(&client, "{\"op\":1,\"d\":null}");
+    mu_assert_string_eq("{\"op\":1,\"d\":2147483647}", resume_sent);
+
+    ev_timer_stop(client.loop, client.hb_watcher);
+    ev_loop_destroy(client.loop);
+    cord_bump_destroy(client.persistent_allocator);
+    cord_bump_destroy(client.temporary_allocator);
+}
+
+MU_TEST(test_gateway_message_to_json) {
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(4));
+
+    cord_message_t message = {0};
+    message.content = cstr("say \"hi\"");
+    cord_message_reference_t reference = {.message_id = 42};
+    message.message_reference = &reference;
+
+    cord_embed_footer_t footer = {.text = cstr("footer")};
+    message.embeds = cord_array_create(allocator, sizeof(cord_embed_t));
+    cord_embed_t *embed = cord_array_push(message.embeds);
+    cord_embed_init(embed, allocator);
+    embed->title = cstr("title");
+    embed->color = 0xff00;
+    embed->footer = &footer;
+    embed->fields = cord_array_create(allocator, sizeof(cord_embed_field_t));
+    cord_embed_field_t *field = cord_array_push(embed->fields);
+    *field = (cord_embed_field_t){cstr("a"), cstr("b"), true, allocator};
+
+    cord_json_writer_t writer;
+    cord_json_writer_init(&writer, allocator);
+    mu_assert_string_eq(
+        "{\"content\":\"say \\\"hi\\\"\",\"embeds\":[{\"title\":\"title\","
+        "\"color\":65280,\"footer\":{\"text\":\"footer\"},\"fields\":"
+        "[{\"name\":\"a\",\"value\":\"b\",\"inline\":true}]}],"
+        "\"message_reference\":{\"message_id\":\"42\"}}",
+        cord_message_to_json(&writer, &message));
+
+    cord_bump_destroy(allocator);
+}
+
+MU_TEST(test_gateway_message_builder_json) {
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(4));
+
+    cord_message_builder_t builder;
+    cord_message_builder_init(&builder, allocator, 1);
+    cord_message_builder_set_content(&builder, cstr("<@2> look"));
+    mu_check(cord_message_builder_reply_to(&builder, 3));
+
+    cord_embed_t *embed = cord_message_builder_add_embed(&builder);
+    embed->description = cstr("two\nlines");
+    mu_check(cord_embed_add_field(embed, cstr("n"), cstr("v"), false));
+
+    cord_allowed_mentions_t *mentions =
+        cord_message_builder_allowed_mentions(&builder, CORD_MENTION_ROLES);
+    mu_check(cord_allowed_mentions_add_user(mentions, 2));
+
+    cord_component_t *row = cord_message_builder_add_row(&builder);
+    cord_component_add_button(
+        row, CORD_BUTTON_PRIMARY, cstr("Yes"), cstr("vote_yes"));
+    cord_component_add_button(
+        row, CORD_BUTTON_LINK, cstr("Docs"), cstr("https://example.com"));
+
+    mu_check(cord_message_builder_attach_file(
+        &builder, "log.txt", "/var/log/bot.log", cstr("")));
+    mu_check(cord_message_builder_attach_data(
+        &builder, "chart.png", "png", 3, cstr("Votes")));
+
+    cord_json_writer_t writer;
+    cord_json_writer_init(&writer, allocator);
+    mu_assert_string_eq(
+        "{\"content\":\"<@2> look\",\"embeds\":[{\"description\":"
+        "\"two\\nlines\",\"fields\":[{\"name\":\"n\",\"value\":\"v\"}]}],"
+        "\"message_reference\":{\"message_id\":\"3\"},"
+        "\"allowed_mentions\":{\"parse\":[\"roles\"],\"users\":[\"2\"],"
+        "\"replied_user\":false},"
+        "\"components\":[{\"type\":1,\"components\":["
+        "{\"type\":2,\"style\":1,\"label\":\"Yes\",\"custom_id\":\"vote_yes\"},"
+        "{\"type\":2,\"style\":5,\"label\":\"Docs\","
+        "\"url\":\"https://example.com\"}]}],"
+        "\"attachments\":[{\"id\":0,\"filename\":\"log.txt\"},"
+        "{\"id\":1,\"filename\":\"chart.png\",\"description\":\"Votes\"}]}",
+        cord_message_builder_to_json(&writer, &builder));
+
+    // Files are handed to the request as they were attached
+    cord_http_file_t *files = (void *)builder.files->data;
+    mu_assert_string_eq("/var/log/bot.log", files[0].path);
+    mu_assert_int_eq(3, (i32)files[1].length);
+
+    cord_bump_destroy(allocator);
+}
+
+MU_TEST(test_gateway_reconnect_delay) {
+    // The first retry is quick, later ones back off up to a minute
+    mu_assert_double_eq(0.05, cord_reconnect_delay(0, 0.0));
+    mu_assert_double_eq(0.1, cord_reconnect_delay(0, 1.0));
+    mu_assert_double_eq(0.4, cord_reconnect_delay(3, 0.0));
+    mu_assert_double_eq(0.6, cord_reconnect_delay(3, 0.5));
+    mu_assert_double_eq(30.0, cord_reconnect_delay(20, 0.0));
+    mu_assert_double_eq(60.0, cord_reconnect_delay(1000, 1.0));
+}
+
+#define TEST_SHARDS 4
+#define TEST_SHARD_MESSAGES 200
+
+/*
+ * What a shard sent to the websocket stand-in, each shard only writes to
+ * its own
+ */
+typedef struct stand_in_t {
+    char identify[512];
+    f64 identified_at;
+    i32 handled;
+} stand_in_t;
+
+static stand_in_t stand_ins[TEST_SHARDS];
+
+static i32 stand_in_send(struct uwsc_client *ws_client,
+                         const void *data,
+                         size_t length,
+                         i32 op) {
+    (void)op;
+
+    cord_client_t *client = ws_client->ext;
+    stand_in_t *stand_in = &stand_ins[client->shard_id];
+    if (memmem(data, length, "\"token\"", 7)) {
+        size_t copied = min(length, sizeof(stand_in->identify) - 1);
+        memcpy(stand_in->identify, data, copied);
+        stand_in->identify[copied] = '\0';
+        stand_in->identified_at = ev_time();
+    }
+    return (i32)length;
+}
+
+static void shard_handler(cord_client_t *client,
+                          cord_json_reader_t *data,
+                          cord_str_t event) {
+    (void)data;
+    (void)event;
+    stand_ins[client->shard_id].handled++;
+}
+
+/*
+ * Stands in for the gateway on the shard's thread: says HELLO, waits on
+ * the shard's loop for the identify and then dispatches messages
+ */
+static i32 stand_in_run(cord_client_t *client) {
+    struct uwsc_client ws_client = {0};
+    ws_client.loop = client->loop;
+    ws_client.ext = client;
+    ws_client.send = stand_in_send;
+    client->ws_client = &ws_client;
+    client->temporary_allocator = cord_bump_create_with_size(KB(64));
+
+    handle_frame(client, "{\"op\":10,\"d\":{\"heartbeat_interval\":41250}}");
+    while (stand_ins[client->shard_id].identify[0] == '\0') {
+        ev_run(client->loop, EVRUN_ONCE);
+    }
+
+    for (i32 i = 0; i < TEST_SHARD_MESSAGES; i++) {
+        handle_frame(client,
+                     "{\"t\":\"MESSAGE_CREATE\",\"s\":2,\"op\":0,"
+                     "\"d\":{\"id\":\"1\"}}");
+    }
+
+    client->ws_client = NULL;
+    return 0;
+}
+
+MU_TEST(test_gateway_shards) {
+    remove_handlers();
+    cord_gateway_event_set_handler(GATEWAY_EVENT_MESSAGE_CREATE,
+                                   shard_handler);
+    memset(stand_ins, 0, sizeof(stand_ins));
+    setenv("CORD_APPLICATION_TOKEN", "test-token", 0);
+
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(16));
+    cord_shards_t *shards = cord_shards_create(allocator, TEST_SHARDS, 2);
+    mu_assert(shards, "shards should be created");
+    shards->run = stand_in_run;
+    shards->gate.interval = 0.1;
+
+    mu_assert(cord_shards_run(shards), "shards should run");
+
+    for (i32 i = 0; i < TEST_SHARDS; i++) {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "\"shard\":[%d,%d]", i, 4);
+        mu_assert(strstr(stand_ins[i].identify, expected), expected);
+        mu_assert_int_eq(TEST_SHARD_MESSAGES, stand_ins[i].handled);
+        mu_assert_int_eq(0, shards->shards[i].result);
+    }
+
+    // Shards of the same bucket identify an interval apart
+    for (i32 i = 0; i + 2 < TEST_SHARDS; i++) {
+        f64 apart = stand_ins[i + 2].identified_at - stand_ins[i].identified_at;
+        mu_assert(apart > 0.09 || apart < -0.09,
+                  "identifies of a bucket should be paced");
+    }
+
+    cord_shards_destroy(shards);
+    cord_bump_destroy(allocator);
+    remove_handlers();
+}
+
+MU_TEST_SUITE(test_suite) {
+    MU_RUN_TEST(test_gateway_event_lookup);
+    MU_RUN_TEST(test_gateway_event_lookup_unknown);
+    MU_RUN_TEST(test_gateway_event_set_handler);
+    MU_RUN_TEST(test_gateway_intents_from_handlers);
+    MU_RUN_TEST(test_gateway_drop_unhandled_events);
+    MU_RUN_TEST(test_gateway_dispatch_borrows_frame);
+    MU_RUN_TEST(test_gateway_message_arenas);
+    MU_RUN_TEST(test_gateway_message_view);
+    MU_RUN_TEST(test_gateway_message_view_truncated);
+    MU_RUN_TEST(test_gateway_message_view_handler);
+    MU_RUN_TEST(test_gateway_cache);
+    MU_RUN_TEST(test_gateway_cache_lru);
+    MU_RUN_TEST(test_gateway_inflate_recorded_stream);
+    MU_RUN_TEST(test_gateway_identify_gate);
+    MU_RUN_TEST(test_gateway_resume);
+    MU_RUN_TEST(test_gateway_control_frames);
+    MU_RUN_TEST(test_gateway_message_to_json);
+    MU_RUN_TEST(test_gateway_message_builder_json);
+    MU_RUN_TEST(test_gateway_reconnect_delay);
+    MU_RUN_TEST(test_gateway_shards);
+}
+
+int main(void) {
+    global_logger_init();
+    MU_RUN_SUITE(test_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
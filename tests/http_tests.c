@@ -0,0 +1,809 @@
+#define _DEFAULT_SOURCE
+
+#include "minunit.h"
+
+#include "../src/core/log.h"
+#include "../src/core/memory.h"
+#include "../src/core/strings.h"
+#include "../src/http/async.h"
+#include "../src/http/http.h"
+#include "../src/http/ratelimit.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * The rate limiter runs against a fake clock and a mock of the Discord API
+ * that enforces its own buckets, so every test is deterministic and fast.
+ */
+
+#define MOCK_MAX_REQUESTS 256
+#define MOCK_MAX_BUCKETS 256
+#define MOCK_LATENCY 0.01
+
+typedef struct mock_bucket_t {
+    u64 channel;
+    i32 remaining;
+    f64 reset_at;
+} mock_bucket_t;
+
+typedef struct mock_server_t {
+    f64 now;
+    f64 wakeup;
+
+    // requests sent by the limiter that wait for a response
+    cord_ratelimit_request_t *inbox[MOCK_MAX_REQUESTS];
+    i32 num_inbox;
+
+    mock_bucket_t buckets[MOCK_MAX_BUCKETS];
+    i32 num_buckets;
+    i32 bucket_limit;
+    f64 bucket_window;
+
+    // answer the next request with a global 429
+    f64 global_retry_after;
+
+    f64 arrivals[MOCK_MAX_REQUESTS * 4];
+    i32 num_arrivals;
+    i32 num_429;
+    i32 num_completed;
+    i32 num_failed;
+} mock_server_t;
+
+static cord_bump_t *allocator = NULL;
+static mock_server_t mock = {0};
+
+static f64 mock_now(void *ctx) {
+    return ((mock_server_t *)ctx)->now;
+}
+
+static void mock_schedule(void *ctx, f64 at) {
+    ((mock_server_t *)ctx)->wakeup = at;
+}
+
+static bool mock_send(void *ctx, cord_ratelimit_request_t *request) {
+    mock_server_t *server = ctx;
+    server->inbox[server->num_inbox++] = request;
+    return true;
+}
+
+static mock_bucket_t *mock_bucket(mock_server_t *server, const char *url) {
+    u64 channel = 0;
+    const char *resource = strstr(url, "/channels/");
+    if (resource) {
+        sscanf(resource, "/channels/%lu", &channel);
+    }
+
+    for (i32 i = 0; i < server->num_buckets; i++) {
+        if (server->buckets[i].channel == channel) {
+            return &server->buckets[i];
+        }
+    }
+
+    mock_bucket_t *bucket = &server->buckets[server->num_buckets++];
+    *bucket = (mock_bucket_t){.channel = channel, .reset_at = -1.0};
+    return bucket;
+}
+
+static cord_http_result_t mock_respond(mock_server_t *server,
+                                       cord_ratelimit_request_t *request,
+                                       char *headers,
+                                       size_t size) {
+    server->arrivals[server->num_arrivals++] = server->now;
+
+    if (server->global_retry_after > 0) {
+        i32 length = snprintf(headers,
+                              size,
+                              "HTTP/1.1 429 Too Many Requests\r\n"
+                              "Retry-After: %.3f\r\n"
+                              "X-RateLimit-Global: true\r\n"
+                              "X-RateLimit-Scope: global\r\n\r\n",
+                              server->global_retry_after);
+        server->global_retry_after = 0;
+        server->num_429++;
+        return (cord_http_result_t){.status = 429,
+                                    .error = true,
+                                    .headers = {headers, length}};
+    }
+
+    mock_bucket_t *bucket = mock_bucket(server, request->url);
+    if (server->now >= bucket->reset_at) {
+        bucket->remaining = server->bucket_limit;
+        bucket->reset_at = server->now + server->bucket_window;
+    }
+
+    bool limited = bucket->remaining == 0;
+    if (limited) {
+        server->num_429++;
+    } else {
+        bucket->remaining--;
+    }
+
+    i32 length = snprintf(headers,
+                          size,
+                          "HTTP/1.1 %d\r\n"
+                          "x-ratelimit-limit: %d\r\n"
+                          "x-ratelimit-remaining: %d\r\n"
+                          "x-ratelimit-reset-after: %.3f\r\n"
+                          "x-ratelimit-bucket: 80c17d2f203122d9\r\n"
+                          "%s\r\n",
+                          limited ? 429 : 200,
+                          server->bucket_limit,
+                          bucket->remaining,
+                          bucket->reset_at - server->now,
+                          limited ? "x-ratelimit-scope: user\r\n" : "");
+    return (cord_http_result_t){.status = limited ? 429 : 200,
+                                .error = limited,
+                                .headers = {headers, length}};
+}
+
+/*
+ * Answer in-flight requests after a fixed latency and jump the clock to
+ * the next wakeup when nothing is in flight
+ */
+static void mock_run(mock_server_t *server, cord_ratelimit_t *limiter) {
+    for (i32 step = 0; step < 100000; step++) {
+        if (server->num_inbox > 0) {
+            cord_ratelimit_request_t *inbox[MOCK_MAX_REQUESTS];
+            i32 count = server->num_inbox;
+            memcpy(inbox, server->inbox, sizeof(inbox[0]) * count);
+            server->num_inbox = 0;
+            server->now += MOCK_LATENCY;
+
+            for (i32 i = 0; i < count; i++) {
+                char headers[512] = {0};
+                cord_http_result_t result =
+                    mock_respond(server, inbox[i], headers, sizeof(headers));
+                cord_ratelimit_complete(limiter, inbox[i], result);
+            }
+        } else if (server->wakeup > 0) {
+            if (server->wakeup > server->now) {
+                server->now = server->wakeup;
+            }
+            server->wakeup = 0;
+            cord_ratelimit_wakeup(limiter);
+        } else {
+            return;
+        }
+    }
+}
+
+static void on_complete(cord_http_result_t result, void *user_data) {
+    mock_server_t *server = user_data;
+    if (!result.error) {
+        server->num_completed++;
+    } else {
+        server->num_failed++;
+    }
+}
+
+static cord_ratelimit_t *create_limiter(void) {
+    return cord_ratelimit_create(allocator,
+                                 (cord_ratelimit_env_t){
+                                     .now = mock_now,
+                                     .schedule = mock_schedule,
+                                     .send = mock_send,
+                                     .ctx = &mock,
+                                 });
+}
+
+static void submit_message(cord_ratelimit_t *limiter, u64 channel) {
+    char url[128] = {0};
+    snprintf(url,
+             sizeof(url),
+             "https://discord.com/api/v10/channels/%lu/messages",
+             channel);
+    const char *body = "{\"content\":\"hi\"}";
+    bool queued = cord_ratelimit_submit(
+        limiter, HTTP_POST, cstr(url), body, on_complete, &mock);
+    mu_check(queued);
+}
+
+void test_setup(void) {
+    allocator = cord_bump_create_with_size(KB(64));
+    mock = (mock_server_t){.bucket_limit = 5, .bucket_window = 2.0};
+}
+
+void test_teardown(void) {
+    cord_bump_destroy(allocator);
+    allocator = NULL;
+}
+
+MU_TEST(test_cord_http_header_value) {
+    cord_str_t headers = cstr("HTTP/1.1 200 OK\r\n"
+                              "Content-Type: application/json\r\n"
+                              "x-ratelimit-bucket:   abcd  \r\n\r\n");
+    cord_str_t bucket =
+        cord_http_header_value(headers, cstr("X-RateLimit-Bucket"));
+    mu_check(cord_str_equals_cstring(bucket, "abcd"));
+
+    cord_str_t missing = cord_http_header_value(headers, cstr("Retry-After"));
+    mu_assert_int_eq(0, missing.length);
+}
+
+MU_TEST(test_cord_ratelimit_parse_headers) {
+    cord_ratelimit_headers_t parsed =
+        cord_ratelimit_parse_headers(cstr("HTTP/1.1 200 OK\r\n"
+                                          "X-RateLimit-Limit: 5\r\n"
+                                          "X-RateLimit-Remaining: 1\r\n"
+                                          "X-RateLimit-Reset-After: 1.250\r\n"
+                                          "X-RateLimit-Bucket: abcd\r\n\r\n"));
+    mu_check(parsed.present);
+    mu_assert_int_eq(5, parsed.limit);
+    mu_assert_int_eq(1, parsed.remaining);
+    mu_assert_double_eq(1.25, parsed.reset_after);
+    mu_check(cord_str_equals_cstring(parsed.bucket, "abcd"));
+    mu_check(!parsed.global);
+
+    parsed = cord_ratelimit_parse_headers(cstr("HTTP/1.1 429\r\n"
+                                               "Retry-After: 0.5\r\n"
+                                               "X-RateLimit-Global: true\r\n"
+                                               "X-RateLimit-Scope: global\r\n"
+                                               "\r\n"));
+    mu_check(!parsed.present);
+    mu_check(parsed.global);
+    mu_assert_double_eq(0.5, parsed.retry_after);
+}
+
+MU_TEST(test_cord_ratelimit_route_key) {
+    u64 first_major = 0;
+    u64 second_major = 0;
+
+    u64 first = cord_ratelimit_route_key(
+        HTTP_DELETE,
+        cstr("https://discord.com/api/v10/channels/1/messages/100"),
+        &first_major);
+    u64 second = cord_ratelimit_route_key(
+        HTTP_DELETE,
+        cstr("https://discord.com/api/v10/channels/1/messages/200"),
+        &second_major);
+    mu_check(first == second);
+    mu_check(first_major == second_major);
+
+    u64 other_channel = cord_ratelimit_route_key(
+        HTTP_DELETE,
+        cstr("https://discord.com/api/v10/channels/2/messages/100"),
+        &second_major);
+    mu_check(first == other_channel);
+    mu_check(first_major != second_major);
+
+    u64 other_method = cord_ratelimit_route_key(
+        HTTP_PATCH,
+        cstr("https://discord.com/api/v10/channels/1/messages/100"),
+        &second_major);
+    mu_check(first != other_method);
+
+    u64 reaction = cord_ratelimit_route_key(
+        HTTP_DELETE,
+        cstr("https://discord.com/api/v10/channels/1/messages/1/reactions/"
+             "%F0%9F%91%8D/@me"),
+        &first_major);
+    u64 other_reaction = cord_ratelimit_route_key(
+        HTTP_DELETE,
+        cstr("https://discord.com/api/v10/channels/1/messages/2/reactions/"
+             "%F0%9F%8E%89/@me"),
+        &second_major);
+    mu_check(reaction == other_reaction);
+
+    cord_ratelimit_route_key(
+        HTTP_POST,
+        cstr("https://discord.com/api/v10/webhooks/1/first-token"),
+        &first_major);
+    cord_ratelimit_route_key(
+        HTTP_POST,
+        cstr("https://discord.com/api/v10/webhooks/1/second-token"),
+        &second_major);
+    mu_check(first_major != second_major);
+}
+
+MU_TEST(test_cord_ratelimit_paces_bucket) {
+    cord_ratelimit_t *limiter = create_limiter();
+    mu_check(limiter);
+
+    const i32 num_requests = 23;
+    for (i32 i = 0; i < num_requests; i++) {
+        submit_message(limiter, 1);
+    }
+    // Limits are unknown until the first response
+    mu_assert_int_eq(1, mock.num_inbox);
+
+    mock_run(&mock, limiter);
+    mu_assert_int_eq(num_requests, mock.num_completed);
+    mu_assert_int_eq(0, mock.num_429);
+    mu_assert_int_eq(0, (i32)limiter->num_rate_limited);
+
+    // 5 requests per 2 second window
+    mu_check(mock.now >= 8.0 && mock.now < 10.0);
+    cord_ratelimit_destroy(limiter);
+}
+
+MU_TEST(test_cord_ratelimit_destroy_fails_pending) {
+    cord_ratelimit_t *limiter = create_limiter();
+    for (i32 i = 0; i < 3; i++) {
+        submit_message(limiter, 1);
+    }
+    submit_message(limiter, 2);
+    mu_check(mock.num_inbox > 0);
+
+    // In-flight and queued requests are all failed, none are dropped
+    cord_ratelimit_destroy(limiter);
+    mu_assert_int_eq(0, mock.num_completed);
+    mu_assert_int_eq(4, mock.num_failed);
+
+    bool queued = cord_ratelimit_submit(limiter,
+                                        HTTP_POST,
+                                        cstr("https://discord.com/api/v10/x"),
+                                        NULL,
+                                        on_complete,
+                                        &mock);
+    mu_check(!queued);
+}
+
+MU_TEST(test_cord_ratelimit_retries_after_429) {
+    cord_ratelimit_t *limiter = create_limiter();
+    mock.global_retry_after = 0.5;
+
+    submit_message(limiter, 1);
+    submit_message(limiter, 2);
+    mock_run(&mock, limiter);
+
+    mu_assert_int_eq(2, mock.num_completed);
+    mu_assert_int_eq(1, (i32)limiter->num_rate_limited);
+
+    // Requests that were not already in flight wait for the global reset
+    f64 limited_at = mock.arrivals[0];
+    for (i32 i = 1; i < mock.num_arrivals; i++) {
+        if (mock.arrivals[i] > limited_at) {
+            mu_check(mock.arrivals[i] >= limited_at + 0.5);
+        }
+    }
+    mu_assert_int_eq(3, mock.num_arrivals);
+    cord_ratelimit_destroy(limiter);
+}
+
+MU_TEST(test_cord_ratelimit_global_limit) {
+    cord_ratelimit_t *limiter = create_limiter();
+
+    const i32 num_requests = 120;
+    for (i32 i = 0; i < num_requests; i++) {
+        submit_message(limiter, 1000 + i);
+    }
+    mu_assert_int_eq(RATELIMIT_GLOBAL_REQUESTS_PER_SECOND, mock.num_inbox);
+
+    mock_run(&mock, limiter);
+    mu_assert_int_eq(num_requests, mock.num_completed);
+    mu_assert_int_eq(0, mock.num_429);
+
+    for (i32 i = 0; i < mock.num_arrivals; i++) {
+        i32 in_window = 0;
+        for (i32 j = i; j < mock.num_arrivals; j++) {
+            if (mock.arrivals[j] < mock.arrivals[i] + 1.0) {
+                in_window++;
+            }
+        }
+        mu_check(in_window <= RATELIMIT_GLOBAL_REQUESTS_PER_SECOND);
+    }
+    cord_ratelimit_destroy(limiter);
+}
+
+MU_TEST(test_cord_ratelimit_shared_bucket_hash) {
+    cord_ratelimit_t *limiter = create_limiter();
+
+    submit_message(limiter, 1);
+    mock_run(&mock, limiter);
+    cord_ratelimit_submit(
+        limiter,
+        HTTP_PATCH,
+        cstr("https://discord.com/api/v10/channels/1/messages/10"),
+        "{}",
+        on_complete,
+        &mock);
+    mock_run(&mock, limiter);
+    mu_assert_int_eq(2, mock.num_completed);
+
+    // Both routes reported the same bucket hash for the same channel
+    cord_ratelimit_route_t *routes = (void *)limiter->routes->data;
+    mu_assert_int_eq(2, (i32)limiter->routes->num_elements);
+    mu_check(routes[0].bucket == routes[1].bucket);
+    cord_ratelimit_destroy(limiter);
+}
+
+MU_TEST(test_cord_ratelimit_multipart_copies_files) {
+    cord_ratelimit_t *limiter = create_limiter();
+    char filename[] = "report.txt";
+    char path[] = "/tmp/report.txt";
+    const char *data = "in memory";
+    cord_http_file_t files[] = {
+        {.filename = filename, .path = path},
+        {.filename = "data.bin", .data = data, .length = strlen(data)},
+    };
+
+    mu_check(cord_ratelimit_submit_multipart(
+        limiter,
+        cstr("https://discord.com/api/v10/channels/1/messages"),
+        "{}",
+        files,
+        2,
+        on_complete,
+        &mock));
+    memset(filename, 0, sizeof(filename));
+    memset(path, 0, sizeof(path));
+
+    // Names and paths are copied, data in memory is not
+    mu_assert_int_eq(1, mock.num_inbox);
+    cord_ratelimit_request_t *request = mock.inbox[0];
+    mu_assert_int_eq(2, request->num_files);
+    mu_assert_string_eq("report.txt", request->files[0].filename);
+    mu_assert_string_eq("/tmp/report.txt", request->files[0].path);
+    mu_check(request->files[1].data == data);
+
+    // A retried request keeps its files
+    mock.global_retry_after = 0.5;
+    mock_run(&mock, limiter);
+    mu_assert_int_eq(1, mock.num_429);
+    mu_assert_int_eq(1, mock.num_completed);
+    cord_ratelimit_destroy(limiter);
+}
+
+/*
+ * Transport that keeps what it sends in flight forever, or fails every
+ * send once failing is set
+ */
+typedef struct failing_env_t {
+    f64 now;
+    f64 wakeup;
+    bool failing;
+    i32 failed;
+    i32 spawned;
+    cord_ratelimit_t *limiter;
+} failing_env_t;
+
+static f64 failing_now(void *ctx) {
+    return ((failing_env_t *)ctx)->now;
+}
+
+static void failing_schedule(void *ctx, f64 at) {
+    ((failing_env_t *)ctx)->wakeup = at;
+}
+
+static bool failing_send(void *ctx, cord_ratelimit_request_t *request) {
+    (void)request;
+    return !((failing_env_t *)ctx)->failing;
+}
+
+static void submit_to_channel(failing_env_t *env, u64 channel);
+
+// Every failure sends to a channel of its own, which takes a new bucket
+static void on_failed(cord_http_result_t result, void *user_data) {
+    failing_env_t *env = user_data;
+    if (result.error) {
+        env->failed++;
+    }
+    if (env->spawned < 10) {
+        env->spawned++;
+        submit_to_channel(env, 1000 + (u64)env->spawned);
+    }
+}
+
+static void submit_to_channel(failing_env_t *env, u64 channel) {
+    char url[128] = {0};
+    snprintf(url,
+             sizeof(url),
+             "https://discord.com/api/v10/channels/%lu/messages",
+             channel);
+    cord_ratelimit_submit(
+        env->limiter, HTTP_POST, cstr(url), "{}", on_failed, env);
+}
+
+MU_TEST(test_cord_ratelimit_wakeup_adds_buckets) {
+    failing_env_t env = {0};
+    env.limiter = cord_ratelimit_create(allocator,
+                                        (cord_ratelimit_env_t){
+                                            .now = failing_now,
+                                            .schedule = failing_schedule,
+                                            .send = failing_send,
+                                            .ctx = &env,
+                                        });
+    mu_check(env.limiter);
+
+    // 50 go out, the global limit holds the other 10 back
+    for (u64 channel = 1; channel <= 60; channel++) {
+        submit_to_channel(&env, channel);
+    }
+    mu_assert_int_eq(60, (i32)env.limiter->buckets->num_elements);
+    mu_check(env.wakeup > 0);
+
+    // Their callbacks grow the bucket array while it is walked
+    env.failing = true;
+    env.now = env.wakeup;
+    cord_ratelimit_wakeup(env.limiter);
+    mu_assert_int_eq(20, env.failed);
+    mu_assert_int_eq(70, (i32)env.limiter->buckets->num_elements);
+    cord_ratelimit_destroy(env.limiter);
+}
+
+#define FORM_SERVER_REQUESTS 3
+
+/*
+ * Answers a few requests on a local socket and keeps what was sent, so the
+ * forms curl writes can be checked without a network
+ */
+typedef struct form_server_t {
+    i32 listener;
+    // Requests answered before the server stops
+    i32 expected;
+    char requests[FORM_SERVER_REQUESTS][KB(4)];
+} form_server_t;
+
+static size_t content_length(const char *request) {
+    const char *header = strstr(request, "Content-Length: ");
+    return header ? strtoul(header + 16, NULL, 10) : 0;
+}
+
+static void *serve_forms(void *arg) {
+    form_server_t *server = arg;
+    for (i32 i = 0; i < server->expected; i++) {
+        i32 fd = accept(server->listener, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+
+        char *request = server->requests[i];
+        size_t length = 0;
+        for (;;) {
+            ssize_t n = recv(fd, request + length, KB(4) - 1 - length, 0);
+            if (n <= 0) {
+                break;
+            }
+            length += (size_t)n;
+            request[length] = '\0';
+            char *body = strstr(request, "\r\n\r\n");
+            if (body && (size_t)(request + length - (body + 4)) >=
+                            content_length(request)) {
+                break;
+            }
+        }
+
+        const char *response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n"
+                               "Connection: close\r\n\r\n{}";
+        send(fd, response, strlen(response), 0);
+        close(fd);
+    }
+    return NULL;
+}
+
+static bool has_header(const char *request, const char *header) {
+    const char *end = strstr(request, "\r\n\r\n");
+    const char *found = strstr(request, header);
+    return found && end && found < end;
+}
+
+// Serves expected requests on a thread, returns the port or -1
+static i32 form_server_start(form_server_t *server,
+                             i32 expected,
+                             pthread_t *thread) {
+    struct sockaddr_in address = {.sin_family = AF_INET,
+                                  .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    socklen_t address_length = sizeof(address);
+    server->expected = expected;
+    server->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (bind(server->listener, (struct sockaddr *)&address, sizeof(address)) ||
+        listen(server->listener, FORM_SERVER_REQUESTS) ||
+        getsockname(
+            server->listener, (struct sockaddr *)&address, &address_length)) {
+        return -1;
+    }
+    pthread_create(thread, NULL, serve_forms, server);
+    return ntohs(address.sin_port);
+}
+
+MU_TEST(test_cord_http_post_multipart) {
+    form_server_t *server = calloc(1, sizeof(form_server_t));
+    pthread_t thread;
+    i32 port = form_server_start(server, 2, &thread);
+    mu_check(port > 0);
+
+    char path[] = "/tmp/cord_form_XXXXXX";
+    i32 fd = mkstemp(path);
+    mu_check(fd >= 0);
+    mu_check(write(fd, "read from disk", 14) == 14);
+    close(fd);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/form", port);
+    const char *data = "sent from memory";
+    cord_http_file_t files[] = {
+        {.filename = "disk.txt", .path = path},
+        {.filename = "memory.bin",
+         .content_type = "application/octet-stream",
+         .data = data,
+         .length = strlen(data)},
+    };
+
+    cord_http_client_t *client = cord_http_client_create(allocator, "token");
+    cord_http_result_t result = cord_http_post_multipart(
+        client, cstr(url), "{\"content\":\"files\"}", files, 2);
+    mu_check(!result.error);
+    free(result.body);
+
+    // The pooled handle goes back to sending json
+    result = cord_http_post(client, NULL, cstr(url), "{}");
+    mu_check(!result.error);
+    free(result.body);
+
+    pthread_join(thread, NULL);
+    cord_http_client_destroy(client);
+    close(server->listener);
+    unlink(path);
+
+    const char *form = server->requests[0];
+    mu_check(has_header(form, "Authorization: Bot token"));
+    mu_check(has_header(form, "Content-Type: multipart/form-data; boundary="));
+    mu_check(!has_header(form, "Content-Type: application/json"));
+    mu_check(strstr(form, "name=\"payload_json\"\r\n"
+                          "Content-Type: application/json\r\n\r\n"
+                          "{\"content\":\"files\"}"));
+    mu_check(strstr(form, "name=\"files[0]\"; filename=\"disk.txt\""));
+    mu_check(strstr(form, "\r\n\r\nread from disk\r\n"));
+    mu_check(strstr(form, "name=\"files[1]\"; filename=\"memory.bin\"\r\n"
+                          "Content-Type: application/octet-stream\r\n\r\n"
+                          "sent from memory\r\n"));
+
+    const char *json = server->requests[1];
+    mu_check(has_header(json, "Content-Type: application/json"));
+    mu_check(!has_header(json, "multipart"));
+    free(server);
+}
+
+typedef struct async_results_t {
+    i32 completed;
+    i32 cancelled;
+    i32 status[2];
+    char body[2][16];
+} async_results_t;
+
+static void on_async_complete(cord_http_future_t *future,
+                              cord_http_result_t result,
+                              void *user_data) {
+    (void)future;
+    async_results_t *results = user_data;
+    i32 i = results->completed++;
+    if (i < 2) {
+        results->status[i] = result.error ? -1 : result.status;
+        snprintf(results->body[i],
+                 sizeof(results->body[i]),
+                 "%.*s",
+                 (i32)result.length,
+                 result.body);
+    }
+}
+
+static void on_cancelled_complete(cord_http_future_t *future,
+                                  cord_http_result_t result,
+                                  void *user_data) {
+    (void)future;
+    (void)result;
+    ((async_results_t *)user_data)->cancelled++;
+}
+
+static void on_complete_cancels(cord_http_future_t *future,
+                                cord_http_result_t result,
+                                void *user_data) {
+    cord_http_future_cancel(future);
+    on_async_complete(future, result, user_data);
+}
+
+// Runs the loop until the engine has nothing in flight
+static void run_async(struct ev_loop *loop, cord_http_async_t *engine) {
+    for (i32 i = 0; i < 1000 && cord_http_async_in_flight(engine) > 0; i++) {
+        ev_run(loop, EVRUN_ONCE);
+    }
+}
+
+static bool served(form_server_t *server, const char *request_line) {
+    for (i32 i = 0; i < server->expected; i++) {
+        if (strncmp(server->requests[i],
+                    request_line,
+                    strlen(request_line)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+MU_TEST(test_cord_http_async_requests) {
+    form_server_t *server = calloc(1, sizeof(form_server_t));
+    pthread_t thread;
+    i32 port = form_server_start(server, 3, &thread);
+    mu_check(port > 0);
+
+    char base[64];
+    snprintf(base, sizeof(base), "http://127.0.0.1:%d", port);
+    char url[96];
+
+    struct ev_loop *loop = ev_loop_new(0);
+    cord_http_client_t *client = cord_http_client_create(allocator, "token");
+    cord_http_async_t *engine = cord_http_async_create(allocator, loop, client);
+    mu_check(engine);
+    async_results_t results = {0};
+
+    // Both requests are in flight at once, on the loop's sockets
+    snprintf(url, sizeof(url), "%s/first", base);
+    cord_http_future_t *first =
+        cord_http_async_get(engine, cstr(url), on_async_complete, &results);
+    snprintf(url, sizeof(url), "%s/second", base);
+    cord_http_future_t *second = cord_http_async_post(
+        engine, cstr(url), "{\"n\":2}", on_async_complete, &results);
+    snprintf(url, sizeof(url), "%s/cancelled", base);
+    cord_http_future_t *cancelled = cord_http_async_get(
+        engine, cstr(url), on_cancelled_complete, &results);
+    mu_check(first && second && cancelled);
+    mu_assert_int_eq(3, (i32)cord_http_async_in_flight(engine));
+
+    cord_http_future_cancel(cancelled);
+    mu_assert_int_eq(2, (i32)cord_http_async_in_flight(engine));
+    run_async(loop, engine);
+    mu_assert_int_eq(2, results.completed);
+    mu_assert_int_eq(0, results.cancelled);
+    for (i32 i = 0; i < 2; i++) {
+        mu_assert_int_eq(200, results.status[i]);
+        mu_assert_string_eq("{}", results.body[i]);
+    }
+
+    // Finished and cancelled futures are reused
+    snprintf(url, sizeof(url), "%s/third", base);
+    cord_http_future_t *third =
+        cord_http_async_get(engine, cstr(url), on_complete_cancels, &results);
+    mu_check(third == first || third == second || third == cancelled);
+    run_async(loop, engine);
+    mu_assert_int_eq(3, results.completed);
+
+    // Cancelling from the callback doesn't recycle the future twice
+    i32 idle = 0;
+    for (cord_http_future_t *it = engine->idle; it && idle < 4; it = it->next) {
+        idle++;
+    }
+    mu_assert_int_eq(3, idle);
+
+    pthread_join(thread, NULL);
+    cord_http_async_destroy(engine);
+    cord_http_client_destroy(client);
+    ev_loop_destroy(loop);
+    close(server->listener);
+
+    mu_check(served(server, "GET /first "));
+    mu_check(served(server, "POST /second "));
+    mu_check(served(server, "GET /third "));
+    mu_check(!served(server, "GET /cancelled "));
+    free(server);
+}
+
+MU_TEST_SUITE(test_ratelimit) {
+    MU_SUITE_CONFIGURE(&test_setup, &test_teardown);
+
+    MU_RUN_TEST(test_cord_http_header_value);
+    MU_RUN_TEST(test_cord_ratelimit_parse_headers);
+    MU_RUN_TEST(test_cord_ratelimit_route_key);
+    MU_RUN_TEST(test_cord_ratelimit_paces_bucket);
+    MU_RUN_TEST(test_cord_ratelimit_destroy_fails_pending);
+    MU_RUN_TEST(test_cord_ratelimit_retries_after_429);
+    MU_RUN_TEST(test_cord_ratelimit_global_limit);
+    MU_RUN_TEST(test_cord_ratelimit_shared_bucket_hash);
+    MU_RUN_TEST(test_cord_ratelimit_multipart_copies_files);
+    MU_RUN_TEST(test_cord_ratelimit_wakeup_adds_buckets);
+    MU_RUN_TEST(test_cord_http_post_multipart);
+    MU_RUN_TEST(test_cord_http_async_requests);
+}
+
+int main(void) {
+    global_logger_init();
+    MU_RUN_SUITE(test_ratelimit);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -1,28 +1,532 @@
 #include "minunit.h"
 
+#include "../src/core/json_index.h"
+#include "../src/core/json_reader.h"
+#include "../src/core/json_writer.h"
+#include "../src/core/memory.h"
+#include "../src/core/strings.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
 static int in = 0;
 static int expect = 0;
+static cord_bump_t *allocator = NULL;
 
 void test_setup(void) {
     in = 1;
     expect = 1;
+    allocator = cord_bump_create_with_size(KB(4));
 }
 
 void test_teardown(void) {
-    // ...
+    cord_bump_destroy(allocator);
+    allocator = NULL;
+}
+
+static bool str_eq(cord_str_t str, const char *expected) {
+    return cord_str_equals(str, cstr(expected));
+}
+
+static bool slice_of(cord_str_t str, const char *input) {
+    return str.data >= input && str.data < input + strlen(input);
 }
 
 MU_TEST(test_my_assert) {
     mu_assert(in == 1, "in should be 1");
 }
 
+MU_TEST(test_json_reader_tokens) {
+    const char *input =
+        "{\"op\": 0, \"t\": \"READY\", \"ok\": true, \"no\": false, "
+        "\"d\": null, \"list\": [1, -2.5e3, {}], \"empty\": []}";
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, cstr(input), allocator);
+
+    cord_json_token_type_t expected[] = {
+        CORD_JSON_TOKEN_OBJECT_START, CORD_JSON_TOKEN_KEY,
+        CORD_JSON_TOKEN_NUMBER,       CORD_JSON_TOKEN_KEY,
+        CORD_JSON_TOKEN_STRING,       CORD_JSON_TOKEN_KEY,
+        CORD_JSON_TOKEN_TRUE,         CORD_JSON_TOKEN_KEY,
+        CORD_JSON_TOKEN_FALSE,        CORD_JSON_TOKEN_KEY,
+        CORD_JSON_TOKEN_NULL,         CORD_JSON_TOKEN_KEY,
+        CORD_JSON_TOKEN_ARRAY_START,  CORD_JSON_TOKEN_NUMBER,
+        CORD_JSON_TOKEN_NUMBER,       CORD_JSON_TOKEN_OBJECT_START,
+        CORD_JSON_TOKEN_OBJECT_END,   CORD_JSON_TOKEN_ARRAY_END,
+        CORD_JSON_TOKEN_KEY,          CORD_JSON_TOKEN_ARRAY_START,
+        CORD_JSON_TOKEN_ARRAY_END,    CORD_JSON_TOKEN_OBJECT_END,
+        CORD_JSON_TOKEN_END,
+    };
+
+    size_t count = sizeof(expected) / sizeof(expected[0]);
+    for (size_t i = 0; i < count; i++) {
+        cord_json_token_t token = cord_json_next(&reader);
+        mu_assert_int_eq(expected[i], token.type);
+        if (i == 4) {
+            mu_assert(str_eq(token.value, "READY"), "string value");
+            mu_assert(slice_of(token.value, input),
+                      "unescaped strings should point into the input");
+        }
+        if (i == 14) {
+            f64 number = 0;
+            mu_assert(cord_json_token_to_f64(token, &number), "f64");
+            mu_assert_double_eq(-2500.0, number);
+        }
+    }
+    mu_assert(!cord_json_failed(&reader), "reader should not fail");
+}
+
+MU_TEST(test_json_reader_escapes) {
+    const char *input = "[\"a\\\"b\\\\c\\n\", \"\\u00e9\\ud83d\\ude00\", "
+                        "\"\\udc00x\"]";
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, cstr(input), allocator);
+
+    cord_json_token_t token = cord_json_next(&reader);
+    mu_assert_int_eq(CORD_JSON_TOKEN_ARRAY_START, token.type);
+
+    mu_assert(cord_json_next_item(&reader, &token), "first item");
+    mu_assert(str_eq(token.value, "a\"b\\c\n"), "simple escapes");
+    mu_assert(!slice_of(token.value, input),
+              "escaped strings should be decoded into the allocator");
+
+    mu_assert(cord_json_next_item(&reader, &token), "second item");
+    mu_assert(str_eq(token.value, "\xc3\xa9\xf0\x9f\x98\x80"),
+              "unicode escapes and surrogate pairs");
+
+    mu_assert(cord_json_next_item(&reader, &token), "third item");
+    mu_assert(str_eq(token.value, "\xef\xbf\xbdx"),
+              "lone surrogates become the replacement character");
+
+    mu_assert(!cord_json_next_item(&reader, &token), "end of array");
+    mu_assert_int_eq(CORD_JSON_TOKEN_END, cord_json_next(&reader).type);
+}
+
+MU_TEST(test_json_reader_integers) {
+    const char *input = "[9223372036854775807, -9223372036854775808, "
+                        "9223372036854775808, 1.5]";
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, cstr(input), allocator);
+    cord_json_next(&reader);
+
+    i64 value = 0;
+    cord_json_token_t token = {0};
+    cord_json_next_item(&reader, &token);
+    mu_assert(cord_json_token_to_i64(token, &value), "max i64");
+    mu_assert(value == INT64_MAX, "max i64 value");
+
+    cord_json_next_item(&reader, &token);
+    mu_assert(cord_json_token_to_i64(token, &value), "min i64");
+    mu_assert(value == INT64_MIN, "min i64 value");
+
+    cord_json_next_item(&reader, &token);
+    mu_assert(!cord_json_token_to_i64(token, &value), "overflow");
+
+    cord_json_next_item(&reader, &token);
+    mu_assert(!cord_json_token_to_i64(token, &value), "fraction");
+}
+
+MU_TEST(test_json_reader_skip_and_raw) {
+    const char *input =
+        "{\"a\": {\"b\": [1, {\"c\": \"}\"}]}, \"d\": [true, \"x\"], \"e\": 1}";
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, cstr(input), allocator);
+    cord_json_next(&reader);
+
+    cord_str_t key = {0};
+    mu_assert(cord_json_next_key(&reader, &key), "key a");
+    mu_assert(cord_json_skip(&reader, cord_json_next(&reader)), "skip a");
+
+    mu_assert(cord_json_next_key(&reader, &key), "key d");
+    mu_assert(str_eq(key, "d"), "key d value");
+    cord_str_t raw = cord_json_read_raw(&reader);
+    mu_assert(str_eq(raw, "[true, \"x\"]"), "raw value of d");
+
+    mu_assert(cord_json_next_key(&reader, &key), "key e");
+    mu_assert(str_eq(key, "e"), "key e value");
+
+    // Partially read value is finished where it started
+    i32 depth = reader.depth;
+    mu_assert(cord_json_finish_value(&reader, depth), "finish unread value");
+    mu_assert(!cord_json_next_key(&reader, &key), "end of object");
+    mu_assert_int_eq(CORD_JSON_TOKEN_END, cord_json_next(&reader).type);
+}
+
+MU_TEST(test_json_reader_finish_partial) {
+    const char *input = "{\"d\": {\"x\": [1, 2], \"y\": {\"z\": 3}}, \"s\": 7}";
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, cstr(input), allocator);
+    cord_json_next(&reader);
+
+    cord_str_t key = {0};
+    cord_json_next_key(&reader, &key);
+    i32 depth = reader.depth;
+    cord_json_next(&reader);
+    cord_json_next_key(&reader, &key);
+    cord_json_next(&reader);
+    mu_assert(cord_json_finish_value(&reader, depth), "finish partial value");
+
+    mu_assert(cord_json_next_key(&reader, &key), "next key after d");
+    mu_assert(str_eq(key, "s"), "key s");
+}
+
+MU_TEST(test_json_reader_errors) {
+    const char *invalid[] = {
+        "",           "{",          "{\"a\" 1}",    "{\"a\": 1,}", "[1 2]",
+        "[01]",       "-",          "1.",           "1e",          "tru",
+        "\"abc",      "\"a\\x\"",   "\"\\u12g4\"",  "{1: 2}",      "[1]]",
+        "\"a\tb\"",   "[1, ]",      "{\"a\": [}",
+    };
+
+    size_t count = sizeof(invalid) / sizeof(invalid[0]);
+    for (size_t i = 0; i < count; i++) {
+        cord_json_reader_t reader = {0};
+        cord_json_reader_init(&reader, cstr(invalid[i]), allocator);
+
+        cord_json_token_t token = {0};
+        for (i32 n = 0; n < 16; n++) {
+            token = cord_json_next(&reader);
+            if (token.type == CORD_JSON_TOKEN_END ||
+                token.type == CORD_JSON_TOKEN_ERROR) {
+                break;
+            }
+        }
+        mu_assert(token.type == CORD_JSON_TOKEN_ERROR,
+                  "invalid input should fail");
+        mu_assert(reader.error != NULL, "error message should be set");
+    }
+}
+
+MU_TEST(test_json_reader_depth_limit) {
+    char input[CORD_JSON_MAX_DEPTH + 2] = {0};
+    memset(input, '[', CORD_JSON_MAX_DEPTH + 1);
+
+    cord_json_reader_t reader = {0};
+    cord_json_reader_init(&reader, cstr(input), allocator);
+    cord_json_token_t token = {0};
+    for (i32 i = 0; i <= CORD_JSON_MAX_DEPTH; i++) {
+        token = cord_json_next(&reader);
+    }
+    mu_assert_int_eq(CORD_JSON_TOKEN_ERROR, token.type);
+}
+
+/*
+ * Byte by byte version of what the index computes. Backslashes escape
+ * quotes even outside of strings, where they are invalid anyway.
+ */
+static size_t reference_index(const char *input,
+                              size_t length,
+                              u32 *positions,
+                              size_t *error) {
+    size_t count = 0;
+    bool in_string = false;
+    bool escaped = false;
+    *error = CORD_JSON_INDEX_END;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = input[i];
+        bool after_backslash = escaped;
+        escaped = c == '\\' && !after_backslash;
+
+        if (c == '"' && !after_backslash) {
+            positions[count++] = (u32)i;
+            in_string = !in_string;
+        } else if (in_string) {
+            if ((u8)c < 0x20 && *error == CORD_JSON_INDEX_END) {
+                *error = i;
+            }
+        } else if (strchr("{}[]", c)) {
+            positions[count++] = (u32)i;
+        }
+    }
+    return count;
+}
+
+MU_TEST(test_json_index_matches_reference) {
+    // Long backslash runs so that they cross block boundaries
+    const char alphabet[] = "\"\\\\\\\\{}[]a :,\n";
+    static char input[KB(40)];
+    static u32 expected[KB(40)];
+
+    u32 state = 1;
+    for (size_t i = 0; i < sizeof(input); i++) {
+        state = state * 1103515245 + 12345;
+        input[i] = alphabet[(state >> 16) % (sizeof(alphabet) - 1)];
+    }
+
+    size_t error = 0;
+    size_t count = reference_index(input, sizeof(input), expected, &error);
+    mu_assert(count > CORD_JSON_INDEX_CAPACITY, "input should need refills");
+
+    cord_str_t str = {input, sizeof(input)};
+    for (i32 level = CORD_SIMD_SCALAR; level <= CORD_SIMD_AVX2; level++) {
+        cord_json_index_t index = {0};
+        mu_assert(cord_json_index_init(&index, str, allocator, level),
+                  "index init");
+
+        size_t matched = 0;
+        size_t position = 0;
+        while (matched < count) {
+            size_t next = cord_json_index_next(&index, position);
+            if (next != expected[matched]) {
+                break;
+            }
+            matched++;
+            position = next + 1;
+        }
+        mu_assert_int_eq(count, matched);
+        mu_assert(cord_json_index_next(&index, position) ==
+                      CORD_JSON_INDEX_END,
+                  "no positions past the last one");
+        mu_assert(index.error == error, "first control character in string");
+    }
+}
+
+// Large document with escapes and brackets inside strings
+static char *large_document(size_t *length) {
+    const char *item = "{\"id\": \"%zu\", \"name\": \"a \\\"}]\\\\\", "
+                       "\"tags\": [1, {\"x\": \"[{\"}, []], \"ok\": true},";
+    size_t capacity = KB(256);
+    char *input = balloc(allocator, capacity);
+    size_t used = (size_t)sprintf(input, "{\"items\": [");
+    for (size_t i = 0; used + 256 < capacity; i++) {
+        used += (size_t)sprintf(input + used, item, i);
+    }
+    used--;
+    used += (size_t)sprintf(input + used, "], \"last\": \"end\"}");
+    *length = used;
+    return input;
+}
+
+// Without SIMD init doesn't index on its own
+static void init_indexed(cord_json_reader_t *reader, cord_str_t input) {
+    cord_json_reader_init(reader, input, allocator);
+    if (!reader->index) {
+        cord_json_reader_use_index(reader, CORD_SIMD_SCALAR);
+    }
+}
+
+MU_TEST(test_json_reader_indexed) {
+    size_t length = 0;
+    char *input = large_document(&length);
+    cord_str_t str = {input, (ssize_t)length};
+
+    cord_json_reader_t indexed = {0};
+    cord_json_reader_t plain = {0};
+    init_indexed(&indexed, str);
+    cord_json_reader_init(&plain, str, allocator);
+    mu_assert(indexed.index != NULL, "input should be indexed");
+    plain.index = NULL;
+
+    // Strings found through the index are the same as scanned ones
+    cord_json_token_t a = {0};
+    cord_json_token_t b = {0};
+    do {
+        a = cord_json_next(&indexed);
+        b = cord_json_next(&plain);
+        if (a.type != b.type || !cord_str_equals(a.value, b.value)) {
+            break;
+        }
+    } while (a.type != CORD_JSON_TOKEN_END && a.type != CORD_JSON_TOKEN_ERROR);
+    mu_assert_int_eq(CORD_JSON_TOKEN_END, a.type);
+    mu_assert_int_eq(CORD_JSON_TOKEN_END, b.type);
+
+    // Skipping jumps over the whole array
+    init_indexed(&indexed, str);
+    cord_json_next(&indexed);
+    cord_str_t key = {0};
+    cord_json_next_key(&indexed, &key);
+    cord_json_token_t items = cord_json_next(&indexed);
+    cord_json_next(&indexed);
+    mu_assert(cord_json_finish_value(&indexed, 1), "finish items");
+    mu_assert(cord_json_next_key(&indexed, &key), "key after items");
+    mu_assert(str_eq(key, "last"), "key last");
+    mu_assert(str_eq(cord_json_next(&indexed).value, "end"), "value of last");
+    mu_assert_int_eq(CORD_JSON_TOKEN_ARRAY_START, items.type);
+
+    // Skipped values are still checked for brackets and control characters
+    input[length - 2] = ']';
+    init_indexed(&indexed, str);
+    mu_assert(!cord_json_skip(&indexed, cord_json_next(&indexed)),
+              "mismatched bracket");
+
+    input[length - 2] = '}';
+    input[13] = '\t';
+    init_indexed(&indexed, str);
+    mu_assert(!cord_json_skip(&indexed, cord_json_next(&indexed)),
+              "control character");
+}
+
+MU_TEST(test_json_writer_nesting) {
+    cord_json_writer_t writer = {0};
+    cord_json_writer_init(&writer, allocator);
+
+    cord_json_write_object_start(&writer);
+    cord_json_write_key(&writer, cstr("op"));
+    cord_json_write_integer(&writer, 2);
+    cord_json_write_key(&writer, cstr("d"));
+    cord_json_write_object_start(&writer);
+    cord_json_write_key(&writer, cstr("empty"));
+    cord_json_write_array_start(&writer);
+    cord_json_write_array_end(&writer);
+    cord_json_write_key(&writer, cstr("items"));
+    cord_json_write_array_start(&writer);
+    cord_json_write_bool(&writer, true);
+    cord_json_write_null(&writer);
+    cord_json_write_object_start(&writer);
+    cord_json_write_object_end(&writer);
+    cord_json_write_snowflake(&writer, 175928847299117063);
+    cord_json_write_raw(&writer, cstr("[1,2]"));
+    cord_json_write_array_end(&writer);
+    cord_json_write_object_end(&writer);
+    cord_json_write_object_end(&writer);
+
+    cord_str_t json = cord_json_writer_finish(&writer);
+    mu_assert(str_eq(json,
+                     "{\"op\":2,\"d\":{\"empty\":[],\"items\":[true,null,{},"
+                     "\"175928847299117063\",[1,2]]}}"),
+              "nested output");
+    mu_assert(json.data[json.length] == '\0', "output is terminated");
+}
+
+MU_TEST(test_json_writer_integers) {
+    i64 values[] = {0, 7, -7, 10, 99, 100, -1000, INT64_MAX, INT64_MIN};
+    const char *expected = "[0,7,-7,10,99,100,-1000,9223372036854775807,"
+                           "-9223372036854775808]";
+
+    cord_json_writer_t writer = {0};
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_array_start(&writer);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        cord_json_write_integer(&writer, values[i]);
+    }
+    cord_json_write_array_end(&writer);
+    mu_assert(str_eq(cord_json_writer_finish(&writer), expected), "integers");
+}
+
+static cord_str_t write_string(cord_simd_level_t level, cord_str_t value) {
+    cord_json_writer_t writer = {0};
+    cord_json_writer_init(&writer, allocator);
+    cord_json_writer_use_simd(&writer, level);
+    cord_json_write_string(&writer, value);
+    return cord_json_writer_finish(&writer);
+}
+
+MU_TEST(test_json_writer_escapes) {
+    cord_str_t short_string = cstr("a\"b\\c\n\r\t\b\f\x01/é");
+    mu_assert(str_eq(write_string(CORD_SIMD_SCALAR, short_string),
+                     "\"a\\\"b\\\\c\\n\\r\\t\\b\\f\\u0001/é\""),
+              "escaped string");
+
+    // Every escape position in and across 16 and 32 byte blocks
+    char input[100] = {0};
+    for (size_t i = 0; i < sizeof(input) - 1; i++) {
+        memset(input, 'x', sizeof(input) - 1);
+        input[i] = i % 2 ? '"' : '\x1f';
+        input[sizeof(input) - 2 - i / 2] = '\\';
+        cord_str_t value = cstr(input);
+
+        cord_str_t scalar = write_string(CORD_SIMD_SCALAR, value);
+        cord_str_t sse2 = write_string(CORD_SIMD_SSE2, value);
+        cord_str_t avx2 = write_string(CORD_SIMD_AVX2, value);
+        if (!cord_str_equals(scalar, sse2) || !cord_str_equals(scalar, avx2)) {
+            mu_fail("escaping differs between instruction sets");
+        }
+        if (i == 40) {
+            mu_assert_int_eq((i32)sizeof(input) - 1 + 8, (i32)scalar.length);
+        }
+    }
+}
+
+MU_TEST(test_json_writer_fixed_buffer) {
+    char buffer[16];
+    cord_json_writer_t writer = {0};
+    cord_json_writer_init_buffer(&writer, buffer, sizeof(buffer));
+    cord_json_write_array_start(&writer);
+    cord_json_write_integer(&writer, 12345);
+    cord_json_write_array_end(&writer);
+    mu_assert(str_eq(cord_json_writer_finish(&writer), "[12345]"), "fits");
+
+    cord_json_writer_init_buffer(&writer, buffer, sizeof(buffer));
+    cord_json_write_string(&writer, cstr("longer than the buffer"));
+    mu_assert(cord_json_writer_failed(&writer), "overflow fails");
+    mu_assert(cord_json_writer_finish(&writer).data == NULL, "no output");
+
+    // Output that doesn't fit the first block grows in the allocator
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_array_start(&writer);
+    for (i32 i = 0; i < 1000; i++) {
+        cord_json_write_integer(&writer, i);
+    }
+    cord_json_write_array_end(&writer);
+    cord_str_t json = cord_json_writer_finish(&writer);
+    mu_assert(json.data != NULL, "grown output");
+    cord_str_t end = {json.data + json.length - 9, 9};
+    mu_assert(str_eq(end, ",998,999]"), "end of grown output");
+}
+
+MU_TEST(test_json_writer_misuse) {
+    cord_json_writer_t writer = {0};
+
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_object_start(&writer);
+    cord_json_write_integer(&writer, 1);
+    mu_assert(cord_json_writer_failed(&writer), "value without a key");
+
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_array_start(&writer);
+    cord_json_write_key(&writer, cstr("key"));
+    mu_assert(cord_json_writer_failed(&writer), "key in an array");
+
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_array_start(&writer);
+    cord_json_write_object_end(&writer);
+    mu_assert(cord_json_writer_failed(&writer), "mismatched end");
+
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_object_start(&writer);
+    cord_json_write_key(&writer, cstr("key"));
+    cord_json_write_object_end(&writer);
+    mu_assert(cord_json_writer_failed(&writer), "key without a value");
+
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_integer(&writer, 1);
+    cord_json_write_integer(&writer, 2);
+    mu_assert(cord_json_writer_failed(&writer), "second root value");
+
+    cord_json_writer_init(&writer, allocator);
+    cord_json_write_array_start(&writer);
+    mu_assert(cord_json_writer_finish(&writer).data == NULL, "left open");
+
+    cord_json_writer_init(&writer, allocator);
+    for (i32 i = 0; i <= CORD_JSON_WRITER_MAX_DEPTH; i++) {
+        cord_json_write_array_start(&writer);
+    }
+    mu_assert(cord_json_writer_failed(&writer), "too deep");
+}
+
 MU_TEST_SUITE(test_suite) {
     MU_SUITE_CONFIGURE(&test_setup, &test_teardown);
     MU_RUN_TEST(test_my_assert);
+    MU_RUN_TEST(test_json_reader_tokens);
+    MU_RUN_TEST(test_json_reader_escapes);
+    MU_RUN_TEST(test_json_reader_integers);
+    MU_RUN_TEST(test_json_reader_skip_and_raw);
+    MU_RUN_TEST(test_json_reader_finish_partial);
+    MU_RUN_TEST(test_json_reader_errors);
+    MU_RUN_TEST(test_json_reader_depth_limit);
+    MU_RUN_TEST(test_json_index_matches_reference);
+    MU_RUN_TEST(test_json_reader_indexed);
+    MU_RUN_TEST(test_json_writer_nesting);
+    MU_RUN_TEST(test_json_writer_integers);
+    MU_RUN_TEST(test_json_writer_escapes);
+    MU_RUN_TEST(test_json_writer_fixed_buffer);
+    MU_RUN_TEST(test_json_writer_misuse);
 }
 
 int main(void) {
     MU_RUN_SUITE(test_suite);
     MU_REPORT();
     return MU_EXIT_CODE;
-}
\ No newline at end of file
+}
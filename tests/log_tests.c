@@ -0,0 +1,141 @@
+#include "minunit.h"
+
+#include "../src/core/log.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define LOG_THREADS 4
+#define LOG_RECORDS 200
+
+static void *log_from_thread(void *arg) {
+    i32 thread = *(i32 *)arg;
+    for (i32 i = 0; i < LOG_RECORDS; i++) {
+        logger_info("thread %d record %d", thread, i);
+    }
+    return NULL;
+}
+
+static i32 count_lines(FILE *stream, const char *needle) {
+    char line[1024];
+    i32 count = 0;
+    rewind(stream);
+    while (fgets(line, sizeof(line), stream)) {
+        if (!needle || strstr(line, needle)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+MU_TEST(test_logger_async_threads) {
+    cord_logger_t *previous = global_logger();
+    FILE *stream = tmpfile();
+    cord_logger_t *logger = logger_create(stream, LOG_LEVEL_INFO, false);
+    logger_use(logger);
+    mu_check(logger_start_async(logger, LOG_OVERFLOW_BLOCK));
+
+    pthread_t threads[LOG_THREADS];
+    i32 ids[LOG_THREADS];
+    for (i32 i = 0; i < LOG_THREADS; i++) {
+        ids[i] = i;
+        pthread_create(&threads[i], NULL, log_from_thread, &ids[i]);
+    }
+    for (i32 i = 0; i < LOG_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    logger_flush(logger);
+
+    mu_assert_int_eq(LOG_THREADS * LOG_RECORDS, count_lines(stream, NULL));
+    mu_assert_int_eq(LOG_RECORDS, count_lines(stream, "thread 2 record"));
+    mu_assert_int_eq(1, count_lines(stream, "thread 3 record 199\n"));
+    mu_assert_int_eq(0, (i32)logger_dropped(logger));
+
+    // Records are written synchronously again after stopping
+    logger_stop_async(logger);
+    logger_info("after stopping");
+    fflush(stream);
+    mu_assert_int_eq(1, count_lines(stream, "after stopping"));
+
+    logger_destroy(logger);
+    logger_use(previous);
+}
+
+MU_TEST(test_logger_async_drops_when_full) {
+    cord_logger_t *previous = global_logger();
+    FILE *stream = tmpfile();
+    cord_logger_t *logger = logger_create(stream, LOG_LEVEL_INFO, false);
+    logger_use(logger);
+    mu_check(logger_start_async(logger, LOG_OVERFLOW_DROP));
+
+    char padding[200];
+    memset(padding, 'x', sizeof(padding) - 1);
+    padding[sizeof(padding) - 1] = '\0';
+
+    logger_info("first");
+    // Keep the flusher from making room
+    pthread_mutex_lock(&logger->lock);
+    for (i32 i = 0; i < 1000; i++) {
+        logger_info("%s", padding);
+    }
+    pthread_mutex_unlock(&logger->lock);
+    logger_flush(logger);
+
+    i32 dropped = (i32)logger_dropped(logger);
+    mu_check(dropped > 0 && dropped < 1000);
+    mu_assert_int_eq(1001 - dropped, count_lines(stream, "INFO"));
+    mu_assert_int_eq(1, count_lines(stream, "log records dropped"));
+
+    logger_destroy(logger);
+    logger_use(previous);
+}
+
+MU_TEST(test_logger_async_flushes_on_exit) {
+    i32 fds[2];
+    mu_check(pipe(fds) == 0);
+
+    pid_t child = fork();
+    mu_check(child >= 0);
+    if (child == 0) {
+        close(fds[0]);
+        cord_logger_t *logger =
+            logger_create(fdopen(fds[1], "w"), LOG_LEVEL_INFO, false);
+        logger_use(logger);
+        logger_start_async(logger, LOG_OVERFLOW_DROP);
+        // Like the fatal errors during setup
+        logger_error("Bot token not found");
+        exit(1);
+    }
+
+    close(fds[1]);
+    char output[1024] = {0};
+    size_t length = 0;
+    ssize_t n = 0;
+    while ((n = read(fds[0], output + length, sizeof(output) - 1 - length)) >
+           0) {
+        length += (size_t)n;
+    }
+    close(fds[0]);
+
+    i32 status = 0;
+    waitpid(child, &status, 0);
+    mu_check(WIFEXITED(status) && WEXITSTATUS(status) == 1);
+    mu_check(strstr(output, "Bot token not found\n"));
+}
+
+MU_TEST_SUITE(test_suite) {
+    MU_RUN_TEST(test_logger_async_threads);
+    MU_RUN_TEST(test_logger_async_drops_when_full);
+    MU_RUN_TEST(test_logger_async_flushes_on_exit);
+}
+
+int main(void) {
+    global_logger_init();
+    MU_RUN_SUITE(test_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
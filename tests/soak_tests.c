@@ -0,0 +1,130 @@
+#include "minunit.h"
+
+#include "../src/core/log.h"
+#include "../src/core/memory.h"
+#include "../src/discord/client.h"
+#include "../src/http/ratelimit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Sends messages through cord_client_send_message for a long time, over a
+ * transport that answers every request right away, and checks that the
+ * resident set stops growing once the allocators have warmed up. Anything a
+ * send leaks shows up as growth over millions of them.
+ *
+ * Usage: soak_tests [sends]
+ */
+
+#define SOAK_ALLOWED_GROWTH MB(1)
+
+static size_t num_sends = 2000000;
+
+typedef struct soak_transport_t {
+    f64 now;
+    cord_ratelimit_request_t *pending;
+    size_t sent;
+} soak_transport_t;
+
+static f64 soak_now(void *ctx) {
+    return ((soak_transport_t *)ctx)->now;
+}
+
+static void soak_schedule(void *ctx, f64 at) {
+    (void)ctx;
+    (void)at;
+}
+
+static bool soak_send(void *ctx, cord_ratelimit_request_t *request) {
+    soak_transport_t *transport = ctx;
+    transport->pending = request;
+    transport->sent++;
+    return true;
+}
+
+static size_t resident_bytes(void) {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return 0;
+    }
+
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+MU_TEST(test_soak_send_message) {
+    cord_bump_t *allocator = cord_bump_create_with_size(KB(64));
+    soak_transport_t transport = {.now = 1000.0};
+
+    cord_client_t client = {0};
+    client.persistent_allocator = allocator;
+    client.ratelimit = cord_ratelimit_create(allocator,
+                                             (cord_ratelimit_env_t){
+                                                 .now = soak_now,
+                                                 .schedule = soak_schedule,
+                                                 .send = soak_send,
+                                                 .ctx = &transport,
+                                             });
+    mu_check(client.ratelimit);
+
+    cord_message_t message = {0};
+    message.channel_id = 381870553235193857ull;
+    message.content = cstr("Soaking up every byte a send leaves behind");
+
+    size_t warm = 0;
+    for (size_t i = 0; i < num_sends; i++) {
+        cord_client_send_message(&client, &message);
+
+        cord_ratelimit_request_t *request = transport.pending;
+        transport.pending = NULL;
+        if (request) {
+            cord_ratelimit_complete(client.ratelimit,
+                                    request,
+                                    (cord_http_result_t){.status = 200});
+        }
+
+        // Stay under the global limit of 50 requests per second
+        transport.now += 0.05;
+        if (i == num_sends / 10) {
+            warm = resident_bytes();
+        }
+    }
+
+    size_t end = resident_bytes();
+    printf("\n%zu sends, resident %zuKB after warm up, %zuKB at the end\n",
+           num_sends,
+           warm / KB(1),
+           end / KB(1));
+
+    // Clean up first, a failed assert returns from the test
+    cord_ratelimit_destroy(client.ratelimit);
+    cord_bump_destroy(allocator);
+
+    mu_assert_int_eq(num_sends, transport.sent);
+    mu_assert(warm > 0, "resident set size should be readable");
+    mu_assert(end <= warm + SOAK_ALLOWED_GROWTH,
+              "resident set should stay flat");
+}
+
+MU_TEST_SUITE(test_suite) {
+    MU_RUN_TEST(test_soak_send_message);
+}
+
+int main(int argc, char **argv) {
+    global_logger_init();
+    if (argc > 1) {
+        num_sends = strtoul(argv[1], NULL, 10);
+    }
+
+    MU_RUN_SUITE(test_suite);
+    MU_REPORT();
+    cord_scratch_release();
+    return MU_EXIT_CODE;
+}
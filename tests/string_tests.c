@@ -1,5 +1,7 @@
 #include "minunit.h"
 
+#include "../src/core/intern.h"
+#include "../src/core/snowflake.h"
 #include "../src/core/strings.h"
 #include "../src/core/typedefs.h"
 
@@ -103,7 +105,7 @@ MU_TEST(test_cord_strbuf_create) {
     mu_assert(result == expected,
               "After creation string builder should not be null");
 
-    cord_strbuf_t invalid = (cord_strbuf_t){NULL, 0, 0};
+    cord_strbuf_t invalid = cord_strbuf_null;
     mu_assert(cord_strbuf_valid(&invalid) == false,
               "Passing invalid string builder to cord_strbuf_valid should "
               "return false");
@@ -160,9 +162,134 @@ MU_TEST(test_cord_strbuf_to_cstring) {
     free(edited_cstring);
 }
 
+MU_TEST(test_cord_strbuf_create_in) {
+    cord_bump_t *bump = cord_bump_create_with_size(KB(1));
+    cord_bump_marker_t start = cord_bump_mark(bump);
+
+    cord_strbuf_t *builder = cord_strbuf_create_in(bump, 16);
+    mu_check(builder);
+    char *data = builder->data;
+
+    // Nothing was allocated after the builder, so it grows in place
+    cord_strbuf_append(builder, cstr("Hello world, from an arena"));
+    mu_check(builder->data == data);
+    mu_check(builder->capacity >= 26);
+
+    // Once something else is allocated it moves to new memory
+    balloc(bump, 8);
+    cord_strbuf_append(builder, cstr(", twice as long as it was at first"));
+    mu_check(builder->data != data);
+    mu_assert_string_eq("Hello world, from an arena, twice as long as it was "
+                        "at first",
+                        cord_strbuf_terminate(builder));
+
+    cord_strbuf_t *other = cord_strbuf_create_in(bump, 16);
+    cord_strbuf_append(other, cstr("Hello"));
+    char *cstring = cstring_of(other, bump);
+    mu_assert_string_eq("Hello", cstring);
+
+    // A single restore releases every builder
+    cord_bump_restore(bump, start);
+    mu_assert_int_eq(0, bump->tail->used);
+    cord_bump_destroy(bump);
+}
+
+/*
+ *   Test cases related to cord_snowflake_t
+ */
+MU_TEST(test_cord_snowflake_parse) {
+    mu_check(cord_snowflake_parse(cstr("175928847299117063")) ==
+             175928847299117063ull);
+    mu_check(cord_snowflake_parse(cstr("18446744073709551615")) == UINT64_MAX);
+
+    // Anything that is not a snowflake is 0
+    mu_check(cord_snowflake_parse(cstr("18446744073709551616")) == 0);
+    mu_check(cord_snowflake_parse(cstr("1759288472a")) == 0);
+    mu_check(cord_snowflake_parse(cstr("-1")) == 0);
+    mu_check(cord_snowflake_parse(cstr("")) == 0);
+    mu_check(cord_snowflake_parse((cord_str_t){0}) == 0);
+}
+
+MU_TEST(test_cord_snowflake_format) {
+    char buffer[CORD_SNOWFLAKE_MAX_LENGTH];
+    cord_str_t id = cord_snowflake_format(175928847299117063ull, buffer);
+    mu_check(cord_str_equals(id, cstr("175928847299117063")));
+
+    id = cord_snowflake_format(UINT64_MAX, buffer);
+    mu_check(cord_str_equals(id, cstr("18446744073709551615")));
+
+    id = cord_snowflake_format(0, buffer);
+    mu_check(cord_str_equals(id, cstr("0")));
+}
+
+MU_TEST(test_cord_snowflake_fields) {
+    // The example from the Discord reference
+    cord_snowflake_t id = 175928847299117063ull;
+    mu_check(cord_snowflake_timestamp(id) == 1462015105796ull);
+    mu_assert_int_eq(1, cord_snowflake_worker(id));
+    mu_assert_int_eq(0, cord_snowflake_process(id));
+    mu_assert_int_eq(7, cord_snowflake_sequence(id));
+}
+
 /*
  *   Test cases related to various string utilities
  */
+MU_TEST(test_cord_intern) {
+    cord_interner_t interner = {0};
+    mu_check(cord_interner_init(&interner));
+
+    char name[] = "moderators";
+    cord_intern_t first = cord_intern(&interner, cstr(name));
+    cord_intern_t second = cord_intern(&interner, cstr("moderators"));
+    cord_intern_t other = cord_intern(&interner, cstr("en-US"));
+    mu_check(first != 0);
+    mu_check(first == second);
+    mu_check(first != other);
+    mu_assert_int_eq(0, cord_intern(&interner, cstr("")));
+    mu_assert_int_eq(2, interner.num_strings);
+
+    // Interned strings are copies
+    name[0] = 'M';
+    mu_check(cord_str_equals_cstring(cord_interned(&interner, first),
+                                     "moderators"));
+    mu_assert_int_eq(0, cord_interned(&interner, 0).length);
+
+    cord_intern_release(&interner, first);
+    mu_assert_int_eq(2, interner.num_strings);
+    cord_intern_release(&interner, second);
+    mu_assert_int_eq(1, interner.num_strings);
+
+    // Released handles are reused
+    cord_intern_t replaced = cord_intern_replace(&interner, 0, cstr("fr"));
+    mu_check(replaced == first);
+    replaced = cord_intern_replace(&interner, replaced, cstr("en-US"));
+    mu_check(replaced == other);
+    mu_assert_int_eq(1, interner.num_strings);
+
+    cord_interner_destroy(&interner);
+}
+
+MU_TEST(test_cord_intern_compact) {
+    cord_interner_t interner = {0};
+    mu_check(cord_interner_init(&interner));
+
+    cord_intern_t kept = cord_intern(&interner, cstr("kept"));
+    char buffer[32];
+    for (i32 i = 0; i < 100000; i++) {
+        snprintf(buffer, sizeof(buffer), "nickname %d", i);
+        cord_intern_release(&interner, cord_intern(&interner, cstr(buffer)));
+    }
+
+    // Released strings are dropped instead of piling up
+    mu_assert_int_eq(1, interner.num_strings);
+    mu_check(cord_interner_bytes(&interner) < KB(256));
+    mu_check(
+        cord_str_equals_cstring(cord_interned(&interner, kept), "kept"));
+    mu_check(cord_intern(&interner, cstr("kept")) == kept);
+
+    cord_interner_destroy(&interner);
+}
+
 MU_TEST(test_cstring_is_empty) {
     const char *non_empty_cstring = "my string";
     const char *empty_cstring = "";
@@ -261,6 +388,18 @@ MU_TEST_SUITE(test_string_builder) {
     MU_RUN_TEST(test_cord_strbuf_append);
     MU_RUN_TEST(test_cord_strbuf_to_str);
     MU_RUN_TEST(test_cord_strbuf_to_cstring);
+    MU_RUN_TEST(test_cord_strbuf_create_in);
+}
+
+MU_TEST_SUITE(test_snowflake) {
+    MU_RUN_TEST(test_cord_snowflake_parse);
+    MU_RUN_TEST(test_cord_snowflake_format);
+    MU_RUN_TEST(test_cord_snowflake_fields);
+}
+
+MU_TEST_SUITE(test_intern) {
+    MU_RUN_TEST(test_cord_intern);
+    MU_RUN_TEST(test_cord_intern_compact);
 }
 
 MU_TEST_SUITE(test_string_utils) {
@@ -276,6 +415,8 @@ MU_TEST_SUITE(test_string_utils) {
 int main(void) {
     MU_RUN_SUITE(test_string_slice);
     MU_RUN_SUITE(test_string_builder);
+    MU_RUN_SUITE(test_snowflake);
+    MU_RUN_SUITE(test_intern);
     MU_RUN_SUITE(test_string_utils);
     MU_REPORT();
     return MU_EXIT_CODE;
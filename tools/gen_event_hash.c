@@ -0,0 +1,118 @@
+#include "../src/discord/gateway_events.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Writes src/discord/event_hash.h, the perfect hash of GATEWAY_EVENTS
+ *
+ * Multipliers are drawn from a fixed seed until the slots of every event
+ * are distinct, so the same list always gives the same table. Run through
+ * the event_hash target after changing the list.
+ *
+ * Usage: gen_event_hash [output]
+ */
+
+#define EVENT_HASH_SLOTS 256
+#define MAX_ATTEMPTS 100000000
+
+#define GATEWAY_EVENT_NAME(name, intents) #name,
+
+static const char *event_names[] = {GATEWAY_EVENTS(GATEWAY_EVENT_NAME)};
+static const size_t event_count = sizeof(event_names) / sizeof(char *);
+
+static u64 next_random(u64 *state) {
+    u64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static bool fill_slots(const u64 *keys, u64 multiplier, u8 *slots) {
+    memset(slots, 0, EVENT_HASH_SLOTS);
+    for (size_t i = 0; i < event_count; i++) {
+        u8 slot = gateway_event_slot(keys[i], multiplier);
+        if (slots[slot]) {
+            return false;
+        }
+        slots[slot] = (u8)(i + 1);
+    }
+    return true;
+}
+
+static void write_header(FILE *out, u64 multiplier, const u8 *slots) {
+    fprintf(out,
+            "#ifndef EVENT_HASH_H\n"
+            "#define EVENT_HASH_H\n"
+            "\n"
+            "#include \"../core/typedefs.h\"\n"
+            "\n"
+            "// Generated by tools/gen_event_hash.c from GATEWAY_EVENTS, "
+            "do not edit\n"
+            "\n"
+            "#define EVENT_HASH_EVENT_COUNT %zu\n"
+            "#define EVENT_HASH_MULTIPLIER 0x%016llxULL\n"
+            "\n"
+            "// Event + 1 by slot, 0 is an empty slot\n"
+            "static const u8 event_slots[%d] = {\n",
+            event_count,
+            (unsigned long long)multiplier,
+            EVENT_HASH_SLOTS);
+    for (i32 i = 0; i < EVENT_HASH_SLOTS; i++) {
+        fprintf(out,
+                "%s%2d,%s",
+                i % 16 == 0 ? "    " : " ",
+                slots[i],
+                i % 16 == 15 ? "\n" : "");
+    }
+    fprintf(out, "};\n\n#endif\n");
+}
+
+int main(int argc, char **argv) {
+    if (event_count >= EVENT_HASH_SLOTS) {
+        fprintf(stderr, "%zu events don't fit the table\n", event_count);
+        return 1;
+    }
+
+    u64 keys[sizeof(event_names) / sizeof(char *)];
+    for (size_t i = 0; i < event_count; i++) {
+        size_t length = strlen(event_names[i]);
+        if (length < EVENT_NAME_MIN_LENGTH || length > EVENT_NAME_MAX_LENGTH) {
+            fprintf(stderr, "%s is too short or too long\n", event_names[i]);
+            return 1;
+        }
+        keys[i] = gateway_event_key(event_names[i], length);
+        for (size_t j = 0; j < i; j++) {
+            if (keys[i] == keys[j]) {
+                fprintf(stderr,
+                        "%s and %s have the same key, change "
+                        "gateway_event_key()\n",
+                        event_names[i],
+                        event_names[j]);
+                return 1;
+            }
+        }
+    }
+
+    u8 slots[EVENT_HASH_SLOTS];
+    u64 state = 0;
+    for (i32 attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+        // Odd multipliers keep every bit of the key
+        u64 multiplier = next_random(&state) | 1;
+        if (!fill_slots(keys, multiplier, slots)) {
+            continue;
+        }
+
+        FILE *out = argc > 1 ? fopen(argv[1], "w") : stdout;
+        if (!out) {
+            perror(argv[1]);
+            return 1;
+        }
+        write_header(out, multiplier, slots);
+        return out == stdout || fclose(out) == 0 ? 0 : 1;
+    }
+
+    fprintf(stderr, "No multiplier found in %d attempts\n", MAX_ATTEMPTS);
+    return 1;
+}